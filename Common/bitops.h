@@ -0,0 +1,45 @@
+#ifndef BITOPS_H
+#define BITOPS_H
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Bit counting on board row masks, with the compiler builtins where available
+
+inline int bitCount(uint64_t value)
+{
+#ifdef _MSC_VER
+    return int(__popcnt64(value));
+#else
+    return __builtin_popcountll(value);
+#endif
+}
+
+// Index of the lowest set bit, value must not be 0
+inline int trailingZeros(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return int(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// Index of the highest set bit, value must not be 0
+inline int highestBit(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return int(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+#endif // BITOPS_H
@@ -0,0 +1,86 @@
+#ifndef PERFCOUNTER_H
+#define PERFCOUNTER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Durations histogram: 4 sub-buckets per power of two of nanoseconds
+struct PerfSnapshot
+{
+    static constexpr int NUM_BUCKETS = 160;
+
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t last_ns = 0;
+    std::array<uint64_t, NUM_BUCKETS> buckets{};
+
+    static int bucketOf(uint64_t ns);
+    static uint64_t bucketValue(int bucket);
+
+    double meanMs() const { return count ? total_ns / 1e6 / count : 0.0; }
+    double percentileMs(double fraction) const;
+    PerfSnapshot since(const PerfSnapshot &older) const;
+};
+
+// Lock-free duration counter. Every thread writes into its own shard with
+// relaxed atomics; readers sum the shards. Nothing is recorded while no
+// overlay is shown (see setEnabled()), so the hooks cost a single load.
+class PerfCounter
+{
+public:
+    static constexpr int NUM_SHARDS = 8;
+
+    explicit PerfCounter(const char *name);
+
+    const char *name() const { return name_; }
+    void record(uint64_t ns);
+    PerfSnapshot snapshot() const;
+
+    static bool isEnabled(){ return enabled_users_.load(std::memory_order_relaxed) > 0; }
+    static void setEnabled(bool is_enabled);
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total_ns{0};
+        std::atomic<uint64_t> last_ns{0};
+        std::atomic<uint32_t> buckets[PerfSnapshot::NUM_BUCKETS] = {};
+    };
+
+    static int shardIndex();
+
+    const char *name_;
+    Shard shards_[NUM_SHARDS];
+
+    static std::atomic<int> enabled_users_;
+};
+
+// Measures the lifetime of the scope into a counter, when counters are enabled
+class PerfScope
+{
+public:
+    explicit PerfScope(PerfCounter &counter)
+        : counter_(PerfCounter::isEnabled() ? &counter : nullptr)
+    {
+        if(counter_)
+            start_ = std::chrono::steady_clock::now();
+    }
+
+    ~PerfScope()
+    {
+        if(counter_)
+            counter_->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - start_).count());
+    }
+
+    PerfScope(const PerfScope &) = delete;
+    PerfScope &operator=(const PerfScope &) = delete;
+
+private:
+    PerfCounter *counter_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif // PERFCOUNTER_H
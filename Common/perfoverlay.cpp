@@ -0,0 +1,197 @@
+#include "perfoverlay.h"
+
+#include <algorithm>
+
+// CONSTANT VARIABLE
+const int PerfOverlay::REFRESH_MS = 250;
+const int PerfOverlay::LAG_PROBE_MS = 20;
+const int PerfOverlay::WINDOW_REFRESHES = 8; // 2 s rolling window
+const int PerfOverlay::ROW_HEIGHT = 38;
+const int PerfOverlay::TEXT_HEIGHT = 14;
+const int PerfOverlay::PADDING = 4;
+
+PerfOverlay::PerfOverlay(QWidget *parent)
+    : QWidget(parent)
+    , lag_counter_("loop lag")
+    , next_probe_ms_(0)
+{
+    // Only a display: never steal clicks or focus from the game
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setFocusPolicy(Qt::NoFocus);
+
+    Row lag_row{&lag_counter_, {}, {}};
+    rows_.append(lag_row);
+    resize(240, rows_.size() * ROW_HEIGHT + 2 * PADDING);
+    hide();
+}
+
+PerfOverlay::~PerfOverlay()
+{
+    if(refresh_timer_.isActive())
+        PerfCounter::setEnabled(false);
+}
+
+/**
+ * @brief Adds a counter to the overlay.
+ *
+ * Counters are shown in insertion order, above the event-loop lag measured by the
+ * overlay itself.
+ *
+ * @param counter The counter to show, it must outlive the overlay.
+ */
+void PerfOverlay::addCounter(PerfCounter *counter)
+{
+    Row row{counter, {}, {}};
+    rows_.insert(rows_.size() - 1, row);
+    resize(width(), rows_.size() * ROW_HEIGHT + 2 * PADDING);
+}
+
+/**
+ * @brief Shows the overlay if hidden, hides it otherwise.
+ */
+void PerfOverlay::toggle()
+{
+    setVisible(!isVisible());
+    if(isVisible())
+        raise();
+}
+
+/**
+ * @brief Stops recording and refreshing when the overlay is hidden.
+ *
+ * @param event Pointer to the QHideEvent object.
+ */
+void PerfOverlay::hideEvent(QHideEvent *event)
+{
+    if(refresh_timer_.isActive()){
+        refresh_timer_.stop();
+        lag_probe_timer_.stop();
+        PerfCounter::setEnabled(false);
+    }
+    QWidget::hideEvent(event);
+}
+
+/**
+ * @brief Starts recording, the lag probe and the periodic refresh when the overlay is shown.
+ *
+ * @param event Pointer to the QShowEvent object.
+ */
+void PerfOverlay::showEvent(QShowEvent *event)
+{
+    if(!refresh_timer_.isActive()){
+        PerfCounter::setEnabled(true);
+        for(Row &row : rows_)
+            row.history.clear();
+
+        lag_clock_.start();
+        next_probe_ms_ = LAG_PROBE_MS;
+        lag_probe_timer_.start(LAG_PROBE_MS, Qt::PreciseTimer, this);
+        refresh_timer_.start(REFRESH_MS, this);
+        refreshStats();
+    }
+    QWidget::showEvent(event);
+}
+
+/**
+ * @brief Handles the lag probe and the refresh timers.
+ *
+ * The lag probe expects to run every LAG_PROBE_MS: how late it actually runs is the
+ * time the event loop spent busy with something else.
+ *
+ * @param event Pointer to the QTimerEvent object representing the timer event.
+ */
+void PerfOverlay::timerEvent(QTimerEvent *event)
+{
+    if(event->timerId() == lag_probe_timer_.timerId()){
+        qint64 now = lag_clock_.elapsed();
+        lag_counter_.record(quint64(qMax<qint64>(0, now - next_probe_ms_)) * 1000000);
+        next_probe_ms_ = now + LAG_PROBE_MS;
+    }else if(event->timerId() == refresh_timer_.timerId()){
+        refreshStats();
+        update();
+    }else{
+        QWidget::timerEvent(event);
+    }
+}
+
+/**
+ * @brief Updates the rolling window of every counter.
+ *
+ * Keeps the last WINDOW_REFRESHES snapshots of each counter, the window is the
+ * difference between the newest and the oldest one.
+ */
+void PerfOverlay::refreshStats()
+{
+    for(Row &row : rows_){
+        row.history.append(row.counter->snapshot());
+        if(row.history.size() > WINDOW_REFRESHES + 1)
+            row.history.removeFirst();
+
+        row.window = row.history.last().since(row.history.first());
+    }
+}
+
+/**
+ * @brief Draws, for every counter, its rolling statistics and its histogram.
+ *
+ * @param event Pointer to the QPaintEvent object representing the paint event.
+ */
+void PerfOverlay::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(0, 0, 0, 170));
+
+    QFont font("Monospace", 7);
+    font.setStyleHint(QFont::TypeWriter);
+    painter.setFont(font);
+
+    const double window_s = qMax(1, (rows_.isEmpty() ? 0 : int(rows_.first().history.size()) - 1)) * REFRESH_MS / 1000.0;
+
+    for(int i = 0; i < rows_.size(); ++i){
+        const Row &row = rows_[i];
+        const PerfSnapshot &window = row.window;
+        QRect area(PADDING, PADDING + i * ROW_HEIGHT, width() - 2 * PADDING, ROW_HEIGHT);
+
+        QString text = QString::asprintf("%-9s %6.2fms %5.0f/s\n p50 %6.2fms  p99 %6.2fms",
+                                         row.counter->name(), window.meanMs(), window.count / window_s,
+                                         window.percentileMs(0.5), window.percentileMs(0.99));
+        painter.setPen(Qt::white);
+        painter.drawText(area.adjusted(0, 0, 0, -(ROW_HEIGHT - 2 * TEXT_HEIGHT)), Qt::AlignLeft | Qt::AlignTop, text);
+
+        drawHistogram(painter, QRect(area.left(), area.top() + 2 * TEXT_HEIGHT,
+                                     area.width(), ROW_HEIGHT - 2 * TEXT_HEIGHT - 2), window);
+    }
+}
+
+/**
+ * @brief Draws the duration histogram of a counter, from 1 us (left) to 100 ms (right).
+ *
+ * @param painter Reference to the QPainter object used for drawing.
+ * @param area Where to draw the histogram.
+ * @param snapshot The statistics to draw.
+ */
+void PerfOverlay::drawHistogram(QPainter &painter, const QRect &area, const PerfSnapshot &snapshot)
+{
+    static const int first_bucket = PerfSnapshot::bucketOf(1000);
+    static const int last_bucket = PerfSnapshot::bucketOf(100000000);
+    const int num_buckets = last_bucket - first_bucket + 1;
+
+    painter.fillRect(area, QColor(255, 255, 255, 30));
+
+    uint64_t max_count = 1;
+    for(int b = first_bucket; b <= last_bucket; ++b)
+        max_count = std::max(max_count, snapshot.buckets[b]);
+
+    const qreal bar_width = qreal(area.width()) / num_buckets;
+    for(int b = first_bucket; b <= last_bucket; ++b){
+        if(snapshot.buckets[b] == 0)
+            continue;
+
+        qreal bar_height = qMax(1.0, qreal(area.height()) * snapshot.buckets[b] / max_count);
+        QColor color = PerfSnapshot::bucketValue(b) < 16000000 ? QColor(102, 204, 102) : QColor(204, 102, 102);
+        painter.fillRect(QRectF(area.left() + (b - first_bucket) * bar_width, area.bottom() + 1 - bar_height,
+                                qMax(1.0, bar_width - 1), bar_height), color);
+    }
+}
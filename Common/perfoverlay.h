@@ -0,0 +1,56 @@
+#ifndef PERFOVERLAY_H
+#define PERFOVERLAY_H
+
+#include <QWidget>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QVector>
+
+#include "Common/perfcounter.h"
+
+class PerfOverlay : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PerfOverlay(QWidget *parent = nullptr);
+    ~PerfOverlay();
+
+    void addCounter(PerfCounter *counter);
+
+public slots:
+    void toggle();
+
+protected:
+    void hideEvent(QHideEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void timerEvent(QTimerEvent *event) override;
+
+private:
+    void drawHistogram(QPainter &painter, const QRect &area, const PerfSnapshot &snapshot);
+    void refreshStats();
+
+    struct Row {
+        PerfCounter *counter;
+        QVector<PerfSnapshot> history; // one snapshot per refresh, oldest first
+        PerfSnapshot window;           // what happened in the last WINDOW_REFRESHES
+    };
+
+    QVector<Row> rows_;
+    PerfCounter lag_counter_;
+    QBasicTimer refresh_timer_, lag_probe_timer_;
+    QElapsedTimer lag_clock_;
+    qint64 next_probe_ms_;
+
+    static const int REFRESH_MS;
+    static const int LAG_PROBE_MS;
+    static const int WINDOW_REFRESHES;
+    static const int ROW_HEIGHT;
+    static const int TEXT_HEIGHT;
+    static const int PADDING;
+};
+
+#endif // PERFOVERLAY_H
@@ -0,0 +1,87 @@
+#include "tetrisai.h"
+
+TetrisAi::TetrisAi(const TetrisWeights &weights)
+    : evaluator_(weights)
+{
+}
+
+/**
+ * @brief Chooses the placement of the current piece of an engine.
+ *
+ * @param engine The engine, in between two ticks.
+ * @param best Set to the chosen placement.
+ * @param path Set to the inputs leading to it from the current piece position.
+ * @return true if a placement has been chosen, false if there is no piece to play.
+ */
+bool TetrisAi::choose(const TetrisEngine &engine, TetrisPlacement &best, std::vector<TetrisAction> &path)
+{
+    if(!choose(engine.rows(), engine.width(), engine.height(), engine.currentPiece().shape(),
+                engine.currentX(), engine.currentY(), engine.currentRotation(), best))
+        return false;
+
+    path = generator_.path(best);
+    return true;
+}
+
+/**
+ * @brief Chooses the placement of the current piece of a saved engine state.
+ *
+ * Only reads `state`, so a snapshot taken with TetrisEngine::saveState() can be
+ * searched on another thread while the game goes on.
+ *
+ * @param state The engine state.
+ * @param best Set to the chosen placement.
+ * @param path Set to the inputs leading to it from the current piece position.
+ * @return true if a placement has been chosen, false if there is no piece to play
+ * or the search has been cancelled.
+ */
+bool TetrisAi::choose(const TetrisEngineState &state, TetrisPlacement &best, std::vector<TetrisAction> &path)
+{
+    if(!state.is_started || state.is_lost)
+        return false;
+
+    if(!choose(state.rows.data(), state.width, state.height, state.curr_shape,
+                state.curr_x, state.curr_y, state.curr_rotation, best))
+        return false;
+
+    path = generator_.path(best);
+    return true;
+}
+
+/**
+ * @brief Chooses the best placement of a piece on a board.
+ *
+ * Among placements with the same score, the one with the shortest path is kept.
+ *
+ * @param rows Row masks of the board.
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param shape The shape of the piece.
+ * @param x The x-coordinate of the piece origin.
+ * @param y The y-coordinate of the piece origin.
+ * @param rotation The rotation index of the piece.
+ * @param best Set to the chosen placement; its path is available through path() until the next call.
+ * @return true if a placement has been chosen, false if the piece cannot move at all
+ * or the search has been cancelled.
+ */
+bool TetrisAi::choose(const uint32_t *rows, int width, int height, TetrisShape shape,
+                      int x, int y, int rotation, TetrisPlacement &best)
+{
+    if(cancel_.isCancelled()
+        || generator_.generate(rows, width, height, shape, x, y, rotation, placements_) == 0)
+        return false;
+
+    double best_score = 0.0;
+    for(size_t i = 0; i < placements_.size(); ++i){
+        if(cancel_.isCancelled())
+            return false;
+
+        double score = evaluator_.evaluate(rows, width, height, placements_[i]);
+        // Placements come by path length: the first of equal scores is the shortest
+        if(i == 0 || score > best_score){
+            best_score = score;
+            best = placements_[i];
+        }
+    }
+    return true;
+}
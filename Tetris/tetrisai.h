@@ -0,0 +1,46 @@
+#ifndef TETRISAI_H
+#define TETRISAI_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrisevaluator.h"
+#include "Tetris/tetrismovegenerator.h"
+
+// Cooperative cancellation of a search running on another thread: the search
+// started for `generation` gives up as soon as `current` has moved on.
+struct TetrisSearchCancel
+{
+    const std::atomic<uint64_t> *current = nullptr;
+    uint64_t generation = 0;
+
+    bool isCancelled() const { return current && current->load(std::memory_order_relaxed) != generation; }
+};
+
+// Greedy player: tries every placement of the current piece and keeps the one
+// the evaluator prefers. Not thread-safe: one instance per thread.
+class TetrisAi
+{
+public:
+    explicit TetrisAi(const TetrisWeights &weights = TetrisWeights::elTetris());
+
+    void setCancel(const TetrisSearchCancel &cancel){ cancel_ = cancel; }
+
+    bool choose(const TetrisEngine &engine, TetrisPlacement &best, std::vector<TetrisAction> &path);
+    bool choose(const TetrisEngineState &state, TetrisPlacement &best, std::vector<TetrisAction> &path);
+    bool choose(const uint32_t *rows, int width, int height, TetrisShape shape,
+                int x, int y, int rotation, TetrisPlacement &best);
+    std::vector<TetrisAction> path(const TetrisPlacement &placement) const { return generator_.path(placement); }
+
+    TetrisEvaluator &evaluator(){ return evaluator_; }
+
+private:
+    TetrisMoveGenerator generator_;
+    TetrisEvaluator evaluator_;
+    std::vector<TetrisPlacement> placements_;
+    TetrisSearchCancel cancel_;
+};
+
+#endif // TETRISAI_H
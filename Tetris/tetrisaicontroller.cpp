@@ -0,0 +1,148 @@
+#include "tetrisaicontroller.h"
+
+// CONSTANT VARIABLE
+const double TetrisAiController::MIN_PIECES_PER_SECOND = 0.1;
+const double TetrisAiController::MAX_PIECES_PER_SECOND = 100.0; // one piece per engine tick
+
+TetrisAiController::TetrisAiController(TetrisBoard *board, QObject *parent)
+    : QObject(parent)
+    , board_(board)
+    , is_enabled_(false)
+    , pieces_per_second_(2.0)
+    , last_seed_(0)
+    , last_piece_(-1)
+    , search_generation_(0)
+{
+    search_pool_ = new TetrisSearchPool(this);
+    connect(search_pool_, &TetrisSearchPool::searchFinished, this, &TetrisAiController::handleSearchFinished);
+    connect(board_, &TetrisBoard::gameInterrupted, this, &TetrisAiController::cancelSearch);
+}
+
+TetrisAiController::~TetrisAiController(){}
+
+/**
+ * @brief Cancels the search running for the current piece, if any.
+ *
+ * Called when the game is paused, reset or restarted: the search stops at its next
+ * check and its result is dropped. The piece is searched again once the game goes on.
+ */
+void TetrisAiController::cancelSearch()
+{
+    search_pool_->cancel();
+    search_generation_ = 0;
+}
+
+/**
+ * @brief Lets the AI play the game of the board, or gives it back to the keyboard.
+ *
+ * @param enabled true to let the AI play.
+ */
+void TetrisAiController::setEnabled(bool enabled)
+{
+    if(enabled == is_enabled_)
+        return;
+
+    is_enabled_ = enabled;
+    last_piece_ = -1;
+    if(is_enabled_){
+        restartTimer();
+    }else{
+        timer_.stop();
+        cancelSearch();
+    }
+}
+
+/**
+ * @brief Sets how fast the AI plays.
+ *
+ * @param pieces_per_second Pieces played per second, clamped between MIN_PIECES_PER_SECOND and
+ * MAX_PIECES_PER_SECOND. Gravity can still lock a piece before the AI plays it at low rates.
+ */
+void TetrisAiController::setPiecesPerSecond(double pieces_per_second)
+{
+    pieces_per_second_ = qBound(MIN_PIECES_PER_SECOND, pieces_per_second, MAX_PIECES_PER_SECOND);
+    if(is_enabled_)
+        restartTimer();
+}
+
+void TetrisAiController::restartTimer()
+{
+    timer_.start(qMax(1, qRound(1000.0 / pieces_per_second_)), Qt::PreciseTimer, this);
+}
+
+/**
+ * @brief Searches the current piece at every timer event.
+ *
+ * The AI only plays when the board is running a live game, and plays every piece once.
+ * The search runs in the background, the piece is played when its result comes back.
+ *
+ * @param event The timer event.
+ */
+void TetrisAiController::timerEvent(QTimerEvent *event)
+{
+    if(event->timerId() != timer_.timerId()){
+        QObject::timerEvent(event);
+        return;
+    }
+
+    const bool is_searching = search_generation_ != 0 && search_generation_ == search_pool_->generation();
+    if(board_->isPlaying() && !is_searching && !isPlayed(board_->engine()))
+        startSearch();
+}
+
+/**
+ * @brief Returns whether the current piece of an engine has already been played.
+ *
+ * A piece is identified by the game seed and the number of pieces dropped before it.
+ *
+ * @param engine The engine of the board.
+ * @return true if the inputs of the current piece have been queued already.
+ */
+bool TetrisAiController::isPlayed(const TetrisEngine &engine) const
+{
+    return engine.seed() == last_seed_ && engine.piecesDropped() == last_piece_;
+}
+
+void TetrisAiController::startSearch()
+{
+    search_generation_ = search_pool_->start(board_->engine());
+}
+
+/**
+ * @brief Queues on the board the inputs found by a search.
+ *
+ * The result is dropped if the piece it has been searched for has moved in the
+ * meantime (gravity, keyboard) or is gone: the current piece is searched again.
+ * The path to the placement is queued at once, it is applied at the next tick.
+ *
+ * @param result The result of the search.
+ */
+void TetrisAiController::handleSearchFinished(const TetrisSearchResult &result)
+{
+    if(result.generation != search_generation_)
+        return;
+    search_generation_ = 0;
+
+    if(!is_enabled_ || !board_->isPlaying())
+        return;
+
+    const TetrisEngine &engine = board_->engine();
+    const bool is_same_piece = engine.seed() == result.seed && engine.piecesDropped() == result.piece
+                               && engine.currentX() == result.x && engine.currentY() == result.y
+                               && engine.currentRotation() == result.rotation;
+    if(!is_same_piece){
+        if(!isPlayed(engine))
+            startSearch();
+        return;
+    }
+
+    if(!result.is_found)
+        return;
+
+    for(TetrisAction action : result.path){
+        if(!board_->pushInput(action))
+            break;
+    }
+    last_seed_ = engine.seed();
+    last_piece_ = engine.piecesDropped();
+}
@@ -0,0 +1,52 @@
+#ifndef TETRISAICONTROLLER_H
+#define TETRISAICONTROLLER_H
+
+#include <QObject>
+#include <QBasicTimer>
+#include <QTimerEvent>
+
+#include "Tetris/tetrisboard.h"
+#include "Tetris/tetrissearchpool.h"
+
+class TetrisAiController : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TetrisAiController(TetrisBoard *board, QObject *parent = nullptr);
+    ~TetrisAiController();
+
+    bool isEnabled() const { return is_enabled_; }
+    double piecesPerSecond() const { return pieces_per_second_; }
+
+public slots:
+    void cancelSearch();
+    void setEnabled(bool enabled);
+    void setPiecesPerSecond(double pieces_per_second);
+
+protected:
+    void timerEvent(QTimerEvent *event) override;
+
+private slots:
+    void handleSearchFinished(const TetrisSearchResult &result);
+
+private:
+    bool isPlayed(const TetrisEngine &engine) const;
+    void restartTimer();
+    void startSearch();
+
+    TetrisBoard *board_;
+    TetrisSearchPool *search_pool_;
+    bool is_enabled_;
+    double pieces_per_second_;
+    quint64 last_seed_;
+    int last_piece_; // pieces dropped when the last piece was played, -1 for none
+    quint64 search_generation_; // search running for the current piece, 0 for none
+
+    QBasicTimer timer_;
+
+    static const double MIN_PIECES_PER_SECOND;
+    static const double MAX_PIECES_PER_SECOND;
+};
+
+#endif // TETRISAICONTROLLER_H
@@ -0,0 +1,163 @@
+#include "tetrisanimation.h"
+
+#include <algorithm>
+
+// CONSTANT VARIABLE
+const int TetrisAnimationTimeline::CLEAR_FLASH_MS = 120;
+const int TetrisAnimationTimeline::ROW_COLLAPSE_MS = 150;
+const int TetrisAnimationTimeline::LOCK_POP_MS = 140;
+
+TetrisAnimationTimeline::TetrisAnimationTimeline()
+    : has_line_clear_(false)
+    , has_lock_(false)
+    , line_clear_start_ms_(0)
+    , lock_start_ms_(0)
+    , line_clear_()
+    , lock_()
+{
+}
+
+/**
+ * @brief Drops the animations that are over.
+ *
+ * Called from the engine tick, no dedicated timer is used for the animations.
+ *
+ * @param now_ms Current time in milliseconds.
+ * @return true if some animation is still running, false otherwise.
+ */
+bool TetrisAnimationTimeline::advance(qint64 now_ms)
+{
+    if(has_line_clear_ && now_ms - line_clear_start_ms_ >= CLEAR_FLASH_MS + ROW_COLLAPSE_MS)
+        has_line_clear_ = false;
+
+    if(has_lock_ && now_ms - lock_start_ms_ >= LOCK_POP_MS)
+        has_lock_ = false;
+
+    return isActive();
+}
+
+/**
+ * @brief Stops all the animations.
+ */
+void TetrisAnimationTimeline::clear()
+{
+    has_line_clear_ = false;
+    has_lock_ = false;
+}
+
+/**
+ * @brief Starts the clear flash and the row collapse of a line clear.
+ *
+ * The removed rows flash first, then the rows above slide down to their new place.
+ * A line clear replaces the one still running, if any, and cancels the lock pop
+ * (the locked squares have moved with the collapse).
+ *
+ * @param line_clear The rows removed by the engine.
+ * @param now_ms Current time in milliseconds.
+ */
+void TetrisAnimationTimeline::startLineClear(const TetrisLineClear &line_clear, qint64 now_ms)
+{
+    if(line_clear.count <= 0)
+        return;
+
+    line_clear_ = line_clear;
+    line_clear_start_ms_ = now_ms;
+    has_line_clear_ = true;
+    has_lock_ = false;
+}
+
+/**
+ * @brief Starts the lock pop on the squares of the piece just locked.
+ *
+ * @param lock The squares written by the engine.
+ * @param now_ms Current time in milliseconds.
+ */
+void TetrisAnimationTimeline::startLock(const TetrisLock &lock, qint64 now_ms)
+{
+    lock_ = lock;
+    lock_start_ms_ = now_ms;
+    has_lock_ = true;
+}
+
+/**
+ * @brief Returns the topmost board row touched by a running animation.
+ *
+ * The row collapse moves every row above the lowest removed one, so the whole top
+ * part of the board is animated while it runs.
+ *
+ * @return The first animated row, or -1 if no animation is running.
+ */
+int TetrisAnimationTimeline::firstAnimatedRow() const
+{
+    if(has_line_clear_)
+        return 0;
+
+    if(has_lock_)
+        return *std::min_element(lock_.y, lock_.y + 4);
+
+    return -1;
+}
+
+/**
+ * @brief Returns the lowest board row touched by a running animation.
+ *
+ * @return The last animated row, or -1 if no animation is running.
+ */
+int TetrisAnimationTimeline::lastAnimatedRow() const
+{
+    int row = -1;
+    if(has_line_clear_)
+        row = line_clear_.rows[line_clear_.count - 1];
+
+    if(has_lock_)
+        row = std::max(row, *std::max_element(lock_.y, lock_.y + 4));
+
+    return row;
+}
+
+/**
+ * @brief Progress of the row collapse, eased out.
+ *
+ * @param now_ms Current time in milliseconds.
+ * @return 0 while the removed rows are flashing, then up to 1 when the rows above have landed.
+ */
+qreal TetrisAnimationTimeline::collapseProgress(qint64 now_ms) const
+{
+    qreal t = progress(now_ms, line_clear_start_ms_ + CLEAR_FLASH_MS, ROW_COLLAPSE_MS);
+    return 1.0 - (1.0 - t) * (1.0 - t);
+}
+
+/**
+ * @brief Progress of the flash of the removed rows.
+ *
+ * @param now_ms Current time in milliseconds.
+ * @return A value from 0 (flash start) to 1 (flash over).
+ */
+qreal TetrisAnimationTimeline::flashProgress(qint64 now_ms) const
+{
+    return progress(now_ms, line_clear_start_ms_, CLEAR_FLASH_MS);
+}
+
+/**
+ * @brief Progress of the lock pop.
+ *
+ * @param now_ms Current time in milliseconds.
+ * @return A value from 0 (piece just locked) to 1 (pop over).
+ */
+qreal TetrisAnimationTimeline::lockProgress(qint64 now_ms) const
+{
+    return progress(now_ms, lock_start_ms_, LOCK_POP_MS);
+}
+
+/**
+ * @brief Linear progress of an animation step, clamped to [0, 1].
+ *
+ * @param now_ms Current time in milliseconds.
+ * @param start_ms Start time of the step.
+ * @param duration_ms Duration of the step.
+ * @return The progress of the step.
+ */
+qreal TetrisAnimationTimeline::progress(qint64 now_ms, qint64 start_ms, int duration_ms)
+{
+    return std::clamp(qreal(now_ms - start_ms) / duration_ms, qreal(0), qreal(1));
+}
@@ -0,0 +1,46 @@
+#ifndef TETRISANIMATION_H
+#define TETRISANIMATION_H
+
+#include <QtGlobal>
+
+#include "Tetris/tetrisengine.h"
+
+// Visual-only effects started from engine events. The engine has already
+// applied the lock/clear when an animation starts: the timeline only keeps
+// what is needed to interpolate the old look into the new one.
+class TetrisAnimationTimeline
+{
+public:
+    static const int CLEAR_FLASH_MS;
+    static const int ROW_COLLAPSE_MS;
+    static const int LOCK_POP_MS;
+
+    TetrisAnimationTimeline();
+
+    bool advance(qint64 now_ms);
+    void clear();
+    void startLineClear(const TetrisLineClear &line_clear, qint64 now_ms);
+    void startLock(const TetrisLock &lock, qint64 now_ms);
+
+    bool isActive() const { return has_line_clear_ || has_lock_; }
+    bool hasLineClear() const { return has_line_clear_; }
+    bool hasLock() const { return has_lock_; }
+    const TetrisLineClear &lineClear() const { return line_clear_; }
+    const TetrisLock &lock() const { return lock_; }
+    int firstAnimatedRow() const;
+    int lastAnimatedRow() const;
+
+    qreal collapseProgress(qint64 now_ms) const;
+    qreal flashProgress(qint64 now_ms) const;
+    qreal lockProgress(qint64 now_ms) const;
+
+private:
+    static qreal progress(qint64 now_ms, qint64 start_ms, int duration_ms);
+
+    bool has_line_clear_, has_lock_;
+    qint64 line_clear_start_ms_, lock_start_ms_;
+    TetrisLineClear line_clear_;
+    TetrisLock lock_;
+};
+
+#endif // TETRISANIMATION_H
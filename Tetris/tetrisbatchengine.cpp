@@ -0,0 +1,842 @@
+#include "tetrisbatchengine.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Common/bitops.h"
+#include "Tetris/tetrispiece.h"
+#include "Tetris/tetriszobrist.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TETRIS_BATCH_X86
+#include <immintrin.h>
+#endif
+
+// GCC and Clang only accept the intrinsics in functions built for their instruction
+// set; MSVC accepts them anywhere
+#if defined(TETRIS_BATCH_X86) && defined(__GNUC__)
+#define TETRIS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TETRIS_TARGET_AVX2
+#endif
+
+// The kernels keep their short arrays of registers out of memory only once their
+// loops are unrolled, which GCC does not do at -O2
+#if defined(__GNUC__)
+#define TETRIS_UNROLL _Pragma("GCC unroll 8")
+#else
+#define TETRIS_UNROLL
+#endif
+
+namespace {
+
+const int LANES = TetrisBatchEngine::LANES;
+
+// Squares of a piece are at most 2 rows and columns away from its origin
+const int WINDOW = 5;
+
+// The piece of every shape and rotation index, rotating right as the engine does,
+// 8 shapes in one AVX2 register where each lane picks the entry of its shape
+// with a permute:
+// - rows[(rotation * WINDOW + i) * 8 + shape] is row i - 2 of the piece, bit
+//   dx + 2 set for a square in column dx;
+// - squares[rotation * 8 + shape] packs the four squares, byte k being
+//   dx + 2 | (dy + 2) << 4 of square k, the lowest squares first.
+struct PieceTable {
+    alignas(32) uint32_t rows[4 * WINDOW * 8];
+    alignas(32) uint32_t squares[4 * 8];
+    alignas(32) int32_t spawn_y[8];                 // see TetrisEngine::spawnY()
+
+    PieceTable()
+    {
+        std::fill(rows, rows + 4 * WINDOW * 8, 0u);
+        std::fill(squares, squares + 4 * 8, 0u);
+        spawn_y[NoShape] = 0;
+        for(int s = 1; s < 8; ++s){
+            spawn_y[s] = TetrisEngine::spawnY(TetrisShape(s));
+            TetrisPiece piece;
+            piece.setShape(TetrisShape(s));
+            for(int r = 0; r < 4; ++r){
+                int order[4] = {0, 1, 2, 3};
+                std::sort(order, order + 4, [&piece](int a, int b){ return piece.y(a) > piece.y(b); });
+                for(int k = 0; k < 4; ++k){
+                    const int dx = piece.x(order[k]), dy = piece.y(order[k]);
+                    rows[index(r, dy + 2, s)] |= 1u << (dx + 2);
+                    squares[r * 8 + s] |= uint32_t((dx + 2) | (dy + 2) << 4) << (8 * k);
+                }
+                piece = piece.rotatedRight();
+            }
+        }
+    }
+
+    static int index(int rotation, int i, int shape){ return (rotation * WINDOW + i) * 8 + shape; }
+    static int squareX(uint32_t squares, int k){ return int(squares >> (8 * k) & 15) - 2; }
+    static int squareY(uint32_t squares, int k){ return int(squares >> (8 * k + 4) & 15) - 2; }
+};
+
+const PieceTable PIECE_TABLE;
+
+/*
+ * One tick of a block, split in two kernels around the rare cases step() leaves
+ * to the scalar code (line clears, level ups, lost games, gravity of one tick):
+ * - lockBlock plays the move of every lane: the rotations then the moves, each
+ *   stopping at the first blocked one like the engine does, and the drop. A
+ *   position fits when the piece masks, shifted to the origin column, do not
+ *   overlap the WINDOW rows around the origin row: the walls and the filled rows
+ *   around the board make every test a plain AND. The drop comes from the column
+ *   tops, the piece falling until one of its lowest squares lands on a top; when
+ *   a top is above a square of the piece (an overhang) the lane falls row by row.
+ *   The piece is then written into the rows and tops, and the counters updated.
+ * - spawnBlock moves the next piece up, draws the new next piece and tests the
+ *   spawn position.
+ */
+struct BlockStep {
+    // The arrays of the block, see TetrisBatchEngine
+    uint32_t *rows;
+    int32_t *tops;
+    const uint8_t *status;
+    int32_t *shape, *next_shape, *y, *score, *pieces, *level_pieces;
+    const int32_t *gravity_ticks;
+    uint64_t *random_state;
+
+    const TetrisBatchMove *moves;
+    int width, spawn_x;
+
+    int32_t is_playing[LANES];          // -1 for a running board, 0 for a lane to skip
+    int32_t land_y[LANES];              // origin row of the locked piece
+    int32_t full_rows[LANES];           // bit i for a full row land_y + i - 2
+    int finish;                         // lanes with a full row or a level up
+    int lost;                           // lanes whose new piece has no space
+    int falling;                        // lanes whose new piece the gravity moves at once
+};
+
+// Origin row a piece falls to from row y, with its masks in the WINDOW rows around the origin
+int dropScalar(const uint32_t *rows, int lane, const uint32_t *masks, int y)
+{
+    for(;; ++y){
+        uint32_t overlap = 0;
+        for(int i = 0; i < WINDOW; ++i)
+            overlap |= rows[(y + 1 + i) * LANES + lane] & masks[i];
+        if(overlap)
+            return y;
+    }
+}
+
+void lockBlockScalar(BlockStep &step)
+{
+    step.finish = 0;
+    for(int lane = 0; lane < LANES; ++lane){
+        step.full_rows[lane] = 0;
+        step.is_playing[lane] = step.status[lane] == TetrisBatchEngine::RunningStatus ? -1 : 0;
+        if(!step.is_playing[lane])
+            continue;
+
+        // Out of the walls, every move further is blocked anyway
+        const int target_rotation = step.moves[lane].rotation & 3;
+        const int target_x = std::clamp(step.moves[lane].x, -2, step.width + 1);
+
+        const int shape = step.shape[lane], y = step.y[lane];
+        uint32_t window[WINDOW], masks[WINDOW], candidate[WINDOW];
+        for(int i = 0; i < WINDOW; ++i){
+            window[i] = step.rows[(y + i) * LANES + lane];
+            masks[i] = PIECE_TABLE.rows[PieceTable::index(0, i, shape)] << step.spawn_x;
+        }
+        auto fits = [&](){
+            uint32_t overlap = 0;
+            for(int i = 0; i < WINDOW; ++i)
+                overlap |= window[i] & candidate[i];
+            return overlap == 0;
+        };
+
+        int rotation = 0, x = step.spawn_x;
+        while(rotation < target_rotation){
+            for(int i = 0; i < WINDOW; ++i)
+                candidate[i] = PIECE_TABLE.rows[PieceTable::index(rotation + 1, i, shape)] << x;
+            if(!fits())
+                break;
+            std::copy(candidate, candidate + WINDOW, masks);
+            ++rotation;
+        }
+        while(x != target_x){
+            const bool is_left = target_x < x;
+            for(int i = 0; i < WINDOW; ++i)
+                candidate[i] = is_left ? masks[i] >> 1 : masks[i] << 1;
+            if(!fits())
+                break;
+            std::copy(candidate, candidate + WINDOW, masks);
+            x += is_left ? -1 : 1;
+        }
+
+        const uint32_t squares = PIECE_TABLE.squares[rotation * 8 + shape];
+        int32_t *tops = step.tops + (x + 2) * LANES + lane;
+        int land_y = INT32_MAX;
+        bool is_under = false;
+        for(int k = 0; k < 4; ++k){
+            const int top = tops[PieceTable::squareX(squares, k) * LANES], dy = PieceTable::squareY(squares, k);
+            land_y = std::min(land_y, top - dy - 1);
+            is_under |= top <= y + dy;
+        }
+        if(is_under)
+            land_y = dropScalar(step.rows, lane, masks, y);
+
+        int full_rows = 0;
+        for(int i = 0; i < WINDOW; ++i){
+            uint32_t &row = step.rows[(land_y + i) * LANES + lane];
+            row |= masks[i];
+            full_rows |= ((masks[i] != 0) & (row == ~0u)) << i;
+        }
+        for(int k = 0; k < 4; ++k){
+            int32_t &top = tops[PieceTable::squareX(squares, k) * LANES];
+            top = std::min(top, land_y + PieceTable::squareY(squares, k));
+        }
+
+        ++step.pieces[lane];
+        step.score[lane] += 10;
+        --step.level_pieces[lane];
+        step.land_y[lane] = land_y;
+        step.full_rows[lane] = full_rows;
+        if(full_rows || step.level_pieces[lane] == 0)
+            step.finish |= 1 << lane;
+    }
+}
+
+void spawnBlockScalar(BlockStep &step)
+{
+    step.lost = 0;
+    step.falling = 0;
+    for(int lane = 0; lane < LANES; ++lane){
+        if(!step.is_playing[lane])
+            continue;
+
+        TetrisRandom generator;
+        generator.setState(step.random_state[lane]);
+        const int shape = step.next_shape[lane];
+        const int y = PIECE_TABLE.spawn_y[shape];
+        step.shape[lane] = shape;
+        step.next_shape[lane] = generator.bounded(1, 8);
+        step.random_state[lane] = generator.state();
+        step.y[lane] = y;
+
+        uint32_t overlap = 0;
+        for(int i = 0; i < WINDOW; ++i)
+            overlap |= step.rows[(y + i) * LANES + lane] & (PIECE_TABLE.rows[PieceTable::index(0, i, shape)] << step.spawn_x);
+        if(overlap)
+            step.lost |= 1 << lane;
+        else if(step.gravity_ticks[lane] <= 1)
+            step.falling |= 1 << lane;
+    }
+}
+
+#ifdef TETRIS_BATCH_X86
+
+TETRIS_TARGET_AVX2 inline __m256i loadAvx2(const int32_t *values)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values));
+}
+
+TETRIS_TARGET_AVX2 inline void storeAvx2(int32_t *values, __m256i value)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(values), value);
+}
+
+// Entry of a PieceTable array for the shape of every lane
+TETRIS_TARGET_AVX2 inline __m256i lookupAvx2(const void *entries, __m256i shape)
+{
+    return _mm256_permutevar8x32_epi32(_mm256_load_si256(static_cast<const __m256i *>(entries)), shape);
+}
+
+// The WINDOW rows of every lane from row `index` / LANES of the block
+TETRIS_TARGET_AVX2 inline void gatherRowsAvx2(const uint32_t *rows, __m256i index, __m256i *window)
+{
+    TETRIS_UNROLL
+    for(int i = 0; i < WINDOW; ++i)
+        window[i] = _mm256_i32gather_epi32(reinterpret_cast<const int *>(rows),
+                                           _mm256_add_epi32(index, _mm256_set1_epi32(i * LANES)), 4);
+}
+
+TETRIS_TARGET_AVX2 inline __m256i overlapAvx2(const __m256i *window, const __m256i *masks)
+{
+    __m256i overlap = _mm256_and_si256(window[0], masks[0]);
+    TETRIS_UNROLL
+    for(int i = 1; i < WINDOW; ++i)
+        overlap = _mm256_or_si256(overlap, _mm256_and_si256(window[i], masks[i]));
+    return overlap;
+}
+
+// Index of the only bit set in every lane, exact through the float exponent
+TETRIS_TARGET_AVX2 inline __m256i bitIndexAvx2(__m256i bit)
+{
+    const __m256i exponent = _mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(bit)), 23);
+    return _mm256_sub_epi32(_mm256_and_si256(exponent, _mm256_set1_epi32(0xff)), _mm256_set1_epi32(127));
+}
+
+TETRIS_TARGET_AVX2 inline int laneMask(__m256i value)
+{
+    return _mm256_movemask_ps(_mm256_castsi256_ps(value));
+}
+
+// Same as lockBlockScalar(). The rotations step the lanes together, a lane that
+// reached its target or got blocked keeping its rotation while the others go on;
+// the moves of all the columns are tested at once. The writes to the rows and
+// tops of each lane go through memory, AVX2 has no scatter.
+TETRIS_TARGET_AVX2 void lockBlockAvx2(BlockStep &step)
+{
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+
+    const __m256i status = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(step.status)));
+    const __m256i is_playing = _mm256_cmpeq_epi32(status, _mm256_set1_epi32(TetrisBatchEngine::RunningStatus));
+    storeAvx2(step.is_playing, is_playing);
+
+    // The moves are pairs (rotation, x): split the two halves, then their rotations and columns
+    const __m256i pairs = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i low_moves = _mm256_permutevar8x32_epi32(loadAvx2(&step.moves[0].rotation), pairs);
+    const __m256i high_moves = _mm256_permutevar8x32_epi32(loadAvx2(&step.moves[LANES / 2].rotation), pairs);
+    const __m256i target_rotation = _mm256_and_si256(_mm256_and_si256(_mm256_permute2x128_si256(low_moves, high_moves, 0x20),
+                                                                      _mm256_set1_epi32(3)), is_playing);
+    __m256i target_x = _mm256_permute2x128_si256(low_moves, high_moves, 0x31);
+    target_x = _mm256_min_epi32(_mm256_max_epi32(target_x, _mm256_set1_epi32(-2)), _mm256_set1_epi32(step.width + 1));
+
+    const __m256i shape = _mm256_and_si256(loadAvx2(step.shape), is_playing);
+    const __m256i y = _mm256_and_si256(loadAvx2(step.y), is_playing);
+    __m256i x = _mm256_set1_epi32(step.spawn_x);
+
+    __m256i window[WINDOW], masks[WINDOW], candidate[WINDOW];
+    gatherRowsAvx2(step.rows, _mm256_add_epi32(_mm256_slli_epi32(y, 3), lanes), window);
+    TETRIS_UNROLL
+    for(int i = 0; i < WINDOW; ++i)
+        masks[i] = _mm256_sllv_epi32(lookupAvx2(PIECE_TABLE.rows + PieceTable::index(0, i, 0), shape), x);
+
+    __m256i squares = lookupAvx2(PIECE_TABLE.squares, shape);
+    __m256i blocked = zero;
+    TETRIS_UNROLL
+    for(int r = 1; r < 4; ++r){
+        const __m256i wanted = _mm256_andnot_si256(blocked, _mm256_cmpgt_epi32(target_rotation, _mm256_set1_epi32(r - 1)));
+        if(_mm256_testz_si256(wanted, wanted))
+            break;
+        TETRIS_UNROLL
+        for(int i = 0; i < WINDOW; ++i)
+            candidate[i] = _mm256_sllv_epi32(lookupAvx2(PIECE_TABLE.rows + PieceTable::index(r, i, 0), shape), x);
+        const __m256i fit = _mm256_cmpeq_epi32(overlapAvx2(window, candidate), zero);
+        const __m256i moved = _mm256_and_si256(wanted, fit);
+        TETRIS_UNROLL
+        for(int i = 0; i < WINDOW; ++i)
+            masks[i] = _mm256_blendv_epi8(masks[i], candidate[i], moved);
+        squares = _mm256_blendv_epi8(squares, lookupAvx2(PIECE_TABLE.squares + r * 8, shape), moved);
+        blocked = _mm256_or_si256(blocked, _mm256_andnot_si256(fit, wanted));
+    }
+
+    __m256i square_x[4], square_y[4];
+    TETRIS_UNROLL
+    for(int k = 0; k < 4; ++k){
+        const __m256i square = _mm256_srli_epi32(squares, 8 * k);
+        square_x[k] = _mm256_sub_epi32(_mm256_and_si256(square, _mm256_set1_epi32(15)), _mm256_set1_epi32(2));
+        square_y[k] = _mm256_sub_epi32(_mm256_and_si256(_mm256_srli_epi32(square, 4), _mm256_set1_epi32(15)),
+                                       _mm256_set1_epi32(2));
+    }
+
+    // The moves at once: bit p of `blocked` is set when the piece does not fit at
+    // column p - 2, from the row of each square shifted by its column. The piece
+    // stops before the first blocked column on its way to the target.
+    blocked = zero;
+    TETRIS_UNROLL
+    for(int k = 0; k < 4; ++k){
+        const __m256i row_index = _mm256_add_epi32(_mm256_slli_epi32(_mm256_add_epi32(y, square_y[k]), 3), lanes);
+        const __m256i row = _mm256_i32gather_epi32(reinterpret_cast<const int *>(step.rows),
+                                                   _mm256_add_epi32(row_index, _mm256_set1_epi32(2 * LANES)), 4);
+        // A negative count shifts everything out
+        blocked = _mm256_or_si256(blocked, _mm256_or_si256(_mm256_srlv_epi32(row, square_x[k]),
+                                                           _mm256_sllv_epi32(row, _mm256_sub_epi32(zero, square_x[k]))));
+    }
+    const __m256i start = _mm256_add_epi32(x, _mm256_set1_epi32(2));
+    const __m256i end = _mm256_blendv_epi8(start, _mm256_add_epi32(target_x, _mm256_set1_epi32(2)), is_playing);
+    const __m256i is_right = _mm256_cmpgt_epi32(end, start);
+    const __m256i low = _mm256_min_epi32(start, end), high = _mm256_max_epi32(start, end);
+    // Bits low to high, high being 31 at most
+    const __m256i path = _mm256_sub_epi32(_mm256_sllv_epi32(_mm256_set1_epi32(2), high), _mm256_sllv_epi32(one, low));
+    const __m256i stops = _mm256_and_si256(_mm256_and_si256(blocked, path), is_playing);
+    // First stop on the right, last one on the left: without two bits in a row, the
+    // float conversion cannot round up to the next power of two
+    const __m256i first_stop = _mm256_and_si256(stops, _mm256_sub_epi32(zero, stops));
+    const __m256i last_stops = _mm256_andnot_si256(_mm256_srli_epi32(stops, 1), stops);
+    const __m256i stop = _mm256_blendv_epi8(_mm256_add_epi32(bitIndexAvx2(last_stops), one),
+                                            _mm256_sub_epi32(bitIndexAvx2(first_stop), one), is_right);
+    const __m256i position = _mm256_blendv_epi8(stop, end, _mm256_cmpeq_epi32(stops, zero));
+    const __m256i left_shift = _mm256_sub_epi32(start, position);
+    const __m256i right_shift = _mm256_sub_epi32(position, start);
+    TETRIS_UNROLL
+    for(int i = 0; i < WINDOW; ++i)
+        masks[i] = _mm256_or_si256(_mm256_srlv_epi32(masks[i], left_shift), _mm256_sllv_epi32(masks[i], right_shift));
+    x = _mm256_sub_epi32(position, _mm256_set1_epi32(2));
+
+    __m256i top_index[4], column_tops[4];
+    __m256i land_y = _mm256_set1_epi32(INT32_MAX);
+    __m256i is_under = zero;
+    TETRIS_UNROLL
+    for(int k = 0; k < 4; ++k){
+        top_index[k] = _mm256_add_epi32(_mm256_slli_epi32(_mm256_add_epi32(x, square_x[k]), 3), lanes);
+        column_tops[k] = _mm256_i32gather_epi32(step.tops, _mm256_add_epi32(top_index[k], _mm256_set1_epi32(2 * LANES)), 4);
+        land_y = _mm256_min_epi32(land_y, _mm256_sub_epi32(_mm256_sub_epi32(column_tops[k], square_y[k]), one));
+        is_under = _mm256_or_si256(is_under, _mm256_cmpgt_epi32(_mm256_add_epi32(_mm256_add_epi32(y, square_y[k]), one),
+                                                                column_tops[k]));
+    }
+    land_y = _mm256_blendv_epi8(y, land_y, is_playing);
+
+    alignas(32) int32_t indices[4][LANES];
+    alignas(32) uint32_t values[WINDOW][LANES];
+    const int under = laneMask(_mm256_and_si256(is_under, is_playing));
+    if(under){
+        for(int i = 0; i < WINDOW; ++i)
+            _mm256_store_si256(reinterpret_cast<__m256i *>(values[i]), masks[i]);
+        storeAvx2(step.land_y, land_y);
+        for(int lane = 0; lane < LANES; ++lane){
+            if(under & (1 << lane)){
+                const uint32_t lane_masks[WINDOW] = {values[0][lane], values[1][lane], values[2][lane],
+                                                     values[3][lane], values[4][lane]};
+                step.land_y[lane] = dropScalar(step.rows, lane, lane_masks, step.y[lane]);
+            }
+        }
+        land_y = loadAvx2(step.land_y);
+    }
+
+    gatherRowsAvx2(step.rows, _mm256_add_epi32(_mm256_slli_epi32(land_y, 3), lanes), window);
+    const __m256i full = _mm256_set1_epi32(-1);
+    __m256i full_rows = zero;
+    TETRIS_UNROLL
+    for(int i = 0; i < WINDOW; ++i){
+        const __m256i row = _mm256_or_si256(window[i], masks[i]);
+        const __m256i is_full = _mm256_andnot_si256(_mm256_cmpeq_epi32(masks[i], zero), _mm256_cmpeq_epi32(row, full));
+        full_rows = _mm256_or_si256(full_rows, _mm256_and_si256(is_full, _mm256_set1_epi32(1 << i)));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(values[i]), row);
+    }
+    storeAvx2(step.land_y, land_y);
+    TETRIS_UNROLL
+    for(int lane = 0; lane < LANES; ++lane){
+        uint32_t *rows = step.rows + step.land_y[lane] * LANES + lane;
+        TETRIS_UNROLL
+        for(int i = 0; i < WINDOW; ++i)
+            rows[i * LANES] = values[i][lane];
+    }
+
+    // The lowest squares first: the top of a column is the one of its highest square
+    TETRIS_UNROLL
+    for(int k = 0; k < 4; ++k){
+        const __m256i top = _mm256_min_epi32(column_tops[k], _mm256_add_epi32(land_y, square_y[k]));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(values[k]), _mm256_blendv_epi8(column_tops[k], top, is_playing));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(indices[k]), top_index[k]);
+    }
+    int32_t *tops = step.tops + 2 * LANES;
+    TETRIS_UNROLL
+    for(int lane = 0; lane < LANES; ++lane){
+        TETRIS_UNROLL
+        for(int k = 0; k < 4; ++k)
+            tops[indices[k][lane]] = int32_t(values[k][lane]);
+    }
+
+    storeAvx2(step.pieces, _mm256_sub_epi32(loadAvx2(step.pieces), is_playing));
+    storeAvx2(step.score, _mm256_add_epi32(loadAvx2(step.score), _mm256_and_si256(is_playing, _mm256_set1_epi32(10))));
+    const __m256i level_pieces = _mm256_add_epi32(loadAvx2(step.level_pieces), is_playing);
+    storeAvx2(step.level_pieces, level_pieces);
+    storeAvx2(step.full_rows, full_rows);
+
+    const __m256i level_up = _mm256_and_si256(_mm256_cmpeq_epi32(level_pieces, zero), is_playing);
+    step.finish = laneMask(_mm256_or_si256(_mm256_cmpgt_epi32(full_rows, zero), level_up));
+}
+
+// Same as spawnBlockScalar(). The generator multiplies 64-bit states, from
+// 32-bit products on 4 lanes at a time.
+TETRIS_TARGET_AVX2 void spawnBlockAvx2(BlockStep &step)
+{
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i is_playing = loadAvx2(step.is_playing);
+    const __m256i multiplier_low = _mm256_set1_epi64x(0x4F6CDD1D);
+    const __m256i multiplier_high = _mm256_set1_epi64x(0x2545F491);
+
+    __m256i drawn[2];
+    TETRIS_UNROLL
+    for(int half = 0; half < 2; ++half){
+        __m256i *states = reinterpret_cast<__m256i *>(step.random_state + 4 * half);
+        const __m256i old_state = _mm256_loadu_si256(states);
+        __m256i state = _mm256_xor_si256(old_state, _mm256_srli_epi64(old_state, 12));
+        state = _mm256_xor_si256(state, _mm256_slli_epi64(state, 25));
+        state = _mm256_xor_si256(state, _mm256_srli_epi64(state, 27));
+
+        // Bits 32 to 63 of state * 0x2545F4914F6CDD1D, then bounded(1, 8)
+        const __m256i low = _mm256_mul_epu32(state, multiplier_low);
+        const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(state, 32), multiplier_low),
+                                               _mm256_mul_epu32(state, multiplier_high));
+        const __m256i next = _mm256_add_epi64(_mm256_srli_epi64(low, 32), cross);
+        drawn[half] = _mm256_srli_epi64(_mm256_mul_epu32(next, _mm256_set1_epi64x(7)), 32);
+
+        const __m128i is_half_playing = half ? _mm256_extracti128_si256(is_playing, 1) : _mm256_castsi256_si128(is_playing);
+        _mm256_storeu_si256(states, _mm256_blendv_epi8(old_state, state, _mm256_cvtepi32_epi64(is_half_playing)));
+    }
+    const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m256i next_shape = _mm256_add_epi32(_mm256_blend_epi32(_mm256_permutevar8x32_epi32(drawn[0], even),
+                                                                   _mm256_permutevar8x32_epi32(drawn[1], even), 0xf0),
+                                                _mm256_set1_epi32(1));
+
+    const __m256i old_next_shape = loadAvx2(step.next_shape);
+    const __m256i shape = _mm256_blendv_epi8(loadAvx2(step.shape), old_next_shape, is_playing);
+    const __m256i y = _mm256_blendv_epi8(loadAvx2(step.y), lookupAvx2(PIECE_TABLE.spawn_y, shape), is_playing);
+    storeAvx2(step.shape, shape);
+    storeAvx2(step.next_shape, _mm256_blendv_epi8(old_next_shape, next_shape, is_playing));
+    storeAvx2(step.y, y);
+
+    const __m256i x = _mm256_set1_epi32(step.spawn_x);
+    __m256i window[WINDOW], masks[WINDOW];
+    gatherRowsAvx2(step.rows, _mm256_add_epi32(_mm256_slli_epi32(y, 3), lanes), window);
+    TETRIS_UNROLL
+    for(int i = 0; i < WINDOW; ++i)
+        masks[i] = _mm256_sllv_epi32(lookupAvx2(PIECE_TABLE.rows + PieceTable::index(0, i, 0), shape), x);
+    const __m256i fit = _mm256_cmpeq_epi32(overlapAvx2(window, masks), _mm256_setzero_si256());
+    const __m256i is_fast = _mm256_cmpgt_epi32(_mm256_set1_epi32(2), loadAvx2(step.gravity_ticks));
+    step.lost = laneMask(_mm256_andnot_si256(fit, is_playing));
+    step.falling = laneMask(_mm256_and_si256(_mm256_and_si256(fit, is_fast), is_playing));
+}
+
+#endif // TETRIS_BATCH_X86
+
+} // namespace
+
+TetrisBatchEngine::TetrisBatchEngine(const TetrisRules &rules, int size)
+    : rules_(rules)
+    , isa_(TetrisBatchEvaluator::bestIsa())
+    , size_(0)
+{
+    static_assert(LANES == 8, "the AVX2 kernels compute the lane indices with a shift by 3");
+    rules_.width = std::clamp(rules_.width, 1, MAX_WIDTH);
+    rules_.height = std::max(rules_.height, 1);
+    walls_ = ~(((1u << rules_.width) - 1) << 2);
+    resize(size);
+}
+
+/**
+ * @brief Sets the number of boards.
+ *
+ * The boards kept go on with their game, the new ones are stopped.
+ *
+ * @param size Number of boards.
+ */
+void TetrisBatchEngine::resize(int size)
+{
+    const int old_blocks = (size_ + LANES - 1) / LANES;
+    size_ = std::max(size, 0);
+    const int blocks = (size_ + LANES - 1) / LANES;
+
+    rows_.resize(size_t(blocks) * (rules_.height + 5) * LANES, ~0u);
+    tops_.resize(size_t(blocks) * (rules_.width + 4) * LANES, rules_.height);
+    for(int b = old_blocks; b < blocks; ++b){
+        uint32_t *rows = blockRows(b);
+        std::fill(rows + 2 * LANES, rows + (rules_.height + 2) * LANES, walls_);
+    }
+
+    const size_t boards = size_t(blocks) * LANES;
+    random_state_.resize(boards, 1);
+    seed_.resize(boards, 0);
+    status_.resize(boards, StoppedStatus);
+    shape_.resize(boards, NoShape);
+    next_shape_.resize(boards, NoShape);
+    y_.resize(boards, 0);
+    score_.resize(boards, 0);
+    lines_.resize(boards, 0);
+    pieces_.resize(boards, 0);
+    gravity_ticks_.resize(boards, rules_.gravity_ticks);
+    level_pieces_.resize(boards, rules_.level_up_pieces);
+    for(size_t i = size_; i < boards; ++i)
+        status_[i] = StoppedStatus;
+}
+
+/**
+ * @brief Starts a new game on a board, as TetrisEngine::start() does.
+ *
+ * @param board Index of the board.
+ * @param seed Seed of the piece generator.
+ */
+void TetrisBatchEngine::start(int board, uint64_t seed)
+{
+    const int lane = board % LANES;
+    uint32_t *rows = blockRows(board / LANES) + lane;
+    for(int y = 0; y < rules_.height; ++y)
+        rows[(y + 2) * LANES] = walls_;
+    int32_t *tops = blockTops(board / LANES) + lane;
+    for(int c = 0; c < rules_.width; ++c)
+        tops[(c + 2) * LANES] = rules_.height;
+
+    TetrisRandom generator(seed);
+    seed_[board] = seed;
+    status_[board] = RunningStatus;
+    score_[board] = 0;
+    lines_[board] = 0;
+    pieces_[board] = 0;
+    gravity_ticks_[board] = rules_.gravity_ticks;
+    level_pieces_[board] = rules_.level_up_pieces;
+    next_shape_[board] = generator.bounded(1, 8);
+    random_state_[board] = generator.state();
+    spawn(board);
+}
+
+/**
+ * @brief Stops the game of a board: step() skips it until it is started again.
+ *
+ * @param board Index of the board.
+ */
+void TetrisBatchEngine::stop(int board)
+{
+    if(status_[board] == RunningStatus)
+        status_[board] = StoppedStatus;
+}
+
+/**
+ * @brief Advances every running board by one tick, playing one placement each.
+ *
+ * @param moves One move per board, see TetrisBatchMove. Moves of the boards not
+ * running are ignored.
+ */
+void TetrisBatchEngine::step(const TetrisBatchMove *moves)
+{
+    const int num_blocks = (size_ + LANES - 1) / LANES;
+    BlockStep block;
+    block.width = rules_.width;
+    block.spawn_x = TetrisEngine::spawnX(rules_.width);
+#ifdef TETRIS_BATCH_X86
+    const bool is_avx2 = isa_ == TetrisBatchEvaluator::Avx2Isa;
+#endif
+
+    for(int b = 0; b < num_blocks; ++b){
+        const int first = b * LANES;
+        uint64_t status;
+        std::memcpy(&status, status_.data() + first, LANES);
+        if(!(status & 0x0101010101010101ULL)) // no RunningStatus byte
+            continue;
+
+        TetrisBatchMove last_moves[LANES] = {};
+        if(first + LANES > size_){
+            std::copy(moves + first, moves + size_, last_moves);
+            block.moves = last_moves;
+        }else{
+            block.moves = moves + first;
+        }
+        block.rows = blockRows(b);
+        block.tops = blockTops(b);
+        block.status = status_.data() + first;
+        block.shape = shape_.data() + first;
+        block.next_shape = next_shape_.data() + first;
+        block.y = y_.data() + first;
+        block.score = score_.data() + first;
+        block.pieces = pieces_.data() + first;
+        block.level_pieces = level_pieces_.data() + first;
+        block.gravity_ticks = gravity_ticks_.data() + first;
+        block.random_state = random_state_.data() + first;
+
+#ifdef TETRIS_BATCH_X86
+        if(is_avx2)
+            lockBlockAvx2(block);
+        else
+#endif
+            lockBlockScalar(block);
+
+        for(int lanes = block.finish; lanes; lanes &= lanes - 1){
+            const int lane = trailingZeros(uint32_t(lanes));
+            const int board = first + lane;
+            if(level_pieces_[board] == 0){
+                level_pieces_[board] = rules_.level_up_pieces;
+                levelUp(board);
+            }
+            if(block.full_rows[lane])
+                removeFullLines(board, block.full_rows[lane], block.land_y[lane]);
+        }
+
+#ifdef TETRIS_BATCH_X86
+        if(is_avx2)
+            spawnBlockAvx2(block);
+        else
+#endif
+            spawnBlockScalar(block);
+
+        for(int lanes = block.lost; lanes; lanes &= lanes - 1){
+            const int board = first + trailingZeros(uint32_t(lanes));
+            shape_[board] = NoShape;
+            status_[board] = LostStatus;
+        }
+        // The gravity of the tick only moves the new piece if it runs every tick
+        for(int lanes = block.falling; lanes; lanes &= lanes - 1){
+            const int board = first + trailingZeros(uint32_t(lanes));
+            if(fits(board, 0, block.spawn_x, y_[board] + 1))
+                ++y_[board];
+            else
+                lock(board, 0, block.spawn_x, y_[board]);
+        }
+    }
+}
+
+/**
+ * @brief Chooses the instruction set of the kernels, e.g. to compare them.
+ *
+ * @param isa The instruction set, lowered to TetrisBatchEvaluator::bestIsa() if
+ * not supported. SSE4 has no gathers nor per-lane shifts: it runs the scalar kernels.
+ */
+void TetrisBatchEngine::setIsa(TetrisBatchEvaluator::Isa isa)
+{
+    isa_ = std::min(isa, TetrisBatchEvaluator::bestIsa());
+}
+
+/**
+ * @brief Returns the row mask of a board, bit x for column x, as TetrisEngine::rowBits().
+ *
+ * @param board Index of the board.
+ * @param y The row.
+ */
+uint32_t TetrisBatchEngine::rowBits(int board, int y) const
+{
+    return (blockRows(board / LANES)[(y + 2) * LANES + board % LANES] & ~walls_) >> 2;
+}
+
+/**
+ * @brief Returns the state hash of a board, as TetrisEngine::stateHash().
+ *
+ * Computed from scratch: the kernels do not keep it up to date, the hash is
+ * meant to compare a finished game with the engine.
+ *
+ * @param board Index of the board.
+ */
+uint64_t TetrisBatchEngine::stateHash(int board) const
+{
+    uint64_t hash = TetrisZobrist::queueKey(0, TetrisShape(shape_[board]))
+                    ^ TetrisZobrist::queueKey(1, TetrisShape(next_shape_[board]))
+                    ^ TetrisZobrist::counterKey(TetrisZobrist::RandomStateCounter, random_state_[board])
+                    ^ TetrisZobrist::counterKey(TetrisZobrist::ScoreCounter, uint64_t(score_[board]));
+    for(int y = 0; y < rules_.height; ++y)
+        hash ^= TetrisZobrist::rowKey(y, rowBits(board, y));
+    return hash;
+}
+
+/**
+ * @brief Checks if the current piece of a board fits at the given position.
+ *
+ * @param board Index of the board.
+ * @param rotation The rotation index.
+ * @param x The x-coordinate of the piece origin.
+ * @param y The y-coordinate of the piece origin, at most the board height.
+ * @return true if all four squares are inside the board and free.
+ */
+bool TetrisBatchEngine::fits(int board, int rotation, int x, int y) const
+{
+    const uint32_t *rows = blockRows(board / LANES) + y * LANES + board % LANES;
+    uint32_t overlap = 0;
+    for(int i = 0; i < WINDOW; ++i)
+        overlap |= rows[i * LANES] & (PIECE_TABLE.rows[PieceTable::index(rotation, i, shape_[board])] << x);
+    return overlap == 0;
+}
+
+/**
+ * @brief Locks the current piece of a board, as TetrisEngine::pieceDropped() does.
+ *
+ * The scalar version of the kernels of step(), for the pieces the gravity locks.
+ */
+void TetrisBatchEngine::lock(int board, int rotation, int x, int y)
+{
+    const int lane = board % LANES;
+    const int shape = shape_[board];
+    uint32_t *rows = blockRows(board / LANES) + y * LANES + lane;
+    int32_t *tops = blockTops(board / LANES) + (x + 2) * LANES + lane;
+
+    int full_rows = 0;
+    for(int i = 0; i < WINDOW; ++i){
+        const uint32_t mask = PIECE_TABLE.rows[PieceTable::index(rotation, i, shape)] << x;
+        rows[i * LANES] |= mask;
+        full_rows |= ((mask != 0) & (rows[i * LANES] == ~0u)) << i;
+    }
+    const uint32_t squares = PIECE_TABLE.squares[rotation * 8 + shape];
+    for(int k = 0; k < 4; ++k){
+        int32_t &top = tops[PieceTable::squareX(squares, k) * LANES];
+        top = std::min(top, y + PieceTable::squareY(squares, k));
+    }
+
+    ++pieces_[board];
+    score_[board] += 10;
+    if(--level_pieces_[board] == 0){
+        level_pieces_[board] = rules_.level_up_pieces;
+        levelUp(board);
+    }
+    if(full_rows)
+        removeFullLines(board, full_rows, y);
+    spawn(board);
+}
+
+/**
+ * @brief Increases the speed of a board, as TetrisEngine::levelUp() does.
+ */
+void TetrisBatchEngine::levelUp(int board)
+{
+    int32_t &gravity_ticks = gravity_ticks_[board];
+    gravity_ticks -= (rules_.level_up_speedup * gravity_ticks + 50) / 100;
+    gravity_ticks = std::max(gravity_ticks, 1);
+}
+
+/**
+ * @brief Removes the full rows of a board and updates its score, as
+ * TetrisEngine::removeFullLines() does.
+ *
+ * @param board Index of the board.
+ * @param full_rows Bit i set if row y + i - 2 is full.
+ * @param y The origin row of the piece locked.
+ */
+void TetrisBatchEngine::removeFullLines(int board, int full_rows, int y)
+{
+    uint32_t *rows = blockRows(board / LANES) + 2 * LANES + board % LANES;
+    const int count = bitCount(uint32_t(full_rows));
+    for(; full_rows; full_rows &= full_rows - 1){
+        for(int row = y + trailingZeros(uint32_t(full_rows)) - 2; row >= 1; --row)
+            rows[row * LANES] = rows[(row - 1) * LANES];
+        rows[0] = walls_;
+    }
+    updateTops(board);
+
+    static const int LINE_SCORES[] = {0, 40, 100, 300, 1200};
+    const int prev_score_range = score_[board] / rules_.level_up_score;
+    lines_[board] += count;
+    score_[board] += LINE_SCORES[count];
+    if(score_[board] / rules_.level_up_score > prev_score_range)
+        levelUp(board);
+}
+
+/**
+ * @brief Spawns the next piece of a board, as TetrisEngine::newPiece() does.
+ *
+ * The board is lost if the piece has no space.
+ */
+void TetrisBatchEngine::spawn(int board)
+{
+    TetrisRandom generator;
+    generator.setState(random_state_[board]);
+    shape_[board] = next_shape_[board];
+    next_shape_[board] = generator.bounded(1, 8);
+    random_state_[board] = generator.state();
+
+    y_[board] = PIECE_TABLE.spawn_y[shape_[board]];
+    if(!fits(board, 0, TetrisEngine::spawnX(rules_.width), y_[board])){
+        shape_[board] = NoShape;
+        status_[board] = LostStatus;
+    }
+}
+
+/**
+ * @brief Recomputes the column tops of a board from its rows.
+ */
+void TetrisBatchEngine::updateTops(int board)
+{
+    const int lane = board % LANES;
+    const uint32_t *rows = blockRows(board / LANES) + 2 * LANES + lane;
+    int32_t *tops = blockTops(board / LANES) + 2 * LANES + lane;
+    for(int c = 0; c < rules_.width; ++c)
+        tops[c * LANES] = rules_.height;
+
+    uint32_t covered = walls_;
+    for(int y = 0; y < rules_.height && covered != ~0u; ++y){
+        for(uint32_t found = rows[y * LANES] & ~covered; found; found &= found - 1)
+            tops[(trailingZeros(found) - 2) * LANES] = y;
+        covered |= rows[y * LANES];
+    }
+}
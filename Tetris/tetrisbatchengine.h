@@ -0,0 +1,105 @@
+#ifndef TETRISBATCHENGINE_H
+#define TETRISBATCHENGINE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisbatchevaluator.h"
+#include "Tetris/tetrisengine.h"
+
+// Placement of the current piece of one board for TetrisBatchEngine::step(): the
+// inputs RotateRight `rotation` times, MoveLeft or MoveRight until column `x`, then
+// HardDrop, all given to the same tick. Blocked rotations and moves are skipped,
+// as the engine does.
+struct TetrisBatchMove
+{
+    int rotation;   // right rotations from the spawn rotation, 0 to 3
+    int x;          // column of the piece origin
+};
+
+// Plays many games in lockstep, one placement per board and tick, with the rules
+// of TetrisEngine: a board stepped with a move plays exactly as an engine given
+// the inputs of the move in one tick (same pieces, rows, score, lines and level).
+// Everything is stored as a structure of arrays, LANES boards per block as in
+// TetrisBoardBatch: the rows, with two wall columns on each side and filled rows
+// above and below the board (a collision test is a few AND of masks), the top of
+// every column, and the piece, generator and score of every board.
+// The rotations, moves and drop of a block are computed for the LANES boards at
+// once (AVX2, scalar fallback); locks and line clears, which only touch a few
+// rows of one board, are done board by board. Only the row masks are kept, not
+// the shape of the locked squares.
+class TetrisBatchEngine
+{
+public:
+    static constexpr int LANES = TetrisBoardBatch::LANES;
+    static constexpr int MAX_WIDTH = 28; // the walls take 4 bits of a 32-bit row
+
+    explicit TetrisBatchEngine(const TetrisRules &rules = TetrisRules(), int size = 0);
+
+    void resize(int size);
+    void start(int board, uint64_t seed);
+    void stop(int board);
+    void step(const TetrisBatchMove *moves);
+
+    TetrisBatchEvaluator::Isa isa() const { return isa_; }
+    void setIsa(TetrisBatchEvaluator::Isa isa);
+
+    const TetrisRules &rules() const { return rules_; }
+    int width() const { return rules_.width; }
+    int height() const { return rules_.height; }
+    int size() const { return size_; }
+
+    bool isRunning(int board) const { return status_[board] == RunningStatus; }
+    bool isLost(int board) const { return status_[board] == LostStatus; }
+    uint64_t seed(int board) const { return seed_[board]; }
+    int score(int board) const { return score_[board]; }
+    int linesRemoved(int board) const { return lines_[board]; }
+    int piecesDropped(int board) const { return pieces_[board]; }
+    int gravityTicks(int board) const { return gravity_ticks_[board]; }
+    TetrisShape currentShape(int board) const { return TetrisShape(shape_[board]); }
+    TetrisShape nextShape(int board) const { return TetrisShape(next_shape_[board]); }
+    int currentX() const { return TetrisEngine::spawnX(rules_.width); }
+    int currentY(int board) const { return y_[board]; }
+    uint32_t rowBits(int board, int y) const;
+    uint64_t stateHash(int board) const;
+
+    // State of a board, one byte per board for the kernels
+    enum Status : uint8_t {
+        StoppedStatus,
+        RunningStatus,
+        LostStatus
+    };
+
+private:
+    uint32_t *blockRows(int block){ return rows_.data() + size_t(block) * (rules_.height + 5) * LANES; }
+    const uint32_t *blockRows(int block) const { return rows_.data() + size_t(block) * (rules_.height + 5) * LANES; }
+    int32_t *blockTops(int block){ return tops_.data() + size_t(block) * (rules_.width + 4) * LANES; }
+
+    bool fits(int board, int rotation, int x, int y) const;
+    void lock(int board, int rotation, int x, int y);
+    void levelUp(int board);
+    void removeFullLines(int board, int full_rows, int y);
+    void spawn(int board);
+    void updateTops(int board);
+
+    TetrisRules rules_;
+    TetrisBatchEvaluator::Isa isa_;
+    int size_;
+    uint32_t walls_; // bits of a row outside the board
+
+    // Per block, lane l: row y at [(y + 2) * LANES + l] with 2 filled rows above the
+    // board and 3 below; top of column c at [(c + 2) * LANES + l] with 2 columns
+    // out of the board on each side, never read for a square
+    std::vector<uint32_t> rows_;
+    std::vector<int32_t> tops_;             // first filled row, the height if none
+
+    std::vector<uint64_t> random_state_;    // piece generator, see TetrisRandom
+    std::vector<uint64_t> seed_;
+    std::vector<uint8_t> status_;
+    std::vector<int32_t> shape_, next_shape_;
+    std::vector<int32_t> y_;                // origin row of the current piece, in spawn column and rotation
+    std::vector<int32_t> score_, lines_, pieces_, gravity_ticks_;
+    std::vector<int32_t> level_pieces_;     // pieces to drop before the next level up
+};
+
+#endif // TETRISBATCHENGINE_H
@@ -0,0 +1,442 @@
+#include "tetrisbatchevaluator.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Common/bitops.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TETRIS_BATCH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only accept the intrinsics in functions built for their instruction
+// set; MSVC accepts them anywhere
+#if defined(TETRIS_BATCH_X86) && defined(__GNUC__)
+#define TETRIS_TARGET_SSE4 __attribute__((target("sse4.1")))
+#define TETRIS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TETRIS_TARGET_SSE4
+#define TETRIS_TARGET_AVX2
+#endif
+
+namespace {
+
+const int LANES = TetrisBoardBatch::LANES;
+
+// Board features in the order the kernels compute them
+enum BatchFeature {
+    BatchRowTransitions,
+    BatchColumnTransitions,
+    BatchHoles,
+    BatchWellSums,
+    BatchAggregateHeight,
+    BatchBumpiness,
+    NUM_BATCH_FEATURES
+};
+
+const int FEATURE_OF[NUM_BATCH_FEATURES] = {
+    RowTransitionsFeature,
+    ColumnTransitionsFeature,
+    HolesFeature,
+    WellSumsFeature,
+    AggregateHeightFeature,
+    BumpinessFeature
+};
+
+// Bit counts are summed in bytes: a row adds at most 9 to a byte (row transitions),
+// so the bytes are widened every FLUSH_ROWS rows
+const int FLUSH_ROWS = 28;
+
+typedef int32_t BlockFeatures[NUM_BATCH_FEATURES][LANES];
+
+// Masks shared by the kernels, for a board `width` columns wide
+struct RowMasks {
+    uint32_t full;      // columns of the board
+    uint32_t inner;     // pairs of neighbour columns, bit x = columns x and x + 1
+    uint32_t edges;     // columns next to a wall
+    uint32_t right;     // wall on the right of the last column
+    int planes;         // bits of a well depth
+};
+
+RowMasks rowMasks(int width, int height)
+{
+    RowMasks masks;
+    masks.full = width >= 32 ? ~0u : (1u << width) - 1;
+    masks.inner = masks.full >> 1;
+    masks.edges = 1u | (1u << (width - 1));
+    masks.right = 1u << (width - 1);
+    masks.planes = 1;
+    while(masks.planes < 31 && (1 << masks.planes) <= height)
+        ++masks.planes;
+    return masks;
+}
+
+/*
+ * Every feature is computed from the rows, top to bottom, as a sum of bit counts:
+ * - covered: columns with a filled square in this row or above; aggregate height
+ *   adds one per covered column and row, bumpiness one per row where exactly one of
+ *   two neighbour columns is covered.
+ * - holes: empty squares of covered columns.
+ * - wells: empty squares with both neighbours filled (walls are filled). The depth
+ *   of the well every column is in is kept in bit planes (plane p holds bit p of
+ *   every depth), incremented with a ripple carry; every well square adds its depth.
+ */
+void blockScalar(const uint32_t *block, int width, int height, int count, BlockFeatures &out)
+{
+    const RowMasks masks = rowMasks(width, height);
+
+    for(int lane = 0; lane < count; ++lane){
+        uint32_t covered = 0;
+        uint32_t planes[32] = {};
+        int sums[NUM_BATCH_FEATURES] = {};
+
+        for(int y = 0; y < height; ++y){
+            const uint32_t row = block[y * LANES + lane];
+            const uint32_t below = y + 1 < height ? block[(y + 1) * LANES + lane] : masks.full;
+
+            sums[BatchRowTransitions] += bitCount((row ^ (row >> 1)) & masks.inner) + bitCount(~row & masks.edges);
+            sums[BatchColumnTransitions] += bitCount(row ^ below);
+            sums[BatchHoles] += bitCount(covered & ~row);
+            covered |= row;
+            sums[BatchAggregateHeight] += bitCount(covered);
+            sums[BatchBumpiness] += bitCount((covered ^ (covered >> 1)) & masks.inner);
+
+            const uint32_t wells = ~row & ((row << 1) | 1u) & ((row >> 1) | masks.right) & masks.full;
+            uint32_t carry = wells;
+            for(int p = 0; p < masks.planes; ++p){
+                const uint32_t next = planes[p] & carry;
+                planes[p] = (planes[p] ^ carry) & wells;
+                carry = next;
+                sums[BatchWellSums] += bitCount(planes[p]) << p;
+            }
+        }
+
+        for(int f = 0; f < NUM_BATCH_FEATURES; ++f)
+            out[f][lane] = sums[f];
+    }
+}
+
+#ifdef TETRIS_BATCH_X86
+
+TETRIS_TARGET_SSE4 inline __m128i bytesCountSse4(__m128i value)
+{
+    const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i low_nibbles = _mm_set1_epi8(0x0f);
+    __m128i low = _mm_and_si128(value, low_nibbles);
+    __m128i high = _mm_and_si128(_mm_srli_epi32(value, 4), low_nibbles);
+    return _mm_add_epi8(_mm_shuffle_epi8(table, low), _mm_shuffle_epi8(table, high));
+}
+
+TETRIS_TARGET_SSE4 inline __m128i widenSse4(__m128i bytes)
+{
+    __m128i words = _mm_maddubs_epi16(bytes, _mm_set1_epi8(1));
+    return _mm_madd_epi16(words, _mm_set1_epi16(1));
+}
+
+// Same as blockScalar(), on 4 lanes of the block starting at `lane`
+TETRIS_TARGET_SSE4 void halfBlockSse4(const uint32_t *block, int width, int height, int lane, BlockFeatures &out)
+{
+    const RowMasks masks = rowMasks(width, height);
+    const __m128i full = _mm_set1_epi32(int(masks.full));
+    const __m128i inner = _mm_set1_epi32(int(masks.inner));
+    const __m128i edges = _mm_set1_epi32(int(masks.edges));
+    const __m128i right = _mm_set1_epi32(int(masks.right));
+    const __m128i one = _mm_set1_epi32(1);
+
+    __m128i covered = _mm_setzero_si128();
+    __m128i planes[32], plane_bytes[32], plane_sums[32];
+    __m128i bytes[NUM_BATCH_FEATURES], sums[NUM_BATCH_FEATURES];
+    for(int p = 0; p < masks.planes; ++p)
+        planes[p] = plane_bytes[p] = plane_sums[p] = _mm_setzero_si128();
+    for(int f = 0; f < NUM_BATCH_FEATURES; ++f)
+        bytes[f] = sums[f] = _mm_setzero_si128();
+
+    for(int y = 0; y < height; ++y){
+        const __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + y * LANES + lane));
+        const __m128i below = y + 1 < height
+                ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + (y + 1) * LANES + lane)) : full;
+
+        __m128i transitions = _mm_and_si128(_mm_xor_si128(row, _mm_srli_epi32(row, 1)), inner);
+        bytes[BatchRowTransitions] = _mm_add_epi8(bytes[BatchRowTransitions],
+                _mm_add_epi8(bytesCountSse4(transitions), bytesCountSse4(_mm_andnot_si128(row, edges))));
+        bytes[BatchColumnTransitions] = _mm_add_epi8(bytes[BatchColumnTransitions], bytesCountSse4(_mm_xor_si128(row, below)));
+        bytes[BatchHoles] = _mm_add_epi8(bytes[BatchHoles], bytesCountSse4(_mm_andnot_si128(row, covered)));
+        covered = _mm_or_si128(covered, row);
+        bytes[BatchAggregateHeight] = _mm_add_epi8(bytes[BatchAggregateHeight], bytesCountSse4(covered));
+        __m128i steps = _mm_and_si128(_mm_xor_si128(covered, _mm_srli_epi32(covered, 1)), inner);
+        bytes[BatchBumpiness] = _mm_add_epi8(bytes[BatchBumpiness], bytesCountSse4(steps));
+
+        __m128i walls = _mm_and_si128(_mm_or_si128(_mm_slli_epi32(row, 1), one), _mm_or_si128(_mm_srli_epi32(row, 1), right));
+        const __m128i wells = _mm_and_si128(_mm_andnot_si128(row, walls), full);
+        __m128i carry = wells;
+        for(int p = 0; p < masks.planes; ++p){
+            __m128i next = _mm_and_si128(planes[p], carry);
+            planes[p] = _mm_and_si128(_mm_xor_si128(planes[p], carry), wells);
+            carry = next;
+            plane_bytes[p] = _mm_add_epi8(plane_bytes[p], bytesCountSse4(planes[p]));
+        }
+
+        if((y + 1) % FLUSH_ROWS == 0 || y + 1 == height){
+            for(int f = 0; f < NUM_BATCH_FEATURES; ++f){
+                sums[f] = _mm_add_epi32(sums[f], widenSse4(bytes[f]));
+                bytes[f] = _mm_setzero_si128();
+            }
+            for(int p = 0; p < masks.planes; ++p){
+                plane_sums[p] = _mm_add_epi32(plane_sums[p], widenSse4(plane_bytes[p]));
+                plane_bytes[p] = _mm_setzero_si128();
+            }
+        }
+    }
+
+    for(int p = 0; p < masks.planes; ++p)
+        sums[BatchWellSums] = _mm_add_epi32(sums[BatchWellSums], _mm_slli_epi32(plane_sums[p], p));
+    for(int f = 0; f < NUM_BATCH_FEATURES; ++f)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out[f] + lane), sums[f]);
+}
+
+void blockSse4(const uint32_t *block, int width, int height, int count, BlockFeatures &out)
+{
+    halfBlockSse4(block, width, height, 0, out);
+    if(count > LANES / 2)
+        halfBlockSse4(block, width, height, LANES / 2, out);
+}
+
+TETRIS_TARGET_AVX2 inline __m256i bytesCountAvx2(__m256i value)
+{
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    __m256i low = _mm256_and_si256(value, low_nibbles);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi32(value, 4), low_nibbles);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(table, low), _mm256_shuffle_epi8(table, high));
+}
+
+TETRIS_TARGET_AVX2 inline __m256i widenAvx2(__m256i bytes)
+{
+    __m256i words = _mm256_maddubs_epi16(bytes, _mm256_set1_epi8(1));
+    return _mm256_madd_epi16(words, _mm256_set1_epi16(1));
+}
+
+// Same as blockScalar(), on the 8 lanes at once
+TETRIS_TARGET_AVX2 void blockAvx2(const uint32_t *block, int width, int height, int, BlockFeatures &out)
+{
+    const RowMasks masks = rowMasks(width, height);
+    const __m256i full = _mm256_set1_epi32(int(masks.full));
+    const __m256i inner = _mm256_set1_epi32(int(masks.inner));
+    const __m256i edges = _mm256_set1_epi32(int(masks.edges));
+    const __m256i right = _mm256_set1_epi32(int(masks.right));
+    const __m256i one = _mm256_set1_epi32(1);
+
+    __m256i covered = _mm256_setzero_si256();
+    __m256i planes[32], plane_bytes[32], plane_sums[32];
+    __m256i bytes[NUM_BATCH_FEATURES], sums[NUM_BATCH_FEATURES];
+    for(int p = 0; p < masks.planes; ++p)
+        planes[p] = plane_bytes[p] = plane_sums[p] = _mm256_setzero_si256();
+    for(int f = 0; f < NUM_BATCH_FEATURES; ++f)
+        bytes[f] = sums[f] = _mm256_setzero_si256();
+
+    for(int y = 0; y < height; ++y){
+        const __m256i row = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + y * LANES));
+        const __m256i below = y + 1 < height
+                ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + (y + 1) * LANES)) : full;
+
+        __m256i transitions = _mm256_and_si256(_mm256_xor_si256(row, _mm256_srli_epi32(row, 1)), inner);
+        bytes[BatchRowTransitions] = _mm256_add_epi8(bytes[BatchRowTransitions],
+                _mm256_add_epi8(bytesCountAvx2(transitions), bytesCountAvx2(_mm256_andnot_si256(row, edges))));
+        bytes[BatchColumnTransitions] = _mm256_add_epi8(bytes[BatchColumnTransitions], bytesCountAvx2(_mm256_xor_si256(row, below)));
+        bytes[BatchHoles] = _mm256_add_epi8(bytes[BatchHoles], bytesCountAvx2(_mm256_andnot_si256(row, covered)));
+        covered = _mm256_or_si256(covered, row);
+        bytes[BatchAggregateHeight] = _mm256_add_epi8(bytes[BatchAggregateHeight], bytesCountAvx2(covered));
+        __m256i steps = _mm256_and_si256(_mm256_xor_si256(covered, _mm256_srli_epi32(covered, 1)), inner);
+        bytes[BatchBumpiness] = _mm256_add_epi8(bytes[BatchBumpiness], bytesCountAvx2(steps));
+
+        __m256i walls = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi32(row, 1), one),
+                                         _mm256_or_si256(_mm256_srli_epi32(row, 1), right));
+        const __m256i wells = _mm256_and_si256(_mm256_andnot_si256(row, walls), full);
+        __m256i carry = wells;
+        for(int p = 0; p < masks.planes; ++p){
+            __m256i next = _mm256_and_si256(planes[p], carry);
+            planes[p] = _mm256_and_si256(_mm256_xor_si256(planes[p], carry), wells);
+            carry = next;
+            plane_bytes[p] = _mm256_add_epi8(plane_bytes[p], bytesCountAvx2(planes[p]));
+        }
+
+        if((y + 1) % FLUSH_ROWS == 0 || y + 1 == height){
+            for(int f = 0; f < NUM_BATCH_FEATURES; ++f){
+                sums[f] = _mm256_add_epi32(sums[f], widenAvx2(bytes[f]));
+                bytes[f] = _mm256_setzero_si256();
+            }
+            for(int p = 0; p < masks.planes; ++p){
+                plane_sums[p] = _mm256_add_epi32(plane_sums[p], widenAvx2(plane_bytes[p]));
+                plane_bytes[p] = _mm256_setzero_si256();
+            }
+        }
+    }
+
+    for(int p = 0; p < masks.planes; ++p)
+        sums[BatchWellSums] = _mm256_add_epi32(sums[BatchWellSums], _mm256_slli_epi32(plane_sums[p], p));
+    for(int f = 0; f < NUM_BATCH_FEATURES; ++f)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out[f]), sums[f]);
+}
+
+#endif // TETRIS_BATCH_X86
+
+} // namespace
+
+TetrisBoardBatch::TetrisBoardBatch()
+    : width_(0)
+    , height_(0)
+    , size_(0)
+{
+}
+
+/**
+ * @brief Empties the batch and sets the size of its boards.
+ *
+ * @param width Number of columns, at most TetrisEngine::MAX_WIDTH.
+ * @param height Number of rows.
+ */
+void TetrisBoardBatch::reset(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+    clear();
+}
+
+/**
+ * @brief Empties the batch, keeping its memory.
+ */
+void TetrisBoardBatch::clear()
+{
+    size_ = 0;
+    data_.clear();
+}
+
+/**
+ * @brief Appends a board to the batch.
+ *
+ * The unused lanes of the last block hold empty boards.
+ *
+ * @param rows The height() row masks of the board.
+ * @return The index of the board in the batch.
+ */
+int TetrisBoardBatch::add(const uint32_t *rows)
+{
+    const int lane = size_ % LANES;
+    if(lane == 0)
+        data_.resize(data_.size() + size_t(height_) * LANES, 0);
+
+    uint32_t *block = data_.data() + data_.size() - size_t(height_) * LANES;
+    for(int y = 0; y < height_; ++y)
+        block[y * LANES + lane] = rows[y];
+    return size_++;
+}
+
+TetrisBatchEvaluator::TetrisBatchEvaluator()
+    : isa_(bestIsa())
+{
+}
+
+/**
+ * @brief Returns the widest instruction set supported by the processor.
+ *
+ * @return Avx2Isa, Sse4Isa, or ScalarIsa on other processors.
+ */
+TetrisBatchEvaluator::Isa TetrisBatchEvaluator::bestIsa()
+{
+#if defined(TETRIS_BATCH_X86) && defined(__GNUC__)
+    if(__builtin_cpu_supports("avx2"))
+        return Avx2Isa;
+    if(__builtin_cpu_supports("sse4.1"))
+        return Sse4Isa;
+#elif defined(TETRIS_BATCH_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool has_sse4 = info[2] & (1 << 19);
+    // AVX registers must also be saved by the operating system
+    const bool has_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    if(has_avx && (info[1] & (1 << 5)))
+        return Avx2Isa;
+    if(has_sse4)
+        return Sse4Isa;
+#endif
+    return ScalarIsa;
+}
+
+/**
+ * @brief Chooses the instruction set, e.g. to compare them.
+ *
+ * @param isa The instruction set, lowered to bestIsa() if not supported.
+ */
+void TetrisBatchEvaluator::setIsa(Isa isa)
+{
+    isa_ = std::min(isa, bestIsa());
+}
+
+/**
+ * @brief Computes the board features of every board of a batch.
+ *
+ * The values are the ones of TetrisEvaluator::boardFeatures(), placement features
+ * are 0.
+ *
+ * @param batch The boards.
+ * @param values Filled with NUM_TETRIS_FEATURES x batch.size() values: feature f of
+ * board i is values[f * batch.size() + i].
+ */
+void TetrisBatchEvaluator::boardFeatures(const TetrisBoardBatch &batch, int32_t *values) const
+{
+    const int size = batch.size();
+    std::fill(values, values + size_t(NUM_TETRIS_FEATURES) * size, 0);
+
+    BlockFeatures block_features;
+    for(int b = 0; b < batch.numBlocks(); ++b){
+        const int count = std::min(LANES, size - b * LANES);
+        switch(isa_){
+#ifdef TETRIS_BATCH_X86
+        case Avx2Isa:
+            blockAvx2(batch.block(b), batch.width(), batch.height(), count, block_features);
+            break;
+        case Sse4Isa:
+            blockSse4(batch.block(b), batch.width(), batch.height(), count, block_features);
+            break;
+#endif
+        default:
+            blockScalar(batch.block(b), batch.width(), batch.height(), count, block_features);
+            break;
+        }
+
+        for(int f = 0; f < NUM_BATCH_FEATURES; ++f)
+            std::memcpy(values + size_t(FEATURE_OF[f]) * size + b * LANES, block_features[f], count * sizeof(int32_t));
+    }
+}
+
+/**
+ * @brief Scores the boards of a batch with the board features only.
+ *
+ * The weighted sum runs in feature order, as in TetrisEvaluator::evaluate(), so that
+ * adding the placement terms gives the same score to the last bit.
+ *
+ * @param batch The boards.
+ * @param weights The weights, the ones of the placement features are not used.
+ * @param scores Filled with batch.size() scores.
+ */
+void TetrisBatchEvaluator::boardScores(const TetrisBoardBatch &batch, const TetrisWeights &weights, double *scores)
+{
+    const int size = batch.size();
+    features_.resize(size_t(NUM_TETRIS_FEATURES) * size);
+    boardFeatures(batch, features_.data());
+
+    std::fill(scores, scores + size, 0.0);
+    for(int f = 0; f < NUM_TETRIS_FEATURES; ++f){
+        if(f == LandingHeightFeature || f == LinesClearedFeature || f == ErodedCellsFeature)
+            continue;
+        const int32_t *values = features_.data() + size_t(f) * size;
+        for(int i = 0; i < size; ++i)
+            scores[i] += weights.values[f] * values[i];
+    }
+}
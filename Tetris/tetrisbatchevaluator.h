@@ -0,0 +1,61 @@
+#ifndef TETRISBATCHEVALUATOR_H
+#define TETRISBATCHEVALUATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisevaluator.h"
+
+// Boards stored as a structure of arrays, LANES boards per block: row y of board
+// i is at block(i / LANES)[y * LANES + i % LANES], so one SIMD load reads the
+// same row of LANES boards.
+class TetrisBoardBatch
+{
+public:
+    static constexpr int LANES = 8;
+
+    TetrisBoardBatch();
+
+    void reset(int width, int height);
+    void clear();
+    int add(const uint32_t *rows);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int size() const { return size_; }
+    int numBlocks() const { return (size_ + LANES - 1) / LANES; }
+    const uint32_t *block(int index) const { return data_.data() + size_t(index) * height_ * LANES; }
+
+private:
+    int width_, height_, size_;
+    std::vector<uint32_t> data_;
+};
+
+// Computes the board features of TetrisEvaluator::boardFeatures() for a whole
+// batch at once, on 8 (AVX2) or 4 (SSE4) boards per instruction, with a scalar
+// fallback. Every feature is a sum over the rows of bit counts of row masks, so
+// the rows of all the boards are processed in lockstep.
+class TetrisBatchEvaluator
+{
+public:
+    enum Isa {
+        ScalarIsa,
+        Sse4Isa,
+        Avx2Isa
+    };
+
+    TetrisBatchEvaluator();
+
+    static Isa bestIsa();
+    Isa isa() const { return isa_; }
+    void setIsa(Isa isa);
+
+    void boardFeatures(const TetrisBoardBatch &batch, int32_t *values) const;
+    void boardScores(const TetrisBoardBatch &batch, const TetrisWeights &weights, double *scores);
+
+private:
+    Isa isa_;
+    std::vector<int32_t> features_;
+};
+
+#endif // TETRISBATCHEVALUATOR_H
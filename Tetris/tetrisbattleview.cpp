@@ -0,0 +1,396 @@
+#include "tetrisbattleview.h"
+
+#include <QRandomGenerator>
+
+#include <cstring>
+
+// CONSTANT VARIABLE
+const int TetrisBattleView::FRAME_MS = 16;
+const int TetrisBattleView::RESTART_DELAY_MS = 3000;
+const int TetrisBattleView::TILE_GAP = 2;
+const int TetrisBattleView::BEVEL_MIN_SIDE = 4;
+const QRgb TetrisBattleView::BACKGROUND_COLOR = 0xFF303030;
+
+TetrisBattleView::TetrisBattleView(int num_boards, const TetrisRules &rules, QWidget *parent)
+    : QWidget(parent)
+    , pieces_per_second_(2.0)
+    , ticks_per_piece_(1)
+    , cell_side_(0)
+    , frame_counter_("frame")
+    , tick_counter_("tick")
+    , render_counter_("render")
+{
+    boards_.reserve(size_t(qBound(1, num_boards, MAX_BOARDS)));
+    for(int i = 0; i < qBound(1, num_boards, MAX_BOARDS); ++i)
+        boards_.emplace_back(rules);
+
+    setPiecesPerSecond(pieces_per_second_);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setFocusPolicy(Qt::StrongFocus);
+
+    perf_overlay_ = new PerfOverlay(this);
+    perf_overlay_->addCounter(&frame_counter_);
+    perf_overlay_->addCounter(&tick_counter_);
+    perf_overlay_->addCounter(&render_counter_);
+}
+
+TetrisBattleView::~TetrisBattleView(){}
+
+/**
+ * @brief Sets how fast the AI plays, on every board.
+ *
+ * As with TetrisAiController, gravity can still lock a piece before the AI plays it at low rates.
+ *
+ * @param pieces_per_second Pieces played per second on each board.
+ */
+void TetrisBattleView::setPiecesPerSecond(double pieces_per_second)
+{
+    pieces_per_second_ = qMax(0.1, pieces_per_second);
+    const int tick_ms = boards_.front().engine.rules().tick_ms;
+    ticks_per_piece_ = qMax(1, qRound(1000.0 / (pieces_per_second_ * tick_ms)));
+}
+
+/**
+ * @brief Starts a new game on every board.
+ *
+ * The boards start a fraction of a piece apart, so that the AI does not search
+ * all of them in the same frame.
+ */
+void TetrisBattleView::start()
+{
+    if(!clock_.isValid())
+        clock_.start();
+
+    const qint64 now = clock_.elapsed();
+    const qint64 piece_ms = qint64(ticks_per_piece_) * boards_.front().engine.rules().tick_ms;
+    for(size_t i = 0; i < boards_.size(); ++i)
+        restartBoard(boards_[i], now + piece_ms * qint64(i) / qint64(boards_.size()));
+
+    timer_.start(FRAME_MS, Qt::PreciseTimer, this);
+}
+
+/**
+ * @brief Starts a new game on one board, with a random seed.
+ *
+ * @param board The board.
+ * @param start_ms View time of the first tick of the game.
+ */
+void TetrisBattleView::restartBoard(Board &board, qint64 start_ms)
+{
+    board.engine.start(QRandomGenerator::global()->generate64());
+    board.start_ms = start_ms;
+    board.lost_ms = -1;
+    board.seen_piece = -1;
+    markRows(board, 0, board.engine.height() - 1);
+}
+
+/**
+ * @brief Runs the ticks of a board due at `now_ms`, as TetrisBoard::processTicks() does.
+ *
+ * The AI plays every piece once, ticks_per_piece_ ticks after it has been seen, and
+ * gives the whole path to the engine in one tick, as the AI controller of the board
+ * does. A lost game starts again after RESTART_DELAY_MS. The rows the ticks changed
+ * are marked for the next render.
+ *
+ * @param board The board.
+ * @param now_ms Current view time in milliseconds.
+ */
+void TetrisBattleView::advanceBoard(Board &board, qint64 now_ms)
+{
+    TetrisEngine &engine = board.engine;
+    if(board.lost_ms >= 0){
+        if(now_ms - board.lost_ms >= RESTART_DELAY_MS)
+            restartBoard(board, now_ms);
+        return;
+    }
+
+    const qint64 tick_ms = engine.rules().tick_ms;
+    while(!engine.isLost() && qint64(engine.tickCount() + 1) * tick_ms <= now_ms - board.start_ms){
+        if(engine.piecesDropped() != board.seen_piece){
+            board.seen_piece = engine.piecesDropped();
+            board.play_tick = engine.tickCount() + uint64_t(ticks_per_piece_);
+        }
+
+        inputs_.clear();
+        if(engine.tickCount() >= board.play_tick){
+            board.play_tick = UINT64_MAX;
+            if(ai_.choose(engine, placement_, path_)){
+                for(TetrisAction action : path_)
+                    inputs_.push_back(TetrisInput{0, action});
+            }
+        }
+
+        const int old_first = engine.currentY() + engine.currentPiece().minY();
+        const int old_last = engine.currentY() + engine.currentPiece().maxY();
+        engine.step(inputs_.data(), int(inputs_.size()));
+
+        for(const TetrisEvent &event : engine.events()){
+            switch(event.type){
+            case LinesCleared:
+                markRows(board, 0, engine.height() - 1);
+                break;
+            case GameLost:
+                board.lost_ms = now_ms;
+                markRows(board, 0, engine.height() - 1);
+                break;
+            default:
+                break;
+            }
+        }
+        if(!engine.events().empty()){
+            markRows(board, old_first, old_last);
+            markPiece(board);
+        }
+    }
+}
+
+/**
+ * @brief Marks the rows of the current piece of a board for the next render.
+ *
+ * @param board The board.
+ */
+void TetrisBattleView::markPiece(Board &board)
+{
+    const TetrisPiece &piece = board.engine.currentPiece();
+    if(piece.shape() != NoShape)
+        markRows(board, board.engine.currentY() + piece.minY(), board.engine.currentY() + piece.maxY());
+}
+
+/**
+ * @brief Marks rows of a board for the next render.
+ *
+ * @param board The board.
+ * @param first_row The first row, clamped to the board.
+ * @param last_row The last row, included, clamped to the board.
+ */
+void TetrisBattleView::markRows(Board &board, int first_row, int last_row)
+{
+    first_row = qMax(0, first_row);
+    last_row = qMin(board.engine.height() - 1, last_row);
+    if(first_row > last_row)
+        return;
+
+    if(board.dirty_first > board.dirty_last){
+        board.dirty_first = first_row;
+        board.dirty_last = last_row;
+    }else{
+        board.dirty_first = qMin(board.dirty_first, first_row);
+        board.dirty_last = qMax(board.dirty_last, last_row);
+    }
+}
+
+/**
+ * @brief Renders the marked rows of a board into the frame.
+ *
+ * Every square is copied from the atlas line by line, without going through a
+ * QPainter. The current piece is drawn over the rows it covers, and a lost game is
+ * drawn with the faded squares of the atlas.
+ *
+ * @param board The board.
+ */
+void TetrisBattleView::renderBoard(Board &board)
+{
+    if(board.dirty_first > board.dirty_last)
+        return;
+
+    const int first_row = board.dirty_first;
+    const int last_row = board.dirty_last;
+    board.dirty_first = 0;
+    board.dirty_last = -1;
+    if(!board.is_visible || cell_side_ <= 0)
+        return;
+
+    const TetrisEngine &engine = board.engine;
+    const TetrisPiece &piece = engine.currentPiece();
+    const bool is_piece_shown = piece.shape() != NoShape && board.lost_ms < 0;
+    const int atlas_top = board.lost_ms < 0 ? 0 : cell_side_;
+    const size_t square_bytes = size_t(cell_side_) * sizeof(QRgb);
+
+    uchar *frame_bits = frame_.bits();
+    const qsizetype frame_stride = frame_.bytesPerLine();
+    TetrisShape row[TetrisEngine::MAX_WIDTH];
+
+    for(int y = first_row; y <= last_row; ++y){
+        for(int x = 0; x < engine.width(); ++x)
+            row[x] = engine.shapeAt(x, y);
+        if(is_piece_shown){
+            for(int i = 0; i < 4; ++i){
+                if(engine.currentY() + piece.y(i) == y)
+                    row[engine.currentX() + piece.x(i)] = piece.shape();
+            }
+        }
+
+        uchar *line = frame_bits + (board.origin.y() + y * cell_side_) * frame_stride
+                      + board.origin.x() * qsizetype(sizeof(QRgb));
+        for(int j = 0; j < cell_side_; ++j, line += frame_stride){
+            const uchar *atlas_line = atlas_.constScanLine(atlas_top + j);
+            for(int x = 0; x < engine.width(); ++x)
+                std::memcpy(line + x * square_bytes, atlas_line + int(row[x]) * square_bytes, square_bytes);
+        }
+    }
+
+    dirty_region_ += QRect(board.origin.x(), board.origin.y() + first_row * cell_side_,
+                           engine.width() * cell_side_, (last_row - first_row + 1) * cell_side_);
+}
+
+/**
+ * @brief Draws the squares of the atlas for the current square size.
+ *
+ * The first line of squares is for live games, the second for lost ones, faded into
+ * the background. Squares are beveled as in TetrisBoard::drawSquare() from
+ * BEVEL_MIN_SIDE pixels, flat below: the thumbnails of many small tiles.
+ */
+void TetrisBattleView::buildAtlas()
+{
+    static constexpr QRgb colorTable[8] = {
+        0x000000, 0xCC6666, 0x66CC66, 0x6666CC,
+        0xCCCC66, 0xCC66CC, 0x66CCCC, 0xDAAA00
+    };
+
+    const int side = cell_side_;
+    atlas_ = QImage(8 * side, 2 * side, QImage::Format_RGB32);
+    QPainter painter(&atlas_);
+    for(int faded = 0; faded < 2; ++faded){
+        for(int shape = 0; shape < 8; ++shape){
+            QColor color = QColor::fromRgb(colorTable[shape]);
+            if(faded)
+                color = QColor::fromRgbF(0.4 * color.redF() + 0.6 * qRed(BACKGROUND_COLOR) / 255.0,
+                                         0.4 * color.greenF() + 0.6 * qGreen(BACKGROUND_COLOR) / 255.0,
+                                         0.4 * color.blueF() + 0.6 * qBlue(BACKGROUND_COLOR) / 255.0);
+
+            const int x = shape * side;
+            const int y = faded * side;
+            if(shape == NoShape || side < BEVEL_MIN_SIDE){
+                painter.fillRect(x, y, side, side, color);
+                continue;
+            }
+
+            painter.fillRect(x + 1, y + 1, side - 2, side - 2, color);
+            painter.setPen(color.lighter());
+            painter.drawLine(x, y + side - 1, x, y);
+            painter.drawLine(x, y, x + side - 1, y);
+            painter.setPen(color.darker());
+            painter.drawLine(x + 1, y + side - 1, x + side - 1, y + side - 1);
+            painter.drawLine(x + side - 1, y + side - 1, x + side - 1, y + 1);
+        }
+    }
+}
+
+/**
+ * @brief Places the tiles in the widget and renders them all again.
+ *
+ * The grid uses the number of columns that gives the largest squares. The tiles of a
+ * widget too small for squares of one pixel are not rendered.
+ */
+void TetrisBattleView::layoutTiles()
+{
+    const int num_boards = boardCount();
+    const int board_width = boards_.front().engine.width();
+    const int board_height = boards_.front().engine.height();
+
+    int best_side = 0, best_columns = 1;
+    for(int columns = 1; columns <= num_boards; ++columns){
+        const int rows = (num_boards + columns - 1) / columns;
+        const int side = qMin((width() - TILE_GAP * (columns + 1)) / (columns * board_width),
+                              (height() - TILE_GAP * (rows + 1)) / (rows * board_height));
+        if(side > best_side){
+            best_side = side;
+            best_columns = columns;
+        }
+    }
+
+    const int side = qMax(1, best_side);
+    const int rows = (num_boards + best_columns - 1) / best_columns;
+    const int grid_width = best_columns * (board_width * side + TILE_GAP) + TILE_GAP;
+    const int grid_height = rows * (board_height * side + TILE_GAP) + TILE_GAP;
+    const QPoint offset(qMax(0, (width() - grid_width) / 2) + TILE_GAP, qMax(0, (height() - grid_height) / 2) + TILE_GAP);
+
+    frame_ = QImage(size().expandedTo(QSize(1, 1)), QImage::Format_RGB32);
+    frame_.fill(BACKGROUND_COLOR);
+    if(side != cell_side_){
+        cell_side_ = side;
+        buildAtlas();
+    }
+
+    for(int i = 0; i < num_boards; ++i){
+        Board &board = boards_[size_t(i)];
+        board.origin = offset + QPoint((i % best_columns) * (board_width * side + TILE_GAP),
+                                       (i / best_columns) * (board_height * side + TILE_GAP));
+        board.is_visible = frame_.rect().contains(QRect(board.origin, QSize(board_width * side, board_height * side)));
+        markRows(board, 0, board_height - 1);
+        renderBoard(board);
+    }
+
+    dirty_region_ = QRegion();
+    update();
+}
+
+/**
+ * @brief Advances every board to the current time and renders what changed.
+ *
+ * All the boards are stepped and rendered on the GUI thread; a single update()
+ * per frame covers every changed area, so the screen is painted at most once per frame.
+ *
+ * @param event Pointer to the QTimerEvent object representing the timer event.
+ */
+void TetrisBattleView::timerEvent(QTimerEvent *event)
+{
+    if(event->timerId() != timer_.timerId()){
+        QWidget::timerEvent(event);
+        return;
+    }
+
+    const qint64 now = clock_.elapsed();
+    {
+        PerfScope tick_scope(tick_counter_);
+        for(Board &board : boards_)
+            advanceBoard(board, now);
+    }
+    {
+        PerfScope render_scope(render_counter_);
+        for(Board &board : boards_)
+            renderBoard(board);
+    }
+
+    if(!dirty_region_.isEmpty()){
+        update(dirty_region_);
+        dirty_region_ = QRegion();
+    }
+}
+
+/**
+ * @brief Copies the repainted area of the frame to the screen.
+ *
+ * @param event Pointer to the QPaintEvent object representing the paint event.
+ */
+void TetrisBattleView::paintEvent(QPaintEvent *event)
+{
+    PerfScope frame_scope(frame_counter_);
+    QPainter painter(this);
+    for(const QRect &rect : event->region())
+        painter.drawImage(rect, frame_, rect);
+}
+
+/**
+ * @brief Lays the tiles out again for the new size, see layoutTiles().
+ *
+ * @param event Pointer to the QResizeEvent object representing the resize event.
+ */
+void TetrisBattleView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    layoutTiles();
+}
+
+/**
+ * @brief F3 toggles the performance HUD: frame paints, board ticks and renders.
+ *
+ * @param event Pointer to the QKeyEvent object representing the key press event.
+ */
+void TetrisBattleView::keyPressEvent(QKeyEvent *event)
+{
+    if(event->key() == Qt::Key_F3)
+        perf_overlay_->toggle();
+    else
+        QWidget::keyPressEvent(event);
+}
@@ -0,0 +1,97 @@
+#ifndef TETRISBATTLEVIEW_H
+#define TETRISBATTLEVIEW_H
+
+#include <QWidget>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QKeyEvent>
+#include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QRegion>
+
+#include <vector>
+
+#include "Common/perfcounter.h"
+#include "Common/perfoverlay.h"
+#include "Tetris/tetrisai.h"
+#include "Tetris/tetrisengine.h"
+
+// Spectator screen: up to MAX_BOARDS games played by the AI, side by side in one
+// widget. The boards are not widgets: every frame they are rendered into one
+// image, only the rows that changed, by copying squares from an atlas drawn once
+// per square size. Small tiles get flat squares. One paint per frame copies the
+// changed areas of the image to the screen.
+class TetrisBattleView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_BOARDS = 99;
+
+    explicit TetrisBattleView(int num_boards, const TetrisRules &rules = TetrisRules(), QWidget *parent = nullptr);
+    ~TetrisBattleView();
+
+    int boardCount() const { return int(boards_.size()); }
+    const TetrisEngine &engine(int board) const { return boards_[size_t(board)].engine; }
+    double piecesPerSecond() const { return pieces_per_second_; }
+
+public slots:
+    void setPiecesPerSecond(double pieces_per_second);
+    void start();
+
+protected:
+    void keyPressEvent(QKeyEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void timerEvent(QTimerEvent *event) override;
+
+private:
+    struct Board {
+        explicit Board(const TetrisRules &rules) : engine(rules) {}
+
+        TetrisEngine engine;
+        qint64 start_ms = 0;            // view time of the first tick
+        qint64 lost_ms = -1;            // view time the game was lost at, -1 while playing
+        int seen_piece = -1;            // pieces dropped when the current piece was first seen
+        uint64_t play_tick = 0;         // engine tick the AI plays the current piece at
+        int dirty_first = 0;            // rows to render, none if dirty_first > dirty_last
+        int dirty_last = -1;
+        QPoint origin;                  // top-left pixel of the tile in frame_
+        bool is_visible = false;        // the whole tile fits in frame_
+    };
+
+    void advanceBoard(Board &board, qint64 now_ms);
+    void buildAtlas();
+    void layoutTiles();
+    void markPiece(Board &board);
+    void markRows(Board &board, int first_row, int last_row);
+    void renderBoard(Board &board);
+    void restartBoard(Board &board, qint64 start_ms);
+
+    std::vector<Board> boards_;
+    TetrisAi ai_;
+    TetrisPlacement placement_;
+    std::vector<TetrisAction> path_;
+    std::vector<TetrisInput> inputs_;
+    double pieces_per_second_;
+    int ticks_per_piece_;
+
+    QImage frame_;                      // the whole view, the screen copies from it
+    QImage atlas_;                      // one square per shape, live games then lost ones
+    QRegion dirty_region_;              // area of frame_ rendered since the last paint
+    int cell_side_;
+
+    QBasicTimer timer_;
+    QElapsedTimer clock_;
+    PerfOverlay *perf_overlay_;
+    PerfCounter frame_counter_, tick_counter_, render_counter_;
+
+    static const int FRAME_MS;
+    static const int RESTART_DELAY_MS;
+    static const int TILE_GAP;
+    static const int BEVEL_MIN_SIDE;
+    static const QRgb BACKGROUND_COLOR;
+};
+
+#endif // TETRISBATTLEVIEW_H
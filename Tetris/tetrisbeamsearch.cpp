@@ -0,0 +1,380 @@
+#include "tetrisbeamsearch.h"
+
+#include <algorithm>
+
+TetrisBeamSearch::TetrisBeamSearch(const TetrisBeamOptions &options, const TetrisWeights &weights)
+    : options_(options)
+    , weights_(weights)
+    , nodes_expanded_(0)
+    , width_(0)
+    , height_(0)
+    , shape_(NoShape)
+    , level_(0)
+    , running_(0)
+    , is_quitting_(false)
+{
+    setOptions(options);
+}
+
+TetrisBeamSearch::~TetrisBeamSearch()
+{
+    stopThreads();
+}
+
+/**
+ * @brief Changes the beam width, depth and number of threads.
+ *
+ * The worker threads are restarted. Must not be called during a search.
+ *
+ * @param options The new options, width and depth are at least 1.
+ */
+void TetrisBeamSearch::setOptions(const TetrisBeamOptions &options)
+{
+    stopThreads();
+    options_ = options;
+    options_.width = std::max(1, options_.width);
+    options_.depth = std::max(1, options_.depth);
+    options_.table_megabytes = std::max(0, options_.table_megabytes);
+    if(options_.table_megabytes == 0)
+        table_.reset();
+    else if(!table_ || table_->megabytes() != size_t(options_.table_megabytes))
+        table_.reset(new TetrisTranspositionTable(options_.table_megabytes));
+    startThreads();
+}
+
+/**
+ * @brief Changes the weights of the features.
+ *
+ * The board scores kept in the transposition table are dropped if the weights change.
+ *
+ * @param weights The new weights.
+ */
+void TetrisBeamSearch::setWeights(const TetrisWeights &weights)
+{
+    if(std::equal(weights.values, weights.values + NUM_TETRIS_FEATURES, weights_.values))
+        return;
+
+    weights_ = weights;
+    if(table_)
+        table_->clear();
+}
+
+/**
+ * @brief Returns the statistics of the transposition table, to size it.
+ *
+ * @return The statistics since the table has been created or the weights changed,
+ * all 0 without a table.
+ */
+TetrisTableStats TetrisBeamSearch::tableStats() const
+{
+    return table_ ? table_->stats() : TetrisTableStats();
+}
+
+/**
+ * @brief Chooses the placement of the current piece of a saved engine state.
+ *
+ * The preview piece of the state is searched too when the depth allows it.
+ *
+ * @param state The engine state, only read.
+ * @param best Set to the chosen placement of the current piece.
+ * @param path Set to the inputs leading to it from the current piece position.
+ * @return true if a placement has been chosen, false if there is no piece to play
+ * or the search has been cancelled.
+ */
+bool TetrisBeamSearch::choose(const TetrisEngineState &state, TetrisPlacement &best, std::vector<TetrisAction> &path)
+{
+    if(!state.is_started || state.is_lost)
+        return false;
+
+    const TetrisShape pieces[2] = {state.curr_shape, state.next_shape};
+    return choose(state.rows.data(), state.width, state.height, pieces, state.next_shape == NoShape ? 1 : 2,
+                  state.curr_x, state.curr_y, state.curr_rotation, best, path);
+}
+
+/**
+ * @brief Chooses the placement of a piece, looking ahead over the pieces that follow it.
+ *
+ * @param rows Row masks of the board.
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param pieces The current piece then the preview pieces, in order.
+ * @param num_pieces Number of pieces in `pieces`, only the first options().depth are searched.
+ * @param x The x-coordinate of the current piece origin.
+ * @param y The y-coordinate of the current piece origin.
+ * @param rotation The rotation index of the current piece.
+ * @param best Set to the placement of the current piece leading to the best board.
+ * @param path Set to the inputs leading to it from the current piece position.
+ * @return true if a placement has been chosen, false if the current piece cannot move
+ * or the search has been cancelled.
+ */
+bool TetrisBeamSearch::choose(const uint32_t *rows, int width, int height, const TetrisShape *pieces, int num_pieces,
+                              int x, int y, int rotation, TetrisPlacement &best, std::vector<TetrisAction> &path)
+{
+    nodes_expanded_ = 0;
+    const int depth = std::min(num_pieces, options_.depth);
+    if(depth < 1 || cancel_.isCancelled()
+        || root_generator_.generate(rows, width, height, pieces[0], x, y, rotation, roots_) == 0)
+        return false;
+
+    width_ = width;
+    height_ = height;
+    if(table_)
+        table_->newSearch();
+    for(std::unique_ptr<Worker> &worker : workers_){
+        worker->children.clear();
+        worker->rows.clear();
+    }
+
+    // The current piece: one node, expanded here
+    addChildren(*workers_[0], 0, rows, roots_, -1, 0.0);
+    nodes_expanded_ = 1;
+    selectBeam();
+
+    for(int level = 1; level < depth; ++level){
+        if(cancel_.isCancelled())
+            return false;
+
+        shape_ = pieces[level];
+        runLevel();
+        if(cancel_.isCancelled())
+            return false;
+        // Every board of the beam tops out: keep the boards of the previous piece
+        if(!selectBeam())
+            break;
+    }
+
+    best = roots_[beam_[0].root];
+    path = root_generator_.path(best);
+    return true;
+}
+
+/**
+ * @brief Expands every board of the beam with the placements of shape_, on all the threads.
+ *
+ * Worker i starts with the i-th slice of the beam. The children are left in the
+ * workers, see selectBeam().
+ */
+void TetrisBeamSearch::runLevel()
+{
+    const size_t count = beam_.size();
+    const size_t num_workers = workers_.size();
+    for(size_t i = 0; i < num_workers; ++i){
+        Worker &worker = *workers_[i];
+        worker.children.clear();
+        worker.rows.clear();
+        worker.nodes = 0;
+        worker.next.store(count * i / num_workers, std::memory_order_relaxed);
+        worker.end = count * (i + 1) / num_workers;
+    }
+
+    if(num_workers > 1){
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++level_;
+        running_ = int(num_workers) - 1;
+    }
+    start_condition_.notify_all();
+
+    expand(0);
+
+    if(num_workers > 1){
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_condition_.wait(lock, [this](){ return running_ == 0; });
+    }
+
+    for(const std::unique_ptr<Worker> &worker : workers_)
+        nodes_expanded_ += worker->nodes;
+}
+
+/**
+ * @brief Expands the boards of a worker slice, then steals boards from the other slices.
+ *
+ * Owners and thieves take boards with the same atomic increment, so every board is
+ * expanded exactly once and no lock is taken.
+ *
+ * @param worker_index The worker.
+ */
+void TetrisBeamSearch::expand(int worker_index)
+{
+    Worker &worker = *workers_[worker_index];
+    const int num_workers = int(workers_.size());
+
+    for(int k = 0; k < num_workers; ++k){
+        Worker &victim = *workers_[(worker_index + k) % num_workers];
+        for(;;){
+            size_t i = victim.next.fetch_add(1, std::memory_order_relaxed);
+            if(i >= victim.end || cancel_.isCancelled())
+                break;
+            expandNode(worker, worker_index, beam_[i]);
+        }
+    }
+}
+
+void TetrisBeamSearch::expandNode(Worker &worker, int worker_index, const Node &node)
+{
+    const uint32_t *rows = beam_rows_.data() + node.rows;
+    worker.generator.generateFromSpawn(rows, width_, height_, shape_, worker.placements);
+    ++worker.nodes;
+
+    addChildren(worker, worker_index, rows, worker.placements, node.root, node.reward);
+}
+
+/**
+ * @brief Adds to a worker the boards left by placements, with their scores.
+ *
+ * The boards missing from the transposition table are scored together by the batch
+ * evaluator; the placement terms are added to the reward. Board scores do not depend
+ * on the pieces to come: they are stored with depth 0 and no queue key.
+ *
+ * @param worker The worker.
+ * @param worker_index Its index.
+ * @param rows Row masks of the board before the placements.
+ * @param placements The placements.
+ * @param root The placement of the current piece the boards come from, -1 when the
+ * placements are the ones of the current piece.
+ * @param reward The placement terms of the pieces placed before.
+ */
+void TetrisBeamSearch::addChildren(Worker &worker, int worker_index, const uint32_t *rows,
+                                   const std::vector<TetrisPlacement> &placements, int root, double reward)
+{
+    const double *weights = weights_.values;
+    worker.batch.reset(width_, height_);
+    worker.evaluated.clear();
+
+    for(size_t i = 0; i < placements.size(); ++i){
+        const size_t offset = worker.rows.size();
+        worker.rows.resize(offset + height_);
+        uint32_t *board = worker.rows.data() + offset;
+
+        int eroded_cells = 0;
+        int lines = TetrisEvaluator::place(rows, width_, height_, placements[i], board, &eroded_cells);
+        double values[NUM_TETRIS_FEATURES];
+        TetrisEvaluator::placementFeatures(height_, placements[i], lines, eroded_cells, values);
+        double placement_terms = weights[LandingHeightFeature] * values[LandingHeightFeature]
+                                 + weights[LinesClearedFeature] * values[LinesClearedFeature]
+                                 + weights[ErodedCellsFeature] * values[ErodedCellsFeature];
+
+        Node child;
+        child.root = root < 0 ? int(i) : root;
+        child.reward = reward + placement_terms;
+        child.hash = TetrisTranspositionTable::boardKey(board, height_);
+        child.rows = offset;
+        child.owner = worker_index;
+
+        double board_terms;
+        if(table_ && table_->probe(child.hash, 0, board_terms)){
+            child.score = child.reward + board_terms;
+        }else{
+            child.score = child.reward;
+            worker.evaluated.push_back(worker.children.size());
+            worker.batch.add(board);
+        }
+        worker.children.push_back(child);
+    }
+
+    if(worker.evaluated.empty())
+        return;
+
+    worker.scores.resize(worker.evaluated.size());
+    worker.evaluator.boardScores(worker.batch, weights_, worker.scores.data());
+    for(size_t i = 0; i < worker.evaluated.size(); ++i){
+        Node &child = worker.children[worker.evaluated[i]];
+        child.score = child.reward + worker.scores[i];
+        if(table_)
+            table_->store(child.hash, 0, worker.scores[i]);
+    }
+}
+
+/**
+ * @brief Keeps the best children of the level as the new beam.
+ *
+ * The same board reached through different placements is kept once, with its best
+ * score. Ties are broken by the placement of the current piece (the shortest path
+ * first), so the result does not depend on how the threads shared the work.
+ *
+ * @return false if the level has no children, the beam is then left unchanged.
+ */
+bool TetrisBeamSearch::selectBeam()
+{
+    candidates_.clear();
+    for(const std::unique_ptr<Worker> &worker : workers_)
+        candidates_.insert(candidates_.end(), worker->children.begin(), worker->children.end());
+    if(candidates_.empty())
+        return false;
+
+    auto is_better = [](const Node &a, const Node &b){
+        if(a.score != b.score)
+            return a.score > b.score;
+        return a.root < b.root;
+    };
+
+    std::sort(candidates_.begin(), candidates_.end(), [&](const Node &a, const Node &b){
+        return a.hash != b.hash ? a.hash < b.hash : is_better(a, b);
+    });
+    candidates_.erase(std::unique(candidates_.begin(), candidates_.end(),
+                                  [](const Node &a, const Node &b){ return a.hash == b.hash; }),
+                      candidates_.end());
+
+    const size_t count = std::min(candidates_.size(), size_t(options_.width));
+    std::partial_sort(candidates_.begin(), candidates_.begin() + count, candidates_.end(), is_better);
+
+    beam_.assign(candidates_.begin(), candidates_.begin() + count);
+    beam_rows_.resize(count * height_);
+    for(size_t i = 0; i < count; ++i){
+        const Worker &owner = *workers_[beam_[i].owner];
+        std::copy_n(owner.rows.data() + beam_[i].rows, height_, beam_rows_.data() + i * height_);
+        beam_[i].rows = i * height_;
+    }
+    return true;
+}
+
+void TetrisBeamSearch::startThreads()
+{
+    int num_threads = options_.threads > 0 ? options_.threads : int(std::thread::hardware_concurrency());
+    num_threads = std::max(1, num_threads);
+
+    is_quitting_ = false;
+    level_ = 0;
+    for(int i = 0; i < num_threads; ++i)
+        workers_.push_back(std::unique_ptr<Worker>(new Worker));
+    for(int i = 1; i < num_threads; ++i)
+        threads_.emplace_back(&TetrisBeamSearch::workerLoop, this, i);
+}
+
+void TetrisBeamSearch::stopThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        is_quitting_ = true;
+    }
+    start_condition_.notify_all();
+    for(std::thread &thread : threads_)
+        thread.join();
+
+    threads_.clear();
+    workers_.clear();
+}
+
+/**
+ * @brief Body of the worker threads: expands every level started by runLevel().
+ *
+ * @param worker_index The worker of the thread, at least 1.
+ */
+void TetrisBeamSearch::workerLoop(int worker_index)
+{
+    uint64_t level = 0;
+    for(;;){
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_condition_.wait(lock, [&](){ return is_quitting_ || level_ != level; });
+            if(is_quitting_)
+                return;
+            level = level_;
+        }
+
+        expand(worker_index);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(--running_ == 0)
+            done_condition_.notify_one();
+    }
+}
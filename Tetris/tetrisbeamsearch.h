@@ -0,0 +1,114 @@
+#ifndef TETRISBEAMSEARCH_H
+#define TETRISBEAMSEARCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Tetris/tetrisai.h"
+#include "Tetris/tetrisbatchevaluator.h"
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrisevaluator.h"
+#include "Tetris/tetrismovegenerator.h"
+#include "Tetris/tetristranspositiontable.h"
+
+struct TetrisBeamOptions
+{
+    int width = 32;     // boards kept after each piece
+    int depth = 2;      // pieces searched, limited by the pieces known
+    int threads = 0;    // 0 for one per hardware thread
+    int table_megabytes = 0; // transposition table for the board scores, 0 for none
+};
+
+// Beam search over the current piece and the preview: every board of the beam
+// gets every placement of the next piece, the best `width` boards are kept. A
+// board is scored by its features plus the placement terms (landing height,
+// lines, eroded cells) of every piece that led to it.
+// The boards of a level are expanded by all the threads; every thread owns a
+// slice of the beam and steals from the slices of the others once done. Board
+// scores go through a transposition table shared by the threads, so a board
+// reached again (by another placement order, or by the next search) is not
+// evaluated twice.
+// A search must not be started from two threads at once.
+class TetrisBeamSearch
+{
+public:
+    explicit TetrisBeamSearch(const TetrisBeamOptions &options = TetrisBeamOptions(),
+                              const TetrisWeights &weights = TetrisWeights::elTetris());
+    ~TetrisBeamSearch();
+
+    void setCancel(const TetrisSearchCancel &cancel){ cancel_ = cancel; }
+    void setOptions(const TetrisBeamOptions &options);
+    void setWeights(const TetrisWeights &weights);
+    const TetrisBeamOptions &options() const { return options_; }
+    uint64_t nodesExpanded() const { return nodes_expanded_; }
+    TetrisTableStats tableStats() const;
+
+    bool choose(const TetrisEngineState &state, TetrisPlacement &best, std::vector<TetrisAction> &path);
+    bool choose(const uint32_t *rows, int width, int height, const TetrisShape *pieces, int num_pieces,
+                int x, int y, int rotation, TetrisPlacement &best, std::vector<TetrisAction> &path);
+
+private:
+    struct Node {
+        int root;           // placement of the current piece it comes from
+        double reward;      // placement terms of the pieces placed so far
+        double score;       // reward + board terms
+        uint64_t hash;      // board key, to merge the same board reached twice
+        size_t rows;        // offset of the rows in the owner's row pool
+        int owner;          // worker holding the rows
+    };
+
+    struct Worker {
+        TetrisMoveGenerator generator;
+        TetrisBatchEvaluator evaluator;
+        TetrisBoardBatch batch;
+        std::vector<double> scores;
+        std::vector<size_t> evaluated; // children scored by the batch
+        std::vector<TetrisPlacement> placements;
+        std::vector<Node> children;
+        std::vector<uint32_t> rows;
+        std::atomic<size_t> next{0};    // next node of the slice to expand
+        size_t end = 0;                 // end of the slice
+        uint64_t nodes = 0;
+    };
+
+    void expand(int worker_index);
+    void expandNode(Worker &worker, int worker_index, const Node &node);
+    void runLevel();
+    void addChildren(Worker &worker, int worker_index, const uint32_t *rows,
+                     const std::vector<TetrisPlacement> &placements, int root, double reward);
+    bool selectBeam();
+    void startThreads();
+    void stopThreads();
+    void workerLoop(int worker_index);
+
+    TetrisBeamOptions options_;
+    TetrisWeights weights_;
+    TetrisSearchCancel cancel_;
+    uint64_t nodes_expanded_;
+
+    // Search in progress
+    int width_, height_;
+    TetrisShape shape_;             // piece placed by the level being expanded
+    std::vector<Node> beam_;
+    std::vector<uint32_t> beam_rows_;
+    std::vector<Node> candidates_;
+    TetrisMoveGenerator root_generator_;
+    std::vector<TetrisPlacement> roots_;
+    std::unique_ptr<TetrisTranspositionTable> table_;
+
+    // Workers: worker 0 is the thread calling choose()
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable start_condition_, done_condition_;
+    uint64_t level_;                // incremented to start a level
+    int running_;                   // threads still expanding the level
+    bool is_quitting_;
+};
+
+#endif // TETRISBEAMSEARCH_H
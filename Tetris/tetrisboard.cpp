@@ -1,27 +1,77 @@
 #include "tetrisboard.h"
 
+// CONSTANT VARIABLE
+const size_t TetrisBoard::REPLAY_CHUNK_BYTES = 4096;
+const double TetrisBoard::MIN_REPLAY_SPEED = 0.25;
+const double TetrisBoard::MAX_REPLAY_SPEED = 64.0;
+
 TetrisBoard::TetrisBoard(QWidget *parent)
     : QFrame(parent)
-    , board_width_steps_(1)
-    , board_height_steps_(1)
     , square_side_(1) // px
     , is_started_(false)
     , is_paused_(false)
-    , score_(0)
-    , level_up_range_(2400)
+    , best_score_(0)
     , not_active_alpha_color_(100)
     , active_alpha_color_(255)
-    , board_(QVector<TetrisShape>(board_width_steps_*board_height_steps_))
+    , static_layer_alpha_(-1)
+    , is_static_layer_dirty_(true)
+    , paused_time_ms_(0)
+    , pause_started_ms_(0)
+    , is_replaying_(false)
+    , replay_speed_(1.0)
+    , replay_ticks_due_(0.0)
+    , last_replay_frame_ms_(0)
+    , is_rewind_enabled_(false)
+    , is_rewound_(false)
+    , next_piece_label_(nullptr)
+    , hint_seed_(0)
+    , hint_piece_(-1)
+    , recorded_hash_(0)
+    , frame_counter_("frame")
+    , tick_counter_("tick")
+    , clear_counter_("clr tick")
+    , replay_player_(engine_)
 {
     // Set some default properties for the frame
     setFrameStyle(QFrame::StyledPanel | QFrame::Plain);
 
+    // Performance HUD, toggled with F3
+    perf_overlay_ = new PerfOverlay(this);
+    perf_overlay_->addCounter(&frame_counter_);
+    perf_overlay_->addCounter(&tick_counter_);
+    perf_overlay_->addCounter(&clear_counter_);
+    perf_overlay_->move(frameWidth(), frameWidth());
+
+    // Every game is recorded, the file is written by a background thread
+    replay_writer_ = new TetrisReplayWriter(this);
+    connect(replay_writer_, &TetrisReplayWriter::replaySaved, this, &TetrisBoard::replaySaved);
+    replay_writer_->start(QThread::LowPriority);
+    suspend_writer_ = new TetrisReplayWriter(this);
+    suspend_writer_->start(QThread::LowPriority);
+
     // Needed to recognize event in frame from used (i.e., key pressed)
     setFocusPolicy(Qt::StrongFocus);
 
-    clearBoard();
-    next_piece_.setRandomShape();
-    // qDebug() << "Initialization completed: piece: " << int(next_piece_.shape()) ;
+    engine_.setBoardSize(1, 1);
+    tick_inputs_.reserve(TetrisInputQueue::CAPACITY);
+}
+
+/**
+ * @brief Suspends the game in progress, if any, and closes its replay.
+ *
+ * The replay of a suspended game is not finished, since the game is not: it is
+ * kept in the suspended game and written again once resumed, so the partial file
+ * is dropped. The replay of any other game is finished as usual.
+ *
+ * The writer threads are children of the board: they are destroyed afterwards,
+ * once they have written everything queued.
+ */
+TetrisBoard::~TetrisBoard()
+{
+    if(suspend())
+        replay_writer_->discardFile();
+    else
+        finishReplay();
 }
 
 /**
@@ -32,11 +82,16 @@ TetrisBoard::TetrisBoard(QWidget *parent)
  * different elements are drawn or updated accordingly. The method uses QPainter to render
  * graphics on the widget surface.
  *
+ * The grid and the placed pieces only change when a piece locks, so they are kept in a
+ * cached static layer and copied for the repainted area only. Running animations, the
+ * hint of the training mode and the current piece are drawn on top of it.
+ *
  * @param event Pointer to the QPaintEvent object representing the paint event.
  */
 void TetrisBoard::paintEvent(QPaintEvent *event)
 {
     // qDebug() << "Called paintEvent" ;
+    PerfScope frame_scope(frame_counter_);
     QFrame::paintEvent(event);
 
     QPainter painter(this);
@@ -52,62 +107,514 @@ void TetrisBoard::paintEvent(QPaintEvent *event)
     if (!is_started_) {
         painter.drawText(rect, "Welcome", text_option);
         return;
-    } else if(is_paused_){
+    } else if(is_paused_ && !is_replaying_){
         alpha_color = not_active_alpha_color_;
-    } else if(is_lost_){
+    } else if(engine_.isLost()){
         alpha_color = not_active_alpha_color_;
         QString test = "test";
-        emit updateScores(score_, test);
+        emit updateScores(engine_.score(), test);
     }
 
-    drawBackgroundGrid(painter, alpha_color);
+    if(is_static_layer_dirty_ || static_layer_alpha_ != alpha_color)
+        updateStaticLayer(alpha_color);
 
-    drawPlacedPieces(painter, alpha_color);
+    QRect target = event->rect().intersected(rect);
+    painter.drawPixmap(target, static_layer_, target.translated(-rect.topLeft()));
+
+    drawAnimations(painter, alpha_color);
+
+    if(isHintShown())
+        drawHint(painter);
 
     drawCurrentPiece(painter, alpha_color);
 
     // To draw on top of everything
     painter.setPen(Qt::black);
-    if(is_paused_ && !is_lost_)
+    if(is_paused_ && !is_replaying_ && !engine_.isLost())
         painter.drawText(rect, Qt::AlignCenter, "Pause");
-    else if(is_lost_)
+    else if(engine_.isLost())
         painter.drawText(rect, Qt::AlignCenter, "Ouch, you lost ...");
 
     // qDebug() << "paintEvent completed" ;
 }
 
+/**
+ * @brief Redraws the cached static layer.
+ *
+ * Draws the background grid and the placed pieces into `static_layer_`, with the given
+ * alpha. Called from paintEvent() only when the board content or the alpha changed.
+ *
+ * @param alpha_color Alpha color value applied to grid and pieces.
+ */
+void TetrisBoard::updateStaticLayer(int alpha_color)
+{
+    QRect rect = contentsRect();
+    if(static_layer_.size() != rect.size())
+        static_layer_ = QPixmap(rect.size());
+
+    static_layer_.fill(Qt::transparent);
+
+    QPainter painter(&static_layer_);
+    painter.translate(-rect.topLeft());
+    drawBackgroundGrid(painter, alpha_color);
+    drawPlacedPieces(painter, alpha_color);
+
+    static_layer_alpha_ = alpha_color;
+    is_static_layer_dirty_ = false;
+}
+
+/**
+ * @brief Draws the running lock and line clear animations.
+ *
+ * For a line clear, the removed rows (kept by the timeline) flash at their old place,
+ * then the rows above, taken from the static layer which already holds the new board,
+ * slide from their old place to the new one. For a lock, the squares of the locked
+ * piece pop out and fade back to normal.
+ *
+ * @param painter Reference to the QPainter object used for drawing.
+ * @param alpha_color Alpha color value for transparency effect.
+ */
+void TetrisBoard::drawAnimations(QPainter &painter, int alpha_color)
+{
+    if(!animations_.isActive())
+        return;
+
+    const qint64 now = clock_.elapsed();
+    QRect rect = contentsRect();
+
+    if(animations_.hasLineClear()){
+        const TetrisLineClear &line_clear = animations_.lineClear();
+        const qreal flash = animations_.flashProgress(now);
+        const qreal collapse = animations_.collapseProgress(now);
+        const int last_row = line_clear.rows[line_clear.count - 1];
+
+        QRect area(rect.left(), rect.top(), rect.width(), (last_row + 1) * square_side_);
+        painter.save();
+        painter.setClipRect(area, Qt::IntersectClip);
+        painter.fillRect(area, palette().window());
+
+        // From the lowest removed row up, counting the removed rows met so far:
+        // that is how many lines each row above has fallen.
+        int removed = line_clear.count - 1;
+        int shift = 0;
+        for(int row = last_row; row >= -line_clear.count; --row){
+            if(removed >= 0 && line_clear.rows[removed] == row){
+                int fade_alpha = qRound(alpha_color * (1.0 - collapse));
+                for(int j = 0; j < engine_.width(); ++j){
+                    if(line_clear.cells[removed][j] != NoShape)
+                        drawSquare(painter, rect.left() + j * square_side_, rect.top() + row * square_side_,
+                                   line_clear.cells[removed][j], fade_alpha);
+                }
+
+                QColor flash_color = Qt::white;
+                flash_color.setAlpha(qRound(200 * (1.0 - flash) * (1.0 - collapse)));
+                painter.fillRect(rect.left(), rect.top() + row * square_side_, rect.width(), square_side_, flash_color);
+
+                --removed;
+                ++shift;
+                continue;
+            }
+
+            int new_row = row + shift;
+            qreal y = rect.top() + (new_row - shift * (1.0 - collapse)) * square_side_;
+            painter.drawPixmap(QPointF(rect.left(), y), static_layer_,
+                               QRectF(0, new_row * square_side_, rect.width(), square_side_));
+        }
+        painter.restore();
+    }
+
+    if(animations_.hasLock()){
+        const TetrisLock &lock = animations_.lock();
+        const qreal pop = 1.0 - animations_.lockProgress(now);
+        const int grow = qRound(pop * square_side_ / 6.0);
+
+        QColor glow_color = Qt::white;
+        glow_color.setAlpha(qRound(140 * pop * alpha_color / 255.0));
+        for(int i = 0; i < 4; ++i){
+            QRect square(rect.left() + lock.x[i] * square_side_, rect.top() + lock.y[i] * square_side_,
+                         square_side_, square_side_);
+            painter.fillRect(square.adjusted(-grow, -grow, grow, grow), glow_color);
+            drawSquare(painter, square.left(), square.top(), lock.shape, alpha_color);
+        }
+    }
+}
+
+/**
+ * @brief Returns the widget area covered by the running animations.
+ *
+ * Only the animated rows are repainted while an animation runs.
+ *
+ * @return The animated area, or an empty rectangle if no animation is running.
+ */
+QRect TetrisBoard::animatedRect() const
+{
+    int first_row = animations_.firstAnimatedRow();
+    int last_row = animations_.lastAnimatedRow();
+    if(first_row < 0)
+        return QRect();
+
+    QRect rect = contentsRect();
+    int margin = square_side_ / 4 + 1; // lock pop grows outside the squares
+    return QRect(rect.left(), rect.top() + first_row * square_side_,
+                 rect.width(), (last_row - first_row + 1) * square_side_)
+        .adjusted(0, -margin, 0, margin)
+        .intersected(rect);
+}
+
+/**
+ * @brief Returns the widget area covered by the current piece.
+ *
+ * @return The bounding rectangle of the current piece, or an empty rectangle if there is none.
+ */
+QRect TetrisBoard::currentPieceRect() const
+{
+    const TetrisPiece &piece = engine_.currentPiece();
+    if(piece.shape() == NoShape)
+        return QRect();
+
+    QRect rect = contentsRect();
+    return QRect(rect.left() + (engine_.currentX() + piece.minX()) * square_side_,
+                 rect.top() + (engine_.currentY() + piece.minY()) * square_side_,
+                 (piece.maxX() - piece.minX() + 1) * square_side_,
+                 (piece.maxY() - piece.minY() + 1) * square_side_);
+}
+
+/**
+ * @brief Returns the widget area covered by the hint.
+ *
+ * @return The bounding rectangle of the hint squares, or an empty rectangle if there is no hint.
+ */
+QRect TetrisBoard::hintRect() const
+{
+    if(hint_piece_ < 0)
+        return QRect();
+
+    QRect bounds;
+    QRect rect = contentsRect();
+    for(const QPoint &square : hint_squares_)
+        bounds |= QRect(rect.left() + square.x() * square_side_, rect.top() + square.y() * square_side_,
+                        square_side_, square_side_);
+    return bounds;
+}
+
+/**
+ * @brief Returns whether the hint is drawn.
+ *
+ * A hint is only drawn during a live game, while the piece it has been found for is the
+ * current piece: it disappears by itself once the piece locks.
+ *
+ * @return true if the hint belongs to the current piece.
+ */
+bool TetrisBoard::isHintShown() const
+{
+    return hint_piece_ >= 0 && isPlaying() && engine_.seed() == hint_seed_ && engine_.piecesDropped() == hint_piece_;
+}
+
 /**
  * @brief Handles timer events for the Tetris game.
  *
  * Overrides the default timerEvent function. If the timer event is triggered
- * it calls the `oneLineDown()` method to move the current Tetris piece
- * down one line. If the timer event is not from the game timer, it delegates the event
- * handling to the base class (QFrame) implementation.
+ * it runs all the engine ticks that are due according to the game clock, see
+ * `processTicks()`, or the replay ticks due at the playback speed, see `advanceReplay()`,
+ * and repaints the rows of the running animations. If the timer event is not from the
+ * game timer, it delegates the event handling to the base class (QFrame) implementation.
  *
  * @param event Pointer to the QTimerEvent object representing the timer event.
  */
 void TetrisBoard::timerEvent(QTimerEvent *event){
     if(event->timerId() == timer_.timerId()){
-        // std::cout << "Timout event passed" << std::endl;
-        oneLineDown();
+        if(is_replaying_)
+            advanceReplay(clock_.elapsed());
+        else
+            processTicks(gameTime());
+
+        // Animations follow the engine tick: only their rows are repainted
+        if(animations_.isActive()){
+            QRect animated_rect = animatedRect();
+            animations_.advance(clock_.elapsed());
+            update(animated_rect.united(animatedRect()));
+        }
     } else {
         QFrame::timerEvent(event);
     }
 }
 
+/**
+ * @brief Runs every engine tick whose boundary has been reached.
+ *
+ * The game clock is split in ticks of `tick_ms` milliseconds. For every tick ending
+ * before `now_ms`, the inputs queued with a timestamp up to the tick boundary are
+ * taken from the input queue and handed to the engine together, in queue order.
+ * A late Qt timer only delays the ticks, it never changes which tick an input
+ * belongs to, so the same input stream always produces the same game. Applied inputs are
+ * recorded in the replay together with their tick, the engine state every
+ * KEYFRAME_TICKS ticks, so that the replay can be seeked, and the state hash
+ * whenever it changed, so that a replay going out of sync shows where.
+ * When the performance HUD is shown, every tick is timed (ticks removing lines are
+ * also recorded separately).
+ *
+ * @param now_ms Current game time in milliseconds.
+ */
+void TetrisBoard::processTicks(qint64 now_ms)
+{
+    const qint64 tick_ms = engine_.rules().tick_ms;
+
+    while(!engine_.isLost() && qint64(engine_.tickCount() + 1) * tick_ms <= now_ms){
+        const qint64 boundary = qint64(engine_.tickCount() + 1) * tick_ms;
+
+        if(replay_encoder_.isRecording() && engine_.tickCount() > 0
+           && engine_.tickCount() % TetrisReplay::KEYFRAME_TICKS == 0){
+            engine_.saveState(keyframe_state_);
+            replay_encoder_.addKeyframe(keyframe_state_);
+        }
+        if(replay_encoder_.isRecording() && engine_.stateHash() != recorded_hash_){
+            recorded_hash_ = engine_.stateHash();
+            replay_encoder_.addHash(engine_.tickCount(), recorded_hash_);
+        }
+
+        TetrisInput input;
+        tick_inputs_.clear();
+        while(input_queue_.peek(input) && input.timestamp_ms <= boundary){
+            input_queue_.pop(input);
+            tick_inputs_.append(input);
+            replay_encoder_.addInput(engine_.tickCount(), input.action);
+        }
+
+        const bool is_measured = PerfCounter::isEnabled();
+        QElapsedTimer tick_timer;
+        if(is_measured)
+            tick_timer.start();
+
+        engine_.step(tick_inputs_.constData(), int(tick_inputs_.size()));
+
+        if(is_measured){
+            quint64 tick_ns = tick_timer.nsecsElapsed();
+            tick_counter_.record(tick_ns);
+            for(const TetrisEvent &event : engine_.events()){
+                if(event.type == LinesCleared)
+                    clear_counter_.record(tick_ns);
+            }
+        }
+
+        handleEngineEvents();
+    }
+
+    if(replay_encoder_.buffer().size() >= REPLAY_CHUNK_BYTES)
+        flushReplay();
+}
+
+/**
+ * @brief Plays the replay ticks due since the last timer event.
+ *
+ * The wall clock time elapsed is scaled by the playback speed; the fraction of a
+ * tick left is kept for the next call, so slow speeds also play every tick.
+ * Playback stops at the end of the replay.
+ *
+ * @param now_ms Current time of the board clock in milliseconds.
+ */
+void TetrisBoard::advanceReplay(qint64 now_ms)
+{
+    const uint64_t first_tick = replay_player_.tick();
+
+    replay_ticks_due_ += double(now_ms - last_replay_frame_ms_) * replay_speed_ / engine_.rules().tick_ms;
+    last_replay_frame_ms_ = now_ms;
+
+    while(replay_ticks_due_ >= 1.0 && replay_player_.stepTick()){
+        replay_ticks_due_ -= 1.0;
+        handleEngineEvents();
+    }
+
+    if(replay_player_.isAtEnd()){
+        timer_.stop();
+        replay_ticks_due_ = 0.0;
+        emit replayFinished();
+    }
+
+    if(replay_player_.tick() != first_tick)
+        emit replayPositionChanged(replayPosition());
+}
+
+/**
+ * @brief Reacts to the events produced by the last engine tick.
+ *
+ * Updates the score displays, the next piece preview, starts the lock and line clear
+ * animations and stops the game when lost. Animations are skipped when a replay is played
+ * faster than real time. When only the current piece moved, just
+ * its old and new areas are repainted; otherwise the static layer is invalidated and
+ * the whole board is repainted. pieceSpawned() is emitted last, once the board is up
+ * to date. In practice mode, the state at each spawn is kept for rewind().
+ */
+void TetrisBoard::handleEngineEvents()
+{
+    const std::vector<TetrisEvent> &events = engine_.events();
+    if(events.empty())
+        return;
+
+    const qint64 now = clock_.elapsed();
+    bool is_locked = false, is_cleared = false, is_spawned = false;
+
+    for(const TetrisEvent &event : events){
+        switch(event.type){
+        case ScoreChanged:
+            emit updateScoreLcd(event.value);
+            if(event.value > best_score_)
+                emit updateBestScoreLcd(event.value);
+            break;
+        case PieceSpawned:
+            showNextPiece();
+            is_spawned = true;
+            if(is_rewind_enabled_ && !is_replaying_){
+                engine_.saveState(rewind_state_);
+                rewind_buffer_.push(rewind_state_);
+            }
+            break;
+        case PieceLocked:
+            is_locked = true;
+            break;
+        case LinesCleared:
+            is_cleared = true;
+            break;
+        case GameLost:
+            timer_.stop();
+            finishReplay();
+            animations_.clear();
+            is_static_layer_dirty_ = true;
+            if(!is_replaying_){
+                discardSuspendedGame();
+                emit gameLost(event.value);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    const bool is_animated = !is_replaying_ || replay_speed_ <= 1.0;
+    if(is_cleared && is_animated)
+        animations_.startLineClear(engine_.lastClear(), now);
+    else if(is_locked && is_animated)
+        animations_.startLock(engine_.lastLock(), now);
+
+    QRect piece_rect = currentPieceRect();
+    if(is_locked || is_static_layer_dirty_){
+        is_static_layer_dirty_ = true;
+        update();
+    }else{
+        update(last_piece_rect_.united(piece_rect));
+    }
+    last_piece_rect_ = piece_rect;
+
+    if(is_spawned)
+        emit pieceSpawned();
+}
+
+/**
+ * @brief Queues a player action for the next tick boundary.
+ *
+ * The action is stamped with the current game time and pushed into the lock-free
+ * input queue; it is applied by the engine at the first tick boundary after that
+ * time. It can be called from any thread (e.g. to inject inputs from a bot).
+ *
+ * @param action The action to queue.
+ * @return true if the action has been queued, false if the queue is full.
+ */
+bool TetrisBoard::pushInput(TetrisAction action)
+{
+    TetrisInput input;
+    input.timestamp_ms = quint32(qMax<qint64>(0, gameTime()));
+    input.action = action;
+    return input_queue_.push(input);
+}
+
+/**
+ * @brief Returns the directory where the game replays are saved.
+ *
+ * @return The replay directory, inside the application data location.
+ */
+QString TetrisBoard::replayDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/replays";
+}
+
+/**
+ * @brief Returns the path of the file the game in progress is suspended to.
+ *
+ * @return The suspended game file, inside the application data location.
+ */
+QString TetrisBoard::suspendedGamePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/suspended_game.atsg";
+}
+
+/**
+ * @brief Starts recording the game just started.
+ *
+ * Opens a new replay file (named after the current date and time) on the writer
+ * thread and writes the replay header: seed and rules of the engine.
+ */
+void TetrisBoard::startReplay()
+{
+    replay_path_ = replayDirectory() + "/tetris_"
+                   + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss_zzz") + ".atrp";
+    replay_writer_->openFile(replay_path_);
+    recorded_replay_.clear();
+    replay_encoder_.begin(engine_.rules(), engine_.seed());
+    recorded_hash_ = engine_.stateHash();
+    replay_encoder_.addHash(0, recorded_hash_);
+}
+
+/**
+ * @brief Ends the recording of the current game, if any.
+ *
+ * Writes the final state of the game, hands the remaining bytes to the writer
+ * thread and closes the file.
+ */
+void TetrisBoard::finishReplay()
+{
+    if(!replay_encoder_.isRecording())
+        return;
+
+    if(engine_.stateHash() != recorded_hash_)
+        replay_encoder_.addHash(engine_.tickCount(), engine_.stateHash());
+    replay_encoder_.finish(engine_.tickCount(), engine_.score(),
+                           engine_.linesRemoved(), engine_.piecesDropped());
+    flushReplay();
+    replay_writer_->closeFile();
+}
+
+/**
+ * @brief Hands the recorded bytes to the writer thread.
+ *
+ * Called every REPLAY_CHUNK_BYTES bytes and at the end of the game. Never waits
+ * for the file to be written. The bytes are also kept in recordedReplay(), for the
+ * score of the game to be verified once it is over.
+ */
+void TetrisBoard::flushReplay()
+{
+    std::vector<uint8_t> &buffer = replay_encoder_.buffer();
+    if(buffer.empty())
+        return;
+
+    const QByteArray chunk(reinterpret_cast<const char*>(buffer.data()), qsizetype(buffer.size()));
+    recorded_replay_.append(chunk);
+    replay_writer_->writeData(chunk);
+    buffer.clear();
+}
+
 /**
  * @brief Handles key release events for controlling the Tetris game.
  *
  * Overrides the default keyReleaseEvent function. Controls include releasing the space
  * key to return to normal speed after speeding up the descent of the current Tetris piece.
- * If the game is not started, paused, or there is no current piece, the event is delegated
- * to the base class (QFrame) implementation.
+ * As for key presses, the action is queued for the next tick boundary. If the game is not
+ * started, paused, or there is no current piece, the event is delegated to the base class
+ * (QFrame) implementation.
  *
  * @param event Pointer to the QKeyEvent object representing the key release event.
  */
 void TetrisBoard::keyReleaseEvent(QKeyEvent *event)
 {
-    if (!is_started_ || is_paused_ || curr_piece_.shape() == NoShape) {
+    if (!is_started_ || is_paused_ || is_replaying_ || engine_.currentPiece().shape() == NoShape) {
         QFrame::keyReleaseEvent(event);
         return;
     }
@@ -120,7 +627,7 @@ void TetrisBoard::keyReleaseEvent(QKeyEvent *event)
     switch (event->key()) {
     case Qt::Key_Space:
         // std::cout << "SPACE RELEASED." << std::endl;
-        backToNormalSpeed();
+        pushInput(SoftDropOff);
         break;
     default:
         QFrame::keyReleaseEvent(event);
@@ -131,15 +638,33 @@ void TetrisBoard::keyReleaseEvent(QKeyEvent *event)
  * @brief Handles key press events for controlling the Tetris game.
  *
  * Overrides the default keyPressEvent. Controls include moving the current Tetris piece
- * left, right, rotating it left or right, and speeding up its descent. If the game is not started,
- * paused, or there is no current piece, the event is delegated to the base class
- * (QFrame) implementation.
+ * left, right, rotating it left or right, and speeding up its descent. Keys are not applied
+ * here: they are queued with their timestamp and applied at the next tick boundary. F3 toggles
+ * the performance HUD at any time. While a replay is shown, left and right step it one tick
+ * backward or forward. In practice mode, backspace rewinds the game one piece, see
+ * rewind(). If the game is not started, paused, or there is no current piece, the event
+ * is delegated to the base class (QFrame) implementation.
  *
  * @param event Pointer to the QKeyEvent object representing the key press event.
  */
 void TetrisBoard::keyPressEvent(QKeyEvent *event)
 {
-    if (!is_started_ || is_paused_ || curr_piece_.shape() == NoShape) {
+    if(event->key() == Qt::Key_F3){
+        perf_overlay_->toggle();
+        return;
+    }
+
+    if(is_replaying_){
+        if(event->key() == Qt::Key_Left)
+            stepReplay(-1);
+        else if(event->key() == Qt::Key_Right)
+            stepReplay(1);
+        else
+            QFrame::keyPressEvent(event);
+        return;
+    }
+
+    if (!is_started_ || is_paused_ || engine_.currentPiece().shape() == NoShape) {
         QFrame::keyPressEvent(event);
         return;
     }
@@ -151,23 +676,27 @@ void TetrisBoard::keyPressEvent(QKeyEvent *event)
     switch (event->key()) {
     case Qt::Key_Left:
         // std::cout << "LEFT" << std::endl;
-        tryMove(curr_piece_, curr_x_ - 1, curr_y_);
+        pushInput(MoveLeft);
         break;
     case Qt::Key_Right:
         // std::cout << "RIGHT" << std::endl;
-        tryMove(curr_piece_, curr_x_ + 1, curr_y_);
+        pushInput(MoveRight);
         break;
     case Qt::Key_Up:
         // std::cout << "ROTATING LEFT" << std::endl;
-        tryMove(curr_piece_.rotatedLeft(), curr_x_, curr_y_);
+        pushInput(RotateLeft);
         break;
     case Qt::Key_Down:
         // std::cout << "ROTATING RIGHT" << std::endl;
-        tryMove(curr_piece_.rotatedRight(), curr_x_, curr_y_);
+        pushInput(RotateRight);
         break;
     case Qt::Key_Space:
         // std::cout << "SPACE PRESSED. " << std::endl;
-        speedUp();
+        pushInput(SoftDropOn);
+        break;
+    case Qt::Key_Backspace:
+        if(!rewind(1))
+            QFrame::keyPressEvent(event);
         break;
     default:
         QFrame::keyPressEvent(event);
@@ -233,13 +762,13 @@ void TetrisBoard::drawBackgroundGrid(QPainter &painter, int alpha_color = 255)
     painter.setPen(QPen(color, 1, Qt::SolidLine));
 
     // Draw vertical lines
-    for (int i = 1; i < board_width_steps_; ++i) {
+    for (int i = 1; i < engine_.width(); ++i) {
         int x = rect.left() + i * square_side_;
         painter.drawLine(x, rect.top(), x, rect.bottom());
     }
 
     // // Draw horizontal lines
-    for (int i = 1; i < board_height_steps_; ++i) {
+    for (int i = 1; i < engine_.height(); ++i) {
         int y = rect.top() + i * square_side_;
         painter.drawLine(rect.left(), y, rect.right(), y);
     }
@@ -262,10 +791,14 @@ void TetrisBoard::drawPlacedPieces(QPainter &painter, int alpha_color)
     QRect rect = contentsRect();
 
     // qDebug() << "Drawing OLD pieces" ;
-    // Drawing back all past squares (stored in board_)
-    for(int i = 0; i<board_height_steps_; ++i){
-        for (int j = 0; j<board_width_steps_; ++j){
-            TetrisShape shape = shapeAt(j, i);
+    // Drawing back all past squares (stored in the engine)
+    for(int i = 0; i<engine_.height(); ++i){
+        // Skipping empty rows using the row mask
+        if(engine_.rowBits(i) == 0)
+            continue;
+
+        for (int j = 0; j<engine_.width(); ++j){
+            TetrisShape shape = engine_.shapeAt(j, i);
             if (shape != NoShape){
                 drawSquare(painter, rect.left() + j * square_side_,
                            rect.top() + i * square_side_,
@@ -290,46 +823,34 @@ void TetrisBoard::drawCurrentPiece(QPainter &painter, int alpha_color)
 
     // qDebug() << "Drawing NEW piece" ;
     // Drawing new piece
-    if (curr_piece_.shape() != NoShape) {
+    const TetrisPiece &piece = engine_.currentPiece();
+    if (piece.shape() != NoShape) {
         for (int i = 0; i < 4; ++i) {
-            int x = curr_x_ + curr_piece_.x(i);
-            int y = curr_y_ + curr_piece_.y(i);
+            int x = engine_.currentX() + piece.x(i);
+            int y = engine_.currentY() + piece.y(i);
             drawSquare(painter, rect.left() + x * square_side_,
                        rect.top() + y*square_side_,
-                       curr_piece_.shape(), alpha_color);
+                       piece.shape(), alpha_color);
         }
     }
 }
 
 /**
- * @brief Display a new piece in the game.
+ * @brief Draws the outline of the squares of the hint.
+ *
+ * The squares are computed once, by setHint(): only four rectangles are drawn here.
  *
- * Sets the current piece to be the previously shown next piece, generates a new random piece
- * for the next piece preview, updates and displays the next piece preview on the QLabel widget,
- * positions the current piece in the middle of the board's width, and attempts to place it at
- * the top of the board. If the new piece cannot be placed due to lack of space, the game is
- * considered lost, the current piece is set to NoShape, and the game stops with a signal emitted.
+ * @param painter Reference to the QPainter object used for drawing.
  */
-void TetrisBoard::newPiece()
+void TetrisBoard::drawHint(QPainter &painter)
 {
-    curr_piece_ = next_piece_;
-    next_piece_.setRandomShape();
-    // qDebug() << "[NEWPIECE] Current piece: " << curr_piece_.shape();
-    // qDebug() << "[NEWPIECE] Next selected piece: " << next_piece_.shape();
-    showNextPiece();
-    curr_x_ = board_width_steps_ / 2;
-    curr_y_ = qAbs(curr_piece_.minY());
-
-    // qDebug() << "[NEWPIECE] Trying positioning new piece top. Curr coords: " << curr_x_ << ", " << curr_y_;
-    if (!tryMove(curr_piece_, curr_x_, curr_y_)) {
-        // qDebug() << "New piece no have space, setting noShape.";
-        curr_piece_.setShape(NoShape);
-        is_lost_ = true;
-        timer_.stop();
-        emit gameLost(score_);
-        update();
-    }
-    // qDebug() << "NewPiece completed.";
+    QRect rect = contentsRect();
+
+    painter.setPen(QPen(QColor(0, 0, 0, 160), 2));
+    painter.setBrush(Qt::NoBrush);
+    for(const QPoint &square : hint_squares_)
+        painter.drawRect(rect.left() + square.x() * square_side_ + 2, rect.top() + square.y() * square_side_ + 2,
+                         square_side_ - 4, square_side_ - 4);
 }
 
 /**
@@ -358,18 +879,19 @@ void TetrisBoard::showNextPiece()
     if(!next_piece_label_)
         return;
 
-    int dx  = next_piece_.maxX() - next_piece_.minX() + 1;
-    int dy  = next_piece_.maxY() - next_piece_.minY() + 1;
+    const TetrisPiece &next_piece = engine_.nextPiece();
+    int dx  = next_piece.maxX() - next_piece.minX() + 1;
+    int dy  = next_piece.maxY() - next_piece.minY() + 1;
 
     QPixmap pixmap(dx*square_side_, dy*square_side_);
     QPainter painter(&pixmap);
     painter.fillRect(pixmap.rect(), next_piece_label_->palette().window());
 
     for(int i = 0; i < 4; i++){
-        int x = next_piece_.x(i) - next_piece_.minX();
-        int y = next_piece_.y(i) - next_piece_.minY();
+        int x = next_piece.x(i) - next_piece.minX();
+        int y = next_piece.y(i) - next_piece.minY();
 
-        drawSquare(painter, x*square_side_, y*square_side_, next_piece_.shape());
+        drawSquare(painter, x*square_side_, y*square_side_, next_piece.shape());
     }
 
     next_piece_label_->setPixmap(pixmap);
@@ -377,302 +899,462 @@ void TetrisBoard::showNextPiece()
 }
 
 /**
- * @brief Moves the current piece one line down if possible.
+ * @brief Calculates and returns the size of the game board.
+ *
+ * Computes the total width and height of the game board including squares and frame borders,
+ * based on the square side length, number of steps in width and height, and the frame width.
  *
- * Attempts to move the current piece one line down. If the move is successful,
- * the piece's position is updated. If the move fails (piece cannot move down further),
- * the pieceDropped() method is called to finalize the piece's position on the board.
+ * @return QSize object representing the size of the game board.
  */
-void TetrisBoard::oneLineDown()
-{
-    if(!tryMove(curr_piece_, curr_x_, curr_y_ + 1))
-        pieceDropped();
+QSize TetrisBoard::getBoardSize(){
+    // qDebug() << "getBoardSize: [Width, Height]: " << square_side_*engine_.width() + 2*frameWidth() << "," <<square_side_*engine_.height() + 2*frameWidth();
+    return QSize(square_side_*engine_.width() + 2*frameWidth(),
+                 square_side_*engine_.height() + 2*frameWidth());
 }
 
 /**
- * @brief Attempts to move a piece to a new position on the board.
+ * @brief Sets the size of the game board.
  *
- * Checks if the new position for the piece is within the board boundaries and does not
- * overlap with existing pieces on the board. If the move is valid, updates the current
- * piece and its position, and triggers a board update.
+ * Resizes the board to the given dimensions, computes the number of squares
+ * in width and height and adjusts the widget size to match an integer multiple
+ * of squares. The number of columns is limited to TetrisEngine::MAX_WIDTH.
  *
- * @param new_piece The piece to move.
- * @param new_x The new x-coordinate for the piece.
- * @param new_y The new y-coordinate for the piece.
- * @return true if the piece can be moved to the new position, false otherwise.
+ * @param board_size The desired size of the board.
  */
-bool TetrisBoard::tryMove(const TetrisPiece &new_piece, int new_x, int new_y)
+void TetrisBoard::setBoardSize(QSize board_size)
 {
-    // qDebug() << "TryMove starting." ;
-    for(int i  = 0; i<4; ++i){
-        int x = new_piece.x(i) + new_x;
-        int y = new_piece.y(i) + new_y;
-
-        // qDebug() << "[tryMove] X and Y: " << new_piece.x(i) << ", " << new_piece.y(i) << " -- " << new_x << ", " << new_y;
-        if(x < 0 || x >= board_width_steps_ || y < 0 || y >= board_height_steps_)
-            return false;
+    // qDebug() << "setBoardSize started" ;
+    // Resizing with available dimension in the layout
+    resize(board_size);
 
-        if (shapeAt(x, y) != NoShape)
-            return false;
-    }
+    // Computing, given square side, number of squares per width and height
+    engine_.setBoardSize(contentsRect().width() / square_side_,
+                         contentsRect().height() / square_side_);
 
-    // qDebug() << "TryMove all pieces have space." ;
-    curr_piece_ = new_piece;
-    curr_x_ = new_x;
-    curr_y_ = new_y;
-    update();
+    // Resizing to have a int multiple of squares as actual widget size
+    setFixedSize(getBoardSize());
+    is_static_layer_dirty_ = true;
 
-    // qDebug() << "TryMove completed." ;
-    return true;
+    // qDebug() << "setBoardSize completed" ;
 }
 
 /**
- * @brief Handles actions after a piece has been dropped.
+ * @brief Starts a new game.
  *
- * Places the current piece on the board, increments the count of dropped pieces,
- * increases the score, updates the score display, checks for level up conditions,
- * removes full lines from the board, and spawns a new piece.
+ * Initializes game state, restarts the game clock, empties the input queue and the
+ * rewind buffer, drops the suspended game, starts the engine with a fresh seed, starts
+ * recording the replay and starts the tick timer.
+ * A replay being shown is closed first. gameInterrupted() is emitted so that background
+ * searches on the previous game are dropped.
  */
-void TetrisBoard::pieceDropped()
+void TetrisBoard::start()
 {
-    for (int i = 0; i < 4; ++i) {
-        int x = curr_x_ + curr_piece_.x(i);
-        int y = curr_y_ + curr_piece_.y(i);
-        // qDebug() << "X AND Y: " << x << ", " << y;
-        shapeAt(x, y) = curr_piece_.shape();
-    }
-
-    ++num_piece_dropped_;
-    score_+=10;
+    stopReplay();
+    emit gameInterrupted();
+    is_started_ = true;
+    is_paused_ = false;
 
-    emit updateScoreLcd(score_);
-    if(score_>best_score_)
-        emit updateBestScoreLcd(score_);
+    input_queue_.clear();
+    paused_time_ms_.storeRelaxed(0);
+    clock_.start();
 
+    animations_.clear();
+    is_static_layer_dirty_ = true;
+    finishReplay();
+    discardSuspendedGame();
+    is_rewound_ = false;
+    rewind_buffer_.reset(engine_.width(), engine_.height());
+    engine_.start(QRandomGenerator::global()->generate64());
+    startReplay();
+    handleEngineEvents();
 
-    if(num_piece_dropped_ % 25 == 0)
-        levelUp();
+    emit updateScoreLcd(engine_.score());
 
-    removeFullLines();
-    newPiece();
+    timer_.start(engine_.rules().tick_ms, Qt::PreciseTimer, this);
+    // std::cout << "Game logic has started. Timer started" << std::endl;
 }
 
 /**
- * @brief Removes full lines from the board and updates the score.
+ * @brief Shows where a piece should be placed (training mode).
+ *
+ * The hint is drawn as an outline while the given piece is the current one, see
+ * isHintShown(). Only its area is repainted.
  *
- * Checks each line on the board to see if it is full. If a line is full, it is removed
- * and all lines above it are moved down. The score is updated based on the number of
- * lines removed, and the level is increased if necessary.
+ * @param seed The seed of the game the piece belongs to.
+ * @param piece The number of pieces dropped before the piece.
+ * @param placement The placement to show, in board coordinates.
  */
-void TetrisBoard::removeFullLines()
+void TetrisBoard::setHint(quint64 seed, int piece, const TetrisPlacement &placement)
 {
-    int num_full_lines = 0;
+    update(hintRect());
 
-    for(int i = 0; i < board_height_steps_; i++){
-        bool is_line_full = true;
+    int count = 0;
+    for(int i = 0; i < 4; ++i){
+        for(quint32 bits = placement.rows[i]; bits != 0 && count < 4; bits &= bits - 1)
+            hint_squares_[count++] = QPoint(qCountTrailingZeroBits(bits), placement.top + i);
+    }
+    hint_seed_ = seed;
+    hint_piece_ = count == 4 ? piece : -1;
 
-        for(int j = 0; j < board_width_steps_; j++){
-            if(shapeAt(j, i) == TetrisShape::NoShape){
-                is_line_full = false;
-                break;
-            }
-        }
+    update(hintRect());
+}
 
-        // Counting
-        if(is_line_full){
-            num_full_lines++;
-            // qDebug() << "Line is full, REMOVE LINE: " << i;
-            // Move all line from 0 to actual found one
-            for(int y = i; y>=1; y--){
-                for(int x = 0; x < board_width_steps_; x++){
-                    shapeAt(x, y) = shapeAt(x, y-1);
-                }
-            }
-        }
+/**
+ * @brief Removes the hint, if any.
+ */
+void TetrisBoard::clearHint()
+{
+    update(hintRect());
+    hint_piece_ = -1;
+}
 
-        if(num_full_lines > 0){
-            // Increase level each level_up_range_ points
-            int prev_score_range = score_/level_up_range_;
-            updateScore(num_full_lines);
-            int curr_score_range = score_/level_up_range_;
-            if(curr_score_range>prev_score_range)
-                levelUp();
+/**
+ * @brief Resets the game state.
+ *
+ * This method resets the game to its initial state. It stops the game logic,
+ * sets the game as not started and not paused, and resets the score. The replay
+ * of an interrupted game is closed as it is, its suspended game dropped, a replay
+ * being shown is closed. gameInterrupted() is emitted.
+ */
+void TetrisBoard::reset()
+{
+    emit gameInterrupted();
+    stopReplay();
+    if(is_started_)
+        discardSuspendedGame();
+    finishReplay();
+    is_started_ = false;
+    is_paused_ = false;
+    engine_.stop();
+    timer_.stop();
+    // std::cout << "Game logic has stopped." << std::endl;
+}
 
-            emit updateScoreLcd(score_);
-            if(score_ > best_score_)
-                emit updateBestScoreLcd(score_);
+/**
+ * @brief Pauses the ongoing game.
+ *
+ * This method pauses the game if it is currently started. It stops the game timer
+ * and the game clock, and updates the game state. A live game is also suspended to
+ * disk, see suspend(). gameInterrupted() is emitted.
+ */
+void TetrisBoard::pause()
+{
+    if(!is_started_ || is_paused_)
+        return;
 
-        }
-    }
+    emit gameInterrupted();
+    is_paused_ = true;
+    timer_.stop();
+    pause_started_ms_ = clock_.elapsed();
+    suspend();
+    // std::cout << "Game has paused" << std::endl;
+    update();
 }
 
 /**
- * @brief Clears the Tetris board by resetting all board squares to NoShape.
+ * @brief Resumes the paused game.
  *
- * Resets the board by setting each square in the board array to NoShape,
- * indicating that no Tetris piece occupies that square. This method prepares the board
- * for a new game or after the game has ended.
+ * This method resumes the game if it is currently paused. The paused time is removed
+ * from the game clock, then the tick timer is restarted. A replay resumes playing from
+ * where it has been paused. gameResumed() is emitted.
  */
-void TetrisBoard::clearBoard()
+void TetrisBoard::resume()
 {
-    // qDebug() << "clearBoard started" ;
-    for (int i = 0; i < board_height_steps_ * board_width_steps_; ++i)
-        board_[i] = NoShape;
+    if(!is_paused_)
+        return;
 
-    // qDebug() << "clearBoard completed" ;
+    is_paused_ = false;
+    paused_time_ms_.fetchAndAddRelaxed(clock_.elapsed() - pause_started_ms_);
+    last_replay_frame_ms_ = clock_.elapsed();
+    if(is_replaying_ ? !replay_player_.isAtEnd() : !engine_.isLost())
+        timer_.start(engine_.rules().tick_ms, Qt::PreciseTimer, this);
+    // std::cout << "Game has resumed after paused." << std::endl;
+    update();
+    emit gameResumed();
 }
 
 /**
- * @brief Increases the game speed by reducing the timeout interval.
+ * @brief Turns the practice mode rewind on or off.
+ *
+ * The pieces played before are forgotten: turned on during a game, the rewind goes
+ * back to the pieces spawned from then on only.
  *
- * Decreases the timeout interval (`timeout_time_`) by 20% of its current value,
- * which effectively speeds up the falling of Tetris pieces. Restarts the timer
- * with the updated timeout interval.
+ * @param enabled true to keep the state at each spawn, see rewind().
  */
-void TetrisBoard::levelUp()
+void TetrisBoard::setRewindEnabled(bool enabled)
 {
-    timeout_time_ -= qRound( static_cast<float>(20 * timeout_time_) / 100 );
-    timer_.stop();
-    timer_.start(timeout_time_, this);
-    // std::cout << "Leveled up, timeout = " <<  timeout_time_ << std::endl;
+    is_rewind_enabled_ = enabled;
+    rewind_buffer_.reset(engine_.width(), engine_.height());
 }
 
 /**
- * @brief Updates the score based on the number of lines removed.
+ * @brief Takes the game back to the spawn of an earlier piece (practice mode).
  *
- * Adds points to the score based on the number of lines removed in a single move.
+ * The state comes from the rewind buffer: nothing is replayed, the cost does not
+ * depend on the length of the game. The game clock is moved back with the engine
+ * tick, the queued inputs are dropped. Once the earlier state is known to load, the
+ * replay is closed as it was when the game left the rules: a rewound game never
+ * reaches the leaderboard, see isRewound(). Nothing changes if it does not load.
  *
- * @param lines_removed The number of lines removed.
+ * @param pieces Number of pieces to take back, limited to the pieces kept by the buffer.
+ * @return true if the game has been rewound, false if rewind is disabled, the game is
+ * not being played or no earlier piece is kept.
  */
-void TetrisBoard::updateScore(const int lines_removed)
+bool TetrisBoard::rewind(int pieces)
 {
-    switch (lines_removed) {
-    case 1:
-        score_+=40;
-        break;
-    case 2:
-        score_+=100;
-        break;
-    case 3:
-        score_+=300;
-        break;
-    case 4:
-        score_+=1200;
-        break;
-    }
+    if(!is_rewind_enabled_ || !isPlaying() || pieces < 1 || rewind_buffer_.size() < 2)
+        return false;
+
+    const int steps = rewind_buffer_.peek(pieces, rewind_state_);
+    if(steps == 0 || !engine_.isPlayable(rewind_state_))
+        return false;
+
+    finishReplay();
+    rewind_buffer_.drop(steps);
+    engine_.loadState(rewind_state_);
+
+    is_rewound_ = true;
+    input_queue_.clear();
+    paused_time_ms_.fetchAndAddRelaxed(gameTime() - qint64(engine_.tickCount()) * engine_.rules().tick_ms);
+
+    animations_.clear();
+    is_static_layer_dirty_ = true;
+    last_piece_rect_ = currentPieceRect();
+    showNextPiece();
+    emit updateScoreLcd(engine_.score());
+    emit pieceSpawned();
+    update();
+    return true;
 }
 
 /**
- * @brief Calculates and returns the size of the game board.
+ * @brief Saves the live game in progress to suspendedGamePath().
  *
- * Computes the total width and height of the game board including squares and frame borders,
- * based on the square side length, number of steps in width and height, and the frame width.
+ * The engine state at the last tick boundary is written with the replay recorded
+ * so far; queued inputs not applied yet are dropped. Only the serialization runs
+ * here, in a few microseconds: the file is written by a background thread and
+ * replaces the previous one atomically, so the application can be stopped at any
+ * time without leaving half a saved game. Nothing happens without a live game.
  *
- * @return QSize object representing the size of the game board.
+ * @return true if the game has been saved, false if there is no live game.
  */
-QSize TetrisBoard::getBoardSize(){
-    // qDebug() << "getBoardSize: [Width, Height]: " << square_side_*board_width_steps_ + 2*frameWidth() << "," <<square_side_*board_height_steps_ + 2*frameWidth();
-    return QSize(square_side_*board_width_steps_ + 2*frameWidth(),
-                 square_side_*board_height_steps_ + 2*frameWidth());
+bool TetrisBoard::suspend()
+{
+    if(!is_started_ || is_replaying_ || engine_.isLost())
+        return false;
+
+    flushReplay();
+    suspended_game_.rules = engine_.rules();
+    engine_.saveState(suspended_game_.state);
+    suspended_game_.is_rewound = is_rewound_;
+    suspended_game_.has_replay = replay_encoder_.isRecording();
+    suspended_game_.replay_tick = replay_encoder_.lastTick();
+    suspended_game_.replay.assign(recorded_replay_.constBegin(), recorded_replay_.constEnd());
+
+    suspended_bytes_.clear();
+    suspended_game_.encode(suspended_bytes_);
+    suspend_writer_->openFile(suspendedGamePath());
+    suspend_writer_->writeData(QByteArray(reinterpret_cast<const char*>(suspended_bytes_.data()),
+                                          qsizetype(suspended_bytes_.size())));
+    suspend_writer_->closeFile();
+    return true;
 }
 
 /**
- * @brief Sets the size of the game board.
+ * @brief Resumes the game saved by suspend(), paused.
  *
- * Resizes the board to the given dimensions, computes the number of squares
- * in width and height and adjusts the widget size to match an integer multiple
- * of squares.
+ * The engine is loaded from the saved state, nothing is replayed: reading and
+ * restoring take well under a millisecond. The replay recorded before the
+ * suspension is written again to a new replay file and recorded on from there, so
+ * that the score of a resumed game can still enter the leaderboard. The saved game
+ * is kept until the game ends, in case the application stops again before the next
+ * suspension.
  *
- * @param board_size The desired size of the board.
+ * The saved game is checked before anything is touched: if it cannot be resumed,
+ * the live game and its replay go on as they were.
+ *
+ * @return true if the game has been resumed, false if there is no saved game, if
+ * it does not have the rules and board size of the live game or cannot be played.
  */
-void TetrisBoard::setBoardSize(QSize board_size)
+bool TetrisBoard::loadSuspendedGame()
 {
-    // qDebug() << "setBoardSize started" ;
-    // Resizing with available dimension in the layout
-    resize(board_size);
+    QFile file(suspendedGamePath());
+    if(is_replaying_ || !file.open(QIODevice::ReadOnly))
+        return false;
 
-    // Computing, given square side, number of squares per width and height
-    board_width_steps_ = contentsRect().width() / square_side_;
-    board_height_steps_ = contentsRect().height() / square_side_;
+    const QByteArray data = file.readAll();
+    if(!suspended_game_.decode(reinterpret_cast<const uint8_t*>(data.constData()), size_t(data.size()))
+       || suspended_game_.rules != engine_.rules() || !engine_.isPlayable(suspended_game_.state))
+        return false;
 
-    // Resizing to have a int multiple of squares as actual widget size
-    setFixedSize(getBoardSize());
+    emit gameInterrupted();
+    finishReplay();
+    engine_.loadState(suspended_game_.state);
 
-    // Updating all variable linked to size
-    board_.resize(board_width_steps_ * board_height_steps_);
-    clearBoard();
+    is_started_ = true;
+    is_paused_ = true;
+    is_rewound_ = suspended_game_.is_rewound;
+    rewind_buffer_.reset(engine_.width(), engine_.height());
+    input_queue_.clear();
+
+    // The game clock goes on from the saved tick once resumed
+    clock_.start();
+    paused_time_ms_.storeRelaxed(-qint64(engine_.tickCount()) * engine_.rules().tick_ms);
+    pause_started_ms_ = clock_.elapsed();
+
+    recorded_replay_.clear();
+    if(suspended_game_.has_replay){
+        replay_path_ = replayDirectory() + "/tetris_"
+                       + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss_zzz") + ".atrp";
+        replay_writer_->openFile(replay_path_);
+        recorded_replay_.append(reinterpret_cast<const char*>(suspended_game_.replay.data()),
+                                qsizetype(suspended_game_.replay.size()));
+        replay_writer_->writeData(recorded_replay_);
+        replay_encoder_.resume(suspended_game_.replay_tick);
+        recorded_hash_ = engine_.stateHash();
+        replay_encoder_.addHash(engine_.tickCount(), recorded_hash_);
+    }
 
-    // qDebug() << "setBoardSize completed" ;
+    animations_.clear();
+    is_static_layer_dirty_ = true;
+    last_piece_rect_ = currentPieceRect();
+    showNextPiece();
+    emit updateScoreLcd(engine_.score());
+    update();
+    return true;
 }
 
 /**
- * @brief Starts a new game.
+ * @brief Drops the suspended game file, once its game is over or abandoned.
+ */
+void TetrisBoard::discardSuspendedGame()
+{
+    suspend_writer_->removeFile(suspendedGamePath());
+}
+
+/**
+ * @brief Loads a replay file and starts playing it on the board.
+ *
+ * A game in progress is stopped and its replay closed. The board takes the size of the
+ * replayed game; the live size is restored by stopReplay().
  *
- * Initializes game state, resets the timeout, updates the score display,
- * clears the board, spawns a new piece, and starts the game timer.
+ * @param path Path of the replay file.
+ * @return true if the replay is playing, false if the file cannot be read or is not a valid replay.
  */
-void TetrisBoard::start()
+bool TetrisBoard::loadReplay(const QString &path)
 {
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QByteArray data = file.readAll();
+    TetrisReplay replay;
+    if(!replay.decode(reinterpret_cast<const uint8_t*>(data.constData()), size_t(data.size()))
+       || replay.rules.width > TetrisEngine::MAX_WIDTH || replay.rules.tick_ms <= 0)
+        return false;
+
+    timer_.stop();
+    finishReplay();
+    if(!is_replaying_)
+        live_rules_ = engine_.rules();
+
+    replay_player_.load(std::move(replay));
+    is_replaying_ = true;
     is_started_ = true;
-    is_lost_ = false;
+    is_paused_ = false;
+    setFixedSize(getBoardSize());
 
-    resetTimeout();
+    clock_.start();
+    last_replay_frame_ms_ = 0;
+    replay_ticks_due_ = 0.0;
+    showReplayState();
 
-    num_piece_dropped_ = 0;
+    timer_.start(engine_.rules().tick_ms, Qt::PreciseTimer, this);
+    return true;
+}
 
-    emit updateScoreLcd(score_);
+/**
+ * @brief Moves the replay to the given time.
+ *
+ * Costs at most TetrisReplay::KEYFRAME_TICKS engine ticks, see TetrisReplayPlayer::seek().
+ * Playback goes on from there if it was playing.
+ *
+ * @param position_ms Time from the start of the replay in milliseconds.
+ */
+void TetrisBoard::seekReplay(qint64 position_ms)
+{
+    if(!is_replaying_)
+        return;
 
-    clearBoard();
-    newPiece();
-    timer_.start(timeout_time_, this);
-    // std::cout << "Game logic has started. Timer started" << std::endl;
+    replay_player_.seek(uint64_t(qMax<qint64>(0, position_ms) / engine_.rules().tick_ms));
+    replay_ticks_due_ = 0.0;
+    showReplayState();
+
+    if(!is_paused_ && !replay_player_.isAtEnd() && !timer_.isActive()){
+        last_replay_frame_ms_ = clock_.elapsed();
+        timer_.start(engine_.rules().tick_ms, Qt::PreciseTimer, this);
+    }
 }
 
 /**
- * @brief Resets the game state.
+ * @brief Sets the replay playback speed.
  *
- * This method resets the game to its initial state. It stops the game logic,
- * sets the game as not started and not paused, and resets the score.
+ * @param speed Multiplier of the real game speed, clamped to [MIN_REPLAY_SPEED, MAX_REPLAY_SPEED].
  */
-void TetrisBoard::reset()
+void TetrisBoard::setReplaySpeed(double speed)
 {
-    is_started_ = false;
-    is_paused_ = false;
-    score_ = 0;
-    timer_.stop();
-    // std::cout << "Game logic has stopped." << std::endl;
+    replay_speed_ = qBound(MIN_REPLAY_SPEED, speed, MAX_REPLAY_SPEED);
+    if(replay_speed_ > 1.0)
+        animations_.clear();
 }
 
 /**
- * @brief Pauses the ongoing game.
+ * @brief Pauses the replay and moves it by a number of ticks.
  *
- * This method pauses the game if it is currently started. It stops the game timer
- * and updates the game state.
+ * @param ticks Number of ticks to move, negative to step backward.
  */
-void TetrisBoard::pause()
+void TetrisBoard::stepReplay(int ticks)
 {
-    if(!is_started_)
+    if(!is_replaying_)
         return;
 
-    is_paused_ = true;
-    timer_.stop();
-    // std::cout << "Game has paused" << std::endl;
-    update();
+    pause();
+    qint64 tick = qMax<qint64>(0, qint64(replay_player_.tick()) + ticks);
+    seekReplay(tick * engine_.rules().tick_ms);
 }
 
 /**
- * @brief Resumes the paused game.
+ * @brief Stops showing the replay and brings the board back to the welcome screen.
  *
- * This method resumes the game if it is currently paused. It restarts the game timer
- * and updates the game state.
+ * The board size of the live game is restored.
  */
-void TetrisBoard::resume()
+void TetrisBoard::stopReplay()
 {
-    if(!is_paused_)
+    if(!is_replaying_)
         return;
 
+    timer_.stop();
+    is_replaying_ = false;
+    is_started_ = false;
     is_paused_ = false;
-    timer_.start(timeout_time_, this);
-    // std::cout << "Game has resumed after paused." << std::endl;
+    animations_.clear();
+
+    engine_ = TetrisEngine(live_rules_);
+    setFixedSize(getBoardSize());
+    is_static_layer_dirty_ = true;
+    update();
+}
+
+/**
+ * @brief Refreshes the whole board after the replay jumped to another tick.
+ */
+void TetrisBoard::showReplayState()
+{
+    animations_.clear();
+    is_static_layer_dirty_ = true;
+    last_piece_rect_ = currentPieceRect();
+    showNextPiece();
+    emit updateScoreLcd(engine_.score());
+    emit replayPositionChanged(replayPosition());
     update();
 }
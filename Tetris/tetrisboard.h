@@ -8,13 +8,30 @@
 #include <QLabel>
 #include <QKeyEvent>
 #include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
 #include <QtMath>
 #include <QSettings>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QFile>
 
 #include <QDebug>
 
 #include "iostream"
+#include "Common/perfcounter.h"
+#include "Common/perfoverlay.h"
+#include "Tetris/tetrisanimation.h"
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrisinputqueue.h"
+#include "Tetris/tetrismovegenerator.h"
 #include "Tetris/tetrispiece.h"
+#include "Tetris/tetrisreplay.h"
+#include "Tetris/tetrisreplayplayer.h"
+#include "Tetris/tetrisreplaywriter.h"
+#include "Tetris/tetrisrewindbuffer.h"
+#include "Tetris/tetrissavedgame.h"
 
 class TetrisBoard : public QFrame
 {
@@ -23,23 +40,56 @@ class TetrisBoard : public QFrame
 public:
 
     explicit TetrisBoard(QWidget *parent = nullptr);
+    ~TetrisBoard();
 
     QSize getBoardSize();
     void setNextPieceLabel(QLabel *label);
     void setBoardSize(QSize board_size);
     void setSquareSide(int side_size){ square_side_ = side_size; }
+    const TetrisEngine &engine() const { return engine_; }
+    bool pushInput(TetrisAction action);
+    QString replayPath() const { return replay_path_; }
+    const QByteArray &recordedReplay() const { return recorded_replay_; }
+    bool loadReplay(const QString &path);
+    bool loadSuspendedGame();
+    const TetrisReplay &replay() const { return replay_player_.replay(); }
+    bool isPaused() const { return is_paused_; }
+    bool isPlaying() const { return is_started_ && !is_paused_ && !is_replaying_ && !engine_.isLost(); }
+    bool isReplaying() const { return is_replaying_; }
+    bool isRewindEnabled() const { return is_rewind_enabled_; }
+    bool isRewound() const { return is_rewound_; }
+    qint64 replayDuration() const { return qint64(replay_player_.endTick()) * engine_.rules().tick_ms; }
+    qint64 replayPosition() const { return qint64(replay_player_.tick()) * engine_.rules().tick_ms; }
+
+    static QString replayDirectory();
+    static QString suspendedGamePath();
 
 public slots:
     void start();
     void reset();
     void pause();
     void resume();
+    bool rewind(int pieces = 1);
+    void setRewindEnabled(bool enabled);
+    void clearHint();
+    void seekReplay(qint64 position_ms);
+    void setHint(quint64 seed, int piece, const TetrisPlacement &placement);
+    void setReplaySpeed(double speed);
+    void stepReplay(int ticks);
+    void stopReplay();
+    bool suspend();
 
 signals:
     void gameLost(const int score);
+    void gameInterrupted();
+    void gameResumed();
+    void pieceSpawned();
     void updateBestScoreLcd(const int score);
     void updateScoreLcd(const int score);
     void updateScores(const int score, const QString& new_username);
+    void replaySaved(const QString &path);
+    void replayFinished();
+    void replayPositionChanged(qint64 position_ms);
 
 
 protected:
@@ -50,41 +100,75 @@ protected:
 
 
 private:
-    inline void backToNormalSpeed(){   timer_.start(timeout_time_, this); };
-    void clearBoard();
+    void advanceReplay(qint64 now_ms);
+    QRect animatedRect() const;
+    QRect currentPieceRect() const;
+    void discardSuspendedGame();
+    void drawAnimations(QPainter &painter, int alpha_color);
     void drawBackgroundGrid(QPainter &painter, int alpha_color);
     void drawCurrentPiece(QPainter &painter, int alpha_color);
+    void drawHint(QPainter &painter);
     void drawPlacedPieces(QPainter &painter, int alpha_color);
     void drawSquare(QPainter &painter, int x, int y, TetrisShape shape, int alpha_color);
-    void levelUp();
-    void newPiece();
-    void oneLineDown();
-    void pieceDropped();
-    void removeFullLines();
-    inline void resetTimeout(){    timeout_time_ = 700;    };
+    void finishReplay();
+    void flushReplay();
+    qint64 gameTime() const { return clock_.elapsed() - paused_time_ms_.loadRelaxed(); }
+    void handleEngineEvents();
+    QRect hintRect() const;
+    bool isHintShown() const;
+    void processTicks(qint64 now_ms);
     void showNextPiece();
-    inline void speedUp(){  timer_.start(50, this); };
-    TetrisShape &shapeAt(int x, int y) { return board_[(y * board_width_steps_) + x]; }
-    bool tryMove(const TetrisPiece &new_piece, int new_x, int new_y);
-    void updateScore(const int lines_removed);
+    void showReplayState();
+    void startReplay();
+    void updateStaticLayer(int alpha_color);
 
-    int board_width_steps_, board_height_steps_;
     int square_side_;
     bool is_started_, is_paused_;
-    int timeout_time_;
-    int score_, best_score_;
-    int curr_x_, curr_y_;
-    int num_piece_dropped_, num_lines_removed_;
-    int level_up_range_;
+    int best_score_;
     int not_active_alpha_color_, active_alpha_color_;
-    int is_lost_;
+    int static_layer_alpha_;
+    bool is_static_layer_dirty_;
+    QAtomicInteger<qint64> paused_time_ms_;
+    qint64 pause_started_ms_;
+    bool is_replaying_;
+    double replay_speed_, replay_ticks_due_;
+    qint64 last_replay_frame_ms_;
+    bool is_rewind_enabled_, is_rewound_;
 
     QSettings settings_;
     QBasicTimer timer_;
-    TetrisPiece curr_piece_, next_piece_;
+    QElapsedTimer clock_;
     QLabel *next_piece_label_;
-
-    QVector<TetrisShape> board_;
+    PerfOverlay *perf_overlay_;
+    QPixmap static_layer_; // grid and placed pieces
+    QRect last_piece_rect_;
+    quint64 hint_seed_;
+    int hint_piece_; // pieces dropped before the piece of the hint, -1 for no hint
+    QPoint hint_squares_[4];
+    QString replay_path_;
+    QByteArray recorded_replay_; // replay of the current or last game, as written to replay_path_
+    TetrisReplayWriter *replay_writer_;
+    TetrisReplayWriter *suspend_writer_; // suspended game file, see suspend()
+
+    TetrisEngine engine_;
+    TetrisInputQueue input_queue_;
+    QVector<TetrisInput> tick_inputs_;
+    TetrisAnimationTimeline animations_;
+    TetrisReplayEncoder replay_encoder_;
+    TetrisEngineState keyframe_state_;
+    quint64 recorded_hash_; // last state hash written to the replay
+    TetrisRules live_rules_; // rules of the live game, restored after playing a replay
+    TetrisReplayPlayer replay_player_;
+    TetrisRewindBuffer rewind_buffer_; // state at the spawn of the last pieces, practice mode only
+    TetrisEngineState rewind_state_;
+    TetrisSavedGame suspended_game_;
+    std::vector<uint8_t> suspended_bytes_;
+
+    PerfCounter frame_counter_, tick_counter_, clear_counter_;
+
+    static const size_t REPLAY_CHUNK_BYTES;
+    static const double MIN_REPLAY_SPEED;
+    static const double MAX_REPLAY_SPEED;
 };
 
 #endif // TETRISBOARD_H
@@ -0,0 +1,638 @@
+#include "tetrisengine.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "Tetris/tetriszobrist.h"
+
+/**
+ * @brief Tells whether the engines can play with these rules.
+ *
+ * Every tick length and level-up step must be positive, and the speedup a
+ * percentage. The board size is checked by each engine against its own limits.
+ *
+ * @return true if the rules are valid.
+ */
+bool TetrisRules::isValid() const
+{
+    return tick_ms > 0 && gravity_ticks > 0 && soft_drop_ticks > 0 && level_up_pieces > 0 && level_up_score > 0
+           && level_up_speedup >= 0 && level_up_speedup <= 100;
+}
+
+/**
+ * @brief Compares every rule, board size included.
+ *
+ * @param other The rules to compare with.
+ * @return true if all the rules are equal.
+ */
+bool TetrisRules::operator==(const TetrisRules &other) const
+{
+    return width == other.width && height == other.height && tick_ms == other.tick_ms
+           && gravity_ticks == other.gravity_ticks && soft_drop_ticks == other.soft_drop_ticks
+           && level_up_pieces == other.level_up_pieces && level_up_score == other.level_up_score
+           && level_up_speedup == other.level_up_speedup;
+}
+
+TetrisEngine::TetrisEngine(const TetrisRules &rules)
+    : rules_(rules)
+    , seed_(0)
+    , tick_(0)
+    , is_started_(false)
+    , is_lost_(false)
+    , is_soft_dropping_(false)
+    , gravity_ticks_(rules.gravity_ticks)
+    , gravity_counter_(0)
+    , score_(0)
+    , curr_x_(0)
+    , curr_y_(0)
+    , curr_rotation_(0)
+    , num_piece_dropped_(0)
+    , num_lines_removed_(0)
+    , last_lock_()
+    , last_clear_()
+    , hash_(0)
+{
+    static_assert(MAX_WIDTH <= 32, "TetrisLineClear stores at most 32 columns per row");
+    setBoardSize(rules_.width, rules_.height);
+}
+
+/**
+ * @brief Resizes the playfield.
+ *
+ * The width is clamped to MAX_WIDTH, since every row is kept as a bit mask for
+ * the collision tests. The board is cleared.
+ *
+ * @param width Number of columns.
+ * @param height Number of rows.
+ */
+void TetrisEngine::setBoardSize(int width, int height)
+{
+    rules_.width = std::clamp(width, 1, MAX_WIDTH);
+    rules_.height = std::max(height, 1);
+
+    rows_.resize(rules_.height);
+    cells_.resize(rules_.width * rules_.height);
+    clearBoard();
+    hash_ = computeHash();
+}
+
+/**
+ * @brief Starts a new game from the given seed.
+ *
+ * Resets score, counters, gravity and tick count, clears the board and spawns the
+ * first piece. Two engines started with the same rules and seed, and stepped with
+ * the same inputs, always play the same game.
+ *
+ * @param seed Seed of the piece generator.
+ */
+void TetrisEngine::start(uint64_t seed)
+{
+    seed_ = seed;
+    generator_.setSeed(seed);
+    tick_ = 0;
+
+    is_started_ = true;
+    is_lost_ = false;
+    is_soft_dropping_ = false;
+    gravity_ticks_ = rules_.gravity_ticks;
+    gravity_counter_ = 0;
+    score_ = 0;
+    num_piece_dropped_ = 0;
+    num_lines_removed_ = 0;
+
+    events_.clear();
+    clearBoard();
+    next_piece_.setRandomShape(generator_);
+    hash_ = computeHash();
+    newPiece();
+}
+
+/**
+ * @brief Advances the game by exactly one tick.
+ *
+ * Applies the given inputs in order, then runs gravity. This is the only place
+ * where the game state changes while playing: inputs are never applied in between
+ * ticks, so the outcome only depends on which tick each input was given to.
+ * The events produced during the tick are available through events() until the
+ * next call.
+ *
+ * @param inputs Inputs to apply at this tick boundary, oldest first.
+ * @param count Number of inputs.
+ */
+void TetrisEngine::step(const TetrisInput *inputs, int count)
+{
+    events_.clear();
+    if(!is_started_ || is_lost_)
+        return;
+
+    for(int i = 0; i < count && !is_lost_; ++i)
+        applyAction(inputs[i].action);
+
+    if(!is_lost_){
+        int interval = is_soft_dropping_ ? rules_.soft_drop_ticks : gravity_ticks_;
+        if(++gravity_counter_ >= interval){
+            gravity_counter_ = 0;
+            oneLineDown();
+        }
+    }
+
+    ++tick_;
+}
+
+/**
+ * @brief Copies the whole game state into `state`.
+ *
+ * Only valid in between two calls of step(): the events of the last tick and the
+ * last lock and clear (used by the renderer only) are not part of the state.
+ * The vectors of `state` are reused, so saving into the same object again does not
+ * allocate.
+ *
+ * @param state The state to fill.
+ */
+void TetrisEngine::saveState(TetrisEngineState &state) const
+{
+    state.width = rules_.width;
+    state.height = rules_.height;
+    state.seed = seed_;
+    state.tick = tick_;
+    state.random_state = generator_.state();
+
+    state.is_started = is_started_;
+    state.is_lost = is_lost_;
+    state.is_soft_dropping = is_soft_dropping_;
+    state.gravity_ticks = gravity_ticks_;
+    state.gravity_counter = gravity_counter_;
+    state.score = score_;
+    state.pieces_dropped = num_piece_dropped_;
+    state.lines_removed = num_lines_removed_;
+
+    state.curr_shape = curr_piece_.shape();
+    state.next_shape = next_piece_.shape();
+    state.curr_x = curr_x_;
+    state.curr_y = curr_y_;
+    state.curr_rotation = curr_rotation_;
+
+    state.rows = rows_;
+    state.cells = cells_;
+}
+
+/**
+ * @brief Restores a state saved by saveState().
+ *
+ * The engine then continues exactly as the one the state has been saved from. The
+ * current piece is rebuilt from its shape and rotation index.
+ *
+ * States read from files (keyframes, saved games) are not trusted: see isPlayable().
+ *
+ * @param state The state to restore.
+ * @return true if the state has been restored, false if it does not match the board
+ * size of the engine or cannot be played (the engine is left unchanged).
+ */
+bool TetrisEngine::loadState(const TetrisEngineState &state)
+{
+    if(!isPlayable(state))
+        return false;
+
+    seed_ = state.seed;
+    tick_ = state.tick;
+    generator_.setState(state.random_state);
+
+    is_started_ = state.is_started;
+    is_lost_ = state.is_lost;
+    is_soft_dropping_ = state.is_soft_dropping;
+    gravity_ticks_ = state.gravity_ticks;
+    gravity_counter_ = state.gravity_counter;
+    score_ = state.score;
+    num_piece_dropped_ = state.pieces_dropped;
+    num_lines_removed_ = state.lines_removed;
+
+    curr_piece_.setShape(state.curr_shape);
+    for(int i = 0; i < (state.curr_rotation & 3); ++i)
+        curr_piece_ = curr_piece_.rotatedRight();
+    next_piece_.setShape(state.next_shape);
+    curr_x_ = state.curr_x;
+    curr_y_ = state.curr_y;
+    curr_rotation_ = state.curr_rotation & 3;
+
+    rows_ = state.rows;
+    cells_ = state.cells;
+    events_.clear();
+    last_clear_.count = 0;
+    hash_ = computeHash();
+    return true;
+}
+
+/**
+ * @brief Tells whether a state can be restored and played on from.
+ *
+ * The board must have the size of the engine, with squares of valid shapes exactly
+ * where the row masks have bits. The shapes of the queue must be valid, a running
+ * game must have a current and a next piece, and the current piece must fit in
+ * the board: every later write into the board relies on it. The generator state
+ * must be one the generator can reach, and the counters must not be negative.
+ *
+ * @param state The state to check.
+ * @return true if loadState() can restore it.
+ */
+bool TetrisEngine::isPlayable(const TetrisEngineState &state) const
+{
+    if(state.width != rules_.width || state.height != rules_.height
+        || state.rows.size() != rows_.size() || state.cells.size() != cells_.size())
+        return false;
+
+    if(state.random_state == 0 || state.gravity_ticks <= 0 || state.gravity_counter < 0 || state.score < 0
+        || state.pieces_dropped < 0 || state.lines_removed < 0 || state.curr_rotation < 0 || state.curr_rotation > 3
+        || state.curr_shape < NoShape || state.curr_shape > JShape || state.next_shape < NoShape || state.next_shape > JShape)
+        return false;
+
+    const uint32_t full_row = rules_.width >= 32 ? ~0u : (1u << rules_.width) - 1;
+    for(int y = 0; y < rules_.height; ++y){
+        if(state.rows[y] & ~full_row)
+            return false;
+        for(int x = 0; x < rules_.width; ++x){
+            const TetrisShape shape = state.cells[y * rules_.width + x];
+            if(shape < NoShape || shape > JShape || (shape != NoShape) != bool(state.rows[y] & (1u << x)))
+                return false;
+        }
+    }
+
+    // A running game always has a piece to move and the next one
+    if(state.is_started && !state.is_lost && (state.curr_shape == NoShape || state.next_shape == NoShape))
+        return false;
+    if(state.curr_shape == NoShape)
+        return true;
+
+    TetrisPiece piece;
+    piece.setShape(state.curr_shape);
+    for(int i = 0; i < state.curr_rotation; ++i)
+        piece = piece.rotatedRight();
+    for(int i = 0; i < 4; ++i){
+        const int x = state.curr_x + piece.x(i);
+        const int y = state.curr_y + piece.y(i);
+        if(x < 0 || x >= rules_.width || y < 0 || y >= rules_.height || (state.rows[y] & (1u << x)))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Applies a single player action to the current piece.
+ *
+ * Moves and rotations are ignored when blocked. Toggling the soft drop restarts the
+ * gravity counter, so the first accelerated (or normal) line comes one full
+ * interval after the key event. A hard drop locks the piece at once; the following
+ * actions of the same tick apply to the next piece.
+ *
+ * @param action The action to apply.
+ */
+void TetrisEngine::applyAction(TetrisAction action)
+{
+    if(curr_piece_.shape() == NoShape)
+        return;
+
+    switch(action){
+    case MoveLeft:
+        tryMove(curr_piece_, curr_x_ - 1, curr_y_, curr_rotation_);
+        break;
+    case MoveRight:
+        tryMove(curr_piece_, curr_x_ + 1, curr_y_, curr_rotation_);
+        break;
+    case RotateLeft:
+        tryMove(curr_piece_.rotatedLeft(), curr_x_, curr_y_, (curr_rotation_ + 3) & 3);
+        break;
+    case RotateRight:
+        tryMove(curr_piece_.rotatedRight(), curr_x_, curr_y_, (curr_rotation_ + 1) & 3);
+        break;
+    case SoftDropOn:
+        if(!is_soft_dropping_){
+            is_soft_dropping_ = true;
+            gravity_counter_ = 0;
+        }
+        break;
+    case SoftDropOff:
+        if(is_soft_dropping_){
+            is_soft_dropping_ = false;
+            gravity_counter_ = 0;
+        }
+        break;
+    case SonicDrop:
+        while(tryMove(curr_piece_, curr_x_, curr_y_ + 1, curr_rotation_)) {}
+        break;
+    case HardDrop:
+        while(tryMove(curr_piece_, curr_x_, curr_y_ + 1, curr_rotation_)) {}
+        gravity_counter_ = 0;
+        pieceDropped();
+        break;
+    case NoAction:
+        break;
+    }
+}
+
+/**
+ * @brief Clears the board by resetting all squares to NoShape and all row masks to 0.
+ */
+void TetrisEngine::clearBoard()
+{
+    std::fill(rows_.begin(), rows_.end(), 0u);
+    std::fill(cells_.begin(), cells_.end(), NoShape);
+}
+
+/**
+ * @brief Hashes the whole state covered by stateHash(), from scratch.
+ *
+ * Only used when the state is set at once (start, loadState): the game updates
+ * the hash with the keys of the parts it changes.
+ *
+ * @return The hash.
+ */
+uint64_t TetrisEngine::computeHash() const
+{
+    uint64_t hash = TetrisZobrist::queueKey(0, curr_piece_.shape()) ^ TetrisZobrist::queueKey(1, next_piece_.shape())
+                    ^ TetrisZobrist::counterKey(TetrisZobrist::RandomStateCounter, generator_.state())
+                    ^ TetrisZobrist::counterKey(TetrisZobrist::ScoreCounter, uint64_t(score_));
+    for(int y = 0; y < rules_.height; ++y)
+        hash ^= TetrisZobrist::rowKey(y, rows_[y]);
+    return hash;
+}
+
+/**
+ * @brief Checks if a piece fits on the board at the given position.
+ *
+ * @param piece The piece to test.
+ * @param x The x-coordinate of the piece origin.
+ * @param y The y-coordinate of the piece origin.
+ * @return true if all four squares are inside the board and free, false otherwise.
+ */
+bool TetrisEngine::fits(const TetrisPiece &piece, int x, int y) const
+{
+    for(int i = 0; i < 4; ++i){
+        int cx = x + piece.x(i);
+        int cy = y + piece.y(i);
+
+        if(cx < 0 || cx >= rules_.width || cy < 0 || cy >= rules_.height)
+            return false;
+
+        if(rows_[cy] & (1u << cx))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Increases the game speed.
+ *
+ * Removes `level_up_speedup` percent of the current gravity interval (at least one
+ * tick is kept) and restarts the gravity counter.
+ */
+void TetrisEngine::levelUp()
+{
+    gravity_ticks_ -= (rules_.level_up_speedup * gravity_ticks_ + 50) / 100;
+    gravity_ticks_ = std::max(gravity_ticks_, 1);
+    gravity_counter_ = 0;
+    pushEvent(LevelUp, gravity_ticks_);
+}
+
+/**
+ * @brief Spawns the next piece at the top of the board.
+ *
+ * The previously shown next piece becomes the current one and a new next piece is
+ * drawn. If the new piece has no space, the game is lost.
+ */
+void TetrisEngine::newPiece()
+{
+    hash_ ^= TetrisZobrist::queueKey(0, curr_piece_.shape()) ^ TetrisZobrist::queueKey(1, next_piece_.shape())
+             ^ TetrisZobrist::counterKey(TetrisZobrist::RandomStateCounter, generator_.state());
+    curr_piece_ = next_piece_;
+    next_piece_.setRandomShape(generator_);
+    hash_ ^= TetrisZobrist::queueKey(1, next_piece_.shape())
+             ^ TetrisZobrist::counterKey(TetrisZobrist::RandomStateCounter, generator_.state());
+
+    curr_rotation_ = 0;
+    curr_x_ = spawnX(rules_.width);
+    curr_y_ = spawnY(curr_piece_.shape());
+
+    if(!fits(curr_piece_, curr_x_, curr_y_)){
+        curr_piece_.setShape(NoShape);
+        hash_ ^= TetrisZobrist::queueKey(0, NoShape);
+        is_lost_ = true;
+        pushEvent(GameLost, score_);
+        return;
+    }
+
+    hash_ ^= TetrisZobrist::queueKey(0, curr_piece_.shape());
+    pushEvent(PieceSpawned, curr_piece_.shape());
+}
+
+/**
+ * @brief Returns the row of the origin of a newly spawned piece.
+ *
+ * The piece is spawned in rotation 0 with its highest square on the first row.
+ *
+ * @param shape The shape of the piece.
+ * @return The y-coordinate of the piece origin.
+ */
+int TetrisEngine::spawnY(TetrisShape shape)
+{
+    TetrisPiece piece;
+    piece.setShape(shape);
+    return std::abs(piece.minY());
+}
+
+/**
+ * @brief Lists the pieces a saved game will play, in order.
+ *
+ * The current piece, the preview, then the pieces the generator will draw after
+ * them: the game being deterministic, they are all known in advance.
+ *
+ * @param state The state, see saveState().
+ * @param pieces Filled with `count` shapes.
+ * @param count Number of pieces wanted.
+ * @return The number of pieces written, 0 if the game is not running.
+ */
+int TetrisEngine::upcomingPieces(const TetrisEngineState &state, TetrisShape *pieces, int count)
+{
+    if(!state.is_started || state.is_lost || state.curr_shape == NoShape || count <= 0)
+        return 0;
+    return listPieces(state.curr_shape, state.next_shape, state.random_state, pieces, count);
+}
+
+/**
+ * @brief Lists the pieces the running game will play, in order, as the static
+ * upcomingPieces() does for a saved state.
+ *
+ * @param pieces Filled with `count` shapes.
+ * @param count Number of pieces wanted.
+ * @return The number of pieces written, 0 if the game is not running.
+ */
+int TetrisEngine::upcomingPieces(TetrisShape *pieces, int count) const
+{
+    if(!is_started_ || is_lost_ || curr_piece_.shape() == NoShape || count <= 0)
+        return 0;
+    return listPieces(curr_piece_.shape(), next_piece_.shape(), generator_.state(), pieces, count);
+}
+
+/**
+ * @brief Lists the current piece, the preview, then the pieces drawn from a generator state.
+ *
+ * @return count.
+ */
+int TetrisEngine::listPieces(TetrisShape current, TetrisShape next, uint64_t random_state,
+                             TetrisShape *pieces, int count)
+{
+    TetrisRandom generator;
+    generator.setState(random_state);
+    TetrisPiece piece;
+    for(int i = 0; i < count; ++i){
+        if(i == 0){
+            pieces[i] = current;
+        }else if(i == 1){
+            pieces[i] = next;
+        }else{
+            piece.setRandomShape(generator);
+            pieces[i] = piece.shape();
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Moves the current piece one line down, dropping it if it cannot move.
+ */
+void TetrisEngine::oneLineDown()
+{
+    if(!tryMove(curr_piece_, curr_x_, curr_y_ + 1, curr_rotation_))
+        pieceDropped();
+}
+
+/**
+ * @brief Locks the current piece on the board.
+ *
+ * Writes the piece into the board, awards the drop points, levels up every
+ * `level_up_pieces` pieces, removes full lines and spawns a new piece.
+ */
+void TetrisEngine::pieceDropped()
+{
+    const int prev_score = score_;
+    last_lock_.shape = curr_piece_.shape();
+    for(int i = 0; i < 4; ++i){
+        int x = curr_x_ + curr_piece_.x(i);
+        int y = curr_y_ + curr_piece_.y(i);
+        shapeAt(x, y) = curr_piece_.shape();
+        hash_ ^= TetrisZobrist::rowKey(y, rows_[y]) ^ TetrisZobrist::rowKey(y, rows_[y] | (1u << x));
+        rows_[y] |= 1u << x;
+        last_lock_.x[i] = x;
+        last_lock_.y[i] = y;
+    }
+
+    ++num_piece_dropped_;
+    score_ += 10;
+    pushEvent(PieceLocked, curr_piece_.shape());
+    pushEvent(ScoreChanged, score_);
+
+    if(num_piece_dropped_ % rules_.level_up_pieces == 0)
+        levelUp();
+
+    removeFullLines();
+    hash_ ^= TetrisZobrist::counterKey(TetrisZobrist::ScoreCounter, uint64_t(prev_score))
+             ^ TetrisZobrist::counterKey(TetrisZobrist::ScoreCounter, uint64_t(score_));
+    newPiece();
+}
+
+/**
+ * @brief Removes full lines from the board and updates the score.
+ *
+ * A row is full when its mask has all the `width` bits set. Full rows are removed
+ * and all rows above are moved down; their index and content are kept in lastClear()
+ * for the renderer. The score is updated once, based on the number
+ * of lines removed together, and the level is increased if the score enters a new
+ * `level_up_score` range.
+ */
+void TetrisEngine::removeFullLines()
+{
+    const uint32_t full_row = rules_.width >= 32 ? ~0u : (1u << rules_.width) - 1;
+    int num_full_lines = 0;
+
+    for(int i = 0; i < rules_.height; ++i){
+        if(rows_[i] != full_row)
+            continue;
+
+        if(num_full_lines < TetrisLineClear::MAX_ROWS){
+            last_clear_.rows[num_full_lines] = i;
+            std::copy_n(cells_.begin() + i * rules_.width, rules_.width,
+                        last_clear_.cells[num_full_lines]);
+        }
+
+        num_full_lines++;
+        // Move all lines from 0 to the found one
+        for(int y = i; y >= 1; --y){
+            hash_ ^= TetrisZobrist::rowKey(y, rows_[y]) ^ TetrisZobrist::rowKey(y, rows_[y - 1]);
+            rows_[y] = rows_[y - 1];
+            std::copy_n(cells_.begin() + (y - 1) * rules_.width, rules_.width,
+                        cells_.begin() + y * rules_.width);
+        }
+        hash_ ^= TetrisZobrist::rowKey(0, rows_[0]) ^ TetrisZobrist::rowKey(0, 0);
+        rows_[0] = 0;
+        std::fill_n(cells_.begin(), rules_.width, NoShape);
+    }
+
+    if(num_full_lines == 0)
+        return;
+
+    last_clear_.count = std::min(num_full_lines, int(TetrisLineClear::MAX_ROWS));
+    num_lines_removed_ += num_full_lines;
+    pushEvent(LinesCleared, num_full_lines);
+
+    // Increase level each level_up_score points
+    int prev_score_range = score_ / rules_.level_up_score;
+    updateScore(num_full_lines);
+    int curr_score_range = score_ / rules_.level_up_score;
+    if(curr_score_range > prev_score_range)
+        levelUp();
+
+    pushEvent(ScoreChanged, score_);
+}
+
+/**
+ * @brief Attempts to move the current piece to a new position.
+ *
+ * @param new_piece The piece to move (possibly rotated).
+ * @param new_x The new x-coordinate for the piece.
+ * @param new_y The new y-coordinate for the piece.
+ * @param new_rotation Rotation index (0-3, clockwise) of `new_piece`.
+ * @return true if the piece has been moved, false if the position is blocked.
+ */
+bool TetrisEngine::tryMove(const TetrisPiece &new_piece, int new_x, int new_y, int new_rotation)
+{
+    if(!fits(new_piece, new_x, new_y))
+        return false;
+
+    curr_piece_ = new_piece;
+    curr_x_ = new_x;
+    curr_y_ = new_y;
+    curr_rotation_ = new_rotation;
+    pushEvent(PieceMoved);
+    return true;
+}
+
+/**
+ * @brief Updates the score based on the number of lines removed together.
+ *
+ * @param lines_removed The number of lines removed.
+ */
+void TetrisEngine::updateScore(const int lines_removed)
+{
+    switch(lines_removed){
+    case 1:
+        score_ += 40;
+        break;
+    case 2:
+        score_ += 100;
+        break;
+    case 3:
+        score_ += 300;
+        break;
+    case 4:
+        score_ += 1200;
+        break;
+    }
+}
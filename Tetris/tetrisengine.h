@@ -0,0 +1,167 @@
+#ifndef TETRISENGINE_H
+#define TETRISENGINE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisinputqueue.h"
+#include "Tetris/tetrispiece.h"
+#include "Tetris/tetrisrandom.h"
+
+struct TetrisRules
+{
+    int width = 10;
+    int height = 20;
+    int tick_ms = 10;               // length of one engine tick
+    int gravity_ticks = 70;         // ticks per line at level 0
+    int soft_drop_ticks = 5;        // ticks per line while soft dropping
+    int level_up_pieces = 25;       // level up every N dropped pieces ...
+    int level_up_score = 2400;      // ... and every N points
+    int level_up_speedup = 20;      // % of gravity removed at each level
+
+    bool isValid() const;
+    bool operator==(const TetrisRules &other) const;
+    bool operator!=(const TetrisRules &other) const { return !(*this == other); }
+};
+
+enum TetrisEventType : uint8_t {
+    PieceSpawned,
+    PieceMoved,
+    PieceLocked,
+    LinesCleared,
+    ScoreChanged,
+    LevelUp,
+    GameLost
+};
+
+struct TetrisEvent
+{
+    TetrisEventType type;
+    int value;
+};
+
+// Squares written by the last locked piece
+struct TetrisLock
+{
+    TetrisShape shape;
+    int x[4], y[4];
+};
+
+// Rows removed by the last line clear, in board coordinates before the clear
+struct TetrisLineClear
+{
+    static constexpr int MAX_ROWS = 4;
+
+    int count;
+    int rows[MAX_ROWS];                 // ascending
+    TetrisShape cells[MAX_ROWS][32];    // content of each removed row
+};
+
+// Whole game state at a tick boundary, see TetrisEngine::saveState()
+struct TetrisEngineState
+{
+    int width = 0, height = 0;
+    uint64_t seed = 0;
+    uint64_t tick = 0;
+    uint64_t random_state = 0;
+
+    bool is_started = false, is_lost = false, is_soft_dropping = false;
+    int gravity_ticks = 0, gravity_counter = 0;
+    int score = 0;
+    int pieces_dropped = 0, lines_removed = 0;
+
+    TetrisShape curr_shape = NoShape, next_shape = NoShape;
+    int curr_x = 0, curr_y = 0, curr_rotation = 0;
+
+    std::vector<uint32_t> rows;
+    std::vector<TetrisShape> cells;
+};
+
+class TetrisEngine
+{
+public:
+    static constexpr int MAX_WIDTH = 32; // one bit per column in a row mask
+
+    explicit TetrisEngine(const TetrisRules &rules = TetrisRules());
+
+    void setBoardSize(int width, int height);
+    void start(uint64_t seed);
+    void stop(){ is_started_ = false; }
+    void step(const TetrisInput *inputs, int count);
+    void saveState(TetrisEngineState &state) const;
+    bool loadState(const TetrisEngineState &state);
+    bool isPlayable(const TetrisEngineState &state) const;
+
+    const TetrisRules &rules() const { return rules_; }
+    int width() const { return rules_.width; }
+    int height() const { return rules_.height; }
+    TetrisShape shapeAt(int x, int y) const { return cells_[(y * rules_.width) + x]; }
+    uint32_t rowBits(int y) const { return rows_[y]; }
+    const uint32_t *rows() const { return rows_.data(); }
+
+    const TetrisPiece &currentPiece() const { return curr_piece_; }
+    int currentX() const { return curr_x_; }
+    int currentY() const { return curr_y_; }
+    int currentRotation() const { return curr_rotation_; }
+    const TetrisPiece &nextPiece() const { return next_piece_; }
+    int upcomingPieces(TetrisShape *pieces, int count) const;
+
+    const std::vector<TetrisEvent> &events() const { return events_; }
+    const TetrisLineClear &lastClear() const { return last_clear_; }
+    const TetrisLock &lastLock() const { return last_lock_; }
+    int gravityTicks() const { return gravity_ticks_; }
+    bool isLost() const { return is_lost_; }
+    bool isStarted() const { return is_started_; }
+    int linesRemoved() const { return num_lines_removed_; }
+    int piecesDropped() const { return num_piece_dropped_; }
+    int score() const { return score_; }
+    uint64_t seed() const { return seed_; }
+    uint64_t stateHash() const { return hash_; }
+    uint64_t tickCount() const { return tick_; }
+
+    static int spawnX(int width){ return width / 2; }
+    static int spawnY(TetrisShape shape);
+    static int upcomingPieces(const TetrisEngineState &state, TetrisShape *pieces, int count);
+
+private:
+    void applyAction(TetrisAction action);
+    void clearBoard();
+    uint64_t computeHash() const;
+    bool fits(const TetrisPiece &piece, int x, int y) const;
+    void levelUp();
+    static int listPieces(TetrisShape current, TetrisShape next, uint64_t random_state,
+                          TetrisShape *pieces, int count);
+    void newPiece();
+    void oneLineDown();
+    void pieceDropped();
+    void pushEvent(TetrisEventType type, int value = 0){ events_.push_back({type, value}); }
+    void removeFullLines();
+    TetrisShape &shapeAt(int x, int y) { return cells_[(y * rules_.width) + x]; }
+    bool tryMove(const TetrisPiece &new_piece, int new_x, int new_y, int new_rotation);
+    void updateScore(const int lines_removed);
+
+    TetrisRules rules_;
+    TetrisRandom generator_;
+    uint64_t seed_;
+    uint64_t tick_;
+
+    bool is_started_, is_lost_, is_soft_dropping_;
+    int gravity_ticks_, gravity_counter_;
+    int score_;
+    int curr_x_, curr_y_, curr_rotation_;
+    int num_piece_dropped_, num_lines_removed_;
+
+    TetrisPiece curr_piece_, next_piece_;
+    TetrisLock last_lock_;
+    TetrisLineClear last_clear_;
+
+    std::vector<uint32_t> rows_;
+    std::vector<TetrisShape> cells_;
+    std::vector<TetrisEvent> events_;
+
+    // Zobrist hash of the rows, current and next shapes, generator and score,
+    // updated on every lock, clear and spawn, see stateHash()
+    uint64_t hash_;
+};
+
+#endif // TETRISENGINE_H
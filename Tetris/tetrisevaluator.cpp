@@ -0,0 +1,216 @@
+#include "tetrisevaluator.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "Common/bitops.h"
+
+/**
+ * @brief Returns the El-Tetris weights.
+ *
+ * Weights tuned by Yiyuan Lee for the six Dellacherie features; aggregate height
+ * and bumpiness are not used.
+ *
+ * @return The weights.
+ */
+TetrisWeights TetrisWeights::elTetris()
+{
+    TetrisWeights weights;
+    std::fill(weights.values, weights.values + NUM_TETRIS_FEATURES, 0.0);
+
+    weights.values[LandingHeightFeature] = -4.500158825082766;
+    weights.values[LinesClearedFeature] = 3.4181268101392694;
+    weights.values[RowTransitionsFeature] = -3.2178882868487753;
+    weights.values[ColumnTransitionsFeature] = -9.348695305445199;
+    weights.values[HolesFeature] = -7.899265427351652;
+    weights.values[WellSumsFeature] = -3.3855972247263626;
+    return weights;
+}
+
+/**
+ * @brief Returns the name of a feature, as used in the tuner checkpoints.
+ *
+ * @param feature The feature, see TetrisFeature.
+ * @return The name, "unknown" out of range.
+ */
+const char *TetrisWeights::featureName(int feature)
+{
+    static const char *const NAMES[NUM_TETRIS_FEATURES] = {
+        "landing_height", "lines_cleared", "eroded_cells", "row_transitions", "column_transitions",
+        "holes", "well_sums", "aggregate_height", "bumpiness"
+    };
+    return feature >= 0 && feature < NUM_TETRIS_FEATURES ? NAMES[feature] : "unknown";
+}
+
+TetrisEvaluator::TetrisEvaluator(const TetrisWeights &weights)
+    : weights_(weights)
+{
+}
+
+/**
+ * @brief Scores a placement: the weighted sum of the features of the board it leaves.
+ *
+ * @param rows Row masks of the board before the placement.
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param placement The placement, see TetrisMoveGenerator.
+ * @return The score, higher is better.
+ */
+double TetrisEvaluator::evaluate(const uint32_t *rows, int width, int height, const TetrisPlacement &placement)
+{
+    double values[NUM_TETRIS_FEATURES];
+    features(rows, width, height, placement, values);
+
+    double score = 0.0;
+    for(int i = 0; i < NUM_TETRIS_FEATURES; ++i)
+        score += weights_.values[i] * values[i];
+    return score;
+}
+
+/**
+ * @brief Computes all the features of a placement.
+ *
+ * @param rows Row masks of the board before the placement.
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param placement The placement, see TetrisMoveGenerator.
+ * @param values Filled with NUM_TETRIS_FEATURES values, indexed by TetrisFeature.
+ */
+void TetrisEvaluator::features(const uint32_t *rows, int width, int height, const TetrisPlacement &placement,
+                               double *values)
+{
+    board_.resize(height);
+    int eroded_cells = 0;
+    int lines = place(rows, width, height, placement, board_.data(), &eroded_cells);
+
+    boardFeatures(board_.data(), width, height, values);
+    placementFeatures(height, placement, lines, eroded_cells, values);
+}
+
+/**
+ * @brief Computes the features that depend on the placement, not on the board left.
+ *
+ * @param height Number of rows.
+ * @param placement The placement, see TetrisMoveGenerator.
+ * @param lines Rows removed by the placement, see place().
+ * @param eroded_cells Squares of the piece removed with them, see place().
+ * @param values Its LandingHeightFeature, LinesClearedFeature and ErodedCellsFeature values are set.
+ */
+void TetrisEvaluator::placementFeatures(int height, const TetrisPlacement &placement, int lines, int eroded_cells,
+                                        double *values)
+{
+    int bottom = placement.top;
+    for(int k = 0; k < 4; ++k){
+        if(placement.rows[k])
+            bottom = placement.top + k;
+    }
+    values[LandingHeightFeature] = height - (placement.top + bottom) / 2.0;
+    values[LinesClearedFeature] = lines;
+    values[ErodedCellsFeature] = lines * eroded_cells;
+}
+
+/**
+ * @brief Computes the features that only depend on the board.
+ *
+ * Everything is computed on the row masks, scanning the rows from the top once.
+ * The placement features (landing height, lines cleared, eroded cells) are set to 0.
+ *
+ * @param rows Row masks of the board.
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param values Filled with NUM_TETRIS_FEATURES values, indexed by TetrisFeature.
+ */
+void TetrisEvaluator::boardFeatures(const uint32_t *rows, int width, int height, double *values)
+{
+    const uint64_t full_row = (uint64_t(1) << width) - 1;
+
+    int row_transitions = 0, column_transitions = 0, holes = 0, well_sums = 0;
+    int column_heights[64] = {};
+    int well_depths[64] = {};
+    uint64_t covered = 0; // columns with a filled square above
+
+    for(int y = 0; y < height; ++y){
+        const uint64_t row = rows[y];
+
+        // Walls on both sides are filled
+        uint64_t walled = (row << 1) | 1 | (uint64_t(1) << (width + 1));
+        row_transitions += bitCount((walled ^ (walled >> 1)) & ((uint64_t(1) << (width + 1)) - 1));
+
+        uint64_t below = y + 1 < height ? rows[y + 1] : full_row;
+        column_transitions += bitCount(row ^ below);
+
+        holes += bitCount(covered & ~row & full_row);
+
+        for(uint64_t first = row & ~covered; first; first &= first - 1)
+            column_heights[trailingZeros(first)] = height - y;
+        covered |= row;
+
+        // Empty squares with both neighbours filled: every well square adds its depth
+        uint64_t wells = ~walled & (walled << 1) & (walled >> 1);
+        wells = (wells >> 1) & full_row;
+        for(int x = 0; x < width; ++x){
+            if((wells >> x) & 1)
+                well_sums += ++well_depths[x];
+            else
+                well_depths[x] = 0;
+        }
+    }
+
+    int aggregate_height = 0, bumpiness = 0;
+    for(int x = 0; x < width; ++x){
+        aggregate_height += column_heights[x];
+        if(x > 0)
+            bumpiness += std::abs(column_heights[x] - column_heights[x - 1]);
+    }
+
+    values[LandingHeightFeature] = 0.0;
+    values[LinesClearedFeature] = 0.0;
+    values[ErodedCellsFeature] = 0.0;
+    values[RowTransitionsFeature] = row_transitions;
+    values[ColumnTransitionsFeature] = column_transitions;
+    values[HolesFeature] = holes;
+    values[WellSumsFeature] = well_sums;
+    values[AggregateHeightFeature] = aggregate_height;
+    values[BumpinessFeature] = bumpiness;
+}
+
+/**
+ * @brief Writes a placement into a board and removes the full rows, as the engine does.
+ *
+ * @param rows Row masks of the board before the placement.
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param placement The placement, see TetrisMoveGenerator.
+ * @param result Filled with the `height` row masks of the resulting board. Can be `rows`.
+ * @param eroded_cells If not null, set to the squares of the piece removed with the full rows.
+ * @return The number of rows removed.
+ */
+int TetrisEvaluator::place(const uint32_t *rows, int width, int height, const TetrisPlacement &placement,
+                           uint32_t *result, int *eroded_cells)
+{
+    const uint32_t full_row = width >= 32 ? ~0u : (1u << width) - 1;
+    int lines = 0, eroded = 0;
+
+    // From the bottom up: every kept row moves down by the rows removed below it
+    int write = height - 1;
+    for(int y = height - 1; y >= 0; --y){
+        uint32_t row = rows[y];
+        int k = y - placement.top;
+        if(k >= 0 && k < 4)
+            row |= placement.rows[k];
+
+        if(row == full_row){
+            ++lines;
+            if(k >= 0 && k < 4)
+                eroded += bitCount(placement.rows[k]);
+            continue;
+        }
+        result[write--] = row;
+    }
+    while(write >= 0)
+        result[write--] = 0;
+
+    if(eroded_cells)
+        *eroded_cells = eroded;
+    return lines;
+}
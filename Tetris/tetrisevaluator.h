@@ -0,0 +1,56 @@
+#ifndef TETRISEVALUATOR_H
+#define TETRISEVALUATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrismovegenerator.h"
+
+enum TetrisFeature {
+    LandingHeightFeature,      // height of the middle of the placed piece
+    LinesClearedFeature,
+    ErodedCellsFeature,        // lines cleared x squares of the piece removed with them
+    RowTransitionsFeature,     // filled/empty changes along the rows, walls are filled
+    ColumnTransitionsFeature,  // filled/empty changes along the columns, the floor is filled
+    HolesFeature,              // empty squares below a filled one
+    WellSumsFeature,           // 1 + 2 + ... + depth of every well
+    AggregateHeightFeature,
+    BumpinessFeature,          // height differences of neighbour columns
+    NUM_TETRIS_FEATURES
+};
+
+struct TetrisWeights
+{
+    double values[NUM_TETRIS_FEATURES];
+
+    static TetrisWeights elTetris();
+    static const char *featureName(int feature);
+};
+
+// Classic weighted-feature evaluation of the board left by a placement
+// (Dellacherie features, El-Tetris weights by default). Not thread-safe: one
+// evaluator per thread, it reuses its buffers.
+class TetrisEvaluator
+{
+public:
+    explicit TetrisEvaluator(const TetrisWeights &weights = TetrisWeights::elTetris());
+
+    void setWeights(const TetrisWeights &weights){ weights_ = weights; }
+    const TetrisWeights &weights() const { return weights_; }
+
+    double evaluate(const uint32_t *rows, int width, int height, const TetrisPlacement &placement);
+    void features(const uint32_t *rows, int width, int height, const TetrisPlacement &placement,
+                  double *values);
+
+    static void boardFeatures(const uint32_t *rows, int width, int height, double *values);
+    static void placementFeatures(int height, const TetrisPlacement &placement, int lines, int eroded_cells,
+                                  double *values);
+    static int place(const uint32_t *rows, int width, int height, const TetrisPlacement &placement,
+                     uint32_t *result, int *eroded_cells = nullptr);
+
+private:
+    TetrisWeights weights_;
+    std::vector<uint32_t> board_;
+};
+
+#endif // TETRISEVALUATOR_H
@@ -0,0 +1,318 @@
+#include "tetrisfinesse.h"
+
+#include <algorithm>
+
+#include "Tetris/tetrispiece.h"
+
+// CONSTANT VARIABLE
+const int TetrisFinesse::AUTO_REPEAT_MS = 50;          // longest interval between two repeats of a held key
+const int TetrisFinesse::AUTO_REPEAT_DELAY_MS = 600;   // longest delay before the first repeat
+
+namespace {
+
+struct Square {
+    int x, y;
+    bool operator<(const Square &other) const { return y != other.y ? y < other.y : x < other.x; }
+};
+
+// Squares of a shape in every rotation index, rotating right as the engine does,
+// sorted so that two placements are compared square by square
+struct Rotations {
+    Square squares[8][4][4];
+
+    Rotations()
+    {
+        for(int s = 0; s < 8; ++s){
+            TetrisPiece piece;
+            piece.setShape(TetrisShape(s));
+            for(int r = 0; r < 4; ++r){
+                for(int k = 0; k < 4; ++k)
+                    squares[s][r][k] = {piece.x(k), piece.y(k)};
+                std::sort(squares[s][r], squares[s][r] + 4);
+                piece = piece.rotatedRight();
+            }
+        }
+    }
+};
+
+const Rotations &rotations()
+{
+    static const Rotations table;
+    return table;
+}
+
+bool isMoveKey(TetrisAction action)
+{
+    return action == MoveLeft || action == MoveRight || action == RotateLeft || action == RotateRight;
+}
+
+} // namespace
+
+TetrisFinesse::TetrisFinesse()
+    : padded_width_(0)
+    , padded_height_(0)
+{
+}
+
+/**
+ * @brief Replays a game and analyses every piece locked.
+ *
+ * @param replay The decoded replay.
+ * @param report Filled with the analysis of every piece and the totals.
+ * @return false if the replay has no valid board size.
+ */
+bool TetrisFinesse::analyse(const TetrisReplay &replay, TetrisFinesseReport &report)
+{
+    report = TetrisFinesseReport();
+    if(replay.rules.width < 4 || replay.rules.width > TetrisEngine::MAX_WIDTH || replay.rules.height < 4)
+        return false;
+
+    const std::vector<bool> presses = countKeys(replay);
+    const std::vector<TetrisReplayInput> &inputs = replay.inputs;
+    const uint64_t end_tick = replay.is_finished ? replay.final_tick
+                              : (inputs.empty() ? 0 : inputs.back().tick + 1);
+
+    TetrisEngine engine(replay.rules);
+    engine.start(replay.seed);
+
+    std::vector<uint32_t> board(engine.rows(), engine.rows() + engine.height());
+    std::vector<TetrisInput> tick_inputs;
+    TetrisFinessePiece piece = {0, engine.currentPiece().shape(), 0, 0, 0, -1, {}};
+    int next_keys = 0; // pressed after a HardDrop of the same tick, for the piece after it
+    size_t input_index = 0;
+
+    while(!engine.isLost() && engine.tickCount() < end_tick){
+        const uint64_t tick = engine.tickCount();
+        bool is_dropped = false;
+        tick_inputs.clear();
+        for(; input_index < inputs.size() && inputs[input_index].tick <= tick; ++input_index){
+            const TetrisAction action = inputs[input_index].action;
+            tick_inputs.push_back({0, action});
+            if(presses[input_index] && isMoveKey(action)){
+                if(is_dropped)
+                    ++next_keys;
+                else
+                    ++piece.keys;
+            }
+            is_dropped |= action == HardDrop;
+        }
+
+        engine.step(tick_inputs.data(), int(tick_inputs.size()));
+
+        const int locks = int(std::count_if(engine.events().begin(), engine.events().end(),
+                                            [](const TetrisEvent &event){ return event.type == PieceLocked; }));
+        for(int i = 0; i < locks; ++i){
+            // Only the squares of the last lock of the tick are known
+            piece.lock_tick = tick;
+            if(i == locks - 1)
+                piece.minimal_keys = minimalKeys(board.data(), engine.width(), engine.height(),
+                                                 engine.lastLock(), &piece.minimal_path);
+            if(piece.minimal_keys >= 0){
+                report.keys += piece.keys;
+                report.minimal_keys += piece.minimal_keys;
+                report.faults += piece.faults();
+                report.faulty_pieces += piece.faults() > 0;
+            }
+            report.pieces.push_back(piece);
+
+            piece = {piece.index + 1, engine.currentPiece().shape(), tick + 1, 0, next_keys, -1, {}};
+            next_keys = 0;
+        }
+        if(locks)
+            board.assign(engine.rows(), engine.rows() + engine.height());
+    }
+
+    return true;
+}
+
+/**
+ * @brief Finds the fewest keys taking a piece from its spawn position to where it locked.
+ *
+ * 0-1 breadth-first search over the (x, y, rotation) positions: the keys (taps,
+ * held moves, rotations) cost one, falling one row costs nothing. The first time
+ * a position covering the locked squares comes out of the queue is through the
+ * fewest keys.
+ *
+ * @param rows Row masks of the board the piece spawned on.
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param lock The squares of the piece once locked, see TetrisEngine::lastLock().
+ * @param path If not null, set to the keys of a shortest sequence.
+ * @return The number of keys, -1 if the squares cannot be reached.
+ */
+int TetrisFinesse::minimalKeys(const uint32_t *rows, int width, int height, const TetrisLock &lock,
+                               std::vector<TetrisFinesseKey> *path)
+{
+    if(path)
+        path->clear();
+    if(lock.shape == NoShape)
+        return -1;
+
+    padded_width_ = width + 2 * PADDING;
+    padded_height_ = height + 2 * PADDING;
+    const Rotations &table = rotations();
+
+    // Origins where the piece fits, one mask per rotation and row (column x is bit x + PADDING)
+    fit_.assign(size_t(4) * padded_height_, 0);
+    const uint64_t all_columns = (uint64_t(1) << width) - 1;
+    for(int r = 0; r < 4; ++r){
+        for(int y = -PADDING; y < height + PADDING; ++y){
+            uint64_t origins = ~uint64_t(0);
+            for(const Square &square : table.squares[lock.shape][r]){
+                const int board_y = y + square.y;
+                const uint64_t free = board_y < 0 || board_y >= height ? 0
+                                      : (~uint64_t(rows[board_y]) & all_columns) << PADDING;
+                origins &= square.x >= 0 ? free >> square.x : free << -square.x;
+            }
+            fit_[size_t(r) * padded_height_ + y + PADDING] = origins & ((uint64_t(1) << padded_width_) - 1);
+        }
+    }
+
+    // The positions covering the locked squares, one per rotation at most
+    Square target[4];
+    for(int k = 0; k < 4; ++k)
+        target[k] = {lock.x[k], lock.y[k]};
+    std::sort(target, target + 4);
+    bool is_target[4];
+    int target_x[4], target_y[4];
+    for(int r = 0; r < 4; ++r){
+        const Square *squares = table.squares[lock.shape][r];
+        target_x[r] = target[0].x - squares[0].x;
+        target_y[r] = target[0].y - squares[0].y;
+        is_target[r] = true;
+        for(int k = 1; k < 4; ++k){
+            is_target[r] &= target[k].x - squares[k].x == target_x[r]
+                            && target[k].y - squares[k].y == target_y[r];
+        }
+    }
+
+    const int spawn_x = TetrisEngine::spawnX(width), spawn_y = TetrisEngine::spawnY(lock.shape);
+    if(!fits(0, spawn_x, spawn_y))
+        return -1;
+
+    distance_.assign(size_t(4) * padded_height_ * padded_width_, -1);
+    parent_.resize(distance_.size());
+    key_.resize(distance_.size());
+    queue_.clear();
+
+    const size_t start = state(0, spawn_x, spawn_y);
+    distance_[start] = 0;
+    queue_.push_back(uint32_t(start));
+
+    while(!queue_.empty()){
+        const size_t current = queue_.front();
+        queue_.pop_front();
+
+        const int x = int(current % padded_width_) - PADDING;
+        const int y = int(current / padded_width_ % padded_height_) - PADDING;
+        const int r = int(current / padded_width_ / padded_height_);
+        const int keys = distance_[current];
+
+        if(is_target[r] && x == target_x[r] && y == target_y[r]){
+            if(path){
+                for(size_t s = current; s != start; s = parent_[s]){
+                    if(key_[s] != FALL)
+                        path->push_back(TetrisFinesseKey(key_[s]));
+                }
+                std::reverse(path->begin(), path->end());
+            }
+            return keys;
+        }
+
+        auto reach = [&](int next_r, int next_x, int next_y, uint8_t key){
+            const size_t next = state(next_r, next_x, next_y);
+            const int cost = key == FALL ? 0 : 1;
+            if(distance_[next] >= 0 && distance_[next] <= keys + cost)
+                return;
+            distance_[next] = keys + cost;
+            parent_[next] = uint32_t(current);
+            key_[next] = key;
+            if(cost)
+                queue_.push_back(uint32_t(next));
+            else
+                queue_.push_front(uint32_t(next));
+        };
+
+        if(fits(r, x, y + 1))
+            reach(r, x, y + 1, FALL);
+        if(fits(r, x - 1, y)){
+            reach(r, x - 1, y, TapLeftKey);
+            int far = x - 1;
+            while(fits(r, far - 1, y))
+                --far;
+            reach(r, far, y, DasLeftKey);
+        }
+        if(fits(r, x + 1, y)){
+            reach(r, x + 1, y, TapRightKey);
+            int far = x + 1;
+            while(fits(r, far + 1, y))
+                ++far;
+            reach(r, far, y, DasRightKey);
+        }
+        if(fits((r + 3) & 3, x, y))
+            reach((r + 3) & 3, x, y, RotateLeftKey);
+        if(fits((r + 1) & 3, x, y))
+            reach((r + 1) & 3, x, y, RotateRightKey);
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Tells the key presses from the auto repeats among the recorded inputs.
+ *
+ * A move is a repeat of a held key if the input before it is a move the same way,
+ * at most AUTO_REPEAT_MS earlier; or at most AUTO_REPEAT_DELAY_MS earlier when
+ * repeats follow it (the first repeat comes after the longer delay). Rotations are
+ * always presses. Drops are not keys of the model: they are never counted.
+ *
+ * @param replay The decoded replay.
+ * @return One flag per input of the replay, true for a move or rotation key press.
+ */
+std::vector<bool> TetrisFinesse::countKeys(const TetrisReplay &replay)
+{
+    const std::vector<TetrisReplayInput> &inputs = replay.inputs;
+    std::vector<bool> presses(inputs.size(), false);
+    const uint64_t tick_ms = std::max(1, replay.rules.tick_ms);
+
+    // Inputs that come from a key press or repeat (soft drop releases do not stop a repeat)
+    std::vector<size_t> keys;
+    for(size_t i = 0; i < inputs.size(); ++i){
+        if(inputs[i].action != SoftDropOff && inputs[i].action != NoAction)
+            keys.push_back(i);
+    }
+
+    for(size_t k = 0; k < keys.size(); ++k){
+        const TetrisReplayInput &input = inputs[keys[k]];
+        if(input.action != MoveLeft && input.action != MoveRight){
+            presses[keys[k]] = input.action == RotateLeft || input.action == RotateRight;
+            continue;
+        }
+
+        bool is_repeat = false;
+        if(k > 0 && inputs[keys[k - 1]].action == input.action){
+            const uint64_t gap_ms = (input.tick - inputs[keys[k - 1]].tick) * tick_ms;
+            const bool is_followed = k + 1 < keys.size() && inputs[keys[k + 1]].action == input.action
+                                     && (inputs[keys[k + 1]].tick - input.tick) * tick_ms <= uint64_t(AUTO_REPEAT_MS);
+            is_repeat = gap_ms <= uint64_t(AUTO_REPEAT_MS)
+                        || (gap_ms <= uint64_t(AUTO_REPEAT_DELAY_MS) && is_followed);
+        }
+        presses[keys[k]] = !is_repeat;
+    }
+    return presses;
+}
+
+/**
+ * @brief Checks if the piece of the last search fits at a position.
+ *
+ * @param rotation The rotation index.
+ * @param x The x-coordinate of the piece origin.
+ * @param y The y-coordinate of the piece origin.
+ * @return true if all four squares are inside the board and free.
+ */
+bool TetrisFinesse::fits(int rotation, int x, int y) const
+{
+    if(x < -PADDING || x >= padded_width_ - PADDING || y < -PADDING || y >= padded_height_ - PADDING)
+        return false;
+    return (fit_[size_t(rotation) * padded_height_ + y + PADDING] >> (x + PADDING)) & 1;
+}
@@ -0,0 +1,85 @@
+#ifndef TETRISFINESSE_H
+#define TETRISFINESSE_H
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrisreplay.h"
+
+// Key presses of the finesse model: a tap moves one column, a held key (DAS)
+// moves until the piece is blocked
+enum TetrisFinesseKey : uint8_t {
+    TapLeftKey,
+    TapRightKey,
+    DasLeftKey,
+    DasRightKey,
+    RotateLeftKey,
+    RotateRightKey
+};
+
+struct TetrisFinessePiece
+{
+    int index;                  // pieces dropped before it
+    TetrisShape shape;
+    uint64_t spawn_tick, lock_tick;
+    int keys;                   // move and rotation keys pressed while it was played
+    int minimal_keys;           // fewest keys reaching the same squares, -1 if none found
+    std::vector<TetrisFinesseKey> minimal_path;
+
+    int faults() const { return minimal_keys < 0 || keys < minimal_keys ? 0 : keys - minimal_keys; }
+};
+
+struct TetrisFinesseReport
+{
+    std::vector<TetrisFinessePiece> pieces;     // every piece locked, in order
+    int keys = 0, minimal_keys = 0;             // pieces with a minimal path only
+    int faults = 0, faulty_pieces = 0;
+
+    double efficiency() const { return keys ? double(minimal_keys) / keys : 1.0; }
+};
+
+// Post-game finesse analysis: replays a game and, for every piece locked,
+// compares the keys pressed to the fewest keys taking the piece from its spawn
+// position to the same squares.
+// The model counts moves and rotations only. Falling is free (gravity brings
+// the piece down one row at a time, soft drop only speeds it up), so tucks
+// and spins cost their moves. A held direction key counts once whatever the
+// distance it moves the piece.
+// The replays only record moves, so the key presses are told from the auto
+// repeats of a held key by their timing, see countKeys().
+class TetrisFinesse
+{
+public:
+    static const int AUTO_REPEAT_MS;
+    static const int AUTO_REPEAT_DELAY_MS;
+
+    TetrisFinesse();
+
+    bool analyse(const TetrisReplay &replay, TetrisFinesseReport &report);
+    int minimalKeys(const uint32_t *rows, int width, int height, const TetrisLock &lock,
+                    std::vector<TetrisFinesseKey> *path = nullptr);
+
+    static std::vector<bool> countKeys(const TetrisReplay &replay);
+
+private:
+    // Origins are kept PADDING columns/rows away from the board edges
+    static constexpr int PADDING = 2;
+    static constexpr uint8_t FALL = 0xff;
+
+    size_t state(int rotation, int x, int y) const
+    {
+        return (size_t(rotation) * padded_height_ + y + PADDING) * padded_width_ + x + PADDING;
+    }
+    bool fits(int rotation, int x, int y) const;
+
+    int padded_width_, padded_height_;
+    std::vector<uint64_t> fit_;         // origins where the piece fits, per rotation and row
+    std::vector<int> distance_;         // keys to each state, -1 if not reached
+    std::vector<uint32_t> parent_;      // state each state is first reached from
+    std::vector<uint8_t> key_;          // TetrisFinesseKey leading to it, FALL for a fall
+    std::deque<uint32_t> queue_;
+};
+
+#endif // TETRISFINESSE_H
@@ -0,0 +1,140 @@
+#include "tetrishintcontroller.h"
+
+TetrisHintController::TetrisHintController(TetrisBoard *board, QObject *parent)
+    : QObject(parent)
+    , board_(board)
+    , is_enabled_(false)
+    , search_generation_(0)
+    , hint_seed_(0)
+    , hint_piece_(-1)
+    , is_hint_found_(false)
+    , hint_()
+{
+    search_pool_ = new TetrisSearchPool(this);
+    search_pool_->setPerfectClearEnabled(true);
+    connect(search_pool_, &TetrisSearchPool::searchFinished, this, &TetrisHintController::handleSearchFinished);
+    connect(board_, &TetrisBoard::pieceSpawned, this, &TetrisHintController::handlePieceSpawned);
+    connect(board_, &TetrisBoard::gameInterrupted, this, &TetrisHintController::handleGameInterrupted);
+    connect(board_, &TetrisBoard::gameResumed, this, &TetrisHintController::handleGameResumed);
+}
+
+TetrisHintController::~TetrisHintController(){}
+
+/**
+ * @brief Shows or hides the hints on the board.
+ *
+ * When enabled during a game, the cached hint of the current piece is shown at once;
+ * if the piece has not been searched yet, it is searched from where it is now.
+ *
+ * @param enabled true to show the hints.
+ */
+void TetrisHintController::setEnabled(bool enabled)
+{
+    if(enabled == is_enabled_)
+        return;
+
+    is_enabled_ = enabled;
+    if(!is_enabled_){
+        search_pool_->cancel();
+        search_generation_ = 0;
+        board_->clearHint();
+        return;
+    }
+
+    showHint();
+}
+
+/**
+ * @brief Drops the hint shown when the game is paused, reset or restarted.
+ *
+ * The running search stops at its next check and its result is dropped. The cached
+ * hint is kept: it only matches a game with the seed and piece it has been searched
+ * for, and is shown again if the paused game goes on, see handleGameResumed().
+ */
+void TetrisHintController::handleGameInterrupted()
+{
+    search_pool_->cancel();
+    search_generation_ = 0;
+    board_->clearHint();
+}
+
+/**
+ * @brief Shows the hint of the current piece again once a paused game goes on.
+ */
+void TetrisHintController::handleGameResumed()
+{
+    if(is_enabled_)
+        showHint();
+}
+
+/**
+ * @brief Starts searching the piece that just spawned.
+ *
+ * The engine state is copied by the search pool, the search starts from the spawn
+ * position whatever the player does in the meantime. It replaces the search of the
+ * previous piece, if that one is still running; the hint cached for that piece is
+ * forgotten.
+ */
+void TetrisHintController::handlePieceSpawned()
+{
+    hint_piece_ = -1;
+    if(!is_enabled_ || !board_->isPlaying())
+        return;
+
+    search_generation_ = search_pool_->start(board_->engine());
+}
+
+/**
+ * @brief Returns whether the hint of the current piece of an engine is cached.
+ *
+ * @param engine The engine of the board.
+ * @return true if the current piece has been searched already.
+ */
+bool TetrisHintController::isCached(const TetrisEngine &engine) const
+{
+    return engine.seed() == hint_seed_ && engine.piecesDropped() == hint_piece_;
+}
+
+/**
+ * @brief Gives the cached hint of the current piece to the board, or searches the
+ * piece from where it is now if it has not been searched yet.
+ */
+void TetrisHintController::showHint()
+{
+    if(isCached(board_->engine())){
+        if(is_hint_found_)
+            board_->setHint(hint_seed_, hint_piece_, hint_);
+    }else{
+        handlePieceSpawned();
+    }
+}
+
+/**
+ * @brief Caches the placement found for a piece and gives it to the board.
+ *
+ * The beam placement, delivered before the perfect clear search is done, is shown
+ * but not cached: the final result replaces it. The result is kept even if the
+ * piece has locked in the meantime: the board only draws a hint while the piece it
+ * has been searched for is the current one.
+ *
+ * @param result The result of the search.
+ */
+void TetrisHintController::handleSearchFinished(const TetrisSearchResult &result)
+{
+    if(result.generation != search_generation_)
+        return;
+    if(!result.is_final){
+        if(is_enabled_ && result.is_found)
+            board_->setHint(result.seed, result.piece, result.placement);
+        return;
+    }
+    search_generation_ = 0;
+
+    hint_seed_ = result.seed;
+    hint_piece_ = result.piece;
+    is_hint_found_ = result.is_found;
+    hint_ = result.placement;
+
+    if(is_enabled_ && is_hint_found_)
+        board_->setHint(hint_seed_, hint_piece_, hint_);
+}
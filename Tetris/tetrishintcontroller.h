@@ -0,0 +1,51 @@
+#ifndef TETRISHINTCONTROLLER_H
+#define TETRISHINTCONTROLLER_H
+
+#include <QObject>
+
+#include "Tetris/tetrisboard.h"
+#include "Tetris/tetrissearchpool.h"
+
+// Training mode: shows on the board where the AI would place the current piece,
+// or, while the stack is low, the first placement of a perfect clear if any: the
+// beam placement is shown as soon as it is found, and replaced once a perfect
+// clear is.
+// The placement is searched in the background once per piece, when it spawns,
+// and cached for that spawn: moving the piece never starts a search, and the
+// board only draws the cached squares.
+class TetrisHintController : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TetrisHintController(TetrisBoard *board, QObject *parent = nullptr);
+    ~TetrisHintController();
+
+    bool isEnabled() const { return is_enabled_; }
+
+public slots:
+    void setEnabled(bool enabled);
+
+private slots:
+    void handleGameInterrupted();
+    void handleGameResumed();
+    void handlePieceSpawned();
+    void handleSearchFinished(const TetrisSearchResult &result);
+
+private:
+    bool isCached(const TetrisEngine &engine) const;
+    void showHint();
+
+    TetrisBoard *board_;
+    TetrisSearchPool *search_pool_;
+    bool is_enabled_;
+    quint64 search_generation_; // search running for the current piece, 0 for none
+
+    // Hint of the last piece searched
+    quint64 hint_seed_;
+    int hint_piece_; // pieces dropped before it, -1 for none
+    bool is_hint_found_;
+    TetrisPlacement hint_;
+};
+
+#endif // TETRISHINTCONTROLLER_H
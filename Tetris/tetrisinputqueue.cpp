@@ -0,0 +1,97 @@
+#include "tetrisinputqueue.h"
+
+TetrisInputQueue::TetrisInputQueue()
+{
+    clear();
+}
+
+/**
+ * @brief Empties the queue.
+ *
+ * Resets every cell sequence number and both cursors. Must not run concurrently
+ * with push() or pop(), it is meant to be called while the game is stopped.
+ */
+void TetrisInputQueue::clear()
+{
+    for(size_t i = 0; i < CAPACITY; ++i)
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_release);
+}
+
+/**
+ * @brief Reads the oldest input without removing it.
+ *
+ * Lets the engine look at the timestamp of the next input and leave it in the
+ * queue if it belongs to a later tick. Only the consumer thread may call it.
+ *
+ * @param input Filled with the oldest input when one is available.
+ * @return true if an input was available, false if the queue is empty.
+ */
+bool TetrisInputQueue::peek(TetrisInput &input) const
+{
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    const Cell &cell = cells_[pos & MASK];
+
+    if(cell.sequence.load(std::memory_order_acquire) != pos + 1)
+        return false;
+
+    input = cell.input;
+    return true;
+}
+
+/**
+ * @brief Removes the oldest input from the queue.
+ *
+ * Only the consumer thread (the one stepping the engine) may call it.
+ *
+ * @param input Filled with the removed input.
+ * @return true if an input was removed, false if the queue is empty.
+ */
+bool TetrisInputQueue::pop(TetrisInput &input)
+{
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell &cell = cells_[pos & MASK];
+
+    if(cell.sequence.load(std::memory_order_acquire) != pos + 1)
+        return false;
+
+    input = cell.input;
+    dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+    cell.sequence.store(pos + CAPACITY, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Appends an input to the queue.
+ *
+ * Lock-free and safe to call from any number of threads at the same time
+ * (bounded multi-producer queue with per-cell sequence numbers). Producers never
+ * wait on the consumer: when the queue is full the input is rejected.
+ *
+ * @param input The timestamped input to enqueue.
+ * @return true if the input was queued, false if the queue is full.
+ */
+bool TetrisInputQueue::push(const TetrisInput &input)
+{
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+    for(;;){
+        Cell &cell = cells_[pos & MASK];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+
+        if(diff == 0){
+            if(enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                cell.input = input;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }else if(diff < 0){
+            return false;
+        }else{
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef TETRISINPUTQUEUE_H
+#define TETRISINPUTQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Values are stored in replays: only append new actions at the end.
+enum TetrisAction : uint8_t {
+    NoAction,
+    MoveLeft,
+    MoveRight,
+    RotateLeft,
+    RotateRight,
+    SoftDropOn,
+    SoftDropOff,
+    SonicDrop,      // down to the landing row, without locking the piece
+    HardDrop        // down to the landing row, then locks the piece
+};
+
+struct TetrisInput
+{
+    uint32_t timestamp_ms; // game clock, paused time excluded
+    TetrisAction action;
+};
+
+class TetrisInputQueue
+{
+public:
+    static constexpr size_t CAPACITY = 256; // power of two
+
+    TetrisInputQueue();
+
+    void clear();
+    bool peek(TetrisInput &input) const;
+    bool pop(TetrisInput &input);
+    bool push(const TetrisInput &input);
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        TetrisInput input;
+    };
+
+    static constexpr size_t MASK = CAPACITY - 1;
+
+    Cell cells_[CAPACITY];
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+
+#endif // TETRISINPUTQUEUE_H
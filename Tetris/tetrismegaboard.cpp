@@ -0,0 +1,262 @@
+#include "tetrismegaboard.h"
+
+#include <QRandomGenerator>
+
+TetrisMegaBoard::TetrisMegaBoard(const TetrisRules &rules, int square_side, QWidget *parent)
+    : QWidget(parent)
+    , engine_(rules)
+    , square_side_(square_side)
+{
+    setFixedSize(engine_.width() * square_side_, engine_.height() * square_side_);
+    setFocusPolicy(Qt::StrongFocus);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+/**
+ * @brief Starts a new game with a random seed.
+ */
+void TetrisMegaBoard::start()
+{
+    engine_.start(QRandomGenerator::global()->generate64());
+    input_queue_.clear();
+    clock_.start();
+    timer_.start(engine_.rules().tick_ms, Qt::PreciseTimer, this);
+
+    update();
+    emit scoreChanged(0);
+    emit currentPieceMoved(currentPieceRect());
+}
+
+/**
+ * @brief Returns the widget area covered by the current piece.
+ *
+ * @return The bounding rectangle of the current piece, or an empty rectangle if there is none.
+ */
+QRect TetrisMegaBoard::currentPieceRect() const
+{
+    const TetrisPiece &piece = engine_.currentPiece();
+    if(piece.shape() == NoShape)
+        return QRect();
+
+    return QRect((engine_.currentX() + piece.minX()) * square_side_,
+                 (engine_.currentY() + piece.minY()) * square_side_,
+                 (piece.maxX() - piece.minX() + 1) * square_side_,
+                 (piece.maxY() - piece.minY() + 1) * square_side_);
+}
+
+/**
+ * @brief Returns the widget area covered by a range of board rows.
+ *
+ * @param first_row The first row.
+ * @param last_row The last row, included.
+ * @return The rectangle of the rows, over the whole width of the board.
+ */
+QRect TetrisMegaBoard::rowsRect(int first_row, int last_row) const
+{
+    return QRect(0, first_row * square_side_, width(), (last_row - first_row + 1) * square_side_);
+}
+
+/**
+ * @brief Runs every engine tick whose boundary has been reached, as TetrisBoard::processTicks() does.
+ *
+ * @param now_ms Current game time in milliseconds.
+ */
+void TetrisMegaBoard::processTicks(qint64 now_ms)
+{
+    const qint64 tick_ms = engine_.rules().tick_ms;
+
+    while(!engine_.isLost() && qint64(engine_.tickCount() + 1) * tick_ms <= now_ms){
+        const qint64 boundary = qint64(engine_.tickCount() + 1) * tick_ms;
+
+        TetrisInput input;
+        tick_inputs_.clear();
+        while(input_queue_.peek(input) && input.timestamp_ms <= boundary){
+            input_queue_.pop(input);
+            tick_inputs_.append(input);
+        }
+
+        const QRect old_piece_rect = currentPieceRect();
+        const int old_top = engine_.board().top();
+        engine_.step(tick_inputs_.constData(), int(tick_inputs_.size()));
+        handleEngineEvents(old_piece_rect, old_top);
+    }
+}
+
+/**
+ * @brief Reacts to the events of the last engine tick.
+ *
+ * Only the rows the tick changed are repainted: those of the piece before and after
+ * the tick or, after a line clear, the rows from the top of the stack down to the
+ * lowest row removed, which are the only ones moved down.
+ *
+ * @param old_piece_rect The area of the current piece before the tick.
+ * @param old_top The first stored row of the board before the tick.
+ */
+void TetrisMegaBoard::handleEngineEvents(const QRect &old_piece_rect, int old_top)
+{
+    const std::vector<TetrisEvent> &events = engine_.events();
+    if(events.empty())
+        return;
+
+    bool is_cleared = false;
+    for(const TetrisEvent &event : events){
+        switch(event.type){
+        case ScoreChanged:
+            emit scoreChanged(event.value);
+            break;
+        case LinesCleared:
+            is_cleared = true;
+            break;
+        case GameLost:
+            timer_.stop();
+            emit gameLost(event.value);
+            break;
+        default:
+            break;
+        }
+    }
+
+    const QRect piece_rect = currentPieceRect();
+    QRect dirty_rect = old_piece_rect.united(piece_rect);
+    if(is_cleared)
+        dirty_rect = dirty_rect.united(rowsRect(qMin(old_top, engine_.board().top()), engine_.lastClearedRow()));
+    update(dirty_rect);
+
+    if(piece_rect != old_piece_rect)
+        emit currentPieceMoved(piece_rect);
+}
+
+/**
+ * @brief Handles the game timer: runs the ticks due, see processTicks().
+ *
+ * @param event Pointer to the QTimerEvent object representing the timer event.
+ */
+void TetrisMegaBoard::timerEvent(QTimerEvent *event)
+{
+    if(event->timerId() == timer_.timerId())
+        processTicks(clock_.elapsed());
+    else
+        QWidget::timerEvent(event);
+}
+
+/**
+ * @brief Queues an action for the next tick boundary.
+ *
+ * @param action The action to apply.
+ * @return true if the action has been queued, false if the queue is full.
+ */
+bool TetrisMegaBoard::pushInput(TetrisAction action)
+{
+    TetrisInput input;
+    input.timestamp_ms = quint32(clock_.elapsed());
+    input.action = action;
+    return input_queue_.push(input);
+}
+
+/**
+ * @brief Handles key presses: the keys of TetrisBoard, plus enter to hard drop the
+ * piece, since falling through thousands of rows would take minutes.
+ *
+ * @param event Pointer to the QKeyEvent object representing the key press event.
+ */
+void TetrisMegaBoard::keyPressEvent(QKeyEvent *event)
+{
+    if(!timer_.isActive() || (event->isAutoRepeat() && event->key() == Qt::Key_Space)){
+        QWidget::keyPressEvent(event);
+        return;
+    }
+
+    switch(event->key()){
+    case Qt::Key_Left:
+        pushInput(MoveLeft);
+        break;
+    case Qt::Key_Right:
+        pushInput(MoveRight);
+        break;
+    case Qt::Key_Up:
+        pushInput(RotateLeft);
+        break;
+    case Qt::Key_Down:
+        pushInput(RotateRight);
+        break;
+    case Qt::Key_Space:
+        pushInput(SoftDropOn);
+        break;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        pushInput(HardDrop);
+        break;
+    default:
+        QWidget::keyPressEvent(event);
+    }
+}
+
+/**
+ * @brief Handles key releases: releasing space ends the soft drop.
+ *
+ * @param event Pointer to the QKeyEvent object representing the key release event.
+ */
+void TetrisMegaBoard::keyReleaseEvent(QKeyEvent *event)
+{
+    if(timer_.isActive() && !event->isAutoRepeat() && event->key() == Qt::Key_Space)
+        pushInput(SoftDropOff);
+    else
+        QWidget::keyReleaseEvent(event);
+}
+
+/**
+ * @brief Paints the part of the board in the exposed area.
+ *
+ * The cost follows the exposed area, not the board: only its rows and columns are
+ * visited, and the empty rows above the stack are not looked up at all.
+ *
+ * @param event Pointer to the QPaintEvent object representing the paint event.
+ */
+void TetrisMegaBoard::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    const QRect exposed = event->rect();
+    painter.fillRect(exposed, QColor(0x20, 0x20, 0x20));
+
+    const int first_x = qMax(0, exposed.left() / square_side_);
+    const int last_x = qMin(engine_.width() - 1, exposed.right() / square_side_);
+    const int first_y = qMax(engine_.board().top(), exposed.top() / square_side_);
+    const int last_y = qMin(engine_.height() - 1, exposed.bottom() / square_side_);
+
+    for(int y = first_y; y <= last_y; ++y){
+        for(int x = first_x; x <= last_x; ++x){
+            const TetrisShape shape = engine_.shapeAt(x, y);
+            if(shape != NoShape)
+                drawSquare(painter, x * square_side_, y * square_side_, shape);
+        }
+    }
+
+    const TetrisPiece &piece = engine_.currentPiece();
+    if(piece.shape() != NoShape){
+        for(int i = 0; i < 4; ++i){
+            const int x = engine_.currentX() + piece.x(i);
+            const int y = engine_.currentY() + piece.y(i);
+            drawSquare(painter, x * square_side_, y * square_side_, piece.shape());
+        }
+    }
+}
+
+/**
+ * @brief Draws a single square, in the colors of TetrisBoard::drawSquare().
+ *
+ * @param painter Reference to the QPainter object used for drawing.
+ * @param x X-coordinate of the top-left corner of the square.
+ * @param y Y-coordinate of the top-left corner of the square.
+ * @param shape The shape giving the color of the square.
+ */
+void TetrisMegaBoard::drawSquare(QPainter &painter, int x, int y, TetrisShape shape)
+{
+    static constexpr QRgb colorTable[8] = {
+        0x000000, 0xCC6666, 0x66CC66, 0x6666CC,
+        0xCCCC66, 0xCC66CC, 0x66CCCC, 0xDAAA00
+    };
+
+    const QColor color = QColor::fromRgb(colorTable[int(shape)]);
+    painter.fillRect(x, y, square_side_, square_side_, color.darker());
+    painter.fillRect(x + 1, y + 1, square_side_ - 2, square_side_ - 2, color);
+}
@@ -0,0 +1,57 @@
+#ifndef TETRISMEGABOARD_H
+#define TETRISMEGABOARD_H
+
+#include <QWidget>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QKeyEvent>
+#include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QVector>
+
+#include "Tetris/tetrisinputqueue.h"
+#include "Tetris/tetrismegaengine.h"
+
+// Keyboard game on a TetrisMegaEngine board, meant to be the widget of a
+// QScrollArea: only the part of the board the scroll area shows is painted,
+// and only the rows a tick changed are repainted.
+class TetrisMegaBoard : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TetrisMegaBoard(const TetrisRules &rules, int square_side, QWidget *parent = nullptr);
+
+    const TetrisMegaEngine &engine() const { return engine_; }
+    QRect currentPieceRect() const;
+
+public slots:
+    void start();
+
+signals:
+    void currentPieceMoved(const QRect &rect);
+    void gameLost(int score);
+    void scoreChanged(int score);
+
+protected:
+    void keyPressEvent(QKeyEvent *event) override;
+    void keyReleaseEvent(QKeyEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void timerEvent(QTimerEvent *event) override;
+
+private:
+    void drawSquare(QPainter &painter, int x, int y, TetrisShape shape);
+    void handleEngineEvents(const QRect &old_piece_rect, int old_top);
+    void processTicks(qint64 now_ms);
+    bool pushInput(TetrisAction action);
+    QRect rowsRect(int first_row, int last_row) const;
+
+    TetrisMegaEngine engine_;
+    TetrisInputQueue input_queue_;
+    QVector<TetrisInput> tick_inputs_;
+    QBasicTimer timer_;
+    QElapsedTimer clock_;
+    int square_side_;
+};
+
+#endif // TETRISMEGABOARD_H
@@ -0,0 +1,319 @@
+#include "tetrismegaengine.h"
+
+#include <algorithm>
+
+/**
+ * @brief Creates an engine for the given rules.
+ *
+ * The level up and gravity rules divide the counters of the game: rules that
+ * TetrisRules::isValid() rejects are replaced by the default ones. The board size
+ * is kept, clamped by setBoardSize().
+ *
+ * @param rules The rules of the games.
+ */
+TetrisMegaEngine::TetrisMegaEngine(const TetrisRules &rules)
+    : rules_(rules.isValid() ? rules : TetrisRules())
+    , seed_(0)
+    , tick_(0)
+    , is_started_(false)
+    , is_lost_(false)
+    , is_soft_dropping_(false)
+    , gravity_ticks_(rules_.gravity_ticks)
+    , gravity_counter_(0)
+    , score_(0)
+    , curr_x_(0)
+    , curr_y_(0)
+    , curr_rotation_(0)
+    , num_piece_dropped_(0)
+    , num_lines_removed_(0)
+    , last_lock_()
+    , last_cleared_row_(-1)
+{
+    setBoardSize(rules.width, rules.height);
+}
+
+/**
+ * @brief Resizes the playfield, clamped to the sparse board limits. The board is cleared.
+ *
+ * @param width Number of columns.
+ * @param height Number of rows.
+ */
+void TetrisMegaEngine::setBoardSize(int width, int height)
+{
+    board_.reset(width, height);
+    rules_.width = board_.width();
+    rules_.height = board_.height();
+}
+
+/**
+ * @brief Starts a new game from the given seed, as TetrisEngine::start() does.
+ *
+ * @param seed Seed of the piece generator.
+ */
+void TetrisMegaEngine::start(uint64_t seed)
+{
+    seed_ = seed;
+    generator_.setSeed(seed);
+    tick_ = 0;
+
+    is_started_ = true;
+    is_lost_ = false;
+    is_soft_dropping_ = false;
+    gravity_ticks_ = rules_.gravity_ticks;
+    gravity_counter_ = 0;
+    score_ = 0;
+    num_piece_dropped_ = 0;
+    num_lines_removed_ = 0;
+    last_cleared_row_ = -1;
+
+    events_.clear();
+    board_.reset(rules_.width, rules_.height);
+    curr_piece_.setShape(NoShape);
+    next_piece_.setRandomShape(generator_);
+    newPiece();
+}
+
+/**
+ * @brief Advances the game by exactly one tick, as TetrisEngine::step() does.
+ *
+ * @param inputs Inputs to apply at this tick boundary, oldest first.
+ * @param count Number of inputs.
+ */
+void TetrisMegaEngine::step(const TetrisInput *inputs, int count)
+{
+    events_.clear();
+    if(!is_started_ || is_lost_)
+        return;
+
+    for(int i = 0; i < count && !is_lost_; ++i)
+        applyAction(inputs[i].action);
+
+    if(!is_lost_){
+        int interval = is_soft_dropping_ ? rules_.soft_drop_ticks : gravity_ticks_;
+        if(++gravity_counter_ >= interval){
+            gravity_counter_ = 0;
+            oneLineDown();
+        }
+    }
+
+    ++tick_;
+}
+
+/**
+ * @brief Applies a single player action to the current piece, as TetrisEngine::applyAction() does.
+ *
+ * @param action The action to apply.
+ */
+void TetrisMegaEngine::applyAction(TetrisAction action)
+{
+    if(curr_piece_.shape() == NoShape)
+        return;
+
+    switch(action){
+    case MoveLeft:
+        tryMove(curr_piece_, curr_x_ - 1, curr_y_, curr_rotation_);
+        break;
+    case MoveRight:
+        tryMove(curr_piece_, curr_x_ + 1, curr_y_, curr_rotation_);
+        break;
+    case RotateLeft:
+        tryMove(curr_piece_.rotatedLeft(), curr_x_, curr_y_, (curr_rotation_ + 3) & 3);
+        break;
+    case RotateRight:
+        tryMove(curr_piece_.rotatedRight(), curr_x_, curr_y_, (curr_rotation_ + 1) & 3);
+        break;
+    case SoftDropOn:
+        if(!is_soft_dropping_){
+            is_soft_dropping_ = true;
+            gravity_counter_ = 0;
+        }
+        break;
+    case SoftDropOff:
+        if(is_soft_dropping_){
+            is_soft_dropping_ = false;
+            gravity_counter_ = 0;
+        }
+        break;
+    case SonicDrop:
+        dropPiece();
+        break;
+    case HardDrop:
+        dropPiece();
+        gravity_counter_ = 0;
+        pieceDropped();
+        break;
+    case NoAction:
+        break;
+    }
+}
+
+/**
+ * @brief Moves the current piece down as far as it goes.
+ *
+ * The rows above the stack being empty, the piece falls to the stack in one move,
+ * then row by row: a drop costs the rows it goes through in the stack, not the
+ * height of the board. Only one PieceMoved event is sent for the free fall.
+ */
+void TetrisMegaEngine::dropPiece()
+{
+    const int free_rows = board_.top() - 1 - (curr_y_ + curr_piece_.maxY());
+    if(free_rows > 0)
+        tryMove(curr_piece_, curr_x_, curr_y_ + free_rows, curr_rotation_);
+    while(tryMove(curr_piece_, curr_x_, curr_y_ + 1, curr_rotation_)) {}
+}
+
+/**
+ * @brief Checks if a piece fits on the board at the given position.
+ *
+ * Squares above the stack are free without reading the board.
+ *
+ * @param piece The piece to test.
+ * @param x The x-coordinate of the piece origin.
+ * @param y The y-coordinate of the piece origin.
+ * @return true if all four squares are inside the board and free, false otherwise.
+ */
+bool TetrisMegaEngine::fits(const TetrisPiece &piece, int x, int y) const
+{
+    for(int i = 0; i < 4; ++i){
+        int cx = x + piece.x(i);
+        int cy = y + piece.y(i);
+
+        if(cx < 0 || cx >= rules_.width || cy < 0 || cy >= rules_.height)
+            return false;
+
+        if(board_.isFilled(cx, cy))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Increases the game speed, as TetrisEngine::levelUp() does.
+ */
+void TetrisMegaEngine::levelUp()
+{
+    gravity_ticks_ -= (rules_.level_up_speedup * gravity_ticks_ + 50) / 100;
+    gravity_ticks_ = std::max(gravity_ticks_, 1);
+    gravity_counter_ = 0;
+    pushEvent(LevelUp, gravity_ticks_);
+}
+
+/**
+ * @brief Spawns the next piece at the top of the board, as TetrisEngine::newPiece() does.
+ *
+ * If the new piece has no space, the game is lost.
+ */
+void TetrisMegaEngine::newPiece()
+{
+    curr_piece_ = next_piece_;
+    next_piece_.setRandomShape(generator_);
+
+    curr_rotation_ = 0;
+    curr_x_ = TetrisEngine::spawnX(rules_.width);
+    curr_y_ = TetrisEngine::spawnY(curr_piece_.shape());
+
+    if(!fits(curr_piece_, curr_x_, curr_y_)){
+        curr_piece_.setShape(NoShape);
+        is_lost_ = true;
+        pushEvent(GameLost, score_);
+        return;
+    }
+
+    pushEvent(PieceSpawned, curr_piece_.shape());
+}
+
+/**
+ * @brief Moves the current piece one line down, dropping it if it cannot move.
+ */
+void TetrisMegaEngine::oneLineDown()
+{
+    if(!tryMove(curr_piece_, curr_x_, curr_y_ + 1, curr_rotation_))
+        pieceDropped();
+}
+
+/**
+ * @brief Locks the current piece on the board, as TetrisEngine::pieceDropped() does.
+ */
+void TetrisMegaEngine::pieceDropped()
+{
+    last_lock_.shape = curr_piece_.shape();
+    for(int i = 0; i < 4; ++i){
+        int x = curr_x_ + curr_piece_.x(i);
+        int y = curr_y_ + curr_piece_.y(i);
+        board_.fill(x, y, curr_piece_.shape());
+        last_lock_.x[i] = x;
+        last_lock_.y[i] = y;
+    }
+
+    ++num_piece_dropped_;
+    score_ += 10;
+    pushEvent(PieceLocked, curr_piece_.shape());
+    pushEvent(ScoreChanged, score_);
+
+    if(num_piece_dropped_ % rules_.level_up_pieces == 0)
+        levelUp();
+
+    removeFullLines();
+    newPiece();
+}
+
+/**
+ * @brief Removes full lines and updates the score, as TetrisEngine::removeFullLines() does.
+ *
+ * The board has no full row before a lock, so only the rows of the piece just
+ * locked are tested: from the top down, each full one is removed and the rows
+ * above fall by one, the rows below it keep their place.
+ */
+void TetrisMegaEngine::removeFullLines()
+{
+    last_cleared_row_ = -1;
+    int rows[4];
+    std::copy_n(last_lock_.y, 4, rows);
+    std::sort(rows, rows + 4);
+
+    int num_full_lines = 0;
+    for(int i = 0; i < 4; ++i){
+        if((i > 0 && rows[i] == rows[i - 1]) || !board_.isRowFull(rows[i]))
+            continue;
+        board_.removeRow(rows[i]);
+        last_cleared_row_ = rows[i];
+        num_full_lines++;
+    }
+
+    if(num_full_lines == 0)
+        return;
+
+    num_lines_removed_ += num_full_lines;
+    pushEvent(LinesCleared, num_full_lines);
+
+    static const int LINE_SCORES[] = {0, 40, 100, 300, 1200};
+    int prev_score_range = score_ / rules_.level_up_score;
+    score_ += LINE_SCORES[num_full_lines];
+    int curr_score_range = score_ / rules_.level_up_score;
+    if(curr_score_range > prev_score_range)
+        levelUp();
+
+    pushEvent(ScoreChanged, score_);
+}
+
+/**
+ * @brief Attempts to move the current piece to a new position.
+ *
+ * @param new_piece The piece to move (possibly rotated).
+ * @param new_x The new x-coordinate for the piece.
+ * @param new_y The new y-coordinate for the piece.
+ * @param new_rotation Rotation index (0-3, clockwise) of `new_piece`.
+ * @return true if the piece has been moved, false if the position is blocked.
+ */
+bool TetrisMegaEngine::tryMove(const TetrisPiece &new_piece, int new_x, int new_y, int new_rotation)
+{
+    if(!fits(new_piece, new_x, new_y))
+        return false;
+
+    curr_piece_ = new_piece;
+    curr_x_ = new_x;
+    curr_y_ = new_y;
+    curr_rotation_ = new_rotation;
+    pushEvent(PieceMoved);
+    return true;
+}
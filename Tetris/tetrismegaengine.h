@@ -0,0 +1,86 @@
+#ifndef TETRISMEGAENGINE_H
+#define TETRISMEGAENGINE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrisinputqueue.h"
+#include "Tetris/tetrispiece.h"
+#include "Tetris/tetrisrandom.h"
+#include "Tetris/tetrissparseboard.h"
+
+// Stress mode: the game of TetrisEngine on boards of up to
+// TetrisSparseBoard::MAX_WIDTH x MAX_HEIGHT cells, to catch what does not scale
+// in collisions, line clears and rendering. The cells are kept in a
+// TetrisSparseBoard: the empty rows above the stack take no memory, a collision
+// test reads at most the four rows of the piece, a line clear only touches the
+// rows removed. Same rules, pieces and scoring as TetrisEngine: a game on a board
+// TetrisEngine can hold plays exactly as it would there. Invalid rules are
+// replaced by the defaults. There is no saved state, hash or replay.
+class TetrisMegaEngine
+{
+public:
+    explicit TetrisMegaEngine(const TetrisRules &rules = TetrisRules());
+
+    void setBoardSize(int width, int height);
+    void start(uint64_t seed);
+    void stop(){ is_started_ = false; }
+    void step(const TetrisInput *inputs, int count);
+
+    const TetrisRules &rules() const { return rules_; }
+    int width() const { return rules_.width; }
+    int height() const { return rules_.height; }
+    const TetrisSparseBoard &board() const { return board_; }
+    TetrisShape shapeAt(int x, int y) const { return board_.shapeAt(x, y); }
+
+    const TetrisPiece &currentPiece() const { return curr_piece_; }
+    int currentX() const { return curr_x_; }
+    int currentY() const { return curr_y_; }
+    int currentRotation() const { return curr_rotation_; }
+    const TetrisPiece &nextPiece() const { return next_piece_; }
+
+    const std::vector<TetrisEvent> &events() const { return events_; }
+    const TetrisLock &lastLock() const { return last_lock_; }
+    int lastClearedRow() const { return last_cleared_row_; }
+    int gravityTicks() const { return gravity_ticks_; }
+    bool isLost() const { return is_lost_; }
+    bool isStarted() const { return is_started_; }
+    int linesRemoved() const { return num_lines_removed_; }
+    int piecesDropped() const { return num_piece_dropped_; }
+    int score() const { return score_; }
+    uint64_t seed() const { return seed_; }
+    uint64_t tickCount() const { return tick_; }
+
+private:
+    void applyAction(TetrisAction action);
+    void dropPiece();
+    bool fits(const TetrisPiece &piece, int x, int y) const;
+    void levelUp();
+    void newPiece();
+    void oneLineDown();
+    void pieceDropped();
+    void pushEvent(TetrisEventType type, int value = 0){ events_.push_back({type, value}); }
+    void removeFullLines();
+    bool tryMove(const TetrisPiece &new_piece, int new_x, int new_y, int new_rotation);
+
+    TetrisRules rules_;
+    TetrisRandom generator_;
+    uint64_t seed_;
+    uint64_t tick_;
+
+    bool is_started_, is_lost_, is_soft_dropping_;
+    int gravity_ticks_, gravity_counter_;
+    int score_;
+    int curr_x_, curr_y_, curr_rotation_;
+    int num_piece_dropped_, num_lines_removed_;
+
+    TetrisPiece curr_piece_, next_piece_;
+    TetrisLock last_lock_;
+    int last_cleared_row_;      // lowest row removed by the last lock, before the clear; -1 if none
+
+    TetrisSparseBoard board_;
+    std::vector<TetrisEvent> events_;
+};
+
+#endif // TETRISMEGAENGINE_H
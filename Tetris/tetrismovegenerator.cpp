@@ -0,0 +1,356 @@
+#include "tetrismovegenerator.h"
+
+#include <algorithm>
+
+#include "Common/bitops.h"
+
+TetrisMoveGenerator::TetrisMoveGenerator()
+    : width_(0)
+    , height_(0)
+    , padded_height_(0)
+    , shape_(NoShape)
+    , generation_(0)
+{
+}
+
+/**
+ * @brief Lists the placements of the current piece of an engine.
+ *
+ * The search starts from the current position of the piece, so a piece already
+ * moved by the player only gets the placements still reachable.
+ *
+ * @param engine The engine, in between two ticks.
+ * @param placements Filled with the placements, see generate().
+ * @return The number of placements.
+ */
+int TetrisMoveGenerator::generate(const TetrisEngine &engine, std::vector<TetrisPlacement> &placements)
+{
+    return generate(engine.rows(), engine.width(), engine.height(), engine.currentPiece().shape(),
+                    engine.currentX(), engine.currentY(), engine.currentRotation(), placements);
+}
+
+/**
+ * @brief Lists the placements of a newly spawned piece.
+ *
+ * @param rows Row masks of the board, see TetrisEngine::rows().
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param shape The shape of the piece.
+ * @param placements Filled with the placements, see generate().
+ * @return The number of placements, 0 if the piece cannot spawn.
+ */
+int TetrisMoveGenerator::generateFromSpawn(const uint32_t *rows, int width, int height, TetrisShape shape,
+                                           std::vector<TetrisPlacement> &placements)
+{
+    return generate(rows, width, height, shape, TetrisEngine::spawnX(width), TetrisEngine::spawnY(shape), 0, placements);
+}
+
+/**
+ * @brief Lists every placement a piece can reach from the given position.
+ *
+ * Breadth-first search over the (x, y, rotation) positions of the piece, with one
+ * edge per engine action (MoveLeft, MoveRight, RotateLeft, RotateRight, SonicDrop).
+ * The search runs on bit masks: for every rotation and row, one bit per origin
+ * column, so a whole row of positions is moved, rotated or collision tested with
+ * a few word operations. Each layer holds the positions first reached after the
+ * same number of inputs.
+ *
+ * From every position reached, a HardDrop gives the placement below it: since
+ * the layers come by increasing number of inputs, the first time a placement is
+ * found is through its shortest path.
+ *
+ * @param rows Row masks of the board, see TetrisEngine::rows().
+ * @param width Number of columns, at most TetrisEngine::MAX_WIDTH.
+ * @param height Number of rows.
+ * @param shape The shape of the piece.
+ * @param x The x-coordinate of the piece origin.
+ * @param y The y-coordinate of the piece origin.
+ * @param rotation The rotation index of the piece.
+ * @param placements Filled with the placements, in order of path length.
+ * @return The number of placements, 0 if the piece does not fit at its position.
+ */
+int TetrisMoveGenerator::generate(const uint32_t *rows, int width, int height, TetrisShape shape,
+                                  int x, int y, int rotation, std::vector<TetrisPlacement> &placements)
+{
+    placements.clear();
+    rotation &= 3;
+    if(!fits(rows, width, height, shape, x, y, rotation))
+        return 0;
+
+    width_ = width;
+    height_ = height;
+    padded_height_ = height + 2 * PADDING;
+    shape_ = shape;
+
+    const size_t num_rows = size_t(4) * padded_height_;
+    fit_.resize(num_rows);
+    visited_.assign(num_rows, 0);
+    layers_.clear();
+
+    const size_t num_placements = num_rows * 64;
+    if(placed_.size() < num_placements){
+        placed_.assign(num_placements, 0);
+        generation_ = 0;
+    }
+    // Stamps instead of clearing the buffer at each search
+    if(++generation_ == 0){
+        std::fill(placed_.begin(), placed_.end(), 0);
+        generation_ = 1;
+    }
+
+    // Origins where the piece fits, one mask per rotation and row
+    for(int r = 0; r < 4; ++r){
+        const Rotation &rot = rotationOf(shape, r);
+
+        // Board row as a mask of blocked columns, walls included
+        auto blocked = [&](int board_y) -> uint64_t {
+            if(board_y < 0 || board_y >= height)
+                return ~uint64_t(0);
+            return ((uint64_t(rows[board_y]) | (~uint64_t(0) << width)) << PADDING) | ((uint64_t(1) << PADDING) - 1);
+        };
+
+        for(int oy = -PADDING; oy < height + PADDING; ++oy){
+            uint64_t collisions = 0;
+            for(int k = 0; k <= rot.max_y - rot.min_y; ++k){
+                uint64_t board_row = blocked(oy + rot.min_y + k);
+                for(uint32_t m = rot.masks[k]; m; m &= m - 1){
+                    // Square at column origin + min_x + j
+                    int shift = rot.min_x + trailingZeros(m);
+                    collisions |= shift >= 0 ? board_row >> shift : board_row << -shift;
+                }
+            }
+            fit_[row(r, oy)] = ~collisions & ((uint64_t(1) << (width + 2 * PADDING)) - 1);
+        }
+    }
+
+    frontier_.assign(num_rows, 0);
+    next_.assign(num_rows, 0);
+    landed_.assign(num_rows, 0);
+    frontier_[row(rotation, y)] = uint64_t(1) << (x + PADDING);
+    visited_[row(rotation, y)] = frontier_[row(rotation, y)];
+
+    // Rows of the frontier (all rotations): a layer only grows one row down
+    int first_y = y, last_y = y;
+
+    for(int layer = 0; ; ++layer){
+        layers_.insert(layers_.end(), frontier_.begin(), frontier_.end());
+
+        // Hard drop of every position of the layer: slide the masks down through
+        // the fitting origins; bits that cannot go further are the placements,
+        // and also the positions a SonicDrop leads to
+        int landed_last_y = last_y;
+        for(int r = 0; r < 4; ++r){
+            const Rotation &rot = rotationOf(shape, r);
+            uint64_t falling = 0;
+            for(int oy = first_y; oy < height + PADDING; ++oy){
+                falling = (falling | frontier_[row(r, oy)]) & fit_[row(r, oy)];
+                if(!falling){
+                    if(oy >= last_y)
+                        break;
+                    continue;
+                }
+
+                uint64_t below = oy + 1 < height + PADDING ? fit_[row(r, oy + 1)] : 0;
+                landed_[row(r, oy)] = falling & ~below;
+                if(landed_[row(r, oy)])
+                    landed_last_y = std::max(landed_last_y, oy);
+
+                for(uint64_t landed = falling & ~below; landed; landed &= landed - 1){
+                    int ox = trailingZeros(landed) - PADDING;
+                    size_t key = row(rot.canonical, oy + rot.canonical_dy) * 64 + size_t(ox + rot.canonical_dx + PADDING);
+                    if(placed_[key] == generation_)
+                        continue;
+                    placed_[key] = generation_;
+
+                    TetrisPlacement placement;
+                    placement.x = ox;
+                    placement.y = oy;
+                    placement.rotation = r;
+                    placement.top = oy + rot.min_y;
+                    for(int k = 0; k < 4; ++k)
+                        placement.rows[k] = rot.masks[k] << (ox + rot.min_x);
+                    placement.path_length = layer + 1;
+
+                    // The position of this layer the piece has been dropped from
+                    placement.drop_x = ox;
+                    placement.drop_y = oy;
+                    while(!isInLayer(layer, r, ox, placement.drop_y))
+                        --placement.drop_y;
+                    placements.push_back(placement);
+                }
+                falling &= below;
+            }
+        }
+
+        // Next layer: every position one input away, not reached yet
+        int next_first = height + PADDING, next_last = -PADDING - 1;
+        for(int r = 0; r < 4; ++r){
+            for(int oy = first_y; oy <= landed_last_y; ++oy){
+                size_t i = row(r, oy);
+                uint64_t reached = (frontier_[i] >> 1) | (frontier_[i] << 1)
+                                   | frontier_[row((r + 1) & 3, oy)] | frontier_[row((r + 3) & 3, oy)];
+                next_[i] = ((reached & fit_[i]) | landed_[i]) & ~visited_[i];
+                landed_[i] = 0;
+                visited_[i] |= next_[i];
+                if(next_[i]){
+                    next_first = std::min(next_first, oy);
+                    next_last = std::max(next_last, oy);
+                }
+            }
+        }
+        if(next_last < next_first)
+            break;
+
+        // Only the rows of the old frontier need to be cleared before reusing it
+        for(int r = 0; r < 4; ++r)
+            std::fill(frontier_.begin() + row(r, first_y), frontier_.begin() + row(r, last_y) + 1, 0);
+        frontier_.swap(next_);
+        first_y = next_first;
+        last_y = next_last;
+    }
+
+    return int(placements.size());
+}
+
+/**
+ * @brief Returns the shortest input path of a placement.
+ *
+ * Walks the search layers back from the position the piece is dropped from: at
+ * each step one of the positions one input away is in the previous layer. Only
+ * valid until the next search of the generator.
+ *
+ * @param placement A placement found by the last search.
+ * @return The actions to apply from the start position, ending with HardDrop.
+ */
+std::vector<TetrisAction> TetrisMoveGenerator::path(const TetrisPlacement &placement) const
+{
+    std::vector<TetrisAction> actions(placement.path_length, HardDrop);
+
+    int x = placement.drop_x, y = placement.drop_y, r = placement.rotation;
+    for(int layer = placement.path_length - 2; layer >= 0; --layer){
+        // Position before the action, action leading from it to (x, y, r)
+        if(isInLayer(layer, r, x + 1, y)){
+            actions[layer] = MoveLeft;
+            ++x;
+        }else if(isInLayer(layer, r, x - 1, y)){
+            actions[layer] = MoveRight;
+            --x;
+        }else if(isInLayer(layer, (r + 1) & 3, x, y)){
+            actions[layer] = RotateLeft;
+            r = (r + 1) & 3;
+        }else if(isInLayer(layer, (r + 3) & 3, x, y)){
+            actions[layer] = RotateRight;
+            r = (r + 3) & 3;
+        }else{
+            actions[layer] = SonicDrop;
+            do{
+                --y;
+            }while(y > -PADDING && !isInLayer(layer, r, x, y));
+        }
+    }
+
+    return actions;
+}
+
+/**
+ * @brief Checks if a piece fits on a board at the given position.
+ *
+ * Same test as the engine, on the row masks.
+ *
+ * @param rows Row masks of the board.
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param shape The shape of the piece.
+ * @param x The x-coordinate of the piece origin.
+ * @param y The y-coordinate of the piece origin.
+ * @param rotation The rotation index of the piece.
+ * @return true if all four squares are inside the board and free, false otherwise.
+ */
+bool TetrisMoveGenerator::fits(const uint32_t *rows, int width, int height, TetrisShape shape,
+                               int x, int y, int rotation)
+{
+    if(shape == NoShape)
+        return false;
+
+    const Rotation &rot = rotationOf(shape, rotation & 3);
+    const int left = x + rot.min_x;
+    const int top = y + rot.min_y;
+    if(left < 0 || x + rot.max_x >= width || top < 0 || y + rot.max_y >= height)
+        return false;
+
+    for(int k = 0; k <= rot.max_y - rot.min_y; ++k){
+        if(rows[top + k] & (rot.masks[k] << left))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks if a position has been first reached in the given search layer.
+ *
+ * @param layer The layer, i.e. the number of inputs from the start position.
+ * @param rotation The rotation index.
+ * @param x The x-coordinate of the piece origin.
+ * @param y The y-coordinate of the piece origin.
+ * @return true if the position belongs to the layer.
+ */
+bool TetrisMoveGenerator::isInLayer(int layer, int rotation, int x, int y) const
+{
+    if(x < -PADDING || x >= width_ + PADDING || y < -PADDING || y >= height_ + PADDING)
+        return false;
+
+    const size_t layer_size = size_t(4) * padded_height_;
+    return (layers_[layer * layer_size + row(rotation, y)] >> (x + PADDING)) & 1;
+}
+
+/**
+ * @brief Returns the row masks of a shape in a rotation.
+ *
+ * The table is built once from TetrisPiece, rotating right as many times as the
+ * rotation index, exactly as the engine does.
+ *
+ * @param shape The shape, not NoShape.
+ * @param rotation The rotation index (0-3).
+ * @return The rotation data.
+ */
+const TetrisMoveGenerator::Rotation &TetrisMoveGenerator::rotationOf(TetrisShape shape, int rotation)
+{
+    static const std::vector<Rotation> table = [](){
+        std::vector<Rotation> rotations(8 * 4);
+
+        for(int s = 1; s < 8; ++s){
+            TetrisPiece piece;
+            piece.setShape(TetrisShape(s));
+
+            for(int i = 0; i < 4; ++i){
+                Rotation &r = rotations[s * 4 + i];
+                r.min_x = piece.minX();
+                r.max_x = piece.maxX();
+                r.min_y = piece.minY();
+                r.max_y = piece.maxY();
+                std::fill(r.masks, r.masks + 4, 0u);
+                for(int k = 0; k < 4; ++k)
+                    r.masks[piece.y(k) - r.min_y] |= 1u << (piece.x(k) - r.min_x);
+
+                // Same squares as a lower rotation: shift the origin onto it
+                r.canonical = i;
+                r.canonical_dx = 0;
+                r.canonical_dy = 0;
+                for(int j = 0; j < i; ++j){
+                    const Rotation &other = rotations[s * 4 + j];
+                    if(std::equal(r.masks, r.masks + 4, other.masks)){
+                        r.canonical = j;
+                        r.canonical_dx = r.min_x - other.min_x;
+                        r.canonical_dy = r.min_y - other.min_y;
+                        break;
+                    }
+                }
+
+                piece = piece.rotatedRight();
+            }
+        }
+        return rotations;
+    }();
+
+    return table[shape * 4 + rotation];
+}
@@ -0,0 +1,69 @@
+#ifndef TETRISMOVEGENERATOR_H
+#define TETRISMOVEGENERATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrisinputqueue.h"
+#include "Tetris/tetrispiece.h"
+
+// Final position of a piece, as reached by TetrisMoveGenerator
+struct TetrisPlacement
+{
+    int x, y, rotation;     // piece origin and rotation index, as in TetrisEngine
+    int top;                // first board row covered by the piece
+    uint32_t rows[4];       // squares covered, rows top..top+3
+    int path_length;        // inputs of the shortest path, HardDrop included
+    int drop_x, drop_y;     // where the HardDrop of the shortest path is given
+};
+
+// Lists every placement a piece can reach with the engine actions (moves,
+// rotations, sonic drops, so tucks and spins included). Placements covering
+// the same squares (e.g. the rotations of SquareShape) are listed once.
+// Not thread-safe: use one generator per thread, it reuses its buffers.
+class TetrisMoveGenerator
+{
+public:
+    TetrisMoveGenerator();
+
+    int generate(const TetrisEngine &engine, std::vector<TetrisPlacement> &placements);
+    int generate(const uint32_t *rows, int width, int height, TetrisShape shape,
+                 int x, int y, int rotation, std::vector<TetrisPlacement> &placements);
+    int generateFromSpawn(const uint32_t *rows, int width, int height, TetrisShape shape,
+                          std::vector<TetrisPlacement> &placements);
+    std::vector<TetrisAction> path(const TetrisPlacement &placement) const;
+
+    static bool fits(const uint32_t *rows, int width, int height, TetrisShape shape,
+                     int x, int y, int rotation);
+
+private:
+    // One rotation of a shape as row masks, see rotationOf()
+    struct Rotation {
+        int min_x, max_x, min_y, max_y;
+        uint32_t masks[4];          // bit 0 = column min_x, rows min_y..min_y+3
+        int canonical;              // lowest rotation covering the same squares
+        int canonical_dx, canonical_dy;
+    };
+
+    static const Rotation &rotationOf(TetrisShape shape, int rotation);
+    void buildFitMasks();
+    bool isInLayer(int layer, int rotation, int x, int y) const;
+    size_t row(int rotation, int y) const { return size_t(rotation) * padded_height_ + y + PADDING; }
+
+    // Origins are kept PADDING columns/rows away from the board edges, so that
+    // every origin of a fitting piece has a bit (column x is bit x + PADDING)
+    static constexpr int PADDING = 2;
+
+    int width_, height_, padded_height_;
+    TetrisShape shape_;
+    uint32_t generation_;
+
+    std::vector<uint64_t> fit_;         // origins where the piece fits, per rotation and row
+    std::vector<uint64_t> visited_, frontier_, next_;
+    std::vector<uint64_t> landed_;      // landing origins of the frontier, see generate()
+    std::vector<uint64_t> layers_;      // origins first reached after N inputs, for each N
+    std::vector<uint32_t> placed_;      // generation stamp per canonical placement
+};
+
+#endif // TETRISMOVEGENERATOR_H
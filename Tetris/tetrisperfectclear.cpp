@@ -0,0 +1,352 @@
+#include "tetrisperfectclear.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "Common/bitops.h"
+#include "Tetris/tetrisevaluator.h"
+
+namespace {
+
+// Empty rows kept above the rows to fill: pieces move and rotate there exactly as
+// on the whole board, a piece spanning at most two rows above or below its origin
+const int MOVE_ROWS = 6;
+
+// Nodes counted by a worker before adding them to the shared count
+const uint64_t NODE_BATCH = 256;
+
+// Stored for the positions that fail; any value would do, only the hit matters
+const double FAILED = -1.0;
+
+// A queue key tells apart every queue the widest board can use
+static_assert(TetrisPerfectClear::MAX_LINES * TetrisEngine::MAX_WIDTH / 4 <= TetrisPerfectClear::MAX_PIECES,
+              "perfect clear queues need more pieces than TetrisZobrist has queue keys");
+
+TetrisPlacement shifted(TetrisPlacement placement, int dy)
+{
+    placement.y += dy;
+    placement.top += dy;
+    placement.drop_y += dy;
+    return placement;
+}
+
+} // namespace
+
+TetrisPerfectClear::TetrisPerfectClear(const TetrisPerfectClearOptions &options)
+    : table_(1)
+    , table_width_(0)
+    , table_padding_(0)
+    , width_(0)
+    , height_(0)
+    , padding_(0)
+    , lines_(0)
+    , next_root_(0)
+    , best_root_(0)
+    , nodes_(0)
+    , is_aborted_(false)
+{
+    setOptions(options);
+}
+
+/**
+ * @brief Changes the options. Must not be called during a solve.
+ *
+ * @param options The new options, max_lines is clamped to 1..MAX_LINES.
+ */
+void TetrisPerfectClear::setOptions(const TetrisPerfectClearOptions &options)
+{
+    options_ = options;
+    options_.max_lines = std::clamp(options_.max_lines, 1, MAX_LINES);
+    options_.table_megabytes = std::max(1, options_.table_megabytes);
+    if(table_.megabytes() != size_t(options_.table_megabytes))
+        table_.resize(options_.table_megabytes);
+
+    int num_threads = options_.threads > 0 ? options_.threads : int(std::thread::hardware_concurrency());
+    workers_.resize(std::max(1, num_threads));
+    for(std::unique_ptr<Worker> &worker : workers_){
+        if(!worker)
+            worker.reset(new Worker);
+    }
+}
+
+/**
+ * @brief Looks for a perfect clear from a saved engine state.
+ *
+ * The queue is the current piece, the preview and the pieces the game will deal
+ * after them, see TetrisEngine::upcomingPieces().
+ *
+ * @param state The engine state, only read.
+ * @param num_pieces Number of pieces of the queue, the current one included.
+ * @param result Filled with the solution, see the other overload.
+ * @return The status, also set in `result`.
+ */
+TetrisPerfectClearStatus TetrisPerfectClear::solve(const TetrisEngineState &state, int num_pieces,
+                                                   TetrisPerfectClearResult &result)
+{
+    std::vector<TetrisShape> pieces(std::max(0, num_pieces));
+    num_pieces = TetrisEngine::upcomingPieces(state, pieces.data(), num_pieces);
+    return solve(state.rows.data(), state.width, state.height, pieces.data(), num_pieces,
+                 state.curr_x, state.curr_y, state.curr_rotation, result);
+}
+
+/**
+ * @brief Looks for a perfect clear: placements of the queue that leave the board empty.
+ *
+ * The number of rows to clear is the height of the stack, or more when the empty
+ * cells of those rows are not a multiple of 4 or fewer pieces would fill them; every
+ * row count up to options().max_lines is tried, the smallest first.
+ *
+ * @param rows Row masks of the board.
+ * @param width Number of columns.
+ * @param height Number of rows.
+ * @param pieces The current piece then the next ones, in order.
+ * @param num_pieces Number of pieces in `pieces`, only the first MAX_PIECES are used
+ * (more than the widest board can need).
+ * @param x The x-coordinate of the current piece origin.
+ * @param y The y-coordinate of the current piece origin.
+ * @param rotation The rotation index of the current piece.
+ * @param result Filled with the placements of the solution and the path of the first one.
+ * @return PerfectClearFound, PerfectClearImpossible once every sequence has failed,
+ * PerfectClearUnknown if the solve has been cancelled or ran out of nodes.
+ */
+TetrisPerfectClearStatus TetrisPerfectClear::solve(const uint32_t *rows, int width, int height,
+                                                   const TetrisShape *pieces, int num_pieces,
+                                                   int x, int y, int rotation, TetrisPerfectClearResult &result)
+{
+    result = TetrisPerfectClearResult();
+    num_pieces = std::min(num_pieces, MAX_PIECES);
+
+    int stack_height = 0;
+    int filled = 0;
+    for(int row = 0; row < height; ++row){
+        if(rows[row] && !stack_height)
+            stack_height = height - row;
+        filled += bitCount(rows[row]);
+    }
+    const int max_lines = std::min(options_.max_lines, height);
+
+    if(num_pieces < 1 || stack_height > max_lines){
+        result.status = PerfectClearImpossible;
+        return result.status;
+    }
+    if(cancel_.isCancelled()
+        || root_generator_.generate(rows, width, height, pieces[0], x, y, rotation, roots_) == 0)
+        return result.status;
+
+    width_ = width;
+    height_ = height;
+    padding_ = std::min(MOVE_ROWS, height - max_lines);
+    pieces_.assign(pieces, pieces + num_pieces);
+    lines_left_.assign(num_pieces + 1, 0);
+    for(int i = num_pieces - 1; i >= 0; --i)
+        lines_left_[i] = lines_left_[i + 1] + (pieces[i] == LineShape);
+    if(table_width_ != width_ || table_padding_ != padding_){
+        table_.clear();
+        table_width_ = width_;
+        table_padding_ = padding_;
+    }
+    table_.newSearch();
+    nodes_.store(0, std::memory_order_relaxed);
+    is_aborted_.store(false, std::memory_order_relaxed);
+
+    for(int lines = std::max(1, stack_height); lines <= max_lines; ++lines){
+        const int empty = lines * width - filled;
+        if(empty % 4 != 0 || empty / 4 > num_pieces)
+            continue;
+
+        lines_ = lines;
+        root_rows_.assign(rows + height - padding_ - lines, rows + height);
+        next_root_.store(0, std::memory_order_relaxed);
+        best_root_.store(int(roots_.size()), std::memory_order_relaxed);
+        best_solution_.clear();
+
+        // Worker 0 is the calling thread
+        std::vector<std::thread> threads;
+        const int num_threads = std::min(int(workers_.size()), int(roots_.size()));
+        for(int i = 1; i < num_threads; ++i)
+            threads.emplace_back(&TetrisPerfectClear::searchRoots, this, std::ref(*workers_[i]));
+        searchRoots(*workers_[0]);
+        for(std::thread &thread : threads)
+            thread.join();
+
+        for(std::unique_ptr<Worker> &worker : workers_){
+            nodes_.fetch_add(worker->nodes, std::memory_order_relaxed);
+            worker->nodes = 0;
+        }
+
+        if(best_root_.load(std::memory_order_relaxed) < int(roots_.size())){
+            result.status = PerfectClearFound;
+            result.lines = lines;
+            result.placements = best_solution_;
+            result.path = root_generator_.path(best_solution_.front());
+            break;
+        }
+        if(is_aborted_.load(std::memory_order_relaxed))
+            break;
+    }
+
+    result.nodes = nodes_.load(std::memory_order_relaxed);
+    if(result.status != PerfectClearFound && !is_aborted_.load(std::memory_order_relaxed))
+        result.status = PerfectClearImpossible;
+    return result.status;
+}
+
+/**
+ * @brief Body of the search threads: searches the placements of the first piece
+ * one at a time until they are all taken or one before them is solved.
+ *
+ * @param worker The worker of the thread.
+ */
+void TetrisPerfectClear::searchRoots(Worker &worker)
+{
+    const int cut_height = padding_ + lines_;
+    const int offset = height_ - cut_height;
+    worker.rows.resize(size_t(pieces_.size() + 1) * cut_height);
+    worker.placements.resize(pieces_.size());
+
+    for(int root = next_root_.fetch_add(1); root < int(roots_.size()); root = next_root_.fetch_add(1)){
+        if(isAborted(worker, root))
+            break;
+
+        // Placements of the first piece covering a row above the rows to fill fail
+        const TetrisPlacement &placement = roots_[root];
+        if(placement.top < height_ - lines_)
+            continue;
+
+        ++worker.nodes;
+        worker.solution.resize(pieces_.size());
+        uint32_t *child = worker.rows.data() + cut_height;
+        const int cleared = TetrisEvaluator::place(root_rows_.data(), width_, cut_height,
+                                                   shifted(placement, -offset), child);
+        worker.solution[0] = placement;
+        if(search(worker, root, 1, child + cleared, lines_ - cleared) != Solved)
+            continue;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(root < best_root_.load(std::memory_order_relaxed)){
+            best_root_.store(root, std::memory_order_relaxed);
+            best_solution_.assign(worker.solution.begin(), worker.solution.end());
+        }
+    }
+}
+
+/**
+ * @brief Searches the placements of one piece and of the pieces after it.
+ *
+ * @param worker The worker of the thread.
+ * @param root The placement of the first piece the position comes from.
+ * @param index The piece to place.
+ * @param rows Row masks of the cut board: padding_ empty rows, then `lines` rows to fill.
+ * @param lines Rows still to fill.
+ * @return Solved with the placements in worker.solution (cut down to the pieces used),
+ * Failed if no placement sequence works, Aborted if the search gave up.
+ */
+TetrisPerfectClear::Outcome TetrisPerfectClear::search(Worker &worker, int root, int index,
+                                                       const uint32_t *rows, int lines)
+{
+    if(lines == 0){
+        worker.solution.resize(index);
+        return Solved;
+    }
+    if(index == int(pieces_.size()) || !canFill(rows + padding_, lines, index))
+        return Failed;
+    if(isAborted(worker, root))
+        return Aborted;
+
+    const int cut_height = padding_ + lines;
+    const uint64_t key = TetrisTranspositionTable::boardKey(rows, cut_height)
+                         ^ TetrisTranspositionTable::queueKey(pieces_.data() + index, int(pieces_.size()) - index);
+    double value;
+    if(table_.probe(key, 0, value))
+        return Failed;
+
+    std::vector<TetrisPlacement> &placements = worker.placements[index];
+    worker.generator.generateFromSpawn(rows, width_, cut_height, pieces_[index], placements);
+
+    // The board of the next piece keeps the row stride of the whole cut board
+    uint32_t *child = worker.rows.data() + size_t(index + 1) * (padding_ + lines_);
+    const int offset = height_ - cut_height;
+    for(const TetrisPlacement &placement : placements){
+        if(placement.top < padding_)
+            continue;
+
+        ++worker.nodes;
+        const int cleared = TetrisEvaluator::place(rows, width_, cut_height, placement, child);
+        worker.solution[index] = shifted(placement, offset);
+
+        Outcome outcome = search(worker, root, index + 1, child + cleared, lines - cleared);
+        if(outcome != Failed)
+            return outcome;
+    }
+
+    table_.store(key, 0, FAILED);
+    return Failed;
+}
+
+/**
+ * @brief Checks if the search of a root has to stop, and publishes the node count.
+ *
+ * @param worker The worker of the thread.
+ * @param root The root searched.
+ * @return true if the solve is cancelled, out of nodes, or an earlier root is solved.
+ */
+bool TetrisPerfectClear::isAborted(Worker &worker, int root)
+{
+    if(root > best_root_.load(std::memory_order_relaxed))
+        return true;
+
+    if(worker.nodes >= NODE_BATCH){
+        nodes_.fetch_add(worker.nodes, std::memory_order_relaxed);
+        worker.nodes = 0;
+    }
+    if((options_.max_nodes && nodes_.load(std::memory_order_relaxed) >= options_.max_nodes)
+        || cancel_.isCancelled()){
+        is_aborted_.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Quick test that the empty cells of the rows to fill can still be filled.
+ *
+ * Two neighbour columns are linked when they are both empty in some row. Clearing
+ * rows never puts two empty cells in the same row, and placing pieces only empties
+ * fewer cells, so the links can only disappear. A piece always fills cells of
+ * linked columns (its squares side by side are in the same row), hence the empty
+ * cells of every group of linked columns must be a multiple of 4, and a group of
+ * one column only takes vertical LineShape pieces.
+ *
+ * @param field The rows to fill.
+ * @param lines Number of rows.
+ * @param index The next piece to place.
+ * @return false if the rows cannot be filled, true if they may be.
+ */
+bool TetrisPerfectClear::canFill(const uint32_t *field, int lines, int index) const
+{
+    const uint32_t full_row = width_ >= 32 ? ~0u : (1u << width_) - 1;
+    uint32_t links = 0; // bit x: columns x and x + 1 linked
+    for(int row = 0; row < lines; ++row){
+        const uint32_t empty = ~field[row] & full_row;
+        links |= empty & (empty >> 1);
+    }
+
+    // Groups end at the columns not linked to the next one
+    uint32_t group = 0;
+    int line_pieces = 0;
+    for(int x = 0; x < width_; ++x){
+        group |= 1u << x;
+        if((links >> x) & 1)
+            continue;
+
+        int empty = 0;
+        for(int row = 0; row < lines; ++row)
+            empty += bitCount(~field[row] & group);
+        if(empty % 4 != 0)
+            return false;
+        if(bitCount(group) == 1)
+            line_pieces += empty / 4;
+        group = 0;
+    }
+    return line_pieces <= lines_left_[index];
+}
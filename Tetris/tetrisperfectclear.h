@@ -0,0 +1,105 @@
+#ifndef TETRISPERFECTCLEAR_H
+#define TETRISPERFECTCLEAR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Tetris/tetrisai.h"
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrismovegenerator.h"
+#include "Tetris/tetristranspositiontable.h"
+#include "Tetris/tetriszobrist.h"
+
+struct TetrisPerfectClearOptions
+{
+    int max_lines = 4;          // rows the pieces may fill, from the bottom, at most MAX_LINES
+    int threads = 0;            // 0 for one per hardware thread
+    int table_megabytes = 16;   // positions known to fail, shared by the threads and kept between solves
+    uint64_t max_nodes = 0;     // placements tried before giving up, 0 for no limit
+};
+
+enum TetrisPerfectClearStatus {
+    PerfectClearFound,
+    PerfectClearImpossible,     // proved: no sequence of the queue empties the board within max_lines
+    PerfectClearUnknown         // cancelled or out of nodes before an answer
+};
+
+struct TetrisPerfectClearResult
+{
+    TetrisPerfectClearStatus status = PerfectClearUnknown;
+    int lines = 0;                              // rows cleared by the solution
+    std::vector<TetrisPlacement> placements;    // one per piece used, in board coordinates once played
+    std::vector<TetrisAction> path;             // inputs of the first placement from the current position
+    uint64_t nodes = 0;                         // placements tried
+};
+
+// Finds a sequence of placements of the queue that empties the board: every row
+// the stack uses (plus more if the cell count requires it) ends up full. Pieces
+// are played in the queue order, the engine having no hold.
+// Depth-first search over the placements of TetrisMoveGenerator, on a board cut
+// down to the rows that can be filled plus room for the moves above them.
+// Positions found to fail are stored in a transposition table shared by the
+// threads; the threads take the placements of the first piece one at a time,
+// and the solution of the first one in generation order is returned, so the
+// answer does not depend on the number of threads.
+// A solve must not be started from two threads at once.
+class TetrisPerfectClear
+{
+public:
+    static constexpr int MAX_LINES = 6;
+    static constexpr int MAX_PIECES = TetrisZobrist::QUEUE_SLOTS; // longer queues are cut
+
+    explicit TetrisPerfectClear(const TetrisPerfectClearOptions &options = TetrisPerfectClearOptions());
+
+    void setCancel(const TetrisSearchCancel &cancel){ cancel_ = cancel; }
+    void setOptions(const TetrisPerfectClearOptions &options);
+    const TetrisPerfectClearOptions &options() const { return options_; }
+    TetrisTableStats tableStats() const { return table_.stats(); }
+
+    TetrisPerfectClearStatus solve(const TetrisEngineState &state, int num_pieces, TetrisPerfectClearResult &result);
+    TetrisPerfectClearStatus solve(const uint32_t *rows, int width, int height, const TetrisShape *pieces,
+                                   int num_pieces, int x, int y, int rotation, TetrisPerfectClearResult &result);
+
+private:
+    enum Outcome { Failed, Solved, Aborted };
+
+    struct Worker {
+        TetrisMoveGenerator generator;
+        std::vector<std::vector<TetrisPlacement>> placements;   // per piece
+        std::vector<uint32_t> rows;                             // board after each piece
+        std::vector<TetrisPlacement> solution;                  // placements of the current line
+        uint64_t nodes = 0;                                     // not yet added to nodes_
+    };
+
+    void searchRoots(Worker &worker);
+    Outcome search(Worker &worker, int root, int index, const uint32_t *rows, int lines);
+    bool isAborted(Worker &worker, int root);
+    bool canFill(const uint32_t *field, int lines, int index) const;
+
+    TetrisPerfectClearOptions options_;
+    TetrisSearchCancel cancel_;
+    TetrisTranspositionTable table_;
+    int table_width_, table_padding_;   // positions in the table are only valid for this size
+
+    // Solve in progress: the board is cut to `padding_` empty rows above the rows to fill
+    int width_, height_, padding_;
+    std::vector<TetrisShape> pieces_;
+    std::vector<int> lines_left_;       // LineShape pieces from each piece of the queue to the end
+    TetrisMoveGenerator root_generator_;
+    std::vector<TetrisPlacement> roots_;
+    std::vector<uint32_t> root_rows_;   // the cut board, before the first piece
+    int lines_;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<int> next_root_;
+    std::atomic<int> best_root_;        // first root solved so far, roots_.size() if none
+    std::atomic<uint64_t> nodes_;
+    std::atomic<bool> is_aborted_;      // a search gave up: failures are not proved
+    std::mutex mutex_;
+    std::vector<TetrisPlacement> best_solution_;
+};
+
+#endif // TETRISPERFECTCLEAR_H
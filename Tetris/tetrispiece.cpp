@@ -1,16 +1,21 @@
 #include "tetrispiece.h"
 
+#include <algorithm>
+
 /**
  * @brief Sets the Tetris piece to a random shape.
  *
  * This method assigns a random shape to the Tetris piece.
  *
  * The range of shapes is defined to be between 1 and 7 (inclusive), corresponding to the
- * different possible Tetris shapes.
+ * different possible Tetris shapes. The shape is drawn from the given generator, so
+ * the same seed always produces the same sequence of pieces.
+ *
+ * @param generator The seeded generator owned by the game engine.
  */
-void TetrisPiece::setRandomShape()
+void TetrisPiece::setRandomShape(TetrisRandom &generator)
 {
-    setShape(TetrisShape(QRandomGenerator::global()->bounded(1, 8)));
+    setShape(TetrisShape(generator.bounded(1, 8)));
 }
 
 /**
@@ -56,7 +61,7 @@ int TetrisPiece::minX() const
 {
     int min = coords_[0][0];
     for (int i = 1; i < 4; ++i)
-        min = qMin(min, coords_[i][0]);
+        min = std::min(min, coords_[i][0]);
     return min;
 }
 
@@ -72,7 +77,7 @@ int TetrisPiece::maxX() const
 {
     int max = coords_[0][0];
     for (int i = 1; i < 4; ++i)
-        max = qMax(max, coords_[i][0]);
+        max = std::max(max, coords_[i][0]);
     return max;
 }
 
@@ -88,7 +93,7 @@ int TetrisPiece::minY() const
 {
     int min = coords_[0][1];
     for (int i = 1; i < 4; ++i)
-        min = qMin(min, coords_[i][1]);
+        min = std::min(min, coords_[i][1]);
     return min;
 }
 
@@ -104,7 +109,7 @@ int TetrisPiece::maxY() const
 {
     int max = coords_[0][1];
     for (int i = 1; i < 4; ++i)
-        max = qMax(max, coords_[i][1]);
+        max = std::max(max, coords_[i][1]);
     return max;
 }
 
@@ -1,7 +1,7 @@
 #ifndef TETRISPIECE_H
 #define TETRISPIECE_H
 
-#include <QRandomGenerator>
+#include "Tetris/tetrisrandom.h"
 
 enum TetrisShape{
     NoShape,
@@ -17,8 +17,8 @@ enum TetrisShape{
 class TetrisPiece
 {
 public:
-    TetrisPiece(){};
-    void setRandomShape();
+    TetrisPiece(){ setShape(NoShape); };
+    void setRandomShape(TetrisRandom &generator);
     void setShape(TetrisShape shape);
 
     TetrisShape shape() const { return piece_shape_; }
@@ -0,0 +1,44 @@
+#ifndef TETRISRANDOM_H
+#define TETRISRANDOM_H
+
+#include <cstdint>
+
+// Small seedable generator (xorshift64*). The whole state is a single 64-bit
+// word, so it can be copied into snapshots and replays and reproduced exactly.
+class TetrisRandom
+{
+public:
+    explicit TetrisRandom(uint64_t seed = 0){ setSeed(seed); }
+
+    void setSeed(uint64_t seed)
+    {
+        // splitmix64 finalizer, so that close seeds give unrelated sequences
+        uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        state_ = (z ^ (z >> 31)) | 1;
+    }
+
+    uint32_t next()
+    {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return uint32_t((state_ * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+
+    // Same contract as QRandomGenerator::bounded(): lowest included, highest excluded
+    int bounded(int lowest, int highest)
+    {
+        uint64_t range = uint64_t(highest - lowest);
+        return lowest + int((uint64_t(next()) * range) >> 32);
+    }
+
+    uint64_t state() const { return state_; }
+    void setState(uint64_t state){ state_ = state ? state : 1; }
+
+private:
+    uint64_t state_;
+};
+
+#endif // TETRISRANDOM_H
@@ -0,0 +1,432 @@
+#include "tetrisreplay.h"
+
+#include <algorithm>
+#include <climits>
+#include <utility>
+
+// CONSTANT VARIABLE
+const uint8_t TetrisReplay::MAGIC[4] = {'A', 'T', 'R', 'P'};
+const uint8_t TetrisReplay::VERSION = 2; // 2: keyframes
+const int TetrisReplay::RECORD_EXTENSION = 14;
+const int TetrisReplay::RECORD_END = 15;
+const int TetrisReplay::EXTENSION_KEYFRAME = 0;
+const int TetrisReplay::EXTENSION_HASH = 1;
+const uint64_t TetrisReplay::KEYFRAME_TICKS = 500;
+const int TetrisReplay::MAX_HEIGHT = 1024;
+const int TetrisReplay::MAX_RULE_TICKS = 100000;            // tick length, gravity and soft drop
+const uint64_t TetrisReplay::MAX_TICKS = 100000000;         // 11 days of play at 10 ms per tick
+
+namespace {
+
+void writeFixed64(std::vector<uint8_t> &out, uint64_t value)
+{
+    for(int i = 0; i < 8; ++i)
+        out.push_back(uint8_t(value >> (8 * i)));
+}
+
+void writeZigzag(std::vector<uint8_t> &out, int64_t value)
+{
+    TetrisReplay::writeVarint(out, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+}
+
+TetrisReplayEncoder::TetrisReplayEncoder()
+    : is_recording_(false)
+    , last_tick_(0)
+{
+}
+
+/**
+ * @brief Starts the recording of a game.
+ *
+ * Writes the magic, the version and the header (seed and rules) into the buffer.
+ *
+ * @param rules The rules the game is played with, including the board size.
+ * @param seed The seed the engine has been started with.
+ */
+void TetrisReplayEncoder::begin(const TetrisRules &rules, uint64_t seed)
+{
+    buffer_.clear();
+    for(uint8_t byte : TetrisReplay::MAGIC)
+        buffer_.push_back(byte);
+    buffer_.push_back(TetrisReplay::VERSION);
+
+    writeFixed64(buffer_, seed);
+
+    TetrisReplay::writeVarint(buffer_, uint64_t(rules.width));
+    TetrisReplay::writeVarint(buffer_, uint64_t(rules.height));
+    TetrisReplay::writeVarint(buffer_, uint64_t(rules.tick_ms));
+    TetrisReplay::writeVarint(buffer_, uint64_t(rules.gravity_ticks));
+    TetrisReplay::writeVarint(buffer_, uint64_t(rules.soft_drop_ticks));
+    TetrisReplay::writeVarint(buffer_, uint64_t(rules.level_up_pieces));
+    TetrisReplay::writeVarint(buffer_, uint64_t(rules.level_up_score));
+    TetrisReplay::writeVarint(buffer_, uint64_t(rules.level_up_speedup));
+
+    last_tick_ = 0;
+    is_recording_ = true;
+}
+
+/**
+ * @brief Records an input applied by the engine.
+ *
+ * Inputs cost one byte when less than 16 ticks apart from the previous record,
+ * two bytes up to ~20 s apart.
+ *
+ * @param tick The engine tick the input has been applied at.
+ * @param action The applied action.
+ */
+void TetrisReplayEncoder::addInput(uint64_t tick, TetrisAction action)
+{
+    if(!is_recording_)
+        return;
+
+    writeKey(tick, int(action));
+}
+
+/**
+ * @brief Records a keyframe: the whole engine state at a tick boundary.
+ *
+ * A player seeking in the replay starts from the closest keyframe before the wanted
+ * tick instead of the beginning of the game. The state must be saved before the
+ * inputs of its tick are applied, and recorded before them.
+ *
+ * @param state The engine state, see TetrisEngine::saveState().
+ */
+void TetrisReplayEncoder::addKeyframe(const TetrisEngineState &state)
+{
+    if(!is_recording_)
+        return;
+
+    payload_.clear();
+    TetrisReplay::encodeState(state, payload_);
+
+    writeKey(state.tick, TetrisReplay::RECORD_EXTENSION);
+    TetrisReplay::writeVarint(buffer_, uint64_t(TetrisReplay::EXTENSION_KEYFRAME));
+    TetrisReplay::writeVarint(buffer_, uint64_t(payload_.size()));
+    buffer_.insert(buffer_.end(), payload_.begin(), payload_.end());
+}
+
+/**
+ * @brief Records the state hash of the engine at a tick boundary.
+ *
+ * Recorded whenever the hash changes (every lock, clear and spawn), a replay
+ * played on another build or machine shows the exact tick where it stops
+ * matching the recorded game. As keyframes, the hash is taken before the
+ * inputs of its tick and recorded before them.
+ *
+ * @param tick The engine tick.
+ * @param hash TetrisEngine::stateHash() at that tick.
+ */
+void TetrisReplayEncoder::addHash(uint64_t tick, uint64_t hash)
+{
+    if(!is_recording_)
+        return;
+
+    writeKey(tick, TetrisReplay::RECORD_EXTENSION);
+    TetrisReplay::writeVarint(buffer_, uint64_t(TetrisReplay::EXTENSION_HASH));
+    TetrisReplay::writeVarint(buffer_, 8);
+    writeFixed64(buffer_, hash);
+}
+
+/**
+ * @brief Ends the recording with the final state of the game.
+ *
+ * @param tick The engine tick count at the end of the game.
+ * @param score The final score.
+ * @param lines The number of removed lines.
+ * @param pieces The number of dropped pieces.
+ */
+void TetrisReplayEncoder::finish(uint64_t tick, int score, int lines, int pieces)
+{
+    if(!is_recording_)
+        return;
+
+    writeKey(tick, TetrisReplay::RECORD_END);
+    TetrisReplay::writeVarint(buffer_, uint64_t(score));
+    TetrisReplay::writeVarint(buffer_, uint64_t(lines));
+    TetrisReplay::writeVarint(buffer_, uint64_t(pieces));
+    is_recording_ = false;
+}
+
+/**
+ * @brief Goes on recording a game whose first records have already been written.
+ *
+ * Used for a game resumed from a saved game: the bytes recorded before, up to
+ * their last record, are in the hands of the caller; the buffer only gets the
+ * records from now on.
+ *
+ * @param last_tick The tick of the last record written, see lastTick().
+ */
+void TetrisReplayEncoder::resume(uint64_t last_tick)
+{
+    buffer_.clear();
+    last_tick_ = last_tick;
+    is_recording_ = true;
+}
+
+/**
+ * @brief Writes a record key: the tick delta from the previous record and the record code.
+ *
+ * @param tick The tick of the record, never lower than the previous one.
+ * @param code The record code (an action, RECORD_EXTENSION or RECORD_END).
+ */
+void TetrisReplayEncoder::writeKey(uint64_t tick, int code)
+{
+    uint64_t delta = tick - last_tick_;
+    last_tick_ = tick;
+    TetrisReplay::writeVarint(buffer_, (delta << 4) | uint64_t(code));
+}
+
+TetrisReplay::TetrisReplay()
+    : seed(0)
+    , is_finished(false)
+    , final_tick(0)
+    , final_score(0)
+    , final_lines(0)
+    , final_pieces(0)
+{
+}
+
+/**
+ * @brief Decodes a replay file.
+ *
+ * A replay cut before its end record (e.g. the application has been killed) is
+ * still decoded, with `is_finished` false. Version 1 replays have no keyframes,
+ * and older replays no state hashes. Rules out of TetrisRules::isValid(), boards
+ * wider than TetrisEngine::MAX_WIDTH or higher than MAX_HEIGHT, tick lengths,
+ * gravity or soft drop over MAX_RULE_TICKS and games over MAX_TICKS ticks are
+ * rejected, so that nothing read from a file can make a replay take unbounded
+ * memory or time to play.
+ *
+ * @param data The file content.
+ * @param size The file size in bytes.
+ * @return true if the replay has been decoded, false if it is not a valid replay.
+ */
+bool TetrisReplay::decode(const uint8_t *data, size_t size)
+{
+    if(size < 13 || data[0] != MAGIC[0] || data[1] != MAGIC[1] || data[2] != MAGIC[2] || data[3] != MAGIC[3])
+        return false;
+    if(data[4] == 0 || data[4] > VERSION)
+        return false;
+
+    TetrisReplayReader reader{data, size, 5, true};
+    seed = reader.fixed64();
+
+    auto bounded = [&reader](uint64_t max){
+        const uint64_t value = reader.varint();
+        if(value > max)
+            reader.is_valid = false;
+        return int(std::min(value, max));
+    };
+    rules.width = bounded(TetrisEngine::MAX_WIDTH);
+    rules.height = bounded(MAX_HEIGHT);
+    rules.tick_ms = bounded(MAX_RULE_TICKS);
+    rules.gravity_ticks = bounded(MAX_RULE_TICKS);
+    rules.soft_drop_ticks = bounded(MAX_RULE_TICKS);
+    rules.level_up_pieces = bounded(INT_MAX);
+    rules.level_up_score = bounded(INT_MAX);
+    rules.level_up_speedup = bounded(100);
+    if(!reader.is_valid || rules.width <= 0 || rules.height <= 0 || !rules.isValid())
+        return false;
+
+    inputs.clear();
+    keyframes.clear();
+    hashes.clear();
+    is_finished = false;
+    uint64_t tick = 0;
+
+    while(reader.pos < size){
+        uint64_t key = reader.varint();
+        if(!reader.is_valid)
+            break;
+
+        if((key >> 4) > MAX_TICKS - tick)
+            return false;
+        tick += key >> 4;
+        int code = int(key & 0xF);
+
+        if(code == RECORD_END){
+            final_score = int(reader.varint());
+            final_lines = int(reader.varint());
+            final_pieces = int(reader.varint());
+            is_finished = reader.is_valid;
+            break;
+        }
+
+        if(code == RECORD_EXTENSION){
+            int type = int(reader.varint());
+            uint64_t length = reader.varint();
+            if(!reader.is_valid || length > size - reader.pos)
+                break; // cut in the middle of the record
+
+            const uint8_t *payload = data + reader.pos;
+            reader.pos += size_t(length);
+
+            if(type == EXTENSION_KEYFRAME){
+                TetrisReplayKeyframe keyframe;
+                keyframe.input_index = inputs.size();
+                if(!decodeState(payload, size_t(length), keyframe.state) || keyframe.state.tick != tick
+                    || keyframe.state.width != rules.width || keyframe.state.height != rules.height)
+                    return false;
+                keyframes.push_back(std::move(keyframe));
+            }else if(type == EXTENSION_HASH && length == 8){
+                TetrisReplayReader hash_reader{payload, 8, 0, true};
+                hashes.push_back({tick, hash_reader.fixed64()});
+            }
+            continue;
+        }
+
+        inputs.push_back({tick, TetrisAction(code)});
+    }
+
+    final_tick = tick;
+    return true;
+}
+
+/**
+ * @brief Writes an engine state in the compact keyframe format.
+ *
+ * Counters are varints, each row is the varint of its mask (one byte when empty),
+ * and the shapes of the filled squares follow, two per byte, in row order.
+ *
+ * @param state The state to write.
+ * @param out The bytes are appended to it.
+ */
+void TetrisReplay::encodeState(const TetrisEngineState &state, std::vector<uint8_t> &out)
+{
+    writeVarint(out, uint64_t(state.width));
+    writeVarint(out, uint64_t(state.height));
+    writeFixed64(out, state.seed);
+    writeVarint(out, state.tick);
+    writeFixed64(out, state.random_state);
+
+    out.push_back(uint8_t((state.is_started ? 1 : 0) | (state.is_lost ? 2 : 0) | (state.is_soft_dropping ? 4 : 0)));
+    writeVarint(out, uint64_t(state.gravity_ticks));
+    writeVarint(out, uint64_t(state.gravity_counter));
+    writeVarint(out, uint64_t(state.score));
+    writeVarint(out, uint64_t(state.pieces_dropped));
+    writeVarint(out, uint64_t(state.lines_removed));
+
+    out.push_back(uint8_t(state.curr_shape | (state.next_shape << 4)));
+    writeZigzag(out, state.curr_x);
+    writeZigzag(out, state.curr_y);
+    out.push_back(uint8_t(state.curr_rotation & 3));
+
+    for(int y = 0; y < state.height; ++y)
+        writeVarint(out, state.rows[y]);
+
+    int nibbles = 0;
+    for(int y = 0; y < state.height; ++y){
+        for(int x = 0; x < state.width; ++x){
+            if(!(state.rows[y] & (1u << x)))
+                continue;
+            uint8_t shape = uint8_t(state.cells[y * state.width + x]);
+            if(nibbles++ & 1)
+                out.back() |= uint8_t(shape << 4);
+            else
+                out.push_back(shape);
+        }
+    }
+}
+
+/**
+ * @brief Reads an engine state written by encodeState().
+ *
+ * Only the encoding is checked here: counters that fit an int, valid shapes and
+ * generator state, a piece near the board. Whether the state can be played, e.g.
+ * whether its piece fits, is checked by TetrisEngine::loadState().
+ *
+ * @param data The encoded state.
+ * @param size Its size in bytes.
+ * @param state The state to fill.
+ * @return true if the state has been read, false if the bytes are not a valid state.
+ */
+bool TetrisReplay::decodeState(const uint8_t *data, size_t size, TetrisEngineState &state)
+{
+    TetrisReplayReader reader{data, size, 0, true};
+
+    uint64_t width = reader.varint();
+    uint64_t height = reader.varint();
+    // Every row takes at least one byte, which also bounds the allocation below
+    if(!reader.is_valid || width == 0 || width > uint64_t(TetrisEngine::MAX_WIDTH) || height == 0 || height > size)
+        return false;
+
+    state.width = int(width);
+    state.height = int(height);
+    state.seed = reader.fixed64();
+    state.tick = reader.varint();
+    state.random_state = reader.fixed64();
+
+    uint8_t flags = reader.byte();
+    state.is_started = flags & 1;
+    state.is_lost = flags & 2;
+    state.is_soft_dropping = flags & 4;
+    auto counter = [&reader](){
+        const uint64_t value = reader.varint();
+        if(value > uint64_t(INT_MAX))
+            reader.is_valid = false;
+        return int(std::min<uint64_t>(value, INT_MAX));
+    };
+    state.gravity_ticks = counter();
+    state.gravity_counter = counter();
+    state.score = counter();
+    state.pieces_dropped = counter();
+    state.lines_removed = counter();
+
+    const uint8_t shapes = reader.byte();
+    const int curr_shape = shapes & 0xF;
+    const int next_shape = shapes >> 4;
+    const int64_t curr_x = reader.zigzag();
+    const int64_t curr_y = reader.zigzag();
+    state.curr_rotation = reader.byte() & 3;
+    if(curr_shape > JShape || next_shape > JShape || state.random_state == 0
+        || curr_x < -int64_t(width) || curr_x > int64_t(width) || curr_y < -int64_t(height) || curr_y > int64_t(height))
+        return false;
+    state.curr_shape = TetrisShape(curr_shape);
+    state.next_shape = TetrisShape(next_shape);
+    state.curr_x = int(curr_x);
+    state.curr_y = int(curr_y);
+
+    const uint32_t full_row = width >= 32 ? ~0u : (1u << width) - 1;
+    state.rows.resize(state.height);
+    for(int y = 0; y < state.height; ++y){
+        uint64_t bits = reader.varint();
+        if(bits & ~uint64_t(full_row))
+            return false;
+        state.rows[y] = uint32_t(bits);
+    }
+
+    state.cells.assign(size_t(state.width) * state.height, NoShape);
+    int nibbles = 0;
+    uint8_t packed = 0;
+    for(int y = 0; y < state.height; ++y){
+        for(int x = 0; x < state.width; ++x){
+            if(!(state.rows[y] & (1u << x)))
+                continue;
+            if(!(nibbles & 1))
+                packed = reader.byte();
+            int shape = (nibbles++ & 1) ? packed >> 4 : packed & 0xF;
+            if(shape == NoShape || shape > JShape)
+                return false;
+            state.cells[y * state.width + x] = TetrisShape(shape);
+        }
+    }
+
+    return reader.is_valid;
+}
+
+/**
+ * @brief Appends an unsigned LEB128 varint.
+ *
+ * @param out The bytes are appended to it.
+ * @param value The value to write.
+ */
+void TetrisReplay::writeVarint(std::vector<uint8_t> &out, uint64_t value)
+{
+    while(value >= 0x80){
+        out.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
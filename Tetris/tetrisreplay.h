@@ -0,0 +1,144 @@
+#ifndef TETRISREPLAY_H
+#define TETRISREPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrisinputqueue.h"
+
+// Replay file layout (all integers are LEB128 varints unless stated):
+//   "ATRP" magic, version (1 byte)
+//   header: seed (8 bytes LE), width, height, tick_ms, gravity_ticks,
+//           soft_drop_ticks, level_up_pieces, level_up_score, level_up_speedup
+//   records: key = (ticks since previous record << 4) | code
+//     code < RECORD_EXTENSION: the TetrisAction applied at that tick
+//     RECORD_EXTENSION: extension type, payload size, payload (unknown types are skipped)
+//       EXTENSION_KEYFRAME: engine state before the inputs of that tick, see encodeState()
+//       EXTENSION_HASH: TetrisEngine::stateHash() before the inputs of that tick (8 bytes LE)
+//     RECORD_END: end of game, followed by score, lines, pieces
+
+// Bounds-checked reader of replay bytes (also used for saved games): once past
+// the end, every read returns 0 and `is_valid` stays false.
+struct TetrisReplayReader
+{
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    bool is_valid;
+
+    uint8_t byte()
+    {
+        if(pos >= size){
+            is_valid = false;
+            return 0;
+        }
+        return data[pos++];
+    }
+
+    uint64_t fixed64()
+    {
+        uint64_t value = 0;
+        for(int i = 0; i < 8; ++i)
+            value |= uint64_t(byte()) << (8 * i);
+        return value;
+    }
+
+    uint64_t varint()
+    {
+        uint64_t value = 0;
+        for(int shift = 0; shift < 64 && is_valid; shift += 7){
+            uint8_t b = byte();
+            value |= uint64_t(b & 0x7F) << shift;
+            if(!(b & 0x80))
+                return value;
+        }
+        is_valid = false;
+        return 0;
+    }
+
+    int64_t zigzag()
+    {
+        uint64_t value = varint();
+        return int64_t(value >> 1) ^ -int64_t(value & 1);
+    }
+};
+
+struct TetrisReplayInput
+{
+    uint64_t tick;
+    TetrisAction action;
+};
+
+struct TetrisReplayHash
+{
+    uint64_t tick;
+    uint64_t hash;              // TetrisEngine::stateHash() at the start of the tick
+};
+
+struct TetrisReplayKeyframe
+{
+    size_t input_index;         // first input applied from this keyframe on
+    TetrisEngineState state;    // state.tick is the keyframe tick
+};
+
+class TetrisReplayEncoder
+{
+public:
+    TetrisReplayEncoder();
+
+    void begin(const TetrisRules &rules, uint64_t seed);
+    void addInput(uint64_t tick, TetrisAction action);
+    void addKeyframe(const TetrisEngineState &state);
+    void addHash(uint64_t tick, uint64_t hash);
+    void finish(uint64_t tick, int score, int lines, int pieces);
+    void resume(uint64_t last_tick);
+
+    std::vector<uint8_t> &buffer(){ return buffer_; }
+    bool isRecording() const { return is_recording_; }
+    uint64_t lastTick() const { return last_tick_; }
+
+private:
+    void writeKey(uint64_t tick, int code);
+
+    bool is_recording_;
+    uint64_t last_tick_;
+    std::vector<uint8_t> buffer_;
+    std::vector<uint8_t> payload_;
+};
+
+class TetrisReplay
+{
+public:
+    static const uint8_t MAGIC[4];
+    static const uint8_t VERSION;
+    static const int RECORD_EXTENSION;
+    static const int RECORD_END;
+    static const int EXTENSION_KEYFRAME;
+    static const int EXTENSION_HASH;
+    static const uint64_t KEYFRAME_TICKS;
+    static const int MAX_HEIGHT;
+    static const int MAX_RULE_TICKS;
+    static const uint64_t MAX_TICKS;
+
+    TetrisReplay();
+
+    bool decode(const uint8_t *data, size_t size);
+
+    static void encodeState(const TetrisEngineState &state, std::vector<uint8_t> &out);
+    static bool decodeState(const uint8_t *data, size_t size, TetrisEngineState &state);
+    static void writeVarint(std::vector<uint8_t> &out, uint64_t value);
+
+    uint64_t seed;
+    TetrisRules rules;
+    std::vector<TetrisReplayInput> inputs;
+    std::vector<TetrisReplayKeyframe> keyframes; // ascending ticks
+    std::vector<TetrisReplayHash> hashes;       // ascending ticks
+
+    bool is_finished;
+    uint64_t final_tick;
+    int final_score, final_lines, final_pieces;
+};
+
+#endif // TETRISREPLAY_H
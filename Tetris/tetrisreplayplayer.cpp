@@ -0,0 +1,87 @@
+#include "tetrisreplayplayer.h"
+
+#include <algorithm>
+#include <utility>
+
+TetrisReplayPlayer::TetrisReplayPlayer(TetrisEngine &engine)
+    : engine_(engine)
+    , input_index_(0)
+{
+}
+
+/**
+ * @brief Loads a replay and rewinds it to its first tick.
+ *
+ * The engine is reset with the rules of the replay, board size included.
+ *
+ * @param replay The decoded replay.
+ */
+void TetrisReplayPlayer::load(TetrisReplay replay)
+{
+    replay_ = std::move(replay);
+    engine_ = TetrisEngine(replay_.rules);
+    rewind();
+}
+
+/**
+ * @brief Restarts the replay from its first tick.
+ */
+void TetrisReplayPlayer::rewind()
+{
+    engine_.start(replay_.seed);
+    input_index_ = 0;
+}
+
+/**
+ * @brief Moves the replay to the given tick.
+ *
+ * Seeking backward, or past the next keyframe, restores the closest keyframe not
+ * after `tick`; the remaining ticks are then simulated. Seeking forward within the
+ * same keyframe interval only simulates the ticks in between.
+ *
+ * @param tick The tick to move to, clamped to the end of the replay.
+ */
+void TetrisReplayPlayer::seek(uint64_t tick)
+{
+    tick = std::min(tick, endTick());
+
+    const std::vector<TetrisReplayKeyframe> &keyframes = replay_.keyframes;
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), tick,
+                                 [](uint64_t value, const TetrisReplayKeyframe &keyframe){
+                                     return value < keyframe.state.tick;
+                                 });
+    const TetrisReplayKeyframe *closest = next == keyframes.begin() ? nullptr : &*(next - 1);
+    const uint64_t closest_tick = closest ? closest->state.tick : 0;
+
+    if(tick < engine_.tickCount() || closest_tick > engine_.tickCount()){
+        if(closest && engine_.loadState(closest->state))
+            input_index_ = closest->input_index;
+        else
+            rewind();
+    }
+
+    while(engine_.tickCount() < tick && stepTick()) {}
+}
+
+/**
+ * @brief Runs one engine tick with the recorded inputs of that tick.
+ *
+ * @return true if a tick has been run, false if the replay is over.
+ */
+bool TetrisReplayPlayer::stepTick()
+{
+    if(isAtEnd())
+        return false;
+
+    const uint64_t tick = engine_.tickCount();
+    const std::vector<TetrisReplayInput> &inputs = replay_.inputs;
+
+    tick_inputs_.clear();
+    while(input_index_ < inputs.size() && inputs[input_index_].tick <= tick){
+        tick_inputs_.push_back({0, inputs[input_index_].action});
+        ++input_index_;
+    }
+
+    engine_.step(tick_inputs_.data(), int(tick_inputs_.size()));
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef TETRISREPLAYPLAYER_H
+#define TETRISREPLAYPLAYER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrisreplay.h"
+
+// Plays a decoded replay back on an engine. Seeking restarts from the closest
+// keyframe, so it costs at most KEYFRAME_TICKS engine ticks.
+class TetrisReplayPlayer
+{
+public:
+    explicit TetrisReplayPlayer(TetrisEngine &engine);
+
+    void load(TetrisReplay replay);
+    void rewind();
+    void seek(uint64_t tick);
+    bool stepTick();
+
+    const TetrisReplay &replay() const { return replay_; }
+    uint64_t endTick() const { return replay_.final_tick; }
+    bool isAtEnd() const { return engine_.isLost() || engine_.tickCount() >= endTick(); }
+    uint64_t tick() const { return engine_.tickCount(); }
+
+private:
+    TetrisEngine &engine_;
+    TetrisReplay replay_;
+    size_t input_index_;
+    std::vector<TetrisInput> tick_inputs_;
+};
+
+#endif // TETRISREPLAYPLAYER_H
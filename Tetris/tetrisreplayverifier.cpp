@@ -0,0 +1,146 @@
+#include "tetrisreplayverifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief Decodes and verifies a replay file.
+ *
+ * @param data The file content.
+ * @param size The file size in bytes.
+ * @param rules The rules the game must have been played with.
+ * @return The verdict, see verify(const TetrisReplay &, const TetrisRules &).
+ */
+TetrisReplayVerification TetrisReplayVerifier::verify(const uint8_t *data, size_t size, const TetrisRules &rules)
+{
+    TetrisReplay replay;
+    if(!replay.decode(data, size))
+        return TetrisReplayVerification();
+    return verify(replay, rules);
+}
+
+/**
+ * @brief Replays a game and compares it to what has been recorded.
+ *
+ * The rules written in the replay are never trusted: a replay recorded with other
+ * rules than the expected ones is rejected before anything is played. Keyframes
+ * are compared as encoded by TetrisReplay::encodeState(), and state hashes to
+ * TetrisEngine::stateHash(), at the start of their tick as the board records
+ * them; the hash recorded at the end tick is checked once the game is over. The
+ * replay stops at the recorded end tick, or earlier if the game is lost: a game
+ * lost before its recorded end does not match.
+ *
+ * @param replay The decoded replay.
+ * @param rules The rules the game must have been played with.
+ * @return The verdict and the result of the replayed game; CorruptVerdict for a
+ * replay cut before its end record, recorded with other rules, or longer than
+ * TetrisReplay::MAX_TICKS.
+ */
+TetrisReplayVerification TetrisReplayVerifier::verify(const TetrisReplay &replay, const TetrisRules &rules)
+{
+    TetrisReplayVerification verification;
+    if(!replay.is_finished || replay.rules != rules || !rules.isValid() || rules.width < 4
+        || rules.width > TetrisEngine::MAX_WIDTH || rules.height < 4 || rules.height > TetrisReplay::MAX_HEIGHT
+        || replay.final_tick > TetrisReplay::MAX_TICKS)
+        return verification;
+
+    TetrisEngine engine(replay.rules);
+    engine.start(replay.seed);
+
+    const std::vector<TetrisReplayInput> &inputs = replay.inputs;
+    const std::vector<TetrisReplayKeyframe> &keyframes = replay.keyframes;
+    const std::vector<TetrisReplayHash> &hashes = replay.hashes;
+    std::vector<TetrisInput> tick_inputs;
+    std::vector<uint8_t> recorded, replayed;
+    TetrisEngineState state;
+    size_t input_index = 0, keyframe_index = 0, hash_index = 0;
+    bool is_state_matching = true;
+
+    auto checkHashes = [&](uint64_t tick){
+        for(; hash_index < hashes.size() && hashes[hash_index].tick == tick; ++hash_index){
+            if(hashes[hash_index].hash != engine.stateHash())
+                return false;
+        }
+        return true;
+    };
+
+    while(!engine.isLost() && engine.tickCount() < replay.final_tick){
+        const uint64_t tick = engine.tickCount();
+
+        if(!checkHashes(tick)){
+            is_state_matching = false;
+            break;
+        }
+        if(keyframe_index < keyframes.size() && keyframes[keyframe_index].state.tick == tick){
+            engine.saveState(state);
+            recorded.clear();
+            replayed.clear();
+            TetrisReplay::encodeState(keyframes[keyframe_index].state, recorded);
+            TetrisReplay::encodeState(state, replayed);
+            if(recorded != replayed || keyframes[keyframe_index].input_index != input_index){
+                is_state_matching = false;
+                break;
+            }
+            ++keyframe_index;
+        }
+
+        tick_inputs.clear();
+        for(; input_index < inputs.size() && inputs[input_index].tick <= tick; ++input_index)
+            tick_inputs.push_back({0, inputs[input_index].action});
+        engine.step(tick_inputs.data(), int(tick_inputs.size()));
+    }
+
+    if(is_state_matching)
+        is_state_matching = checkHashes(engine.tickCount());
+
+    verification.ticks = engine.tickCount();
+    verification.score = engine.score();
+    verification.lines = engine.linesRemoved();
+    verification.pieces = engine.piecesDropped();
+    verification.is_lost = engine.isLost();
+
+    if(!is_state_matching || keyframe_index != keyframes.size() || hash_index != hashes.size()){
+        verification.verdict = StateMismatchVerdict;
+        verification.mismatch_tick = engine.tickCount();
+    }else if(input_index != inputs.size() || verification.ticks != replay.final_tick
+               || verification.score != replay.final_score || verification.lines != replay.final_lines
+               || verification.pieces != replay.final_pieces){
+        verification.verdict = ResultMismatchVerdict;
+    }else{
+        verification.verdict = ValidVerdict;
+    }
+    return verification;
+}
+
+/**
+ * @brief Verifies replay files in parallel.
+ *
+ * Replays are handed out one at a time with an atomic counter, so a thread done
+ * with short games takes the next ones.
+ *
+ * @param replays The file contents.
+ * @param rules The rules the games must have been played with.
+ * @param threads Threads to use, 0 for one per hardware thread.
+ * @return One verdict per replay, in the same order.
+ */
+std::vector<TetrisReplayVerification> TetrisReplayVerifier::verifyAll(const std::vector<std::vector<uint8_t>> &replays,
+                                                                      const TetrisRules &rules, int threads)
+{
+    std::vector<TetrisReplayVerification> verifications(replays.size());
+    std::atomic<size_t> next(0);
+    auto work = [&](){
+        for(size_t i = next.fetch_add(1); i < replays.size(); i = next.fetch_add(1))
+            verifications[i] = verify(replays[i].data(), replays[i].size(), rules);
+    };
+
+    int num_threads = threads > 0 ? threads : int(std::thread::hardware_concurrency());
+    num_threads = std::max(1, std::min<int>(num_threads, int(replays.size())));
+    std::vector<std::thread> workers;
+    for(int i = 1; i < num_threads; ++i)
+        workers.emplace_back(work);
+    work();
+    for(std::thread &worker : workers)
+        worker.join();
+    return verifications;
+}
@@ -0,0 +1,40 @@
+#ifndef TETRISREPLAYVERIFIER_H
+#define TETRISREPLAYVERIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisreplay.h"
+
+enum TetrisReplayVerdict : uint8_t {
+    ValidVerdict,           // the game replays to the recorded keyframes and result
+    CorruptVerdict,         // not a replay, cut before its end, or other rules than expected
+    StateMismatchVerdict,   // a keyframe or state hash differs from the replayed state
+    ResultMismatchVerdict   // the replayed game ends at another tick, score, lines or pieces
+};
+
+struct TetrisReplayVerification
+{
+    TetrisReplayVerdict verdict = CorruptVerdict;
+    uint64_t ticks = 0;             // replayed engine ticks
+    uint64_t mismatch_tick = 0;     // StateMismatchVerdict: first tick whose state differs
+    int score = 0, lines = 0, pieces = 0;   // of the replayed game
+    bool is_lost = false;           // the replayed game ended lost, not stopped
+};
+
+// Re-simulates recorded games to check that their results are real: a replay is
+// valid only if it was played with the expected rules and the engine, given its
+// seed and inputs, goes through every recorded keyframe and state hash and ends
+// at the recorded tick with the recorded score, lines and pieces. verifyAll()
+// checks a batch of submitted replays over all the cores.
+class TetrisReplayVerifier
+{
+public:
+    static TetrisReplayVerification verify(const uint8_t *data, size_t size, const TetrisRules &rules);
+    static TetrisReplayVerification verify(const TetrisReplay &replay, const TetrisRules &rules);
+    static std::vector<TetrisReplayVerification> verifyAll(const std::vector<std::vector<uint8_t>> &replays,
+                                                           const TetrisRules &rules, int threads = 0);
+};
+
+#endif // TETRISREPLAYVERIFIER_H
@@ -0,0 +1,186 @@
+#include "tetrisreplaywriter.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+
+TetrisReplayWriter::TetrisReplayWriter(QObject *parent)
+    : QThread(parent)
+    , head_(0)
+    , tail_(0)
+{
+}
+
+/**
+ * @brief Flushes the queued chunks and stops the writer thread.
+ */
+TetrisReplayWriter::~TetrisReplayWriter()
+{
+    if(isRunning()){
+        enqueue(new Chunk{Chunk::Quit, QByteArray(), QString()});
+        // Leaving the application is the only place where waiting is fine
+        while(!pending_.isEmpty()){
+            if(tryPush(pending_.first()))
+                pending_.removeFirst();
+            else
+                QThread::yieldCurrentThread();
+        }
+        wait();
+    }
+
+    qDeleteAll(pending_);
+}
+
+/**
+ * @brief Closes the current replay file.
+ *
+ * The file is written aside and renamed over its final name once complete (see
+ * QSaveFile), so a file is never seen half written and an older file of the same
+ * name is replaced at once.
+ */
+void TetrisReplayWriter::closeFile()
+{
+    enqueue(new Chunk{Chunk::Close, QByteArray(), QString()});
+}
+
+/**
+ * @brief Closes the current replay file without keeping it.
+ *
+ * Nothing written since openFile() reaches the disk, and an older file of the same
+ * name is left as it is.
+ */
+void TetrisReplayWriter::discardFile()
+{
+    enqueue(new Chunk{Chunk::Discard, QByteArray(), QString()});
+}
+
+/**
+ * @brief Starts a new replay file. An open one is closed first.
+ *
+ * @param path The final path of the replay file.
+ */
+void TetrisReplayWriter::openFile(const QString &path)
+{
+    enqueue(new Chunk{Chunk::Open, QByteArray(), path});
+}
+
+/**
+ * @brief Deletes a file, in order with the files written before.
+ *
+ * @param path The path of the file.
+ */
+void TetrisReplayWriter::removeFile(const QString &path)
+{
+    enqueue(new Chunk{Chunk::Remove, QByteArray(), path});
+}
+
+/**
+ * @brief Appends bytes to the current replay file.
+ *
+ * @param data The bytes to write.
+ */
+void TetrisReplayWriter::writeData(const QByteArray &data)
+{
+    enqueue(new Chunk{Chunk::Data, data, QString()});
+}
+
+/**
+ * @brief Hands a chunk to the writer thread without blocking.
+ *
+ * Chunks that do not fit in the ring (writer far behind) are kept on the producer
+ * side and pushed, in order, at the next call.
+ *
+ * @param chunk The chunk, owned by the writer from now on.
+ */
+void TetrisReplayWriter::enqueue(Chunk *chunk)
+{
+    pending_.append(chunk);
+    while(!pending_.isEmpty() && tryPush(pending_.first()))
+        pending_.removeFirst();
+}
+
+/**
+ * @brief Pushes a chunk into the single-producer single-consumer ring.
+ *
+ * @param chunk The chunk to push.
+ * @return true if the chunk has been pushed, false if the ring is full.
+ */
+bool TetrisReplayWriter::tryPush(Chunk *chunk)
+{
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if(tail - head_.load(std::memory_order_acquire) == CAPACITY)
+        return false;
+
+    ring_[tail % CAPACITY] = chunk;
+    tail_.store(tail + 1, std::memory_order_release);
+    available_.release();
+    return true;
+}
+
+/**
+ * @brief Takes the oldest chunk from the ring, waiting for one if it is empty.
+ *
+ * Only called from the writer thread.
+ *
+ * @return The chunk, owned by the caller.
+ */
+TetrisReplayWriter::Chunk *TetrisReplayWriter::pop()
+{
+    available_.acquire();
+
+    size_t head = head_.load(std::memory_order_relaxed);
+    Chunk *chunk = ring_[head % CAPACITY];
+    head_.store(head + 1, std::memory_order_release);
+    return chunk;
+}
+
+/**
+ * @brief Writer thread loop: writes the chunks in order until asked to quit.
+ */
+void TetrisReplayWriter::run()
+{
+    auto close_current = [this](){
+        if(!file_.isOpen())
+            return;
+
+        if(file_.commit())
+            emit replaySaved(path_);
+    };
+
+    for(;;){
+        Chunk *chunk = pop();
+
+        switch(chunk->kind){
+        case Chunk::Open:
+            close_current();
+            path_ = chunk->path;
+            QDir().mkpath(QFileInfo(path_).absolutePath());
+            file_.setFileName(path_);
+            if(!file_.open(QIODevice::WriteOnly))
+                qWarning() << "Cannot write replay" << file_.fileName();
+            break;
+        case Chunk::Data:
+            if(file_.isOpen())
+                file_.write(chunk->data);
+            break;
+        case Chunk::Close:
+            close_current();
+            break;
+        case Chunk::Discard:
+            if(file_.isOpen()){
+                file_.cancelWriting();
+                file_.commit();
+            }
+            break;
+        case Chunk::Remove:
+            QFile::remove(chunk->path);
+            break;
+        case Chunk::Quit:
+            close_current();
+            delete chunk;
+            return;
+        }
+
+        delete chunk;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef TETRISREPLAYWRITER_H
+#define TETRISREPLAYWRITER_H
+
+#include <QThread>
+#include <QSemaphore>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QSaveFile>
+
+#include <atomic>
+
+// Writes replays (and saved games) on its own thread. The game thread only hands
+// over byte chunks through a lock-free single-producer queue and never waits for I/O.
+class TetrisReplayWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit TetrisReplayWriter(QObject *parent = nullptr);
+    ~TetrisReplayWriter();
+
+    void closeFile();
+    void discardFile();
+    void openFile(const QString &path);
+    void removeFile(const QString &path);
+    void writeData(const QByteArray &data);
+
+signals:
+    void replaySaved(const QString &path);
+
+protected:
+    void run() override;
+
+private:
+    struct Chunk {
+        enum Kind { Open, Data, Close, Discard, Remove, Quit } kind;
+        QByteArray data;
+        QString path;
+    };
+
+    void enqueue(Chunk *chunk);
+    bool tryPush(Chunk *chunk);
+    Chunk *pop();
+
+    static constexpr size_t CAPACITY = 64;
+
+    Chunk *ring_[CAPACITY];
+    std::atomic<size_t> head_, tail_;
+    QSemaphore available_;
+    QVector<Chunk*> pending_; // producer side only: chunks that did not fit in the ring
+
+    QSaveFile file_;
+    QString path_;
+};
+
+#endif // TETRISREPLAYWRITER_H
@@ -0,0 +1,136 @@
+#include "tetrisrewindbuffer.h"
+
+#include <algorithm>
+
+TetrisRewindBuffer::TetrisRewindBuffer(int capacity)
+    : capacity_(std::max(capacity, 1))
+    , width_(0)
+    , height_(0)
+    , cell_bytes_(0)
+    , newest_(-1)
+    , size_(0)
+{
+}
+
+/**
+ * @brief Empties the buffer for a game on a board of the given size.
+ *
+ * Allocates the slots if the board size changed: the only allocation of the buffer.
+ *
+ * @param width Number of columns.
+ * @param height Number of rows.
+ */
+void TetrisRewindBuffer::reset(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+    cell_bytes_ = (width * height + 1) / 2;
+    snapshots_.resize(capacity_);
+    rows_.resize(size_t(capacity_) * height_);
+    cells_.resize(size_t(capacity_) * cell_bytes_);
+    newest_ = -1;
+    size_ = 0;
+}
+
+/**
+ * @brief Records the state of the game at the spawn of a piece.
+ *
+ * Overwrites the oldest snapshot once the buffer is full.
+ *
+ * @param state The state, see TetrisEngine::saveState(), of a board of the size given to reset().
+ */
+void TetrisRewindBuffer::push(const TetrisEngineState &state)
+{
+    if(state.width != width_ || state.height != height_ || snapshots_.empty())
+        return;
+
+    newest_ = (newest_ + 1) % capacity_;
+    size_ = std::min(size_ + 1, capacity_);
+
+    Snapshot &snapshot = snapshots_[newest_];
+    snapshot.seed = state.seed;
+    snapshot.tick = state.tick;
+    snapshot.random_state = state.random_state;
+    snapshot.gravity_ticks = state.gravity_ticks;
+    snapshot.gravity_counter = state.gravity_counter;
+    snapshot.score = state.score;
+    snapshot.pieces_dropped = state.pieces_dropped;
+    snapshot.lines_removed = state.lines_removed;
+    snapshot.curr_x = state.curr_x;
+    snapshot.curr_y = state.curr_y;
+    snapshot.curr_rotation = uint8_t(state.curr_rotation);
+    snapshot.curr_shape = uint8_t(state.curr_shape);
+    snapshot.next_shape = uint8_t(state.next_shape);
+    snapshot.is_soft_dropping = state.is_soft_dropping;
+
+    std::copy(state.rows.begin(), state.rows.end(), rows_.begin() + size_t(newest_) * height_);
+
+    uint8_t *cells = cells_.data() + size_t(newest_) * cell_bytes_;
+    std::fill(cells, cells + cell_bytes_, 0);
+    for(size_t i = 0; i < state.cells.size(); ++i)
+        cells[i / 2] |= uint8_t(state.cells[i]) << (4 * (i % 2));
+}
+
+/**
+ * @brief Reads the snapshot a number of pieces back, without dropping anything.
+ *
+ * Once the state has been restored, drop() the pieces stepped back over.
+ *
+ * @param pieces Pieces to step back, at least 1; clamped to the snapshots kept.
+ * @param state Filled with the state at the spawn of the piece stepped back to,
+ * for TetrisEngine::loadState(); its vectors are reused.
+ * @return The number of pieces stepped back, 0 if there is no older snapshot (state untouched).
+ */
+int TetrisRewindBuffer::peek(int pieces, TetrisEngineState &state) const
+{
+    const int steps = std::min(pieces, size_ - 1);
+    if(steps <= 0)
+        return 0;
+
+    const int slot = (newest_ - steps + capacity_) % capacity_;
+    const Snapshot &snapshot = snapshots_[slot];
+    state.width = width_;
+    state.height = height_;
+    state.seed = snapshot.seed;
+    state.tick = snapshot.tick;
+    state.random_state = snapshot.random_state;
+    state.is_started = true;
+    state.is_lost = false;
+    state.is_soft_dropping = snapshot.is_soft_dropping;
+    state.gravity_ticks = snapshot.gravity_ticks;
+    state.gravity_counter = snapshot.gravity_counter;
+    state.score = snapshot.score;
+    state.pieces_dropped = snapshot.pieces_dropped;
+    state.lines_removed = snapshot.lines_removed;
+    state.curr_shape = TetrisShape(snapshot.curr_shape);
+    state.next_shape = TetrisShape(snapshot.next_shape);
+    state.curr_x = snapshot.curr_x;
+    state.curr_y = snapshot.curr_y;
+    state.curr_rotation = snapshot.curr_rotation;
+
+    const uint32_t *rows = rows_.data() + size_t(slot) * height_;
+    state.rows.assign(rows, rows + height_);
+
+    const uint8_t *cells = cells_.data() + size_t(slot) * cell_bytes_;
+    state.cells.resize(size_t(width_) * height_);
+    for(size_t i = 0; i < state.cells.size(); ++i)
+        state.cells[i] = TetrisShape((cells[i / 2] >> (4 * (i % 2))) & 0xF);
+    return steps;
+}
+
+/**
+ * @brief Drops the snapshots of the last pieces, after a rewind.
+ *
+ * The snapshot stepped back to is kept, as the snapshot of the piece played again.
+ *
+ * @param pieces Pieces stepped back, as returned by peek().
+ */
+void TetrisRewindBuffer::drop(int pieces)
+{
+    const int steps = std::min(pieces, size_ - 1);
+    if(steps <= 0)
+        return;
+
+    newest_ = (newest_ - steps + capacity_) % capacity_;
+    size_ -= steps;
+}
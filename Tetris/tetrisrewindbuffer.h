@@ -0,0 +1,47 @@
+#ifndef TETRISREWINDBUFFER_H
+#define TETRISREWINDBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisengine.h"
+
+// Ring of compact engine snapshots for the practice rewind, one per piece: the
+// counters of the state, the rows as bit masks and the cell shapes packed two
+// per byte (236 bytes for a 10x20 board). The slots are allocated by
+// reset() only, so recording a piece never allocates and a game of any length
+// keeps the last `capacity` pieces in the same memory.
+class TetrisRewindBuffer
+{
+public:
+    explicit TetrisRewindBuffer(int capacity = 100);
+
+    void reset(int width, int height);
+    void push(const TetrisEngineState &state);
+    int peek(int pieces, TetrisEngineState &state) const;
+    void drop(int pieces);
+
+    int capacity() const { return capacity_; }
+    int size() const { return size_; }
+    size_t snapshotBytes() const { return sizeof(Snapshot) + height_ * sizeof(uint32_t) + cell_bytes_; }
+
+private:
+    struct Snapshot
+    {
+        uint64_t seed, tick, random_state;
+        int32_t gravity_ticks, gravity_counter;
+        int32_t score, pieces_dropped, lines_removed;
+        int32_t curr_x, curr_y;
+        uint8_t curr_rotation, curr_shape, next_shape, is_soft_dropping;
+    };
+
+    int capacity_;
+    int width_, height_, cell_bytes_;
+    int newest_, size_;     // slot of the last snapshot, number of snapshots kept
+    std::vector<Snapshot> snapshots_;
+    std::vector<uint32_t> rows_;    // height rows per slot
+    std::vector<uint8_t> cells_;    // cell_bytes per slot, low nibble first
+};
+
+#endif // TETRISREWINDBUFFER_H
@@ -0,0 +1,99 @@
+#include "tetrissavedgame.h"
+
+#include "Tetris/tetrisreplay.h"
+
+// CONSTANT VARIABLE
+const uint8_t TetrisSavedGame::MAGIC[4] = {'A', 'T', 'S', 'G'};
+const uint8_t TetrisSavedGame::VERSION = 1;
+const uint8_t TetrisSavedGame::FLAG_REPLAY = 1;
+const uint8_t TetrisSavedGame::FLAG_REWOUND = 2;
+
+TetrisSavedGame::TetrisSavedGame()
+    : is_rewound(false)
+    , has_replay(false)
+    , replay_tick(0)
+{
+}
+
+/**
+ * @brief Writes the saved game.
+ *
+ * A few hundred bytes plus the replay: the state is written in the keyframe
+ * format of the replays, see TetrisReplay::encodeState().
+ *
+ * @param out The bytes are appended to it.
+ */
+void TetrisSavedGame::encode(std::vector<uint8_t> &out) const
+{
+    for(uint8_t byte : MAGIC)
+        out.push_back(byte);
+    out.push_back(VERSION);
+    out.push_back(uint8_t((has_replay ? FLAG_REPLAY : 0) | (is_rewound ? FLAG_REWOUND : 0)));
+
+    TetrisReplay::writeVarint(out, uint64_t(rules.tick_ms));
+    TetrisReplay::writeVarint(out, uint64_t(rules.gravity_ticks));
+    TetrisReplay::writeVarint(out, uint64_t(rules.soft_drop_ticks));
+    TetrisReplay::writeVarint(out, uint64_t(rules.level_up_pieces));
+    TetrisReplay::writeVarint(out, uint64_t(rules.level_up_score));
+    TetrisReplay::writeVarint(out, uint64_t(rules.level_up_speedup));
+
+    std::vector<uint8_t> state_bytes;
+    TetrisReplay::encodeState(state, state_bytes);
+    TetrisReplay::writeVarint(out, uint64_t(state_bytes.size()));
+    out.insert(out.end(), state_bytes.begin(), state_bytes.end());
+
+    if(has_replay){
+        TetrisReplay::writeVarint(out, replay_tick);
+        TetrisReplay::writeVarint(out, uint64_t(replay.size()));
+        out.insert(out.end(), replay.begin(), replay.end());
+    }
+}
+
+/**
+ * @brief Reads a saved game written by encode().
+ *
+ * @param data The file content.
+ * @param size The file size in bytes.
+ * @return true if the saved game has been read, false if it is not a valid saved
+ * game of a game in progress.
+ */
+bool TetrisSavedGame::decode(const uint8_t *data, size_t size)
+{
+    if(size < 6 || data[0] != MAGIC[0] || data[1] != MAGIC[1] || data[2] != MAGIC[2] || data[3] != MAGIC[3])
+        return false;
+    if(data[4] == 0 || data[4] > VERSION)
+        return false;
+
+    TetrisReplayReader reader{data, size, 6, true};
+    has_replay = data[5] & FLAG_REPLAY;
+    is_rewound = data[5] & FLAG_REWOUND;
+
+    rules.tick_ms = int(reader.varint());
+    rules.gravity_ticks = int(reader.varint());
+    rules.soft_drop_ticks = int(reader.varint());
+    rules.level_up_pieces = int(reader.varint());
+    rules.level_up_score = int(reader.varint());
+    rules.level_up_speedup = int(reader.varint());
+
+    uint64_t length = reader.varint();
+    if(!reader.is_valid || length > size - reader.pos
+        || !TetrisReplay::decodeState(data + reader.pos, size_t(length), state)
+        || !state.is_started || state.is_lost)
+        return false;
+    reader.pos += size_t(length);
+    rules.width = state.width;
+    rules.height = state.height;
+
+    replay.clear();
+    replay_tick = 0;
+    if(has_replay){
+        replay_tick = reader.varint();
+        length = reader.varint();
+        if(!reader.is_valid || length > size - reader.pos || replay_tick > state.tick)
+            return false;
+        replay.assign(data + reader.pos, data + reader.pos + length);
+        reader.pos += size_t(length);
+    }
+
+    return reader.is_valid && rules.tick_ms > 0;
+}
@@ -0,0 +1,39 @@
+#ifndef TETRISSAVEDGAME_H
+#define TETRISSAVEDGAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisengine.h"
+
+// Saved game file layout (all integers are LEB128 varints unless stated):
+//   "ATSG" magic, version (1 byte), flags (1 byte, FLAG_*)
+//   rules: tick_ms, gravity_ticks, soft_drop_ticks, level_up_pieces,
+//          level_up_score, level_up_speedup (the board size is in the state)
+//   engine state: size, then TetrisReplay::encodeState() bytes
+//   with FLAG_REPLAY: tick of the last replay record, size, then the replay
+//   recorded up to the save, without end record
+class TetrisSavedGame
+{
+public:
+    static const uint8_t MAGIC[4];
+    static const uint8_t VERSION;
+    static const uint8_t FLAG_REPLAY;
+    static const uint8_t FLAG_REWOUND;
+
+    TetrisSavedGame();
+
+    void encode(std::vector<uint8_t> &out) const;
+    bool decode(const uint8_t *data, size_t size);
+
+    TetrisRules rules;
+    TetrisEngineState state;
+    bool is_rewound;                // practice game taken back, see TetrisBoard::rewind()
+
+    bool has_replay;
+    uint64_t replay_tick;           // see TetrisReplayEncoder::lastTick()
+    std::vector<uint8_t> replay;
+};
+
+#endif // TETRISSAVEDGAME_H
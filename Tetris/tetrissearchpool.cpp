@@ -0,0 +1,136 @@
+#include "tetrissearchpool.h"
+
+namespace {
+
+// Placements a perfect clear search may try after the beam search, some tens of
+// milliseconds; a small table is plenty for that many
+const uint64_t PERFECT_CLEAR_NODES = 50000;
+const int PERFECT_CLEAR_TABLE_MEGABYTES = 4;
+
+TetrisPerfectClearOptions perfectClearOptions()
+{
+    TetrisPerfectClearOptions options;
+    options.max_nodes = PERFECT_CLEAR_NODES;
+    options.table_megabytes = PERFECT_CLEAR_TABLE_MEGABYTES;
+    return options;
+}
+
+} // namespace
+
+TetrisSearchPool::TetrisSearchPool(QObject *parent)
+    : QObject(parent)
+    , generation_(0)
+    , pending_(0)
+    , weights_(TetrisWeights::elTetris())
+    , is_perfect_clear_enabled_(false)
+    , perfect_clear_(perfectClearOptions())
+{
+    qRegisterMetaType<TetrisSearchResult>();
+    // The beam search has its own threads: a cancelled search returns quickly,
+    // the next one waits for it rather than sharing the cores
+    pool_.setMaxThreadCount(1);
+}
+
+/**
+ * @brief Cancels the running searches and waits for the workers to return.
+ */
+TetrisSearchPool::~TetrisSearchPool()
+{
+    cancel();
+    pool_.waitForDone();
+}
+
+/**
+ * @brief Starts searching the current piece of an engine, in the background.
+ *
+ * The engine state is copied, the engine can go on as soon as this returns. The
+ * search of the previous generation, if any, is cancelled. searchFinished() is
+ * emitted, on the thread of this object, once the search is done unless it has
+ * been cancelled in between.
+ *
+ * With perfect clears enabled, searchFinished() is first emitted with the beam
+ * placement, not final, so that it can be shown without waiting for the perfect
+ * clear search. The queue given to TetrisPerfectClear holds the pieces needed to
+ * fill max_lines rows, the pieces the game will deal included.
+ *
+ * @param engine The engine, in between two ticks.
+ * @return The generation of the search.
+ */
+quint64 TetrisSearchPool::start(const TetrisEngine &engine)
+{
+    const quint64 generation = generation_.fetch_add(1, std::memory_order_relaxed) + 1;
+    ++pending_;
+
+    TetrisEngineState state;
+    engine.saveState(state);
+    const TetrisWeights weights = weights_;
+    const TetrisBeamOptions options = options_;
+    const bool is_perfect_clear_enabled = is_perfect_clear_enabled_;
+
+    pool_.start([this, state, weights, options, is_perfect_clear_enabled, generation](){
+        const TetrisBeamOptions &current = beam_search_.options();
+        if(current.width != options.width || current.depth != options.depth || current.threads != options.threads
+           || current.table_megabytes != options.table_megabytes)
+            beam_search_.setOptions(options);
+        beam_search_.setWeights(weights);
+        beam_search_.setCancel(TetrisSearchCancel{&generation_, generation});
+        perfect_clear_.setCancel(TetrisSearchCancel{&generation_, generation});
+
+        QElapsedTimer timer;
+        timer.start();
+
+        TetrisSearchResult result;
+        result.generation = generation;
+        result.seed = state.seed;
+        result.piece = state.pieces_dropped;
+        result.x = state.curr_x;
+        result.y = state.curr_y;
+        result.rotation = state.curr_rotation;
+        result.is_found = beam_search_.choose(state, result.placement, result.path);
+        result.nodes = beam_search_.nodesExpanded();
+        result.search_ns = timer.nsecsElapsed();
+
+        if(is_perfect_clear_enabled){
+            result.is_final = false;
+            QMetaObject::invokeMethod(this, [this, result](){ deliver(result); }, Qt::QueuedConnection);
+
+            result.is_final = true;
+            const int num_pieces = perfect_clear_.options().max_lines * state.width / 4;
+            if(perfect_clear_.solve(state, num_pieces, perfect_clear_result_) == PerfectClearFound){
+                result.is_found = true;
+                result.is_perfect_clear = true;
+                result.placement = perfect_clear_result_.placements.front();
+                result.path = perfect_clear_result_.path;
+            }
+            result.nodes += perfect_clear_result_.nodes;
+            result.search_ns = timer.nsecsElapsed();
+        }
+
+        // Back to the GUI thread; dropped there if a newer generation exists
+        QMetaObject::invokeMethod(this, [this, result](){ deliver(result); }, Qt::QueuedConnection);
+    });
+    return generation;
+}
+
+/**
+ * @brief Cancels the running search: it stops at its next check, its result is dropped.
+ */
+void TetrisSearchPool::cancel()
+{
+    generation_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Emits the result of a search, unless it belongs to an old generation.
+ *
+ * @param result The result, on the GUI thread. The search is over once the final one is delivered.
+ */
+void TetrisSearchPool::deliver(const TetrisSearchResult &result)
+{
+    if(result.is_final)
+        --pending_;
+    if(result.generation != generation())
+        return;
+
+    emit searchFinished(result);
+}
@@ -0,0 +1,79 @@
+#ifndef TETRISSEARCHPOOL_H
+#define TETRISSEARCHPOOL_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QMetaType>
+
+#include <atomic>
+#include <vector>
+
+#include "Tetris/tetrisai.h"
+#include "Tetris/tetrisbeamsearch.h"
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrisperfectclear.h"
+
+// Outcome of a search, with what identifies the position it has been run on
+struct TetrisSearchResult
+{
+    quint64 generation = 0;
+    quint64 seed = 0;
+    int piece = 0;                  // pieces dropped before the searched piece
+    int x = 0, y = 0, rotation = 0; // searched piece position
+    bool is_found = false;
+    bool is_perfect_clear = false;  // the placement starts a perfect clear
+    bool is_final = true;           // false for the beam placement a perfect clear may still replace
+    TetrisPlacement placement = {};
+    std::vector<TetrisAction> path;
+    qint64 search_ns = 0;
+    quint64 nodes = 0;              // boards expanded
+};
+Q_DECLARE_METATYPE(TetrisSearchResult)
+
+// Runs AI searches in the background, on a snapshot of the engine state, so the
+// GUI thread never waits for a search. Searches run one at a time, each one
+// spread over all the cores by TetrisBeamSearch. Starting a search or calling
+// cancel() moves to a new generation: older searches stop at their next check
+// and their results are never delivered.
+// With perfect clears enabled, the placement of the beam search is delivered at
+// once, not final, then a low stack is given to TetrisPerfectClear within a node
+// budget: the final result is its first placement if it finds one, the beam one
+// again otherwise.
+class TetrisSearchPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TetrisSearchPool(QObject *parent = nullptr);
+    ~TetrisSearchPool();
+
+    quint64 generation() const { return generation_.load(std::memory_order_relaxed); }
+    bool isPerfectClearEnabled() const { return is_perfect_clear_enabled_; }
+    bool isSearching() const { return pending_ > 0; }
+    void setBeamOptions(const TetrisBeamOptions &options){ options_ = options; }
+    void setPerfectClearEnabled(bool enabled){ is_perfect_clear_enabled_ = enabled; }
+    void setWeights(const TetrisWeights &weights){ weights_ = weights; }
+    quint64 start(const TetrisEngine &engine);
+
+public slots:
+    void cancel();
+
+signals:
+    void searchFinished(const TetrisSearchResult &result);
+
+private:
+    void deliver(const TetrisSearchResult &result);
+
+    QThreadPool pool_;
+    std::atomic<quint64> generation_;
+    int pending_; // searches started and not delivered or dropped yet, GUI thread only
+    TetrisWeights weights_;
+    TetrisBeamOptions options_;
+    bool is_perfect_clear_enabled_;
+    TetrisBeamSearch beam_search_; // only used by the pool thread
+    TetrisPerfectClear perfect_clear_; // only used by the pool thread
+    TetrisPerfectClearResult perfect_clear_result_;
+};
+
+#endif // TETRISSEARCHPOOL_H
@@ -0,0 +1,129 @@
+#include "tetrissparseboard.h"
+
+#include <algorithm>
+
+TetrisSparseBoard::TetrisSparseBoard()
+    : width_(1)
+    , height_(1)
+    , words_(1)
+{
+}
+
+/**
+ * @brief Empties the board and sets its size.
+ *
+ * Every slot goes back to the pool: the memory of the previous game is kept, and
+ * reused as long as the width does not change.
+ *
+ * @param width Number of columns, clamped to [1, MAX_WIDTH].
+ * @param height Number of rows, clamped to [1, MAX_HEIGHT].
+ */
+void TetrisSparseBoard::reset(int width, int height)
+{
+    width = std::clamp(width, 1, MAX_WIDTH);
+    height_ = std::clamp(height, 1, MAX_HEIGHT);
+    stack_.clear();
+    free_slots_.clear();
+    for(int32_t slot = int32_t(counts_.size()) - 1; slot >= 0; --slot)
+        free_slots_.push_back(slot);
+
+    if(width != width_){
+        width_ = width;
+        words_ = (width + 63) / 64;
+        free_slots_.clear();
+        bits_.clear();
+        shapes_.clear();
+        counts_.clear();
+    }
+}
+
+/**
+ * @brief Fills a cell.
+ *
+ * The rows between top() and the cell are taken from the pool: as the cell of a
+ * piece lying on the stack or the floor, that is at most one row per new row of
+ * the piece.
+ *
+ * @param x The column, in [0, width()).
+ * @param y The row, in [0, height()).
+ * @param shape The shape of the piece the cell belongs to.
+ */
+void TetrisSparseBoard::fill(int x, int y, TetrisShape shape)
+{
+    while(y < top())
+        stack_.push_back(allocate());
+
+    const int32_t row = slot(y);
+    uint64_t &word = bits_[size_t(row) * words_ + (x >> 6)];
+    if(!(word & (uint64_t(1) << (x & 63))))
+        ++counts_[row];
+    word |= uint64_t(1) << (x & 63);
+    shapes_[size_t(row) * width_ + x] = uint8_t(shape);
+}
+
+/**
+ * @brief Removes a row, the rows above fall by one.
+ *
+ * The cells never move: the slot goes back to the pool, and the slots of the
+ * rows above move down the index, one 4-byte entry each.
+ *
+ * @param y The row, at least top().
+ */
+void TetrisSparseBoard::removeRow(int y)
+{
+    const size_t index = size_t(height_ - 1 - y);
+    free_slots_.push_back(stack_[index]);
+    stack_.erase(stack_.begin() + index);
+}
+
+/**
+ * @brief Returns whether a cell is filled.
+ *
+ * @param x The column, in [0, width()).
+ * @param y The row, in [0, height()).
+ * @return true if the cell is filled; always false above top(), without any lookup.
+ */
+bool TetrisSparseBoard::isFilled(int x, int y) const
+{
+    if(y < top())
+        return false;
+    return bits_[size_t(slot(y)) * words_ + (x >> 6)] & (uint64_t(1) << (x & 63));
+}
+
+/**
+ * @brief Returns the shape of a cell.
+ *
+ * @param x The column, in [0, width()).
+ * @param y The row, in [0, height()).
+ * @return The shape of the piece the cell belongs to, NoShape for an empty cell.
+ */
+TetrisShape TetrisSparseBoard::shapeAt(int x, int y) const
+{
+    if(y < top())
+        return NoShape;
+    return TetrisShape(shapes_[size_t(slot(y)) * width_ + x]);
+}
+
+/**
+ * @brief Takes an empty row slot from the pool, growing the pool if none is free.
+ *
+ * @return The slot.
+ */
+int32_t TetrisSparseBoard::allocate()
+{
+    int32_t row;
+    if(!free_slots_.empty()){
+        row = free_slots_.back();
+        free_slots_.pop_back();
+    }else{
+        row = int32_t(counts_.size());
+        counts_.push_back(0);
+        bits_.resize(bits_.size() + words_);
+        shapes_.resize(shapes_.size() + width_);
+    }
+
+    std::fill_n(bits_.begin() + size_t(row) * words_, words_, 0);
+    std::fill_n(shapes_.begin() + size_t(row) * width_, width_, uint8_t(NoShape));
+    counts_[row] = 0;
+    return row;
+}
@@ -0,0 +1,51 @@
+#ifndef TETRISSPARSEBOARD_H
+#define TETRISSPARSEBOARD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrispiece.h"
+
+// Cells of a board of up to MAX_WIDTH x MAX_HEIGHT for TetrisMegaEngine, where
+// only the non-empty rows take memory. Pieces pile up from the floor and full
+// rows are removed with everything above falling as a block, so the non-empty
+// rows are always the bottom ones, from top() down: they are indexed by their
+// distance to the floor, and nothing is stored above top(). Every row is a bit
+// mask of 64-bit words, the shape of each cell and its number of filled cells,
+// in a slot of a pool that grows with the highest stack of the game and takes
+// back the slots of removed rows.
+class TetrisSparseBoard
+{
+public:
+    static constexpr int MAX_WIDTH = 1024;
+    static constexpr int MAX_HEIGHT = 16384;
+
+    TetrisSparseBoard();
+
+    void reset(int width, int height);
+    void fill(int x, int y, TetrisShape shape);
+    void removeRow(int y);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int top() const { return height_ - int(stack_.size()); } // first stored row, height() if none
+    bool isFilled(int x, int y) const;
+    bool isRowFull(int y) const { return y >= top() && counts_[slot(y)] == width_; }
+    TetrisShape shapeAt(int x, int y) const;
+    size_t pooledRows() const { return counts_.size(); }
+
+private:
+    int32_t slot(int y) const { return stack_[size_t(height_ - 1 - y)]; }
+    int32_t allocate();
+
+    int width_, height_;
+    int words_;                         // 64-bit words per row
+    std::vector<int32_t> stack_;        // slot of row height - 1 - i
+    std::vector<int32_t> free_slots_;
+    std::vector<uint64_t> bits_;        // words_ per slot
+    std::vector<uint8_t> shapes_;       // width_ per slot
+    std::vector<int32_t> counts_;       // filled cells per slot
+};
+
+#endif // TETRISSPARSEBOARD_H
@@ -0,0 +1,232 @@
+#include "tetristranspositiontable.h"
+
+#include <cstring>
+
+#include "Tetris/tetriszobrist.h"
+
+namespace {
+
+// Entries keep the high bits of the key; the low bits hold the depth and generation
+const uint64_t META_MASK = 0xffff;
+
+uint64_t pack(uint64_t key, int depth, uint32_t generation)
+{
+    return (key & ~META_MASK) | (uint64_t(generation & 0xff) << 8) | uint64_t(depth & 0xff);
+}
+
+} // namespace
+
+TetrisTranspositionTable::TetrisTranspositionTable(size_t megabytes)
+    : megabytes_(0)
+    , mask_(0)
+    , generation_(0)
+{
+    resize(megabytes);
+}
+
+/**
+ * @brief Reallocates the table, emptied.
+ *
+ * The number of buckets is the largest power of two fitting in the size. Must not be
+ * called while searches use the table.
+ *
+ * @param megabytes The size of the table, at least 1.
+ */
+void TetrisTranspositionTable::resize(size_t megabytes)
+{
+    megabytes_ = megabytes < 1 ? 1 : megabytes;
+    size_t count = 1;
+    while(count * 2 * sizeof(Bucket) <= megabytes_ * 1024 * 1024)
+        count *= 2;
+
+    mask_ = count - 1;
+    buckets_.reset(new Bucket[count]);
+    clear();
+}
+
+/**
+ * @brief Empties the table and resets the statistics. Not concurrent with the searches.
+ */
+void TetrisTranspositionTable::clear()
+{
+    for(size_t i = 0; i <= mask_; ++i){
+        for(Entry &entry : buckets_[i].entries){
+            entry.check.store(0, std::memory_order_relaxed);
+            entry.value.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation_.store(0, std::memory_order_relaxed);
+    resetStats();
+}
+
+/**
+ * @brief Starts a new search: the entries stored so far get replaced first.
+ */
+void TetrisTranspositionTable::newSearch()
+{
+    generation_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Looks a position up.
+ *
+ * @param key The position key.
+ * @param depth The depth needed: values searched less deeply are not returned.
+ * @param value Set to the value stored, on a hit.
+ * @return true on a hit.
+ */
+bool TetrisTranspositionTable::probe(uint64_t key, int depth, double &value)
+{
+    Counters &stats = threadCounters();
+    stats.probes.fetch_add(1, std::memory_order_relaxed);
+
+    Bucket &bucket = buckets_[key & mask_];
+    for(Entry &entry : bucket.entries){
+        uint64_t bits = entry.value.load(std::memory_order_relaxed);
+        uint64_t meta = entry.check.load(std::memory_order_relaxed) ^ bits;
+        if((meta & ~META_MASK) != (key & ~META_MASK) || meta == 0)
+            continue;
+        if(int(meta & 0xff) < depth)
+            return false;
+
+        std::memcpy(&value, &bits, sizeof(value));
+        stats.hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Stores the value of a position.
+ *
+ * The entry of the same position is updated unless it has been searched more deeply
+ * in the current search. Otherwise the entry replaced is the one of an older search,
+ * then the one searched the least deeply.
+ *
+ * @param key The position key.
+ * @param depth The depth searched to get the value, from 0 to 255.
+ * @param value The value.
+ */
+void TetrisTranspositionTable::store(uint64_t key, int depth, double value)
+{
+    const uint32_t generation = generation_.load(std::memory_order_relaxed) & 0xff;
+    Bucket &bucket = buckets_[key & mask_];
+
+    Entry *victim = nullptr;
+    int victim_rank = 0;
+    bool is_same = false;
+    for(Entry &entry : bucket.entries){
+        uint64_t meta = entry.check.load(std::memory_order_relaxed) ^ entry.value.load(std::memory_order_relaxed);
+        if(meta != 0 && (meta & ~META_MASK) == (key & ~META_MASK)){
+            if(((meta >> 8) & 0xff) == generation && int(meta & 0xff) > depth)
+                return;
+            victim = &entry;
+            is_same = true;
+            break;
+        }
+
+        // Empty entries first, then older searches, then shallower values
+        int rank = meta == 0 ? -1 : (((meta >> 8) & 0xff) == generation ? 256 : 0) + int(meta & 0xff);
+        if(!victim || rank < victim_rank){
+            victim = &entry;
+            victim_rank = rank;
+        }
+    }
+
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    victim->value.store(bits, std::memory_order_relaxed);
+    victim->check.store(pack(key, depth, generation) ^ bits, std::memory_order_relaxed);
+
+    Counters &stats = threadCounters();
+    stats.stores.fetch_add(1, std::memory_order_relaxed);
+    if(!is_same && victim_rank >= 0)
+        stats.replacements.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the statistics since the last resetStats().
+ *
+ * The used entries are counted by scanning the table: do not call it on every search.
+ *
+ * @return The statistics.
+ */
+TetrisTableStats TetrisTranspositionTable::stats() const
+{
+    TetrisTableStats result;
+    for(const Counters &shard : counters_){
+        result.probes += shard.probes.load(std::memory_order_relaxed);
+        result.hits += shard.hits.load(std::memory_order_relaxed);
+        result.stores += shard.stores.load(std::memory_order_relaxed);
+        result.replacements += shard.replacements.load(std::memory_order_relaxed);
+    }
+
+    const uint32_t generation = generation_.load(std::memory_order_relaxed) & 0xff;
+    result.entries = (mask_ + 1) * 4;
+    for(size_t i = 0; i <= mask_; ++i){
+        for(const Entry &entry : buckets_[i].entries){
+            uint64_t meta = entry.check.load(std::memory_order_relaxed) ^ entry.value.load(std::memory_order_relaxed);
+            if(meta != 0 && ((meta >> 8) & 0xff) == generation)
+                ++result.used;
+        }
+    }
+    return result;
+}
+
+void TetrisTranspositionTable::resetStats()
+{
+    for(Counters &shard : counters_){
+        shard.probes.store(0, std::memory_order_relaxed);
+        shard.hits.store(0, std::memory_order_relaxed);
+        shard.stores.store(0, std::memory_order_relaxed);
+        shard.replacements.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Returns the key of a board.
+ *
+ * Zobrist hashing with a random key per row, mixed with the row mask, see TetrisZobrist.
+ *
+ * @param rows Row masks of the board.
+ * @param height Number of rows.
+ * @return The key, to combine with queueKey() with a xor.
+ */
+uint64_t TetrisTranspositionTable::boardKey(const uint32_t *rows, int height)
+{
+    uint64_t key = 0;
+    for(int y = 0; y < height; ++y)
+        key ^= TetrisZobrist::rowKey(y, rows[y]);
+    return key;
+}
+
+/**
+ * @brief Returns the key of the pieces still to play.
+ *
+ * @param pieces The pieces, in order.
+ * @param count Number of pieces, at most TetrisZobrist::QUEUE_SLOTS: the keys of
+ * longer queues are not unique.
+ * @return The key, 0 for no piece.
+ */
+uint64_t TetrisTranspositionTable::queueKey(const TetrisShape *pieces, int count)
+{
+    uint64_t key = 0;
+    for(int i = 0; i < count; ++i)
+        key ^= TetrisZobrist::queueKey(i, pieces[i]);
+    return key;
+}
+
+/**
+ * @brief Returns the statistic counters of the calling thread.
+ *
+ * Threads are spread over STAT_SHARDS cache lines, so counting does not make the
+ * search threads fight over one line.
+ *
+ * @return The counters to use.
+ */
+TetrisTranspositionTable::Counters &TetrisTranspositionTable::threadCounters()
+{
+    static std::atomic<int> next_shard(0);
+    thread_local int shard = next_shard.fetch_add(1, std::memory_order_relaxed) % STAT_SHARDS;
+    return counters_[shard];
+}
@@ -0,0 +1,72 @@
+#ifndef TETRISTRANSPOSITIONTABLE_H
+#define TETRISTRANSPOSITIONTABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "Tetris/tetrispiece.h"
+
+struct TetrisTableStats
+{
+    uint64_t probes = 0, hits = 0;
+    uint64_t stores = 0, replacements = 0;  // replacements: a different position was overwritten
+    size_t entries = 0, used = 0;           // used: entries of the current generation
+
+    double hitRate() const { return probes ? double(hits) / probes : 0.0; }
+    double fillRate() const { return entries ? double(used) / entries : 0.0; }
+};
+
+// Fixed-size table of search values keyed by position, shared by the search
+// threads without locks. A position key hashes the board rows and the pieces
+// still to play, see boardKey() and queueKey(). Each value comes with the depth
+// searched to get it; within a bucket, the entries searched the least deeply
+// (and the ones of older searches first) are replaced first.
+class TetrisTranspositionTable
+{
+public:
+    explicit TetrisTranspositionTable(size_t megabytes = 16);
+
+    void resize(size_t megabytes);
+    void clear();
+    void newSearch();
+    size_t megabytes() const { return megabytes_; }
+
+    bool probe(uint64_t key, int depth, double &value);
+    void store(uint64_t key, int depth, double value);
+
+    TetrisTableStats stats() const;
+    void resetStats();
+
+    static uint64_t boardKey(const uint32_t *rows, int height);
+    static uint64_t queueKey(const TetrisShape *pieces, int count);
+
+private:
+    // The key is checked against key ^ value, so a half-written entry read by
+    // another thread is not mistaken for a hit
+    struct Entry {
+        std::atomic<uint64_t> check;    // (key high bits | meta) ^ value
+        std::atomic<uint64_t> value;    // bits of the double
+    };
+
+    struct alignas(64) Bucket {
+        Entry entries[4];
+    };
+
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> probes{0}, hits{0}, stores{0}, replacements{0};
+    };
+
+    Counters &threadCounters();
+
+    static constexpr int STAT_SHARDS = 16;
+
+    size_t megabytes_;
+    size_t mask_; // buckets - 1
+    std::unique_ptr<Bucket[]> buckets_;
+    std::atomic<uint32_t> generation_;
+    Counters counters_[STAT_SHARDS];
+};
+
+#endif // TETRISTRANSPOSITIONTABLE_H
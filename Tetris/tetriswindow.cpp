@@ -4,6 +4,10 @@
 const QString TetrisWindow::SCORE_KEY_PREFIX = "Tetris/Podium/Score";
 const QString TetrisWindow::USERNAME_KEY_PREFIX = "Tetris/Podium/Username";
 const int TetrisWindow::NUM_SCORES = 3;
+const int TetrisWindow::DEFAULT_REPLAY_SPEED_INDEX = 2; // 1x
+const int TetrisWindow::AI_RESTART_DELAY_MS = 3000;
+const int TetrisWindow::NUM_FINESSE_TIPS = 10;
+const int TetrisWindow::MEGA_SQUARE_SIDE = 8;
 
 
 TetrisWindow::~TetrisWindow(){};
@@ -39,6 +43,31 @@ TetrisWindow::TetrisWindow(QWidget *parent)
     go_back_button_ = new QPushButton("&Go Back");
     go_back_button_->setIcon(QIcon::fromTheme(QIcon::ThemeIcon::GoPrevious));
 
+    replay_button_ = new QPushButton("&Replays...");
+    // Screens besides the game: giant board stress game, AI battle view
+    more_button_ = new QPushButton("&More");
+    QMenu *more_menu = new QMenu(more_button_);
+    more_menu->addAction("Mega board...", this, &TetrisWindow::handleMegaBoardRequested);
+    more_menu->addAction("Battle view...", this, &TetrisWindow::handleBattleViewRequested);
+    more_button_->setMenu(more_menu);
+    replay_bar_ = createReplayBar();
+    replay_bar_->hide();
+
+    // Who plays: the keyboard or the AI, item data is the AI rate in pieces per second
+    // (0 for the keyboard, -1 for the keyboard with the AI hints, -2 for the keyboard
+    // with backspace to rewind)
+    player_combo_ = new QComboBox();
+    player_combo_->addItem("Human", 0.0);
+    player_combo_->addItem("Human - hints", -1.0);
+    player_combo_->addItem("Human - practice", -2.0);
+    player_combo_->addItem("AI - 1 piece/s", 1.0);
+    player_combo_->addItem("AI - 2 pieces/s", 2.0);
+    player_combo_->addItem("AI - 5 pieces/s", 5.0);
+    player_combo_->addItem("AI - 10 pieces/s", 10.0);
+    player_combo_->setFocusPolicy(Qt::NoFocus);
+    ai_controller_ = new TetrisAiController(board_, this);
+    hint_controller_ = new TetrisHintController(board_, this);
+
     best_score_label_ = new QLabel();
     best_score_label_->setAlignment(Qt::AlignRight);
 
@@ -55,6 +84,8 @@ TetrisWindow::TetrisWindow(QWidget *parent)
     connect(go_back_button_, &QPushButton::clicked, this, &TetrisWindow::onGoBackButtonClicked);
     connect(start_game_button_, &QPushButton::clicked, this, &TetrisWindow::handleStartResetButtonClicked);
     connect(pause_restart_button_, &QPushButton::clicked, this, &TetrisWindow::handlePauseRestartButtonClicked);
+    connect(replay_button_, &QPushButton::clicked, this, &TetrisWindow::handleReplayButtonClicked);
+    connect(player_combo_, &QComboBox::activated, this, &TetrisWindow::handlePlayerChanged);
 
     connect(this, &TetrisWindow::gameStarted, board_, &TetrisBoard::start);
     connect(this, &TetrisWindow::gameResetted, board_, &TetrisBoard::reset);
@@ -63,9 +94,20 @@ TetrisWindow::TetrisWindow(QWidget *parent)
     connect(board_, &TetrisBoard::gameLost, this, &TetrisWindow::handleGameLost);
 
     connect(board_, &TetrisBoard::updateScoreLcd, score_lcd_, qOverload<int>(&QLCDNumber::display));
+    connect(board_, &TetrisBoard::replayPositionChanged, this, &TetrisWindow::handleReplayPositionChanged);
+    connect(board_, &TetrisBoard::replayFinished, this, [this](){ handleReplayPositionChanged(board_->replayPosition()); });
 
     connect(this, &TetrisWindow::goBackToMainMenu, board_, &TetrisBoard::pause);
     connect(this, &TetrisWindow::goBackToMainMenu, this, &TetrisWindow::handlePauseGame);
+
+    // A game suspended when the application stopped goes on where it was, paused
+    if(board_->loadSuspendedGame()){
+        start_game_button_->setText("Reset Game");
+        pause_restart_button_->setEnabled(true);
+        pause_restart_button_->setText("Play");
+        is_started_ = true;
+        is_paused_ = true;
+    }
 }
 
 /**
@@ -100,6 +142,10 @@ void TetrisWindow::displayBestScores()
  * This method is called when the game is lost. It disables the pause/restart button,
  * checks if the current score qualifies for the leaderboard, and if so, prompts the
  * user to enter their username. The leaderboard is then updated and displayed.
+ * Games played by the AI never enter the leaderboard: a new one starts after
+ * AI_RESTART_DELAY_MS instead (attract mode). A score enters it only if the
+ * replay recorded by the board plays back to it, see TetrisReplayVerifier. Neither do
+ * practice games that have been rewound.
  *
  * @param score The score achieved in the game.
  */
@@ -107,10 +153,27 @@ void TetrisWindow::handleGameLost(const int score)
 {
     pause_restart_button_->setEnabled(false);
 
+    if(ai_controller_->isEnabled()){
+        QTimer::singleShot(AI_RESTART_DELAY_MS, this, &TetrisWindow::restartAiGame);
+        return;
+    }
+
+    if(board_->isRewound())
+        return;
+
     // qDebug() << "Getting score: " << score;
 
     // if score in podium
     if(score > scores_.begin().key() || scores_.size() < NUM_SCORES){
+        // Only a score the recorded game reproduces enters the leaderboard
+        const QByteArray &replay = board_->recordedReplay();
+        const TetrisReplayVerification verification = TetrisReplayVerifier::verify(
+            reinterpret_cast<const uint8_t*>(replay.constData()), size_t(replay.size()), board_->engine().rules());
+        if(verification.verdict != ValidVerdict || !verification.is_lost || verification.score != score){
+            QMessageBox::warning(this, "Score", "The replay of this game does not reproduce its score: it is not recorded.");
+            return;
+        }
+
         // POP OP
         QString username;
         bool is_username_acquired;
@@ -154,6 +217,12 @@ void TetrisWindow::initializeWindow()
     [[maybe_unused]] qint8 row_back_button_size = 1;
     [[maybe_unused]] qint8 row_back_button_end = row_back_button_start + row_back_button_size -1;
 
+    // REPLAY BUTTON
+    [[maybe_unused]] qint8 col_replay_button_start = col_back_button_start;
+    [[maybe_unused]] qint8 col_replay_button_size = col_back_button_size / 2;
+    [[maybe_unused]] qint8 row_replay_button_start = row_back_button_end + 1;
+    [[maybe_unused]] qint8 row_replay_button_size = 1;
+
     // NEXT LABEL
     [[maybe_unused]] qint8 col_next_label_start = col_board_end + 2;
     [[maybe_unused]] qint8 col_next_label_size = 2;
@@ -214,6 +283,15 @@ void TetrisWindow::initializeWindow()
     [[maybe_unused]] qint8 row_layout_end = 8;
     [[maybe_unused]] qint8 col_layout_end = col_pause_button_end + 2;
 
+    // PLAYER COMBO BOX
+    [[maybe_unused]] qint8 col_player_combo_start = col_start_button_start;
+    [[maybe_unused]] qint8 col_player_combo_size = col_start_button_size + col_pause_button_size;
+    [[maybe_unused]] qint8 row_player_combo_start = row_start_button_end + 1;
+    [[maybe_unused]] qint8 row_player_combo_size = 1;
+
+    // REPLAY BAR (only shown while a replay is played)
+    [[maybe_unused]] qint8 row_replay_bar_start = row_board_end + 1;
+
     QGridLayout *layout = new QGridLayout;
 
     layout->addWidget(title_label_, 0, 0, 1, col_layout_end+1);
@@ -221,6 +299,8 @@ void TetrisWindow::initializeWindow()
     layout->addWidget(board_, row_board_start, col_board_start, row_board_size, col_board_size);
 
     layout->addWidget(go_back_button_, row_back_button_start, col_back_button_start, row_back_button_size, col_back_button_size);
+    layout->addWidget(replay_button_, row_replay_button_start, col_replay_button_start, row_replay_button_size, col_replay_button_size);
+    layout->addWidget(more_button_, row_replay_button_start, col_replay_button_start + col_replay_button_size, row_replay_button_size, col_back_button_size - col_replay_button_size);
     // Empty rows
     layout->setRowStretch(row_back_button_start+1, 5);
 
@@ -240,6 +320,9 @@ void TetrisWindow::initializeWindow()
     layout->addWidget(start_game_button_, row_start_button_start, col_start_button_start, row_start_button_size, col_start_button_size);
 
     layout ->addWidget(pause_restart_button_, row_pause_button_start, col_pause_button_start, row_pause_button_size, col_pause_button_size);
+    layout->addWidget(player_combo_, row_player_combo_start, col_player_combo_start, row_player_combo_size, col_player_combo_size);
+
+    layout->addWidget(replay_bar_, row_replay_bar_start, 0, 1, col_layout_end+1);
 
     setLayout(layout);
 
@@ -261,6 +344,10 @@ void TetrisWindow::initializeWindow()
 void TetrisWindow::onGoBackButtonClicked()
 {
     emit goBackToMainMenu();
+
+    // A replay has been paused by the board
+    if(board_->isReplaying())
+        handleReplayPositionChanged(board_->replayPosition());
 }
 
 /**
@@ -299,10 +386,12 @@ QSize TetrisWindow::getWidgetSize()
  * @brief Handles toggling the game state between started and reset on button click.
  *
  * This method toggles the game state between started and reset when the start/reset button is clicked.
+ * Starting a game closes the replay being shown, if any.
  */
 void TetrisWindow::handleStartResetButtonClicked()
 {
     if(!is_started_){
+        replay_bar_->hide();
         pause_restart_button_->setEnabled(true);
 
         start_game_button_->setText("Reset Game");
@@ -321,6 +410,46 @@ void TetrisWindow::handleStartResetButtonClicked()
     board_->setFocus();
 }
 
+/**
+ * @brief Handles the player selection change.
+ *
+ * Gives the game to the AI at the selected rate, or back to the keyboard, with or without
+ * the placement hints of the training mode, or with the rewind of the practice mode.
+ * Choosing the AI while no game is running starts one.
+ *
+ * @param index The index of the selected item.
+ */
+void TetrisWindow::handlePlayerChanged(int index)
+{
+    const double pieces_per_second = player_combo_->itemData(index).toDouble();
+    hint_controller_->setEnabled(pieces_per_second == -1.0);
+    board_->setRewindEnabled(pieces_per_second == -2.0);
+    ai_controller_->setEnabled(pieces_per_second > 0.0);
+    if(pieces_per_second > 0.0)
+        ai_controller_->setPiecesPerSecond(pieces_per_second);
+
+    if(ai_controller_->isEnabled() && !is_started_)
+        handleStartResetButtonClicked();
+
+    // Setting back focus to main board
+    board_->setFocus();
+}
+
+/**
+ * @brief Starts a new AI game once the last one has been lost.
+ *
+ * Nothing happens if the player has taken over, or if a game or a replay has been
+ * started in the meantime.
+ */
+void TetrisWindow::restartAiGame()
+{
+    if(!ai_controller_->isEnabled() || !is_started_ || !board_->engine().isLost() || board_->isReplaying())
+        return;
+
+    handleStartResetButtonClicked(); // reset
+    handleStartResetButtonClicked(); // start
+}
+
 /**
  * @brief Handles pausing the game.
  *
@@ -470,3 +599,307 @@ void TetrisWindow::updateScores(int new_score, const QString& new_username)
 
     saveScores();
 }
+
+/**
+ * @brief Creates the replay playback controls.
+ *
+ * The bar holds play/pause, one tick step backward and forward, a position slider,
+ * the playback time, the finesse of the game, the speed (0.25x to 64x) and a button
+ * to close the replay.
+ *
+ * @return A pointer to the newly created bar widget.
+ */
+QWidget *TetrisWindow::createReplayBar()
+{
+    QWidget *bar = new QWidget();
+
+    replay_play_button_ = new QPushButton("Pause");
+    replay_step_back_button_ = new QPushButton("<");
+    replay_step_back_button_->setToolTip("One tick backward (Left)");
+    replay_step_forward_button_ = new QPushButton(">");
+    replay_step_forward_button_->setToolTip("One tick forward (Right)");
+    replay_close_button_ = new QPushButton("Close");
+
+    replay_slider_ = new QSlider(Qt::Horizontal);
+    replay_slider_->setFocusPolicy(Qt::NoFocus);
+    replay_time_label_ = new QLabel();
+    replay_finesse_label_ = new QLabel();
+
+    replay_speed_combo_ = new QComboBox();
+    replay_speed_combo_->setFocusPolicy(Qt::NoFocus);
+    for(double speed : {0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, 32.0, 64.0})
+        replay_speed_combo_->addItem(QString::number(speed) + "x", speed);
+    replay_speed_combo_->setCurrentIndex(DEFAULT_REPLAY_SPEED_INDEX);
+
+    for(QPushButton *button : {replay_play_button_, replay_step_back_button_, replay_step_forward_button_, replay_close_button_})
+        button->setFocusPolicy(Qt::NoFocus);
+    replay_step_back_button_->setFixedWidth(28);
+    replay_step_forward_button_->setFixedWidth(28);
+
+    QHBoxLayout *layout = new QHBoxLayout(bar);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(replay_play_button_);
+    layout->addWidget(replay_step_back_button_);
+    layout->addWidget(replay_step_forward_button_);
+    layout->addWidget(replay_slider_, 1);
+    layout->addWidget(replay_time_label_);
+    layout->addWidget(replay_finesse_label_);
+    layout->addWidget(replay_speed_combo_);
+    layout->addWidget(replay_close_button_);
+
+    connect(replay_play_button_, &QPushButton::clicked, this, &TetrisWindow::handleReplayPlayButtonClicked);
+    connect(replay_step_back_button_, &QPushButton::clicked, board_, [this](){ board_->stepReplay(-1); });
+    connect(replay_step_forward_button_, &QPushButton::clicked, board_, [this](){ board_->stepReplay(1); });
+    connect(replay_close_button_, &QPushButton::clicked, this, &TetrisWindow::handleReplayCloseButtonClicked);
+    connect(replay_slider_, &QSlider::valueChanged, this, &TetrisWindow::handleReplaySliderChanged);
+    connect(replay_speed_combo_, qOverload<int>(&QComboBox::currentIndexChanged), this, &TetrisWindow::handleReplaySpeedChanged);
+
+    return bar;
+}
+
+/**
+ * @brief Formats a replay time as minutes, seconds and tenths.
+ *
+ * @param time_ms The time in milliseconds.
+ * @return The formatted time, e.g. "2:05.3".
+ */
+QString TetrisWindow::formatReplayTime(qint64 time_ms)
+{
+    return QString("%1:%2.%3").arg(time_ms / 60000)
+                              .arg((time_ms / 1000) % 60, 2, 10, QChar('0'))
+                              .arg((time_ms / 100) % 10);
+}
+
+/**
+ * @brief Opens a stress game on a giant board, in a window of its own.
+ *
+ * The board size is asked first, up to TetrisSparseBoard::MAX_WIDTH x MAX_HEIGHT.
+ * The game in progress is paused. The giant board is shown in a scroll area that
+ * follows the current piece; closing the window ends the game. Its scores never
+ * enter the leaderboard.
+ */
+void TetrisWindow::handleMegaBoardRequested()
+{
+    if(is_started_ && !is_paused_)
+        handlePauseGame();
+
+    bool is_accepted;
+    TetrisRules rules;
+    rules.width = QInputDialog::getInt(this, "Mega board", "Columns:", 1000, 4, TetrisSparseBoard::MAX_WIDTH, 1, &is_accepted);
+    if(is_accepted)
+        rules.height = QInputDialog::getInt(this, "Mega board", "Rows:", 10000, 4, TetrisSparseBoard::MAX_HEIGHT, 1, &is_accepted);
+    if(!is_accepted){
+        board_->setFocus();
+        return;
+    }
+
+    QScrollArea *scroll_area = new QScrollArea();
+    scroll_area->setAttribute(Qt::WA_DeleteOnClose);
+    TetrisMegaBoard *mega_board = new TetrisMegaBoard(rules, MEGA_SQUARE_SIDE);
+    scroll_area->setWidget(mega_board);
+
+    const QString title = QString("Tetris %1x%2").arg(rules.width).arg(rules.height);
+    connect(mega_board, &TetrisMegaBoard::currentPieceMoved, scroll_area, [scroll_area](const QRect &rect){
+        scroll_area->ensureVisible(rect.center().x(), rect.center().y(),
+                                   scroll_area->viewport()->width() / 3, scroll_area->viewport()->height() / 3);
+    });
+    connect(mega_board, &TetrisMegaBoard::scoreChanged, scroll_area, [scroll_area, title](int score){
+        scroll_area->setWindowTitle(title + " - score " + QString::number(score));
+    });
+    connect(mega_board, &TetrisMegaBoard::gameLost, scroll_area, [scroll_area, title](int score){
+        scroll_area->setWindowTitle(title + " - game over, score " + QString::number(score));
+    });
+
+    scroll_area->resize(800, 600);
+    scroll_area->show();
+    mega_board->setFocus();
+    mega_board->start();
+}
+
+/**
+ * @brief Opens the battle view, AI games on many boards at once, in a window of its own.
+ *
+ * The number of boards is asked first, up to TetrisBattleView::MAX_BOARDS. The game
+ * in progress is paused. Closing the window ends the games.
+ */
+void TetrisWindow::handleBattleViewRequested()
+{
+    if(is_started_ && !is_paused_)
+        handlePauseGame();
+
+    bool is_accepted;
+    const int num_boards = QInputDialog::getInt(this, "Battle view", "Boards:", TetrisBattleView::MAX_BOARDS,
+                                                1, TetrisBattleView::MAX_BOARDS, 1, &is_accepted);
+    if(!is_accepted){
+        board_->setFocus();
+        return;
+    }
+
+    TetrisBattleView *battle_view = new TetrisBattleView(num_boards);
+    battle_view->setAttribute(Qt::WA_DeleteOnClose);
+    battle_view->setWindowTitle(QString("Tetris battle - %1 boards").arg(num_boards));
+    battle_view->resize(1280, 800);
+    battle_view->show();
+    battle_view->start();
+}
+
+/**
+ * @brief Lets the user pick a replay file and plays it on the board.
+ *
+ * The game in progress is paused while the file is chosen, then reset once a
+ * replay has been loaded.
+ */
+void TetrisWindow::handleReplayButtonClicked()
+{
+    if(is_started_ && !is_paused_)
+        handlePauseGame();
+
+    QString path = QFileDialog::getOpenFileName(this, "Open Replay", TetrisBoard::replayDirectory(),
+                                                "Tetris replays (*.atrp)");
+    if(path.isEmpty()){
+        board_->setFocus();
+        return;
+    }
+
+    if(is_started_)
+        handleStartResetButtonClicked();
+
+    if(!board_->loadReplay(path)){
+        QMessageBox::warning(this, "Replay", "Cannot read the replay:\n" + path);
+        return;
+    }
+
+    replay_speed_combo_->setCurrentIndex(DEFAULT_REPLAY_SPEED_INDEX);
+    board_->setReplaySpeed(replay_speed_combo_->currentData().toDouble());
+    {
+        QSignalBlocker blocker(replay_slider_);
+        replay_slider_->setRange(0, int(board_->replayDuration()));
+        replay_slider_->setPageStep(qMax(1, int(board_->replayDuration() / 20)));
+    }
+    handleReplayPositionChanged(board_->replayPosition());
+    showReplayFinesse();
+    replay_bar_->show();
+
+    // Setting back focus to main board
+    board_->setFocus();
+}
+
+/**
+ * @brief Shows the finesse analysis of the replay just loaded.
+ *
+ * The label gives the input efficiency (fewest keys / keys pressed) and the number
+ * of extra keys; its tooltip lists the pieces with the most extra keys, with the
+ * keys that would have placed them.
+ */
+void TetrisWindow::showReplayFinesse()
+{
+    static const char *const SHAPE_NAMES[8] = {"", "I", "T", "O", "Z", "S", "L", "J"};
+    static const char *const KEY_NAMES[6] = {"Left", "Right", "hold Left", "hold Right", "Up", "Down"};
+
+    TetrisFinesse finesse;
+    TetrisFinesseReport report;
+    if(!finesse.analyse(board_->replay(), report) || report.pieces.empty()){
+        replay_finesse_label_->clear();
+        replay_finesse_label_->setToolTip(QString());
+        return;
+    }
+
+    replay_finesse_label_->setText(QString("Finesse %1% (%2 faults)")
+                                       .arg(qRound(100.0 * report.efficiency()))
+                                       .arg(report.faults));
+
+    QVector<const TetrisFinessePiece*> worst;
+    for(const TetrisFinessePiece &piece : report.pieces){
+        if(piece.faults() > 0)
+            worst.append(&piece);
+    }
+    std::stable_sort(worst.begin(), worst.end(), [](const TetrisFinessePiece *a, const TetrisFinessePiece *b){
+        return a->faults() > b->faults();
+    });
+
+    QString tips = QString("%1 keys pressed, %2 needed, %3 of %4 pieces with extra keys")
+                       .arg(report.keys).arg(report.minimal_keys)
+                       .arg(report.faulty_pieces).arg(report.pieces.size());
+    for(int i = 0; i < qMin(NUM_FINESSE_TIPS, int(worst.size())); ++i){
+        const TetrisFinessePiece &piece = *worst[i];
+        QStringList keys;
+        for(TetrisFinesseKey key : piece.minimal_path)
+            keys << KEY_NAMES[key];
+        tips += QString("\nPiece %1 (%2) at %3: %4 keys instead of %5%6")
+                    .arg(piece.index + 1)
+                    .arg(SHAPE_NAMES[piece.shape])
+                    .arg(formatReplayTime(qint64(piece.spawn_tick) * board_->replay().rules.tick_ms))
+                    .arg(piece.keys)
+                    .arg(piece.minimal_keys)
+                    .arg(keys.isEmpty() ? QString() : ": " + keys.join(", "));
+    }
+    replay_finesse_label_->setToolTip(tips);
+}
+
+/**
+ * @brief Closes the replay and goes back to the welcome screen.
+ */
+void TetrisWindow::handleReplayCloseButtonClicked()
+{
+    board_->stopReplay();
+    replay_bar_->hide();
+    score_lcd_->display(0);
+    board_->setFocus();
+}
+
+/**
+ * @brief Toggles the replay between playing and paused.
+ *
+ * At the end of the replay, playing starts it again from the beginning.
+ */
+void TetrisWindow::handleReplayPlayButtonClicked()
+{
+    if(board_->isPaused())
+        board_->resume();
+    else if(board_->replayPosition() >= board_->replayDuration())
+        board_->seekReplay(0);
+    else
+        board_->pause();
+
+    handleReplayPositionChanged(board_->replayPosition());
+    board_->setFocus();
+}
+
+/**
+ * @brief Updates the replay controls with the playback position.
+ *
+ * @param position_ms The replay position in milliseconds.
+ */
+void TetrisWindow::handleReplayPositionChanged(qint64 position_ms)
+{
+    if(!replay_slider_->isSliderDown()){
+        QSignalBlocker blocker(replay_slider_);
+        replay_slider_->setValue(int(position_ms));
+    }
+
+    replay_time_label_->setText(formatReplayTime(position_ms) + " / " + formatReplayTime(board_->replayDuration()));
+
+    bool is_playing = !board_->isPaused() && position_ms < board_->replayDuration();
+    replay_play_button_->setText(is_playing ? "Pause" : "Play");
+}
+
+/**
+ * @brief Seeks the replay to the position chosen with the slider.
+ *
+ * @param position_ms The slider position in milliseconds.
+ */
+void TetrisWindow::handleReplaySliderChanged(int position_ms)
+{
+    board_->seekReplay(position_ms);
+}
+
+/**
+ * @brief Applies the playback speed chosen in the speed combo box.
+ *
+ * @param index Index of the chosen speed.
+ */
+void TetrisWindow::handleReplaySpeedChanged(int index)
+{
+    board_->setReplaySpeed(replay_speed_combo_->itemData(index).toDouble());
+    board_->setFocus();
+}
@@ -12,8 +12,23 @@
 #include <QMultiMap>
 #include <QSettings>
 #include <QInputDialog>
+#include <QComboBox>
+#include <QSlider>
+#include <QHBoxLayout>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QSignalBlocker>
+#include <QScrollArea>
+#include <QMenu>
+#include <QTimer>
 
+#include "Tetris/tetrisaicontroller.h"
+#include "Tetris/tetrisbattleview.h"
 #include "Tetris/tetrisboard.h"
+#include "Tetris/tetrisfinesse.h"
+#include "Tetris/tetrishintcontroller.h"
+#include "Tetris/tetrismegaboard.h"
+#include "Tetris/tetrisreplayverifier.h"
 
 class TetrisWindow : public QWidget
 {
@@ -28,12 +43,22 @@ public:
 
 private slots:
     void displayBestScores();
+    void handleBattleViewRequested();
     void handleGameLost(const int score);
+    void handleMegaBoardRequested();
     void handlePauseGame();
     void handlePauseRestartButtonClicked();
+    void handlePlayerChanged(int index);
     void handleResumeGame();
+    void handleReplayButtonClicked();
+    void handleReplayCloseButtonClicked();
+    void handleReplayPlayButtonClicked();
+    void handleReplayPositionChanged(qint64 position_ms);
+    void handleReplaySliderChanged(int position_ms);
+    void handleReplaySpeedChanged(int index);
     void handleStartResetButtonClicked();
     void onGoBackButtonClicked();
+    void restartAiGame();
 
 public slots:
     void updateScores(int new_score, const QString& new_username);
@@ -47,15 +72,29 @@ signals:
 
 private:
     QLabel *createLabel(const QString &text);
+    QWidget *createReplayBar();
+    QString formatReplayTime(qint64 time_ms);
     void initializeWindow();
     QSize getSizeFromCellToCell(QGridLayout* layout, int from_row, int from_column, int to_row, int to_column);
     void loadScores();
     void saveScores();
+    void showReplayFinesse();
 
     TetrisBoard *board_;
     QPushButton *start_game_button_;
     QPushButton *pause_restart_button_;
     QPushButton *go_back_button_;
+    QPushButton *replay_button_;
+    QPushButton *more_button_;
+    QComboBox *player_combo_;
+    TetrisAiController *ai_controller_;
+    TetrisHintController *hint_controller_;
+    QWidget *replay_bar_;
+    QPushButton *replay_play_button_, *replay_step_back_button_, *replay_step_forward_button_, *replay_close_button_;
+    QComboBox *replay_speed_combo_;
+    QSlider *replay_slider_;
+    QLabel *replay_time_label_;
+    QLabel *replay_finesse_label_;
     QLCDNumber *score_lcd_; //1: 40 - 2: 100 - 3: 300 - 4: 1200
     QLabel *next_piece_label_, *best_score_label_;
     QLabel *title_label_;
@@ -67,6 +106,10 @@ private:
     static const QString SCORE_KEY_PREFIX;
     static const QString USERNAME_KEY_PREFIX;
     static const int NUM_SCORES;
+    static const int DEFAULT_REPLAY_SPEED_INDEX;
+    static const int AI_RESTART_DELAY_MS;
+    static const int NUM_FINESSE_TIPS;
+    static const int MEGA_SQUARE_SIDE;
 };
 
 #endif // TETRISWINDOW_H
@@ -0,0 +1,76 @@
+#include "tetriszobrist.h"
+
+#include "Tetris/tetrisrandom.h"
+
+namespace {
+
+uint64_t mix(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+struct Keys {
+    uint64_t rows[64];
+    uint64_t queue[TetrisZobrist::QUEUE_SLOTS][8];
+    uint64_t counters[2];
+
+    Keys()
+    {
+        TetrisRandom random(0x7e7215);
+        auto next64 = [&](){ return (uint64_t(random.next()) << 32) | random.next(); };
+        for(uint64_t &key : rows)
+            key = next64();
+        for(auto &slot : queue){
+            for(uint64_t &key : slot)
+                key = next64();
+        }
+        for(uint64_t &key : counters)
+            key = next64();
+    }
+};
+
+const Keys &keys()
+{
+    static const Keys keys;
+    return keys;
+}
+
+} // namespace
+
+/**
+ * @brief Returns the key of a board row.
+ *
+ * @param y Row index.
+ * @param row Row mask.
+ * @return The key, not 0 for an empty row.
+ */
+uint64_t TetrisZobrist::rowKey(int y, uint32_t row)
+{
+    return mix(keys().rows[y & 63] + (uint64_t(y >> 6) << 32) + row);
+}
+
+/**
+ * @brief Returns the key of a shape at a place of the piece queue.
+ *
+ * @param slot Place in the queue, 0 for the current piece, below QUEUE_SLOTS.
+ * @param shape The shape, NoShape included.
+ * @return The key.
+ */
+uint64_t TetrisZobrist::queueKey(int slot, TetrisShape shape)
+{
+    return keys().queue[slot & (QUEUE_SLOTS - 1)][shape & 7];
+}
+
+/**
+ * @brief Returns the key of the value of a counter.
+ *
+ * @param counter The counter.
+ * @param value Its value.
+ * @return The key.
+ */
+uint64_t TetrisZobrist::counterKey(Counter counter, uint64_t value)
+{
+    return mix(keys().counters[counter] ^ value);
+}
@@ -0,0 +1,27 @@
+#ifndef TETRISZOBRIST_H
+#define TETRISZOBRIST_H
+
+#include <cstdint>
+
+#include "Tetris/tetrispiece.h"
+
+// Random keys of Zobrist hashing, the same on every run: a state hashes to the
+// xor of the keys of its parts, so changing one part updates the hash with two
+// xors. A row key is mixed with the row mask (a row has up to 2^32 states), a
+// counter key with its value.
+class TetrisZobrist
+{
+public:
+    static constexpr int QUEUE_SLOTS = 64; // places of the piece queue with keys of their own
+
+    enum Counter {
+        ScoreCounter,
+        RandomStateCounter
+    };
+
+    static uint64_t rowKey(int y, uint32_t row);
+    static uint64_t queueKey(int slot, TetrisShape shape);
+    static uint64_t counterKey(Counter counter, uint64_t value);
+};
+
+#endif // TETRISZOBRIST_H
@@ -5,10 +5,17 @@ TicTacToeBoard::TicTacToeBoard(QWidget *parent, const QString xIconPath, const Q
     , ui(new Ui::Form)
     , x_icon_path_(xIconPath)
     , o_icon_path_(oIconPath)
-    , easy_randomness_(true)
+    , bot_move_counter_("bot move")
 {
     ui->setupUi(this);
 
+    // Performance HUD, toggled with F3
+    perf_overlay_ = new PerfOverlay(this);
+    perf_overlay_->addCounter(&bot_move_counter_);
+    QShortcut *perf_shortcut = new QShortcut(QKeySequence(Qt::Key_F3), this);
+    perf_shortcut->setContext(Qt::WidgetWithChildrenShortcut);
+    connect(perf_shortcut, &QShortcut::activated, perf_overlay_, &PerfOverlay::toggle);
+
     // Front and back part of name buttons defined in .ui
     front_button_names_ = {{"left"}, {"center"}, {"right"}};
     back_button_names_ = {{"top"}, {"center"}, {"bottom"}};
@@ -39,11 +46,8 @@ void TicTacToeBoard::initializeBoard()
     emit gameStarted();
 
     // Resetting variables
-    board_ = QVector<QVector<char>>(3, QVector<char>(3, ' '));
+    engine_.reset();
     board_buttons_.clear();
-    free_spots_.clear();
-
-    for(qint8 i=0; i<9; i++){ free_spots_.insert(i); }
 
     // Linking ui button to variable
     for(const QString &back_name: back_button_names_){
@@ -138,11 +142,15 @@ void TicTacToeBoard::handleResetBoardClicked(){
  *
  * This method determines the bot's action based on the current difficulty level,
  * checks the game state for the bot's status, and handles the bot's move accordingly.
+ * The time spent choosing the move is shown in the performance HUD.
  */
 void TicTacToeBoard::performBotAction(){
     gameState robot_status;
 
-    botActionBasedOnLevel();
+    {
+        PerfScope bot_move_scope(bot_move_counter_);
+        botActionBasedOnLevel();
+    }
     robot_status = checkGameStateForPlayer(computer_icon_char_);
     handlePlayerAction(robot_status, computer_icon_char_);
 }
@@ -152,119 +160,20 @@ void TicTacToeBoard::performBotAction(){
 /**
  * @brief Executes the bot's action based on the current game level.
  *
- * This function determines the bot's action based on the selected game level:
+ * The move is chosen by the engine, see TicTacToeEngine::chooseMove():
  * - For Easy level, it alternates between random moves and medium-level strategy.
  * - For Medium level, it uses a medium-level strategy to determine the bot's move.
- * - For Hard level, no specific action is implemented in this function.
- *
- * If an unrecognized game level is provided, it defaults to the medium-level strategy.
+ * - For Hard level, no specific strategy is implemented: it plays as Medium.
  */
 void TicTacToeBoard::botActionBasedOnLevel(){
+    qint8 spot = engine_.chooseMove(game_level_, computer_icon_char_);
+    if(spot < 0)
+        return;
 
-    switch (game_level_) {
-    case gameLevel::easy:{
-        easy_randomness_ ? randomBotAction() : mediumBotAction();
-        easy_randomness_ = !easy_randomness_;
-        break;
-    }
-    case gameLevel::medium:
-        mediumBotAction();
-        break;
-    // case gameLevel::hard:
-    //  hardBotAction();
-    //     break;
-    default:
-        mediumBotAction();
-        break;
-    }
-}
-
-/**
- * @brief Checks if a line of three positions can potentially lead to a win for a player.
- *
- * This function examines three positions on a Tic Tac Toe board and determines if placing
- * the player's icon in one of these positions would result in a winning line. It also
- * populates a vector with the positions that would constitute a winning line if the condition is met.
- *
- * @param a The state of the first position ('X', 'O', or ' ').
- * @param b The state of the second position ('X', 'O', or ' ').
- * @param c The state of the third position ('X', 'O', or ' ').
- * @param player The player's icon ('X' or 'O').
- * @param win_poses A vector to store the positions that form a winning line if true.
- * @return true if placing the player's icon in one of the positions would create a winning line, false otherwise.
- */
-bool TicTacToeBoard::canWinLine(const char a, const char b, const char c, const char player, QVector<qint8> &win_poses){
-    win_poses.clear();
-
-    if(a == player && b == ' ' && c == ' '){
-        win_poses.append(1);
-        win_poses.append(2);
-        return true;
-    }
-
-    if(a == ' ' && b == player && c == ' '){
-        win_poses.append(0);
-        win_poses.append(2);
-        return true;
-    }
-
-    if(a == ' ' && b == ' ' && c == player ){
-        win_poses.append(0);
-        win_poses.append(1);
-        return true;
-    }
-
-    if(a == player && b == player && c == ' '){
-        win_poses.append(2);
-        return true;
-    }
-
-    if(a == player && b == ' ' && c == player){
-        win_poses.append(1);
-        return true;
-    }
-
-    if(a == ' ' && b == player && c == player){
-        win_poses.append(0);
-        return true;
-    }
-
-    if(a == b == c && a == ' '){
-        win_poses = {0,1,2};
-        return true;
-    }
-
-    return false;
+    std::pair<qint8, qint8> idxs = spotToIdxs(spot);
+    markComputerButton(idxs.first, idxs.second);
 }
 
-/**
- * @brief Determines if placing the player's icon in one position can lead to an immediate win.
- *
- * This function evaluates three positions on a Tic Tac Toe board and checks if placing the player's
- * icon in one of these positions would result in an immediate win. It also returns the position where
- * placing the icon would lead to a win.
- *
- * @param a The state of the first position ('X', 'O', or ' ').
- * @param b The state of the second position ('X', 'O', or ' ').
- * @param c The state of the third position ('X', 'O', or ' ').
- * @param player The player's icon ('X' or 'O').
- * @param pose A reference to store the position that would result in a win if true.
- * @return true if placing the player's icon in one of the positions would create an immediate win, false otherwise.
- */
-bool TicTacToeBoard::canWinSingleMove(const char a, const char b, const char c, const char player, qint8 &pose){
-    QVector<qint8> poses;
-    bool can_win_line = canWinLine(a, b, c, player, poses);
-    qint8 free_spot = poses.size();
-
-    if(can_win_line && free_spot==1){
-        pose = poses.at(0);
-        return true;
-    }else{
-        pose = -1;
-        return false;
-    }
-};
-
 /**
  * @brief Changes the color of the given icon.
  *
@@ -308,79 +217,18 @@ QIcon TicTacToeBoard::changeIconColor(const QIcon& icon, const QColor& color) {
  * @return The game state for the specified player (won, draw, playing, or error if player is invalid).
  */
 gameState TicTacToeBoard::checkGameStateForPlayer(char player){
-    // Checking consistancy between possible players
-    if (player != 'O' && player != 'X'){
-        return gameState::error;
-    }
-
-    // Checking for WINNING
-    //Manually handling result check
-    for (int i=0; i<3; i++){
-        // ROW
-        if( board_[i][0] == player &&
-            board_[i][1] == player &&
-            board_[i][2] == player){
-
-            QVector<std::pair<qint8, qint8>> cells = {
-                                                      std::pair<qint8,qint8>(i,0),
-                                                      std::pair<qint8,qint8>(i,1),
-                                                      std::pair<qint8,qint8>(i,2)};
+    int line[3];
+    gameState state = engine_.state(player, line);
 
-            markWinningButtons(cells);
-
-            return gameState::won;
-        }
-
-        // COLUMN
-        if( board_[0][i] == player &&
-            board_[1][i] == player &&
-            board_[2][i] == player){
-
-            QVector<std::pair<qint8, qint8>> cells = {
-                                                      std::pair<qint8,qint8>(0,i),
-                                                      std::pair<qint8,qint8>(1,i),
-                                                      std::pair<qint8,qint8>(2,i)};
-
-            markWinningButtons(cells);
-
-            return gameState::won;
-        }
-    }
-
-    // MAIN DIAG
-    if( board_[0][0] == player &&
-        board_[1][1] == player &&
-        board_[2][2] == player){
-
-        QVector<std::pair<qint8, qint8>> cells = {
-                                                  std::pair<qint8,qint8>(0,0),
-                                                  std::pair<qint8,qint8>(1,1),
-                                                  std::pair<qint8,qint8>(2,2)};
-
-        markWinningButtons(cells);
-        return gameState::won;
-    }
-
-    // SECOND DIAG
-    if( board_[0][2] == player &&
-        board_[1][1] == player &&
-        board_[2][0] == player){
-
-        QVector<std::pair<qint8, qint8>> cells = {
-                                                  std::pair<qint8,qint8>(0,2),
-                                                  std::pair<qint8,qint8>(1,1),
-                                                  std::pair<qint8,qint8>(2,0)};
+    if(state == gameState::won){
+        QVector<std::pair<qint8, qint8>> cells;
+        for(int spot : line)
+            cells.append(spotToIdxs(spot));
 
         markWinningButtons(cells);
-        return gameState::won;
     }
 
-    // Checking for DRAWING, if not won
-    if(free_spots_.empty()){
-        return gameState::draw;
-    }
-
-    return gameState::playing;
+    return state;
 }
 
 /**
@@ -466,7 +314,7 @@ void TicTacToeBoard::grayOutBoardButtons(){
     for (qint8 i = 0; i < 3; ++i) {
         for (qint8 j = 0; j < 3; ++j) {
             QPushButton *button = board_buttons_[i][j];
-            board_[i][j] == 'X' ? button->setIcon(xGrayIcon) : button->setIcon(oGrayIcon);
+            engine_.at(i, j) == 'X' ? button->setIcon(xGrayIcon) : button->setIcon(oGrayIcon);
         }
     }
 }
@@ -478,7 +326,7 @@ void TicTacToeBoard::grayOutBoardButtons(){
  * marks the button with the player's icon, and checks the game state. It implements the main logic.
  */
 void TicTacToeBoard::handleBoardButtonClick(){
-    if(free_spots_.size()==9)
+    if(engine_.freeSpots()==9)
         emit updateCommentLabel("");
 
     QPushButton* button = qobject_cast<QPushButton*>(sender());
@@ -496,14 +344,11 @@ void TicTacToeBoard::handleBoardButtonClick(){
     }
 
     // Check if the cell is empty and fill with proper icon
-    if (row != -1 && col != -1 && board_[row][col] == ' ') {
-        board_[row][col] = player_icon_char_;
+    if (row != -1 && col != -1 && engine_.play(idxsToSpot(row,col), player_icon_char_)) {
         QColor color = Qt::green;
         color.setAlpha(255);
         markButtonWithIcon(button, player_icon_);
 
-        free_spots_.remove(idxsToSpot(row,col));
-
 
         // Player action
         gameState player_icon_status;
@@ -540,7 +385,9 @@ void TicTacToeBoard::handlePlayerAction(const gameState &action_result, const ch
         }
 
         // Disable all the available left spots
-        for(const auto& el: free_spots_){
+        for(qint8 el = 0; el < TicTacToeEngine::NUM_SPOTS; el++){
+            if(!engine_.isFree(el))
+                continue;
             std::pair<qint8, qint8> idxs = spotToIdxs(el);
             qint8 row = idxs.first;
             qint8 col = idxs.second;
@@ -609,9 +456,8 @@ void TicTacToeBoard::markButtonWithIcon(QPushButton *button, QIcon icon){
  */
 void TicTacToeBoard::markComputerButton(qint8 row, qint8 col){
     QPushButton *button = board_buttons_[row][col];
-    board_[row][col] = computer_icon_char_;
+    engine_.play(idxsToSpot(row,col), computer_icon_char_);
     markButtonWithIcon(button, computer_icon_);
-    free_spots_.remove(idxsToSpot(row,col));
 }
 
 /**
@@ -628,132 +474,11 @@ void TicTacToeBoard::markWinningButtons(const QVector<std::pair<qint8, qint8>> &
         qint8 col = idxs.second;
         QIcon icon;
         QPushButton *winning_button = board_buttons_[row][col];
-        board_[row][col] == player_icon_char_ ? icon = player_winning_icon_ : icon = computer_winning_icon_;
+        engine_.at(row, col) == player_icon_char_ ? icon = player_winning_icon_ : icon = computer_winning_icon_;
         markButtonWithIcon(winning_button, icon);
     }
 }
 
-/**
- * @brief Executes a medium-level strategy for the bot's move on the game board.
- *
- * This function implements a medium-level strategy for the bot's move:
- * - It first checks if there's an opportunity to win in a single move.
- * - If no immediate winning move is found, it checks for defensive moves to prevent the player from winning.
- * - If neither winning nor defensive moves are available, it resorts to selecting a random move.
- */
-void TicTacToeBoard::mediumBotAction(){
-    // If multiple choses, choose random
-    qint8 pose;
-    QVector<qint8> poses;
-    QVector<char> players{computer_icon_char_, player_icon_char_};
-
-    // Single spot search
-    for(auto &player: players){
-        for (qint8 i = 0; i<3; i++){
-            // ROW
-            bool can_win_single_move_row = canWinSingleMove(board_[i][0], board_[i][1], board_[i][2], player, pose);
-            if(can_win_single_move_row){
-                markComputerButton(i, pose);
-                return;
-            }
-
-            // COLUMN
-            bool can_win_single_move_col = canWinSingleMove(board_[0][i], board_[1][i], board_[2][i], player, pose);
-            if(can_win_single_move_col){
-                markComputerButton(pose, i);
-                return;
-            }
-        }
-        // MAIN DIAG
-        bool can_win_main_dial = canWinSingleMove(board_[0][0], board_[1][1], board_[2][2], player, pose);
-        if(can_win_main_dial){
-            markComputerButton(pose, pose);
-            return;
-        }
-
-        // SECOND DIAL
-        bool can_win_sec_dial = canWinSingleMove(board_[0][2], board_[1][1], board_[2][0], player, pose);
-        if(can_win_sec_dial){
-            markComputerButton(pose, -pose+2);
-            return;
-        }
-    }
-
-    // Possible winning line
-    for(auto &player : players){
-        for(qint8 i = 0; i<3; i++){
-            // ROW
-            bool can_win_on_row = canWinLine(board_[i][0], board_[i][1], board_[i][2], player, poses);
-            if(can_win_on_row){
-                std::mt19937 gen( std::random_device{}() );
-                std::sample(poses.begin(), poses.end(), &pose, 1, gen);
-                markComputerButton(i, pose);
-                return;
-            }
-
-            // COLUMN
-            bool can_win_on_col = canWinLine(board_[0][i], board_[1][i], board_[2][i], player, poses);
-            if(can_win_on_col){
-                std::mt19937 gen( std::random_device{}() );
-                std::sample(poses.begin(), poses.end(), &pose, 1, gen);
-                markComputerButton(pose, i);
-                return;
-            }
-        }
-
-        // MAIN DIAG
-        bool can_win_main_dial = canWinLine(board_[0][0], board_[1][1], board_[2][2], player, poses);
-        if(can_win_main_dial){
-            std::mt19937 gen( std::random_device{}() );
-            std::sample(poses.begin(), poses.end(), &pose, 1, gen);
-            markComputerButton(pose, pose);
-            return;
-        }
-
-        // SECOND DIAG
-        bool can_win_sec_dial = canWinLine(board_[0][2], board_[1][1], board_[2][0], player, poses);
-        if(can_win_sec_dial){
-            std::mt19937 gen( std::random_device{}() );
-            std::sample(poses.begin(), poses.end(), &pose, 1, gen);
-            markComputerButton(pose, 2-pose);
-            return;
-        }
-    }
-
-    // Random spot selection as last chance
-    randomBotAction();
-}
-
-/**
- * @brief Executes a random action for the bot.
- *
- * This method selects a random free spot on the board and marks it with the bot's icon.
- * It updates the board state, the button's icon, and removes the chosen spot from the list of free spots.
- */
-void TicTacToeBoard::randomBotAction(){
-    if(free_spots_.empty())
-        return;
-
-    // Random number extraction
-    std::mt19937 gen( std::random_device{}() );
-    qint8 el;
-    std::sample(free_spots_.begin(), free_spots_.end(), &el, 1, gen);
-
-    // Mark button with icon
-    std::pair<qint8, qint8> idxs = spotToIdxs(el);
-
-    qint8 row = idxs.first;
-    qint8 col = idxs.second;
-
-    board_[row][col] = computer_icon_char_ ;
-    QPushButton *button = board_buttons_[row][col];
-
-    QIcon icon;
-    computer_icon_char_ == 'O' ? icon = o_icon_ : icon = x_icon_;
-    markButtonWithIcon(button, icon);
-    free_spots_.remove(idxsToSpot(row,col));
-}
-
 /**
  * @brief Sets the QLabel for displaying the current icon.
  *
@@ -4,16 +4,12 @@
 #include <QWidget>
 #include <QLabel>
 #include <QDialog>
-
-#include <random>
-#include <algorithm>
+#include <QShortcut>
 
 #include "ui_board_form.h"
-
-// Game states
-enum gameState{won, draw, playing, error};
-
-enum gameLevel{easy, medium, hard};
+#include "Common/perfcounter.h"
+#include "Common/perfoverlay.h"
+#include "TicTacToe/tictactoeengine.h"
 
 
 class TicTacToeBoard : public QWidget
@@ -44,8 +40,6 @@ private slots:
 
 private:
     void botActionBasedOnLevel();
-    bool canWinLine(const char a, const char b, const char c, const char player, QVector<qint8> &win_poses);
-    bool canWinSingleMove(const char a, const char b, const char c, const char player, qint8 &pose);
     QIcon changeIconColor(const QIcon& icon, const QColor& color);
     gameState checkGameStateForPlayer(char player);
     void clearIconFromButton(QPushButton *button);
@@ -60,8 +54,6 @@ private:
     void markButtonWithIcon(QPushButton *button, QIcon icon);
     void markComputerButton(qint8 row, qint8 col);
     void markWinningButtons(const QVector<std::pair<qint8, qint8>> &idxs_vect);
-    void mediumBotAction();
-    void randomBotAction();
     std::pair<qint8, qint8> spotToIdxs(const qint8 &s);
 
 
@@ -69,20 +61,19 @@ private:
     QString x_icon_path_, o_icon_path_;
     char player_icon_char_, computer_icon_char_;
     char starter_player_;
-    bool easy_randomness_;
 
-    QVector<QVector<char>> board_;
+    TicTacToeEngine engine_;
     QVector<QVector<QPushButton*>> board_buttons_;
     QVector<QString> front_button_names_, back_button_names_;
 
-    QSet<qint8> free_spots_;
-
     QIcon x_icon_, o_icon_;
     QIcon player_winning_icon_, computer_winning_icon_;
     QIcon player_icon_, computer_icon_;
 
     QLabel *current_icon_label_;
     QLabel *comment_label_;
+    PerfOverlay *perf_overlay_;
+    PerfCounter bot_move_counter_;
 
     gameLevel game_level_;
 };
@@ -0,0 +1,203 @@
+#include "tictactoeengine.h"
+
+#include <algorithm>
+
+namespace {
+
+// The eight lines of the board: rows, columns, main and second diagonal
+const int LINES[8][3] = {
+    {0, 1, 2}, {3, 4, 5}, {6, 7, 8},
+    {0, 3, 6}, {1, 4, 7}, {2, 5, 8},
+    {0, 4, 8}, {2, 4, 6}
+};
+
+// Order in which the medium bot looks at the lines
+const int SEARCH_ORDER[8] = {0, 3, 1, 4, 2, 5, 6, 7};
+
+// Zobrist key of a mark, the same on every run: a splitmix64 hash of the spot and player
+uint64_t markKey(int spot, char player)
+{
+    uint64_t z = 0x9E3779B97F4A7C15ULL * uint64_t(2 * spot + (player == 'X' ? 2 : 1));
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+TicTacToeEngine::TicTacToeEngine()
+    : free_spots_(NUM_SPOTS)
+    , hash_(0)
+    , easy_randomness_(true)
+    , random_(std::random_device{}())
+{
+    reset();
+}
+
+/**
+ * @brief Empties the board for a new game.
+ */
+void TicTacToeEngine::reset()
+{
+    spots_.fill(' ');
+    free_spots_ = NUM_SPOTS;
+    hash_ = 0;
+}
+
+/**
+ * @brief Marks a spot for a player.
+ *
+ * @param spot The spot, between 0 and 8.
+ * @param player The player's icon ('X' or 'O').
+ * @return false if the spot is not on the board or is taken.
+ */
+bool TicTacToeEngine::play(int spot, char player)
+{
+    if(spot < 0 || spot >= NUM_SPOTS || !isFree(spot))
+        return false;
+
+    spots_[spot] = player;
+    --free_spots_;
+    hash_ ^= markKey(spot, player);
+    return true;
+}
+
+/**
+ * @brief Checks the game state for a specified player ('X' or 'O').
+ *
+ * @param player The player's icon ('X' or 'O').
+ * @param line If not null and the player won, set to the three spots of the winning line.
+ * @return The game state for the specified player (won, draw, playing, or error if player is invalid).
+ */
+gameState TicTacToeEngine::state(char player, int *line) const
+{
+    if(player != 'O' && player != 'X')
+        return gameState::error;
+
+    for(const int *candidate : LINES){
+        if(spots_[candidate[0]] == player && spots_[candidate[1]] == player && spots_[candidate[2]] == player){
+            if(line)
+                std::copy(candidate, candidate + 3, line);
+            return gameState::won;
+        }
+    }
+
+    return free_spots_ == 0 ? gameState::draw : gameState::playing;
+}
+
+/**
+ * @brief Chooses the move of a bot based on the game level.
+ *
+ * - For Easy level, it alternates between random moves and medium-level strategy.
+ * - For Medium level, it uses a medium-level strategy.
+ * - Hard level has no strategy of its own yet: it plays as Medium.
+ *
+ * @param level The game level.
+ * @param player The bot's icon ('X' or 'O').
+ * @return The spot chosen, -1 if the board is full.
+ */
+int TicTacToeEngine::chooseMove(gameLevel level, char player)
+{
+    if(level == gameLevel::easy){
+        const bool is_random = easy_randomness_;
+        easy_randomness_ = !easy_randomness_;
+        return is_random ? randomMove() : mediumMove(player);
+    }
+    return mediumMove(player);
+}
+
+/**
+ * @brief Chooses a move with the medium-level strategy.
+ *
+ * - It first checks if there's an opportunity to win in a single move.
+ * - If no immediate winning move is found, it blocks the opponent from winning in a single move.
+ * - Otherwise it extends a line holding only its own icon, or else a line holding only the
+ *   opponent's icon, on a random free spot of the line.
+ * - If neither is available, it resorts to selecting a random move.
+ *
+ * Lines are looked at row and column in turn, then the main and second diagonal.
+ *
+ * @param player The bot's icon ('X' or 'O').
+ * @return The spot chosen, -1 if the board is full.
+ */
+int TicTacToeEngine::mediumMove(char player)
+{
+    const char players[2] = {player, opponent(player)};
+    int spots[3], count;
+
+    // Single spot search
+    for(char current : players){
+        for(int index : SEARCH_ORDER){
+            if(canWinLine(LINES[index], current, spots, count) && count == 1)
+                return spots[0];
+        }
+    }
+
+    // Possible winning line
+    for(char current : players){
+        for(int index : SEARCH_ORDER){
+            if(canWinLine(LINES[index], current, spots, count))
+                return sample(spots, count);
+        }
+    }
+
+    // Random spot selection as last chance
+    return randomMove();
+}
+
+/**
+ * @brief Chooses a random free spot.
+ *
+ * @return The spot chosen, -1 if the board is full.
+ */
+int TicTacToeEngine::randomMove()
+{
+    int spots[NUM_SPOTS], count = 0;
+    for(int spot = 0; spot < NUM_SPOTS; ++spot){
+        if(isFree(spot))
+            spots[count++] = spot;
+    }
+    return count ? sample(spots, count) : -1;
+}
+
+/**
+ * @brief Checks if a line can still be completed by a player.
+ *
+ * A line can be completed if it holds the player's icon at least once and no other icon.
+ * A line with no icon at all is not considered.
+ *
+ * @param line The three spots of the line.
+ * @param player The player's icon ('X' or 'O').
+ * @param spots Set to the free spots of the line.
+ * @param count Set to the number of free spots.
+ * @return true if playing the free spots would complete the line.
+ */
+bool TicTacToeEngine::canWinLine(const int line[3], char player, int *spots, int &count) const
+{
+    count = 0;
+    int owned = 0;
+    for(int k = 0; k < 3; ++k){
+        const char spot = spots_[line[k]];
+        if(spot == ' ')
+            spots[count++] = line[k];
+        else if(spot == player)
+            ++owned;
+        else
+            return false;
+    }
+    return owned > 0 && count > 0;
+}
+
+/**
+ * @brief Picks one of the given spots at random.
+ *
+ * @param spots The spots.
+ * @param count The number of spots, at least 1.
+ * @return The spot picked.
+ */
+int TicTacToeEngine::sample(const int *spots, int count)
+{
+    int spot = spots[0];
+    std::sample(spots, spots + count, &spot, 1, random_);
+    return spot;
+}
@@ -0,0 +1,52 @@
+#ifndef TICTACTOEENGINE_H
+#define TICTACTOEENGINE_H
+
+#include <array>
+#include <cstdint>
+#include <random>
+
+// Game states
+enum gameState{won, draw, playing, error};
+
+enum gameLevel{easy, medium, hard};
+
+// Rules and bots of Tic-Tac-Toe, without any Qt dependency so that the games can
+// be simulated headless (see Tools/arcade_sim.cpp). Spots are numbered 0 to 8,
+// row by row; a spot holds 'X', 'O' or ' '.
+class TicTacToeEngine
+{
+public:
+    static constexpr int NUM_SPOTS = 9;
+
+    TicTacToeEngine();
+
+    void reset();
+    void setSeed(uint64_t seed){ random_.seed(seed); }
+
+    char at(int spot) const { return spots_[spot]; }
+    char at(int row, int col) const { return spots_[3 * row + col]; }
+    bool isFree(int spot) const { return spots_[spot] == ' '; }
+    int freeSpots() const { return free_spots_; }
+    uint64_t stateHash() const { return hash_; }
+
+    bool play(int spot, char player);
+    gameState state(char player, int *line = nullptr) const;
+
+    int chooseMove(gameLevel level, char player);
+    int mediumMove(char player);
+    int randomMove();
+
+    static char opponent(char player){ return player == 'O' ? 'X' : 'O'; }
+
+private:
+    bool canWinLine(const int line[3], char player, int *spots, int &count) const;
+    int sample(const int *spots, int count);
+
+    std::array<char, NUM_SPOTS> spots_;
+    int free_spots_;
+    uint64_t hash_; // Zobrist hash of the marks, updated by play()
+    bool easy_randomness_; // the easy bot plays random and medium moves in turn, across games
+    std::mt19937 random_;
+};
+
+#endif // TICTACTOEENGINE_H
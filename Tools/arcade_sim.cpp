@@ -0,0 +1,89 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include "Tetris/tetrisbatchengine.h"
+#include "Tools/arcadesim.h"
+
+/*
+ * Headless game runner, see ArcadeSim.
+ *
+ *   arcade_sim --game tetris --bot greedy --games 200
+ *   arcade_sim --game tetris --bot random --games 100000 --batch 256
+ *   arcade_sim --game tictactoe --bot easy --opponent medium --games 100000
+ *   arcade_sim --game tetris --bot greedy --games 10000 --processes 64
+ *   arcade_sim --game tetris --bot random --games 16 --mega --width 1000 --height 10000
+ *
+ * The report (throughput and result distributions) is printed as JSON on stdout.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("arcade_sim");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Plays seeded games with a bot and reports the throughput and the results as JSON.");
+    parser.addHelpOption();
+
+    const ArcadeSimOptions defaults;
+    QCommandLineOption game_option("game", "Game: tetris or tictactoe.", "name", ArcadeSim::gameName(defaults.game));
+    QCommandLineOption bot_option("bot", "Bot: greedy, beam or random for tetris; random, easy or medium for tictactoe (plays X).", "name");
+    QCommandLineOption opponent_option("opponent", "Tictactoe bot playing O.", "name", ArcadeSim::botName(defaults.opponent));
+    QCommandLineOption games_option("games", "Games to play.", "n", QString::number(defaults.games));
+    QCommandLineOption first_seed_option("first-seed", "Seed of the first game.", "seed", QString::number(defaults.first_seed));
+    QCommandLineOption threads_option("threads", "Threads, 0 for all the cores.", "n", "0");
+    QCommandLineOption pieces_option("max-pieces", "Tetris pieces per game at most, 0 for no limit.", "n", QString::number(defaults.max_pieces));
+    QCommandLineOption width_option("width", "Tetris board width.", "columns", QString::number(defaults.rules.width));
+    QCommandLineOption height_option("height", "Tetris board height.", "rows", QString::number(defaults.rules.height));
+    QCommandLineOption batch_option("batch", "Tetris random bot: boards per thread played in lockstep, 0 for one at a time.", "n", "0");
+    QCommandLineOption processes_option("processes", "Worker processes of one thread each, pinned to the cores, 0 to use threads (Unix only).", "n", "0");
+    QCommandLineOption mega_option("mega", "Tetris random bot: play on sparse giant boards, up to "
+                                   + QString::number(TetrisSparseBoard::MAX_WIDTH) + "x"
+                                   + QString::number(TetrisSparseBoard::MAX_HEIGHT) + ".");
+    QCommandLineOption compact_option("compact", "Print the JSON on one line.");
+    parser.addOptions({game_option, bot_option, opponent_option, games_option, first_seed_option, threads_option,
+                       pieces_option, width_option, height_option, batch_option, processes_option, mega_option, compact_option});
+    parser.process(app);
+
+    ArcadeSimOptions options;
+    QTextStream err(stderr);
+    if(!ArcadeSim::parseGame(parser.value(game_option), options.game)){
+        err << "Unknown game " << parser.value(game_option) << Qt::endl;
+        return 1;
+    }
+    const bool is_tetris = options.game == TetrisSimGame;
+    const QString bot = parser.isSet(bot_option) ? parser.value(bot_option) : (is_tetris ? "greedy" : "medium");
+    if(!ArcadeSim::parseBot(bot, options.bot) || !ArcadeSim::plays(options.bot, options.game)
+       || !ArcadeSim::parseBot(parser.value(opponent_option), options.opponent)
+       || (!is_tetris && !ArcadeSim::plays(options.opponent, options.game))){
+        err << "Unknown bot for " << ArcadeSim::gameName(options.game) << Qt::endl;
+        return 1;
+    }
+    options.games = qMax(0, parser.value(games_option).toInt());
+    options.first_seed = parser.value(first_seed_option).toULongLong();
+    options.threads = parser.value(threads_option).toInt();
+    options.max_pieces = parser.value(pieces_option).toInt();
+    options.mega = parser.isSet(mega_option);
+    options.rules.width = qBound(4, parser.value(width_option).toInt(),
+                                 options.mega ? TetrisSparseBoard::MAX_WIDTH : int(TetrisEngine::MAX_WIDTH));
+    options.rules.height = options.mega ? qBound(4, parser.value(height_option).toInt(), TetrisSparseBoard::MAX_HEIGHT)
+                                        : qMax(4, parser.value(height_option).toInt());
+    options.batch = qMax(0, parser.value(batch_option).toInt());
+    options.processes = qMax(0, parser.value(processes_option).toInt());
+    if(options.batch > 0 && (!is_tetris || options.bot != RandomSimBot || options.rules.width > TetrisBatchEngine::MAX_WIDTH)){
+        err << "--batch needs the random tetris bot and at most " << TetrisBatchEngine::MAX_WIDTH << " columns" << Qt::endl;
+        return 1;
+    }
+    if(options.mega && (!is_tetris || options.bot != RandomSimBot || options.batch > 0)){
+        err << "--mega needs the random tetris bot, without --batch" << Qt::endl;
+        return 1;
+    }
+
+    ArcadeSim sim(options);
+    const QJsonObject report = sim.run();
+    QTextStream(stdout) << QJsonDocument(report).toJson(parser.isSet(compact_option) ? QJsonDocument::Compact
+                                                                                     : QJsonDocument::Indented);
+    return report.contains("error") ? 1 : 0;
+}
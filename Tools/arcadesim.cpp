@@ -0,0 +1,678 @@
+#include "arcadesim.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+
+#ifdef Q_OS_UNIX
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "Tetris/tetrisbatchengine.h"
+
+namespace {
+
+const char *const GAME_NAMES[] = {"tetris", "tictactoe"};
+const char *const BOT_NAMES[] = {"greedy", "beam", "random", "easy", "medium"};
+
+// Mixed into the seed of a game for the generator of the random Tetris bot, so
+// that its moves do not follow the pieces
+const quint64 RANDOM_BOT_SALT = 0x6A09E667F3BCC908ULL;
+
+// Placement of the random Tetris bot
+TetrisBatchMove randomMove(TetrisRandom &generator, int width)
+{
+    TetrisBatchMove move;
+    move.rotation = generator.bounded(0, 4);
+    move.x = generator.bounded(0, width);
+    return move;
+}
+
+} // namespace
+
+ArcadeSim::ArcadeSim(const ArcadeSimOptions &options)
+    : options_(options)
+    , shared_(nullptr)
+{
+    options_.games = std::max(0, options_.games);
+}
+
+/**
+ * @brief Plays all the games, spread over the threads or the worker processes.
+ *
+ * Games are handed out one at a time with an atomic counter, so a thread done with
+ * short games takes the next ones. Every thread owns its bots and engines.
+ *
+ * @return The report, see report(); an "error" member only if the bot does not play the game,
+ * or if a worker process failed (or cannot be forked on this system).
+ */
+QJsonObject ArcadeSim::run()
+{
+    results_.assign(options_.games, ArcadeSimResult());
+    const bool is_tetris = options_.game == TetrisSimGame;
+    if(!plays(options_.bot, options_.game) || (!is_tetris && !plays(options_.opponent, options_.game))){
+        QJsonObject error;
+        error.insert("error", QString("the bots do not play %1").arg(gameName(options_.game)));
+        return error;
+    }
+    if(options_.batch > 0 && (!is_tetris || options_.bot != RandomSimBot || options_.rules.width > TetrisBatchEngine::MAX_WIDTH)){
+        QJsonObject error;
+        error.insert("error", QString("the batch only plays the random bot on tetris boards of %1 columns at most")
+                                  .arg(TetrisBatchEngine::MAX_WIDTH));
+        return error;
+    }
+    if(options_.mega && (!is_tetris || options_.bot != RandomSimBot || options_.batch > 0)){
+        QJsonObject error;
+        error.insert("error", "the mega boards are only played by the random bot, one at a time");
+        return error;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if(options_.processes > 0){
+        if(!runProcesses()){
+            QJsonObject error;
+            error.insert("error", "the worker processes could not play all the games");
+            return error;
+        }
+        return report(timer.nsecsElapsed());
+    }
+
+    std::atomic<int> next_game(0);
+    int num_threads = options_.threads > 0 ? options_.threads : int(std::thread::hardware_concurrency());
+    num_threads = std::max(1, std::min(num_threads, options_.games));
+    std::vector<std::thread> threads;
+    for(int i = 1; i < num_threads; ++i)
+        threads.emplace_back(&ArcadeSim::work, this, std::ref(next_game));
+    work(next_game);
+    for(std::thread &thread : threads)
+        thread.join();
+
+    return report(timer.nsecsElapsed());
+}
+
+/**
+ * @brief Plays games until the counter runs out, with bots and engines of its own.
+ *
+ * @param next_game Index of the next game to play, shared by the threads or processes.
+ */
+void ArcadeSim::work(std::atomic<int> &next_game)
+{
+    if(options_.batch > 0){
+        playTetrisBatch(next_game);
+        return;
+    }
+
+    const bool is_tetris = options_.game == TetrisSimGame;
+    std::unique_ptr<TetrisAi> ai;
+    std::unique_ptr<TetrisBeamSearch> beam_search;
+    std::unique_ptr<TicTacToeEngine> tictactoe;
+    if(options_.bot == GreedySimBot){
+        ai = std::make_unique<TetrisAi>();
+    }else if(options_.bot == BeamSimBot){
+        TetrisBeamOptions beam_options;
+        beam_options.threads = 1; // the games already use all the cores
+        beam_search = std::make_unique<TetrisBeamSearch>(beam_options);
+    }else if(!is_tetris){
+        tictactoe = std::make_unique<TicTacToeEngine>();
+    }
+
+    for(int game = next_game.fetch_add(1); game < options_.games; game = next_game.fetch_add(1)){
+        const quint64 seed = options_.first_seed + game;
+        if(!is_tetris)
+            record(game, playTicTacToe(*tictactoe, options_.bot, options_.opponent, seed));
+        else if(options_.mega)
+            record(game, playTetrisMega(seed, options_));
+        else
+            record(game, playTetris(ai.get(), beam_search.get(), seed, options_));
+    }
+}
+
+#ifdef Q_OS_UNIX
+
+// State of a multi-process run, in an anonymous shared mapping made before the
+// fork: the game counter, and a ring of result records the workers push to and
+// this process drains (a bounded queue with a sequence number per slot, safe
+// for any number of writers and one reader).
+struct ArcadeSim::Shared
+{
+    static constexpr quint64 RING_SIZE = 4096;
+
+    struct Record
+    {
+        std::atomic<quint64> sequence;  // index + 1 once written, index + RING_SIZE once read
+        int game;
+        ArcadeSimResult result;
+    };
+
+    alignas(64) std::atomic<int> next_game;
+    alignas(64) std::atomic<quint64> write_index;  // next slot claimed by a worker
+    alignas(64) Record records[RING_SIZE];
+};
+
+/**
+ * @brief Plays all the games with options_.processes forked worker processes.
+ *
+ * Every worker is pinned to a core of those this process may use (Linux), plays
+ * on one thread with the shared game counter and pushes its results to the ring,
+ * which this process drains into results_ as they come. Results do not depend on
+ * the number of processes.
+ *
+ * @return false if a worker was killed or failed before all the results came.
+ */
+bool ArcadeSim::runProcesses()
+{
+    void *memory = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(memory == MAP_FAILED)
+        return false;
+    Shared *shared = new (memory) Shared;
+    shared->next_game.store(0);
+    shared->write_index.store(0);
+    for(quint64 i = 0; i < Shared::RING_SIZE; ++i)
+        shared->records[i].sequence.store(i);
+
+    std::vector<int> cpus;
+#ifdef Q_OS_LINUX
+    cpu_set_t allowed;
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) == 0){
+        for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu){
+            if(CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+        }
+    }
+#endif
+
+    const int num_processes = std::max(1, std::min(options_.processes, options_.games));
+    std::vector<pid_t> workers;
+    for(int i = 0; i < num_processes; ++i){
+        const pid_t pid = fork();
+        if(pid == 0){
+#ifdef Q_OS_LINUX
+            if(!cpus.empty()){
+                cpu_set_t cpu;
+                CPU_ZERO(&cpu);
+                CPU_SET(cpus[i % cpus.size()], &cpu);
+                sched_setaffinity(0, sizeof(cpu), &cpu);
+            }
+#endif
+            shared_ = shared;
+            work(shared->next_game);
+            _exit(0);
+        }
+        if(pid > 0)
+            workers.push_back(pid);
+    }
+
+    // Drains the ring until every game is in, or no worker is left to send one
+    int received = 0;
+    quint64 read_index = 0;
+    bool is_failed = workers.empty() && options_.games > 0;
+    while(received < options_.games && !is_failed){
+        Shared::Record &record = shared->records[read_index % Shared::RING_SIZE];
+        if(record.sequence.load(std::memory_order_acquire) == read_index + 1){
+            results_[record.game] = record.result;
+            record.sequence.store(read_index + Shared::RING_SIZE, std::memory_order_release);
+            ++read_index;
+            ++received;
+            continue;
+        }
+
+        // Nothing to read: checks that some worker may still send a result
+        bool is_running = false;
+        for(auto worker = workers.begin(); worker != workers.end();){
+            int status;
+            const pid_t pid = waitpid(*worker, &status, WNOHANG);
+            if(pid == 0){
+                is_running = true;
+                ++worker;
+                continue;
+            }
+            is_failed = is_failed || pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+            worker = workers.erase(worker);
+        }
+        if(is_running)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        else if(record.sequence.load(std::memory_order_acquire) != read_index + 1)
+            is_failed = true;   // every worker is done and the ring is empty
+    }
+
+    for(pid_t pid : workers){
+        if(is_failed)
+            kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+    shared->~Shared();
+    munmap(memory, sizeof(Shared));
+    return !is_failed;
+}
+
+#else
+
+struct ArcadeSim::Shared
+{
+};
+
+/**
+ * @brief Worker processes need fork(): not available on this system.
+ *
+ * @return false.
+ */
+bool ArcadeSim::runProcesses()
+{
+    return false;
+}
+
+#endif
+
+/**
+ * @brief Stores the result of a game, or pushes it to the ring of the coordinator
+ * in a worker process.
+ *
+ * @param game Index of the game.
+ * @param result Its result.
+ */
+void ArcadeSim::record(int game, const ArcadeSimResult &result)
+{
+#ifdef Q_OS_UNIX
+    if(shared_){
+        // Claims the next slot, waiting for the coordinator if the ring is full
+        quint64 index = shared_->write_index.load(std::memory_order_relaxed);
+        for(;;){
+            Shared::Record &record = shared_->records[index % Shared::RING_SIZE];
+            const qint64 lag = qint64(record.sequence.load(std::memory_order_acquire) - index);
+            if(lag == 0){
+                if(shared_->write_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)){
+                    record.game = game;
+                    record.result = result;
+                    record.sequence.store(index + 1, std::memory_order_release);
+                    return;
+                }
+            }else{
+                if(lag < 0)
+                    std::this_thread::yield();
+                index = shared_->write_index.load(std::memory_order_relaxed);
+            }
+        }
+    }
+#endif
+    results_[game] = result;
+}
+
+/**
+ * @brief Plays one Tetris game with a bot.
+ *
+ * The path to every placement is given to the engine in one tick, as the AI
+ * controller of the board does. The random bot rotates right, then moves to its
+ * column: the inputs TetrisBatchEngine plays for a TetrisBatchMove.
+ *
+ * @param ai The greedy AI, or null to play with the beam search.
+ * @param beam_search The beam search, used if ai is null; the random bot plays if both are null.
+ * @param seed The seed of the game.
+ * @param options The rules and the number of pieces.
+ * @return The score, the lines and the pieces of the game.
+ */
+ArcadeSimResult ArcadeSim::playTetris(TetrisAi *ai, TetrisBeamSearch *beam_search, quint64 seed,
+                                      const ArcadeSimOptions &options)
+{
+    TetrisEngine engine(options.rules);
+    engine.start(seed);
+
+    TetrisEngineState state;
+    TetrisPlacement placement;
+    TetrisRandom random_bot(seed ^ RANDOM_BOT_SALT);
+    std::vector<TetrisAction> path;
+    std::vector<TetrisInput> inputs;
+    while(!engine.isLost() && (options.max_pieces <= 0 || engine.piecesDropped() < options.max_pieces)){
+        bool is_found = true;
+        if(ai){
+            is_found = ai->choose(engine, placement, path);
+        }else if(beam_search){
+            engine.saveState(state);
+            is_found = beam_search->choose(state, placement, path);
+        }else{
+            const TetrisBatchMove move = randomMove(random_bot, engine.width());
+            const int dx = move.x - engine.currentX();
+            path.assign(move.rotation, RotateRight);
+            path.insert(path.end(), std::abs(dx), dx < 0 ? MoveLeft : MoveRight);
+            path.push_back(HardDrop);
+        }
+        if(!is_found)
+            break;
+
+        inputs.clear();
+        for(TetrisAction action : path)
+            inputs.push_back(TetrisInput{0, action});
+        engine.step(inputs.data(), int(inputs.size()));
+    }
+
+    ArcadeSimResult result;
+    result.score = engine.score();
+    result.lines = engine.linesRemoved();
+    result.moves = engine.piecesDropped();
+    result.hash = engine.stateHash();
+    return result;
+}
+
+/**
+ * @brief Plays Tetris games with the random bot, options_.batch boards at a time.
+ *
+ * A board done with its game starts the next game of the counter, so the threads
+ * share the games as they do one board at a time. Every game plays as in
+ * playTetris(): the same seed gives the same result.
+ *
+ * @param next_game Index of the next game to play, shared by the threads.
+ */
+void ArcadeSim::playTetrisBatch(std::atomic<int> &next_game)
+{
+    const int size = options_.batch;
+    TetrisBatchEngine engine(options_.rules, size);
+    std::vector<TetrisBatchMove> moves(size, TetrisBatchMove{0, 0});
+    std::vector<TetrisRandom> random_bots(size);
+    std::vector<int> games(size, -1);
+
+    int running = 0;
+    auto startGame = [&](int board){
+        const int game = next_game.fetch_add(1);
+        if(game >= options_.games){
+            engine.stop(board);
+            games[board] = -1;
+            return;
+        }
+        const quint64 seed = options_.first_seed + game;
+        engine.start(board, seed);
+        random_bots[board].setSeed(seed ^ RANDOM_BOT_SALT);
+        games[board] = game;
+        ++running;
+    };
+    for(int board = 0; board < size; ++board)
+        startGame(board);
+
+    while(running > 0){
+        for(int board = 0; board < size; ++board){
+            if(games[board] >= 0)
+                moves[board] = randomMove(random_bots[board], engine.width());
+        }
+        engine.step(moves.data());
+
+        for(int board = 0; board < size; ++board){
+            if(games[board] < 0 || (!engine.isLost(board)
+                                     && (options_.max_pieces <= 0 || engine.piecesDropped(board) < options_.max_pieces)))
+                continue;
+            ArcadeSimResult result;
+            result.score = engine.score(board);
+            result.lines = engine.linesRemoved(board);
+            result.moves = engine.piecesDropped(board);
+            result.hash = engine.stateHash(board);
+            record(games[board], result);
+            --running;
+            startGame(board);
+        }
+    }
+}
+
+/**
+ * @brief Plays one Tetris game with the random bot on a TetrisMegaEngine.
+ *
+ * Same moves as the random bot of playTetris(): on a board TetrisEngine can hold,
+ * the same seed gives the same score, lines and pieces.
+ *
+ * @param seed The seed of the game.
+ * @param options The rules and the number of pieces.
+ * @return The score, the lines and the pieces of the game; no state hash.
+ */
+ArcadeSimResult ArcadeSim::playTetrisMega(quint64 seed, const ArcadeSimOptions &options)
+{
+    TetrisMegaEngine engine(options.rules);
+    engine.start(seed);
+
+    TetrisRandom random_bot(seed ^ RANDOM_BOT_SALT);
+    std::vector<TetrisInput> inputs;
+    while(!engine.isLost() && (options.max_pieces <= 0 || engine.piecesDropped() < options.max_pieces)){
+        const TetrisBatchMove move = randomMove(random_bot, engine.width());
+        const int dx = move.x - engine.currentX();
+        inputs.assign(move.rotation, TetrisInput{0, RotateRight});
+        inputs.insert(inputs.end(), std::abs(dx), TetrisInput{0, dx < 0 ? MoveLeft : MoveRight});
+        inputs.push_back(TetrisInput{0, HardDrop});
+        engine.step(inputs.data(), int(inputs.size()));
+    }
+
+    ArcadeSimResult result;
+    result.score = engine.score();
+    result.lines = engine.linesRemoved();
+    result.moves = engine.piecesDropped();
+    return result;
+}
+
+/**
+ * @brief Plays one Tic-Tac-Toe game between two bots.
+ *
+ * The first player changes from a seed to the next, as it changes from a game to
+ * the next in the GUI. The easy bots start with a random move.
+ *
+ * @param engine The engine, reset and seeded here.
+ * @param bot The bot playing 'X'.
+ * @param opponent The bot playing 'O'.
+ * @param seed The seed of the game.
+ * @return The winner and the number of spots played.
+ */
+ArcadeSimResult ArcadeSim::playTicTacToe(TicTacToeEngine &engine, ArcadeSimBot bot, ArcadeSimBot opponent,
+                                         quint64 seed)
+{
+    engine.reset();
+    engine.setSeed(seed);
+
+    char player = seed % 2 ? 'O' : 'X';
+    bool is_random[2] = {true, true}; // next move of an easy bot, per player
+    ArcadeSimResult result;
+    for(;;){
+        const ArcadeSimBot current = player == 'X' ? bot : opponent;
+        bool &is_easy_random = is_random[player == 'X' ? 0 : 1];
+
+        int spot;
+        if(current == RandomSimBot || (current == EasySimBot && is_easy_random))
+            spot = engine.randomMove();
+        else
+            spot = engine.mediumMove(player);
+        is_easy_random = !is_easy_random;
+
+        engine.play(spot, player);
+        ++result.moves;
+
+        const gameState state = engine.state(player);
+        if(state == gameState::won){
+            result.score = player == 'X' ? 1 : -1;
+            break;
+        }
+        if(state != gameState::playing)
+            break;
+        player = TicTacToeEngine::opponent(player);
+    }
+    result.hash = engine.stateHash();
+    return result;
+}
+
+/**
+ * @brief Builds the report of the last run.
+ *
+ * @param elapsed_ns Wall time of the run.
+ * @return The options, the throughput and the distributions of the results.
+ */
+QJsonObject ArcadeSim::report(qint64 elapsed_ns) const
+{
+    const double seconds = std::max<qint64>(1, elapsed_ns) / 1e9;
+    const bool is_tetris = options_.game == TetrisSimGame;
+
+    std::vector<double> scores, lines, moves;
+    qint64 total_moves = 0;
+    quint64 fingerprint = 0;    // of the final states of all the games, in order
+    int wins = 0, losses = 0, draws = 0;
+    for(const ArcadeSimResult &result : results_){
+        scores.push_back(result.score);
+        lines.push_back(result.lines);
+        moves.push_back(result.moves);
+        total_moves += result.moves;
+        fingerprint = (fingerprint ^ result.hash) * 0x100000001B3ULL;
+        wins += result.score > 0;
+        losses += result.score < 0;
+        draws += result.score == 0;
+    }
+
+    QJsonObject json;
+    json.insert("game", gameName(options_.game));
+    json.insert("bot", botName(options_.bot));
+    json.insert("games", options_.games);
+    // 64-bit values do not fit in a JSON number
+    json.insert("first_seed", QString::number(options_.first_seed));
+    json.insert("processes", options_.processes);
+    json.insert("elapsed_s", seconds);
+    json.insert("games_per_second", options_.games / seconds);
+    // Equal for two runs that played the same games, whatever the threads, processes or batch
+    json.insert("state_hash", QString::number(fingerprint, 16));
+
+    if(is_tetris){
+        QJsonObject rules;
+        rules.insert("width", options_.rules.width);
+        rules.insert("height", options_.rules.height);
+        rules.insert("gravity_ticks", options_.rules.gravity_ticks);
+        rules.insert("level_up_pieces", options_.rules.level_up_pieces);
+        rules.insert("level_up_score", options_.rules.level_up_score);
+        rules.insert("level_up_speedup", options_.rules.level_up_speedup);
+        json.insert("rules", rules);
+        json.insert("max_pieces", options_.max_pieces);
+        json.insert("batch", options_.batch);
+        json.insert("mega", options_.mega);
+        json.insert("pieces_per_second", total_moves / seconds);
+        json.insert("score", distribution(scores));
+        json.insert("lines", distribution(lines));
+        json.insert("pieces", distribution(moves));
+    }else{
+        json.insert("opponent", botName(options_.opponent));
+        json.insert("moves_per_second", total_moves / seconds);
+        json.insert("x_wins", wins);
+        json.insert("o_wins", losses);
+        json.insert("draws", draws);
+        json.insert("moves", distribution(moves));
+    }
+    return json;
+}
+
+/**
+ * @brief Summarises a set of values.
+ *
+ * @param values The values, one per game.
+ * @return min, max, mean, standard deviation and the 10th, 50th and 90th percentiles
+ * (nearest rank); all 0 if there is no value.
+ */
+QJsonObject ArcadeSim::distribution(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    double mean = 0.0, variance = 0.0;
+    for(double value : values)
+        mean += value / values.size();
+    for(double value : values)
+        variance += (value - mean) * (value - mean) / values.size();
+
+    auto percentile = [&](double p){
+        if(values.empty())
+            return 0.0;
+        const size_t rank = size_t(std::ceil(p * values.size()));
+        return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+    };
+
+    QJsonObject json;
+    json.insert("min", values.empty() ? 0.0 : values.front());
+    json.insert("max", values.empty() ? 0.0 : values.back());
+    json.insert("mean", mean);
+    json.insert("stddev", std::sqrt(variance));
+    json.insert("p10", percentile(0.10));
+    json.insert("p50", percentile(0.50));
+    json.insert("p90", percentile(0.90));
+    return json;
+}
+
+/**
+ * @brief Returns whether a bot plays a game.
+ *
+ * @param bot The bot.
+ * @param game The game.
+ * @return true for the Tetris bots with Tetris, the Tic-Tac-Toe bots with Tic-Tac-Toe;
+ * the random bot plays both.
+ */
+bool ArcadeSim::plays(ArcadeSimBot bot, ArcadeSimGame game)
+{
+    if(bot == RandomSimBot)
+        return true;
+    const bool is_tetris_bot = bot == GreedySimBot || bot == BeamSimBot;
+    return is_tetris_bot == (game == TetrisSimGame);
+}
+
+/**
+ * @brief Returns the command line name of a game.
+ *
+ * @param game The game.
+ * @return The name, see parseGame().
+ */
+const char *ArcadeSim::gameName(ArcadeSimGame game)
+{
+    return GAME_NAMES[game];
+}
+
+/**
+ * @brief Returns the command line name of a bot.
+ *
+ * @param bot The bot.
+ * @return The name, see parseBot().
+ */
+const char *ArcadeSim::botName(ArcadeSimBot bot)
+{
+    return BOT_NAMES[bot];
+}
+
+/**
+ * @brief Finds a game from its command line name.
+ *
+ * @param name The name, as returned by gameName().
+ * @param game Set to the game if found.
+ * @return false if there is no such game.
+ */
+bool ArcadeSim::parseGame(const QString &name, ArcadeSimGame &game)
+{
+    for(int i = 0; i < int(std::size(GAME_NAMES)); ++i){
+        if(name == GAME_NAMES[i]){
+            game = ArcadeSimGame(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Finds a bot from its command line name.
+ *
+ * @param name The name, as returned by botName().
+ * @param bot Set to the bot if found.
+ * @return false if there is no such bot.
+ */
+bool ArcadeSim::parseBot(const QString &name, ArcadeSimBot &bot)
+{
+    for(int i = 0; i < int(std::size(BOT_NAMES)); ++i){
+        if(name == BOT_NAMES[i]){
+            bot = ArcadeSimBot(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,99 @@
+#ifndef ARCADESIM_H
+#define ARCADESIM_H
+
+#include <QString>
+#include <QJsonObject>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "Tetris/tetrisai.h"
+#include "Tetris/tetrisbeamsearch.h"
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrismegaengine.h"
+#include "TicTacToe/tictactoeengine.h"
+
+enum ArcadeSimGame {
+    TetrisSimGame,
+    TicTacToeSimGame
+};
+
+enum ArcadeSimBot {
+    GreedySimBot,       // Tetris: TetrisAi, one piece at a time
+    BeamSimBot,         // Tetris: TetrisBeamSearch over the preview, one thread per game
+    RandomSimBot,       // Tetris: random rotation and column; TicTacToe: random free spot
+    EasySimBot,         // TicTacToe: gameLevel::easy
+    MediumSimBot        // TicTacToe: gameLevel::medium
+};
+
+struct ArcadeSimOptions
+{
+    ArcadeSimGame game = TetrisSimGame;
+    ArcadeSimBot bot = GreedySimBot;
+    ArcadeSimBot opponent = MediumSimBot;  // TicTacToe: bot playing 'O', `bot` plays 'X'
+    int games = 100;                        // seeds first_seed..first_seed + games - 1
+    quint64 first_seed = 1;
+    int threads = 0;                        // 0 for one per hardware thread
+    TetrisRules rules;
+    int max_pieces = 1000;                  // Tetris: a game stops after this many pieces if not lost before
+    int batch = 0;                          // Tetris random bot: boards per thread stepped together, 0 for one at a time
+    int processes = 0;                      // worker processes of one thread, each pinned to a core; 0 for threads of this process
+    bool mega = false;                      // Tetris random bot: plays on TetrisMegaEngine, boards up to TetrisSparseBoard::MAX_WIDTH x MAX_HEIGHT
+};
+
+// Outcome of one simulated game
+struct ArcadeSimResult
+{
+    int score = 0;      // Tetris: score; TicTacToe: 1 if 'X' won, -1 if 'O' won, 0 for a draw
+    int lines = 0;      // Tetris only
+    int moves = 0;      // pieces dropped or spots played
+    quint64 hash = 0;   // state hash of the engine at the end of the game, 0 on a mega board
+};
+
+// Headless game runner: plays seeded games with a bot, spread over all the
+// cores, and reports the throughput and the distribution of the results as
+// JSON. Game i always uses seed first_seed + i, so the results do not depend
+// on the number of threads and two runs can be compared game by game.
+// The random Tetris bot can also play a batch of boards per thread in lockstep
+// (see TetrisBatchEngine), with the same results game by game.
+// The games can also be played by forked worker processes (Unix only), which
+// share nothing but a game counter and a ring of results in shared memory.
+// The random Tetris bot also plays on giant sparse boards (see TetrisMegaEngine),
+// to stress the collisions and line clears.
+class ArcadeSim
+{
+public:
+    explicit ArcadeSim(const ArcadeSimOptions &options = ArcadeSimOptions());
+
+    const ArcadeSimOptions &options() const { return options_; }
+    const std::vector<ArcadeSimResult> &results() const { return results_; }
+    QJsonObject run();
+
+    static bool plays(ArcadeSimBot bot, ArcadeSimGame game);
+    static const char *gameName(ArcadeSimGame game);
+    static const char *botName(ArcadeSimBot bot);
+    static bool parseGame(const QString &name, ArcadeSimGame &game);
+    static bool parseBot(const QString &name, ArcadeSimBot &bot);
+
+private:
+    struct Shared;
+
+    void work(std::atomic<int> &next_game);
+    bool runProcesses();
+    void record(int game, const ArcadeSimResult &result);
+    static ArcadeSimResult playTetris(TetrisAi *ai, TetrisBeamSearch *beam_search, quint64 seed,
+                                      const ArcadeSimOptions &options);
+    void playTetrisBatch(std::atomic<int> &next_game);
+    static ArcadeSimResult playTetrisMega(quint64 seed, const ArcadeSimOptions &options);
+    static ArcadeSimResult playTicTacToe(TicTacToeEngine &engine, ArcadeSimBot bot, ArcadeSimBot opponent,
+                                         quint64 seed);
+    static QJsonObject distribution(std::vector<double> values);
+    QJsonObject report(qint64 elapsed_ns) const;
+
+    ArcadeSimOptions options_;
+    std::vector<ArcadeSimResult> results_;
+    Shared *shared_;    // in a worker process only: where the results go
+};
+
+#endif // ARCADESIM_H
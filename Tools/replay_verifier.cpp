@@ -0,0 +1,91 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include "Tetris/tetrisreplayverifier.h"
+
+/*
+ * Checks submitted Tetris replays by playing them again, see TetrisReplayVerifier.
+ *
+ *   replay_verifier game1.atrp game2.atrp
+ *   replay_verifier --width 14 --height 16 game1.atrp
+ *
+ * Prints the verdict and the replayed result of every file as JSON on stdout,
+ * with the throughput. The exit code is 1 if any replay is rejected. Replays
+ * must have been played with the default TetrisRules on a board of the given
+ * size: the rules a replay claims are never trusted.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("replay_verifier");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays Tetris games and checks their recorded results.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("replays", "Replay files (.atrp).", "replays...");
+
+    const TetrisRules defaults;
+    QCommandLineOption width_option("width", "Board width the games must have been played on.", "columns", QString::number(defaults.width));
+    QCommandLineOption height_option("height", "Board height the games must have been played on.", "rows", QString::number(defaults.height));
+    QCommandLineOption threads_option("threads", "Threads, 0 for all the cores.", "n", "0");
+    QCommandLineOption compact_option("compact", "Print the JSON on one line.");
+    parser.addOptions({width_option, height_option, threads_option, compact_option});
+    parser.process(app);
+
+    TetrisRules rules;
+    rules.width = parser.value(width_option).toInt();
+    rules.height = parser.value(height_option).toInt();
+
+    const QStringList paths = parser.positionalArguments();
+    std::vector<std::vector<uint8_t>> replays;
+    replays.reserve(paths.size());
+    for(const QString &path : paths){
+        QFile file(path);
+        QByteArray data;
+        if(file.open(QIODevice::ReadOnly))
+            data = file.readAll();
+        replays.emplace_back(data.begin(), data.end()); // an unreadable file is rejected as corrupt
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const std::vector<TetrisReplayVerification> verifications
+        = TetrisReplayVerifier::verifyAll(replays, rules, parser.value(threads_option).toInt());
+    const double seconds = qMax<qint64>(1, timer.nsecsElapsed()) / 1e9;
+
+    const char *const verdicts[] = {"valid", "corrupt", "state_mismatch", "result_mismatch"};
+    QJsonArray results;
+    int rejected = 0;
+    quint64 ticks = 0;
+    for(int i = 0; i < paths.size(); ++i){
+        const TetrisReplayVerification &verification = verifications[i];
+        QJsonObject result;
+        result.insert("file", paths[i]);
+        result.insert("verdict", verdicts[verification.verdict]);
+        result.insert("score", verification.score);
+        result.insert("lines", verification.lines);
+        result.insert("pieces", verification.pieces);
+        result.insert("lost", verification.is_lost);
+        if(verification.verdict == StateMismatchVerdict)
+            result.insert("mismatch_tick", double(verification.mismatch_tick));
+        results.append(result);
+        rejected += verification.verdict != ValidVerdict;
+        ticks += verification.ticks;
+    }
+
+    QJsonObject report;
+    report.insert("replays", int(paths.size()));
+    report.insert("rejected", rejected);
+    report.insert("elapsed_s", seconds);
+    report.insert("replays_per_second", paths.size() / seconds);
+    report.insert("ticks_per_second", double(ticks) / seconds);
+    report.insert("results", results);
+    QTextStream(stdout) << QJsonDocument(report).toJson(parser.isSet(compact_option) ? QJsonDocument::Compact : QJsonDocument::Indented);
+    return rejected ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+#include <cstdio>
+#include <vector>
+
+#include "Tetris/tetrisbatchengine.h"
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrismegaengine.h"
+#include "Tetris/tetrisrandom.h"
+
+/*
+ * Checks that the other engines play the games of TetrisEngine, see
+ * tetris_engine_test.pro:
+ *
+ *   tetris_engine_test
+ *
+ * Random rules, seeds and moves; the state of every game is compared with the one
+ * of a TetrisEngine after every tick. Prints every failed check and exits with 1
+ * if any failed.
+ */
+
+namespace {
+
+int failures = 0;
+
+const char *const ISA_NAMES[] = {"scalar", "sse4", "avx2"};
+
+void check(bool condition, const char *what)
+{
+    if(!condition){
+        std::printf("FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+TetrisRules randomRules(TetrisRandom &random, int max_width)
+{
+    TetrisRules rules;
+    rules.width = random.bounded(4, max_width + 1);
+    rules.height = random.bounded(4, 41);
+    rules.gravity_ticks = random.bounded(1, 61);
+    rules.soft_drop_ticks = random.bounded(1, 11);
+    rules.level_up_pieces = random.bounded(1, 31);
+    rules.level_up_score = random.bounded(1, 501);
+    rules.level_up_speedup = random.bounded(0, 101);
+    return rules;
+}
+
+// The inputs TetrisBatchEngine::step() plays for a move, see TetrisBatchMove
+void moveInputs(const TetrisBatchMove &move, int width, std::vector<TetrisInput> &inputs)
+{
+    inputs.clear();
+    for(int i = 0; i < move.rotation; ++i)
+        inputs.push_back({0, RotateRight});
+    const int spawn_x = TetrisEngine::spawnX(width);
+    for(int x = spawn_x; x != move.x; x += move.x < spawn_x ? -1 : 1)
+        inputs.push_back({0, move.x < spawn_x ? MoveLeft : MoveRight});
+    inputs.push_back({0, HardDrop});
+}
+
+bool isSameGame(const TetrisBatchEngine &batch, int board, const TetrisEngine &engine)
+{
+    if(batch.isLost(board) != engine.isLost() || batch.score(board) != engine.score()
+       || batch.linesRemoved(board) != engine.linesRemoved() || batch.piecesDropped(board) != engine.piecesDropped()
+       || batch.gravityTicks(board) != engine.gravityTicks() || batch.nextShape(board) != engine.nextPiece().shape()
+       || batch.stateHash(board) != engine.stateHash())
+        return false;
+
+    if(!engine.isLost() && (batch.currentShape(board) != engine.currentPiece().shape()
+                            || batch.currentY(board) != engine.currentY()))
+        return false;
+
+    for(int y = 0; y < engine.height(); ++y){
+        if(batch.rowBits(board, y) != engine.rowBits(y))
+            return false;
+    }
+    return true;
+}
+
+// TetrisBatchEngine, with every instruction set, against one TetrisEngine per board
+// given the inputs of each move in one tick. Lost games start again with a new seed.
+void testBatchMatchesEngine()
+{
+    TetrisRandom random(42);
+    for(int round = 0; round < 60; ++round){
+        const TetrisRules rules = randomRules(random, TetrisBatchEngine::MAX_WIDTH);
+        const int size = random.bounded(1, 21);
+        const auto isa = TetrisBatchEvaluator::Isa(round % 3);
+
+        TetrisBatchEngine batch(rules, size);
+        batch.setIsa(isa);
+        std::vector<TetrisEngine> engines(size, TetrisEngine(rules));
+        uint64_t next_seed = uint64_t(round) * 1000 + 1;
+        for(int board = 0; board < size; ++board){
+            batch.start(board, next_seed);
+            engines[board].start(next_seed++);
+        }
+
+        std::vector<TetrisBatchMove> moves(size);
+        std::vector<TetrisInput> inputs;
+        bool is_same = true;
+        for(int tick = 0; tick < 400 && is_same; ++tick){
+            for(TetrisBatchMove &move : moves){
+                move.rotation = random.bounded(0, 4);
+                move.x = random.bounded(-2, rules.width + 2);
+            }
+            batch.step(moves.data());
+
+            for(int board = 0; board < size && is_same; ++board){
+                moveInputs(moves[board], rules.width, inputs);
+                engines[board].step(inputs.data(), int(inputs.size()));
+                is_same = isSameGame(batch, board, engines[board]);
+                if(!is_same)
+                    std::printf("  %s, %dx%d board %d, tick %d\n", ISA_NAMES[isa], rules.width, rules.height,
+                                board, tick);
+
+                if(engines[board].isLost()){
+                    batch.start(board, next_seed);
+                    engines[board].start(next_seed++);
+                }
+            }
+        }
+        check(is_same, "TetrisBatchEngine plays the games of TetrisEngine");
+    }
+}
+
+bool isSameGame(const TetrisMegaEngine &mega, const TetrisEngine &engine)
+{
+    if(mega.isLost() != engine.isLost() || mega.score() != engine.score()
+       || mega.linesRemoved() != engine.linesRemoved() || mega.piecesDropped() != engine.piecesDropped()
+       || mega.gravityTicks() != engine.gravityTicks() || mega.nextPiece().shape() != engine.nextPiece().shape()
+       || mega.currentPiece().shape() != engine.currentPiece().shape() || mega.currentX() != engine.currentX()
+       || mega.currentY() != engine.currentY() || mega.currentRotation() != engine.currentRotation())
+        return false;
+
+    for(int y = 0; y < engine.height(); ++y){
+        for(int x = 0; x < engine.width(); ++x){
+            if(mega.shapeAt(x, y) != engine.shapeAt(x, y))
+                return false;
+        }
+    }
+    return true;
+}
+
+// TetrisMegaEngine against TetrisEngine on the boards both hold, with random keys:
+// moves, rotations, soft drops and sonic drops under gravity, and now and then a hard drop.
+// Lost games start again with a new seed.
+void testMegaMatchesEngine()
+{
+    TetrisRandom random(49);
+    for(int round = 0; round < 120; ++round){
+        // Half the games on narrow boards, where random keys clear lines
+        const TetrisRules rules = randomRules(random, round % 2 ? TetrisEngine::MAX_WIDTH : 6);
+        TetrisMegaEngine mega(rules);
+        TetrisEngine engine(rules);
+        uint64_t next_seed = uint64_t(round) * 1000 + 1;
+        mega.start(next_seed);
+        engine.start(next_seed++);
+
+        bool is_same = true;
+        for(int tick = 0; tick < 5000 && is_same; ++tick){
+            TetrisInput inputs[2];
+            int count = 0;
+            const int key = random.bounded(0, 12);
+            if(key < HardDrop)
+                inputs[count++] = {0, TetrisAction(key)};
+            if(random.bounded(0, 9) == 0)
+                inputs[count++] = {0, HardDrop};
+
+            mega.step(inputs, count);
+            engine.step(inputs, count);
+            is_same = isSameGame(mega, engine);
+            if(!is_same)
+                std::printf("  %dx%d board, seed %d, tick %d\n", rules.width, rules.height, int(next_seed - 1), tick);
+
+            if(engine.isLost()){
+                mega.start(next_seed);
+                engine.start(next_seed++);
+            }
+        }
+        check(is_same, "TetrisMegaEngine plays the games of TetrisEngine");
+        check(mega.board().pooledRows() <= size_t(rules.height), "TetrisMegaEngine pools at most the rows of the board");
+    }
+}
+
+// Invalid rules are replaced by the default ones, the board size is kept and clamped
+void testMegaRejectsInvalidRules()
+{
+    TetrisRules rules;
+    rules.width = 100;
+    rules.height = 1000;
+    rules.gravity_ticks = 0;
+    TetrisRules expected;
+    expected.width = 100;
+    expected.height = 1000;
+    check(TetrisMegaEngine(rules).rules() == expected, "TetrisMegaEngine replaces invalid rules");
+
+    rules = TetrisRules();
+    rules.width = TetrisSparseBoard::MAX_WIDTH + 1;
+    rules.height = TetrisSparseBoard::MAX_HEIGHT + 1;
+    const TetrisMegaEngine mega(rules);
+    check(mega.width() == TetrisSparseBoard::MAX_WIDTH && mega.height() == TetrisSparseBoard::MAX_HEIGHT,
+          "TetrisMegaEngine clamps the board size");
+}
+
+}
+
+int main()
+{
+    testBatchMatchesEngine();
+    testMegaMatchesEngine();
+    testMegaRejectsInvalidRules();
+
+    if(failures)
+        std::printf("%d check(s) failed\n", failures);
+    else
+        std::printf("All checks passed\n");
+    return failures ? 1 : 0;
+}
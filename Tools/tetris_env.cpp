@@ -0,0 +1,69 @@
+#include "Tools/tetris_env.h"
+
+#include "Tools/tetrisvectorenv.h"
+
+struct TetrisEnv
+{
+    TetrisVectorEnv env;
+};
+
+void tetris_env_default_rules(TetrisEnvRules *rules)
+{
+    const TetrisRules defaults;
+    rules->width = defaults.width;
+    rules->height = defaults.height;
+    rules->tick_ms = defaults.tick_ms;
+    rules->gravity_ticks = defaults.gravity_ticks;
+    rules->soft_drop_ticks = defaults.soft_drop_ticks;
+    rules->level_up_pieces = defaults.level_up_pieces;
+    rules->level_up_score = defaults.level_up_score;
+    rules->level_up_speedup = defaults.level_up_speedup;
+}
+
+TetrisEnv *tetris_env_create(const TetrisEnvRules *rules, int size, int queue_length, int threads)
+{
+    if(!rules || size <= 0 || queue_length < 0
+        || rules->width < 4 || rules->width > TetrisEngine::MAX_WIDTH || rules->height < 4)
+        return nullptr;
+
+    // The engine divides by the level-up steps and counts down the tick lengths
+    TetrisRules engine_rules;
+    engine_rules.width = rules->width;
+    engine_rules.height = rules->height;
+    engine_rules.tick_ms = rules->tick_ms;
+    engine_rules.gravity_ticks = rules->gravity_ticks;
+    engine_rules.soft_drop_ticks = rules->soft_drop_ticks;
+    engine_rules.level_up_pieces = rules->level_up_pieces;
+    engine_rules.level_up_score = rules->level_up_score;
+    engine_rules.level_up_speedup = rules->level_up_speedup;
+    if(!engine_rules.isValid())
+        return nullptr;
+
+    return new TetrisEnv{ TetrisVectorEnv(engine_rules, size, queue_length, threads) };
+}
+
+void tetris_env_destroy(TetrisEnv *env)
+{
+    delete env;
+}
+
+void tetris_env_set_buffers(TetrisEnv *env, const TetrisEnvBuffers *buffers)
+{
+    env->env.setBuffers(*buffers);
+}
+
+void tetris_env_reset(TetrisEnv *env, const uint64_t *seeds)
+{
+    env->env.reset(seeds);
+}
+
+void tetris_env_reset_one(TetrisEnv *env, int index, uint64_t seed)
+{
+    if(index >= 0 && index < env->env.size())
+        env->env.reset(index, seed);
+}
+
+void tetris_env_step(TetrisEnv *env, const uint8_t *actions)
+{
+    env->env.step(actions);
+}
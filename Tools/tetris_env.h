@@ -0,0 +1,103 @@
+#ifndef TETRIS_ENV_H
+#define TETRIS_ENV_H
+
+/*
+ * C API of TetrisVectorEnv, for training agents from any language with a C FFI
+ * (ctypes, cffi, ...): a batch of Tetris games stepped one engine tick at a time,
+ * in parallel, the observations written straight into buffers owned by the caller.
+ *
+ *     TetrisEnvRules rules;
+ *     tetris_env_default_rules(&rules);
+ *     TetrisEnv *env = tetris_env_create(&rules, 1024, 5, 0);
+ *     tetris_env_set_buffers(env, &buffers);
+ *     tetris_env_reset(env, seeds);
+ *     while (training)
+ *         tetris_env_step(env, actions);
+ *     tetris_env_destroy(env);
+ *
+ * A game stepped with the same seed and actions plays exactly as the Tetris game
+ * of the application given the same key per tick.
+ */
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(TETRIS_ENV_LIBRARY)
+#    define TETRIS_ENV_EXPORT __declspec(dllexport)
+#  else
+#    define TETRIS_ENV_EXPORT __declspec(dllimport)
+#  endif
+#else
+#  define TETRIS_ENV_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same fields and defaults as TetrisRules */
+typedef struct TetrisEnvRules
+{
+    int width;              /* 4 to 32 columns */
+    int height;             /* at least 4 rows */
+    int tick_ms;            /* positive */
+    int gravity_ticks;      /* positive */
+    int soft_drop_ticks;    /* positive */
+    int level_up_pieces;    /* positive */
+    int level_up_score;     /* positive */
+    int level_up_speedup;   /* 0 to 100 */
+} TetrisEnvRules;
+
+/* Actions, one per game and step: the values of TetrisAction */
+enum TetrisEnvAction {
+    TETRIS_ENV_NO_ACTION,
+    TETRIS_ENV_MOVE_LEFT,
+    TETRIS_ENV_MOVE_RIGHT,
+    TETRIS_ENV_ROTATE_LEFT,
+    TETRIS_ENV_ROTATE_RIGHT,
+    TETRIS_ENV_SOFT_DROP_ON,
+    TETRIS_ENV_SOFT_DROP_OFF,
+    TETRIS_ENV_SONIC_DROP,
+    TETRIS_ENV_HARD_DROP,
+    TETRIS_ENV_ACTION_COUNT
+};
+
+/*
+ * Observation buffers, each holding one slice per game, game i at offset i times
+ * the slice length. Written by every reset and step; a null buffer is skipped.
+ */
+typedef struct TetrisEnvBuffers
+{
+    uint32_t *board;        /* height rows, top first, bit x set if column x is filled */
+    uint8_t *queue;         /* queue_length shapes: current, next, then the upcoming ones (TetrisShape, 0 once lost) */
+    int32_t *heights;       /* width column heights, 0 for an empty column */
+    int32_t *piece;         /* 3: column, row and rotation of the current piece */
+    float *rewards;         /* 1: points scored by the step */
+    uint8_t *dones;         /* 1: 1 once the game is lost */
+} TetrisEnvBuffers;
+
+typedef struct TetrisEnv TetrisEnv;
+
+TETRIS_ENV_EXPORT void tetris_env_default_rules(TetrisEnvRules *rules);
+
+/* Null if the rules or sizes are invalid; threads 0 for one per hardware thread */
+TETRIS_ENV_EXPORT TetrisEnv *tetris_env_create(const TetrisEnvRules *rules, int size, int queue_length, int threads);
+TETRIS_ENV_EXPORT void tetris_env_destroy(TetrisEnv *env);
+
+/* The buffers must stay valid until replaced or the environment destroyed */
+TETRIS_ENV_EXPORT void tetris_env_set_buffers(TetrisEnv *env, const TetrisEnvBuffers *buffers);
+
+/* Starts every game, game i with seeds[i] */
+TETRIS_ENV_EXPORT void tetris_env_reset(TetrisEnv *env, const uint64_t *seeds);
+
+/* Starts game index again, e.g. once done */
+TETRIS_ENV_EXPORT void tetris_env_reset_one(TetrisEnv *env, int index, uint64_t seed);
+
+/* Plays one tick of every game, game i with actions[i]; lost games do not move */
+TETRIS_ENV_EXPORT void tetris_env_step(TetrisEnv *env, const uint8_t *actions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TETRIS_ENV_H */
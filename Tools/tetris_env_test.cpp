@@ -0,0 +1,241 @@
+#include <cstdio>
+#include <vector>
+
+#include "Tetris/tetrisengine.h"
+#include "Tetris/tetrisrandom.h"
+#include "Tools/tetris_env.h"
+
+/*
+ * Checks of the C API of tetris_env, see tetris_env_test.pro:
+ *
+ *   tetris_env_test
+ *
+ * Prints every failed check and exits with 1 if any failed.
+ */
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+    if(!condition){
+        std::printf("FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+// tetris_env_create() with the default rules, one field changed
+bool isCreated(int TetrisEnvRules::*field, int value)
+{
+    TetrisEnvRules rules;
+    tetris_env_default_rules(&rules);
+    rules.*field = value;
+    TetrisEnv *env = tetris_env_create(&rules, 2, 2, 1);
+    tetris_env_destroy(env);
+    return env != nullptr;
+}
+
+void testRejectsInvalidRules()
+{
+    check(isCreated(&TetrisEnvRules::width, 10), "default rules are accepted");
+
+    check(!isCreated(&TetrisEnvRules::level_up_pieces, 0), "level_up_pieces 0 is rejected");
+    check(!isCreated(&TetrisEnvRules::level_up_pieces, -1), "negative level_up_pieces is rejected");
+    check(!isCreated(&TetrisEnvRules::level_up_score, 0), "level_up_score 0 is rejected");
+    check(!isCreated(&TetrisEnvRules::level_up_score, -1), "negative level_up_score is rejected");
+    check(!isCreated(&TetrisEnvRules::gravity_ticks, 0), "gravity_ticks 0 is rejected");
+    check(!isCreated(&TetrisEnvRules::gravity_ticks, -1), "negative gravity_ticks is rejected");
+    check(!isCreated(&TetrisEnvRules::soft_drop_ticks, 0), "soft_drop_ticks 0 is rejected");
+    check(!isCreated(&TetrisEnvRules::soft_drop_ticks, -1), "negative soft_drop_ticks is rejected");
+    check(!isCreated(&TetrisEnvRules::tick_ms, 0), "tick_ms 0 is rejected");
+    check(!isCreated(&TetrisEnvRules::tick_ms, -1), "negative tick_ms is rejected");
+    check(!isCreated(&TetrisEnvRules::level_up_speedup, -1), "negative level_up_speedup is rejected");
+    check(!isCreated(&TetrisEnvRules::level_up_speedup, 101), "level_up_speedup over 100 is rejected");
+
+    check(!isCreated(&TetrisEnvRules::width, 3), "width 3 is rejected");
+    check(!isCreated(&TetrisEnvRules::width, 33), "width 33 is rejected");
+    check(!isCreated(&TetrisEnvRules::height, 3), "height 3 is rejected");
+}
+
+// Observations of every game of an environment, one step after the other
+struct Transcript
+{
+    std::vector<uint32_t> board;
+    std::vector<uint8_t> queue;
+    std::vector<int32_t> heights;
+    std::vector<int32_t> piece;
+    std::vector<float> rewards;
+    std::vector<uint8_t> dones;
+
+    void append(const TetrisEnvBuffers &buffers, const Transcript &sizes)
+    {
+        board.insert(board.end(), buffers.board, buffers.board + sizes.board.size());
+        queue.insert(queue.end(), buffers.queue, buffers.queue + sizes.queue.size());
+        heights.insert(heights.end(), buffers.heights, buffers.heights + sizes.heights.size());
+        piece.insert(piece.end(), buffers.piece, buffers.piece + sizes.piece.size());
+        rewards.insert(rewards.end(), buffers.rewards, buffers.rewards + sizes.rewards.size());
+        dones.insert(dones.end(), buffers.dones, buffers.dones + sizes.dones.size());
+    }
+
+    bool operator==(const Transcript &other) const
+    {
+        return board == other.board && queue == other.queue && heights == other.heights && piece == other.piece
+               && rewards == other.rewards && dones == other.dones;
+    }
+};
+
+// The observation of game i equals the state of a TetrisEngine given the same keys
+bool isObserved(const Transcript &buffers, int i, const TetrisEngine &engine, int score, int queue_length)
+{
+    const int width = engine.width();
+    const int height = engine.height();
+    for(int y = 0; y < height; ++y){
+        if(buffers.board[size_t(i) * height + y] != engine.rowBits(y))
+            return false;
+    }
+    for(int x = 0; x < width; ++x){
+        int column_height = 0;
+        for(int y = height - 1; y >= 0; --y){
+            if(engine.shapeAt(x, y) != NoShape)
+                column_height = height - y;
+        }
+        if(buffers.heights[size_t(i) * width + x] != column_height)
+            return false;
+    }
+
+    const uint8_t *queue = &buffers.queue[size_t(i) * queue_length];
+    const int32_t *piece = &buffers.piece[size_t(i) * 3];
+    if(engine.isLost()){
+        for(int k = 0; k < queue_length; ++k){
+            if(queue[k] != NoShape)
+                return false;
+        }
+    }else if(queue[0] != engine.currentPiece().shape() || queue[1] != engine.nextPiece().shape()
+             || piece[0] != engine.currentX() || piece[1] != engine.currentY()
+             || piece[2] != engine.currentRotation()){
+        return false;
+    }
+
+    return buffers.rewards[i] == float(engine.score() - score) && buffers.dones[i] == (engine.isLost() ? 1 : 0);
+}
+
+// Plays random keys on every game, games starting again once lost, and returns the
+// observations of every step. Each observation is compared with a TetrisEngine
+// given the same keys; with `is_checked`, the result of the comparisons is checked.
+Transcript playRandomKeys(const TetrisEnvRules &rules, int size, int queue_length, int threads, bool is_checked)
+{
+    Transcript transcript;
+    TetrisEnv *env = tetris_env_create(&rules, size, queue_length, threads);
+    check(env != nullptr, "the environment is created");
+    if(!env)
+        return transcript;
+
+    Transcript buffers;
+    buffers.board.resize(size_t(size) * rules.height);
+    buffers.queue.resize(size_t(size) * queue_length);
+    buffers.heights.resize(size_t(size) * rules.width);
+    buffers.piece.resize(size_t(size) * 3);
+    buffers.rewards.resize(size);
+    buffers.dones.resize(size);
+    const TetrisEnvBuffers pointers = {buffers.board.data(), buffers.queue.data(), buffers.heights.data(),
+                                       buffers.piece.data(), buffers.rewards.data(), buffers.dones.data()};
+    tetris_env_set_buffers(env, &pointers);
+
+    TetrisRules engine_rules;
+    engine_rules.width = rules.width;
+    engine_rules.height = rules.height;
+    engine_rules.tick_ms = rules.tick_ms;
+    engine_rules.gravity_ticks = rules.gravity_ticks;
+    engine_rules.soft_drop_ticks = rules.soft_drop_ticks;
+    engine_rules.level_up_pieces = rules.level_up_pieces;
+    engine_rules.level_up_score = rules.level_up_score;
+    engine_rules.level_up_speedup = rules.level_up_speedup;
+    std::vector<TetrisEngine> engines(size, TetrisEngine(engine_rules));
+    // Queues seen at each spawn of the current game: slot k is the piece spawned k pieces later
+    std::vector<std::vector<std::vector<uint8_t>>> spawn_queues(size);
+
+    std::vector<uint64_t> seeds(size);
+    for(int i = 0; i < size; ++i){
+        seeds[i] = uint64_t(i) + 1;
+        engines[i].start(seeds[i]);
+    }
+    tetris_env_reset(env, seeds.data());
+    transcript.append(pointers, buffers);
+
+    bool is_observed = true, is_queue_dealt = true;
+    int losses = 0, total_reward = 0;
+    uint64_t next_seed = uint64_t(size) + 1;
+    TetrisRandom random(43);
+    std::vector<uint8_t> actions(size);
+    for(int step = 0; step < 5000; ++step){
+        for(uint8_t &action : actions)
+            action = uint8_t(random.bounded(0, 3) == 0 ? TETRIS_ENV_HARD_DROP : random.bounded(0, TETRIS_ENV_ACTION_COUNT));
+        tetris_env_step(env, actions.data());
+        transcript.append(pointers, buffers);
+
+        for(int i = 0; i < size; ++i){
+            TetrisEngine &engine = engines[i];
+            const int score = engine.score();
+            const int pieces = engine.piecesDropped();
+            const TetrisInput input = {0, TetrisAction(actions[i])};
+            engine.step(&input, input.action == NoAction ? 0 : 1);
+            is_observed = is_observed && isObserved(buffers, i, engine, score, queue_length);
+            total_reward += int(buffers.rewards[i]);
+
+            std::vector<std::vector<uint8_t>> &queues = spawn_queues[i];
+            if(!engine.isLost() && (queues.empty() || engine.piecesDropped() != pieces)){
+                const uint8_t *queue = &buffers.queue[size_t(i) * queue_length];
+                queues.emplace_back(queue, queue + queue_length);
+                for(int k = 1; k < queue_length && k < int(queues.size()); ++k)
+                    is_queue_dealt = is_queue_dealt && queues[queues.size() - 1 - k][k] == queue[0];
+            }
+
+            if(buffers.dones[i]){
+                ++losses;
+                queues.clear();
+                engine.start(next_seed);
+                tetris_env_reset_one(env, i, next_seed++);
+                is_observed = is_observed && isObserved(buffers, i, engine, engine.score(), queue_length)
+                              && buffers.dones[i] == 0;
+            }
+        }
+    }
+    tetris_env_destroy(env);
+
+    if(is_checked){
+        check(is_observed, "observations and rewards are the ones of TetrisEngine given the same keys");
+        check(is_queue_dealt, "the queue holds the pieces dealt next");
+        check(losses > 0, "lost games are reported done and start again");
+        check(total_reward > 0, "the rewards count the points scored");
+    }
+    return transcript;
+}
+
+// Smallest valid level-up steps: every lock and line clear levels up
+void testPlaysWithSmallestLevelUps()
+{
+    TetrisEnvRules rules;
+    tetris_env_default_rules(&rules);
+    rules.width = 6;
+    rules.level_up_pieces = 1;
+    rules.level_up_score = 1;
+
+    const Transcript transcript = playRandomKeys(rules, 70, 4, 1, true);
+    check(playRandomKeys(rules, 70, 4, 3, false) == transcript,
+          "the same seeds and keys give the same observations on any number of threads");
+}
+
+}
+
+int main()
+{
+    testRejectsInvalidRules();
+    testPlaysWithSmallestLevelUps();
+
+    if(failures)
+        std::printf("%d check(s) failed\n", failures);
+    else
+        std::printf("All checks passed\n");
+    return failures ? 1 : 0;
+}
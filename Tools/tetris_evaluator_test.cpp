@@ -0,0 +1,165 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Tetris/tetrisbatchevaluator.h"
+#include "Tetris/tetrisrandom.h"
+
+/*
+ * Checks of TetrisBatchEvaluator against TetrisEvaluator, see tetris_evaluator_test.pro:
+ *
+ *   tetris_evaluator_test               random boards, every instruction set
+ *   tetris_evaluator_test --benchmark   also times the feature extraction
+ *
+ * Prints every failed check and exits with 1 if any failed. The instruction sets
+ * the processor does not support are run as the best one it does.
+ */
+
+namespace {
+
+int failures = 0;
+
+const char *const ISA_NAMES[] = {"scalar", "sse4", "avx2"};
+
+void check(bool condition, const char *what)
+{
+    if(!condition){
+        std::printf("FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+// Random board: empty rows above a random top, then squares of a random density,
+// never a full row (the engine clears them)
+std::vector<uint32_t> randomBoard(TetrisRandom &random, int width, int height)
+{
+    const uint32_t full = width >= 32 ? ~0u : (1u << width) - 1;
+    const int top = random.bounded(0, height + 1);
+    const int density = random.bounded(0, 101);
+
+    std::vector<uint32_t> rows(height, 0);
+    for(int y = top; y < height; ++y){
+        for(int x = 0; x < width; ++x){
+            if(random.bounded(0, 100) < density)
+                rows[y] |= 1u << x;
+        }
+        if(rows[y] == full)
+            rows[y] &= ~(1u << random.bounded(0, width));
+    }
+    return rows;
+}
+
+// The batch features of every instruction set equal the ones of TetrisEvaluator,
+// for every board size and batch sizes that leave partial blocks
+void testFeaturesMatch()
+{
+    TetrisRandom random(35);
+    for(int iteration = 0; iteration < 400; ++iteration){
+        const int width = iteration < 100 ? 10 : random.bounded(4, 33);
+        const int height = iteration < 100 ? 20 : random.bounded(4, 65);
+        const int count = random.bounded(1, 41);
+
+        std::vector<std::vector<uint32_t>> boards;
+        TetrisBoardBatch batch;
+        batch.reset(width, height);
+        for(int i = 0; i < count; ++i){
+            boards.push_back(randomBoard(random, width, height));
+            batch.add(boards.back().data());
+        }
+
+        std::vector<double> expected(size_t(NUM_TETRIS_FEATURES) * count);
+        for(int i = 0; i < count; ++i){
+            double values[NUM_TETRIS_FEATURES];
+            TetrisEvaluator::boardFeatures(boards[i].data(), width, height, values);
+            for(int f = 0; f < NUM_TETRIS_FEATURES; ++f)
+                expected[size_t(f) * count + i] = values[f];
+        }
+
+        for(int isa = TetrisBatchEvaluator::ScalarIsa; isa <= TetrisBatchEvaluator::Avx2Isa; ++isa){
+            TetrisBatchEvaluator evaluator;
+            evaluator.setIsa(TetrisBatchEvaluator::Isa(isa));
+            std::vector<int32_t> values(expected.size());
+            evaluator.boardFeatures(batch, values.data());
+
+            bool is_equal = true;
+            for(size_t i = 0; i < values.size(); ++i)
+                is_equal = is_equal && double(values[i]) == expected[i];
+            if(!is_equal)
+                std::printf("  %s, %dx%d board, batch of %d\n", ISA_NAMES[isa], width, height, count);
+            check(is_equal, "batch features equal TetrisEvaluator::boardFeatures()");
+        }
+    }
+}
+
+double elapsedNs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Time per board of the feature extraction on 10x20 boards of a game in progress:
+// TetrisEvaluator one board at a time, then the batch of every instruction set
+void benchmark()
+{
+    const int num_boards = 4096;
+    const int repeats = 200;
+    TetrisRandom random(42);
+
+    std::vector<std::vector<uint32_t>> boards;
+    TetrisBoardBatch batch;
+    batch.reset(10, 20);
+    for(int i = 0; i < num_boards; ++i){
+        std::vector<uint32_t> rows(20, 0);
+        for(int y = random.bounded(8, 18); y < 20; ++y){
+            rows[y] = random.next() & 0x3FF;
+            if(rows[y] == 0x3FF)
+                rows[y] = 0x3FE;
+        }
+        boards.push_back(rows);
+        batch.add(boards.back().data());
+    }
+
+    double sink = 0.0;
+    double values[NUM_TETRIS_FEATURES];
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < repeats; ++r){
+        for(const std::vector<uint32_t> &rows : boards){
+            TetrisEvaluator::boardFeatures(rows.data(), 10, 20, values);
+            sink += values[HolesFeature];
+        }
+    }
+    const double reference_ns = elapsedNs(start) / (double(repeats) * num_boards);
+    std::printf("TetrisEvaluator: %.1f ns/board\n", reference_ns);
+
+    std::vector<int32_t> batch_values(size_t(NUM_TETRIS_FEATURES) * num_boards);
+    for(int isa = TetrisBatchEvaluator::ScalarIsa; isa <= TetrisBatchEvaluator::Avx2Isa; ++isa){
+        TetrisBatchEvaluator evaluator;
+        evaluator.setIsa(TetrisBatchEvaluator::Isa(isa));
+        start = std::chrono::steady_clock::now();
+        for(int r = 0; r < repeats; ++r){
+            evaluator.boardFeatures(batch, batch_values.data());
+            sink += batch_values[HolesFeature * num_boards];
+        }
+        const double ns = elapsedNs(start) / (double(repeats) * num_boards);
+        std::printf("TetrisBatchEvaluator %s%s: %.1f ns/board, %.1fx\n", ISA_NAMES[isa],
+                    evaluator.isa() != isa ? " (not supported)" : "", ns, reference_ns / ns);
+    }
+
+    if(sink < 0.0)
+        std::printf("%g\n", sink);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    testFeaturesMatch();
+    if(argc > 1 && std::strcmp(argv[1], "--benchmark") == 0)
+        benchmark();
+
+    if(failures)
+        std::printf("%d check(s) failed\n", failures);
+    else
+        std::printf("All checks passed\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include <cstdio>
+
+#include "Tools/tetristuner.h"
+
+/*
+ * Headless tuner of the Tetris evaluator weights, see TetrisTuner.
+ *
+ *   tetris_tuner --generations 100 --checkpoint run.json
+ *
+ * The checkpoint is written after every generation; running the same command again
+ * resumes the run where it stopped (the options stored in the checkpoint win over
+ * the command line, except --threads).
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("tetris_tuner");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Tunes the Tetris evaluator weights with the cross-entropy method.");
+    parser.addHelpOption();
+
+    const TetrisTunerOptions defaults;
+    QCommandLineOption generations_option("generations", "Generations to run.", "n", "50");
+    QCommandLineOption population_option("population", "Candidates per generation.", "n", QString::number(defaults.population));
+    QCommandLineOption elite_option("elite", "Fraction of the candidates kept.", "fraction", QString::number(defaults.elite_fraction));
+    QCommandLineOption seeds_option("seeds", "Games per candidate.", "n", QString::number(defaults.seeds));
+    QCommandLineOption first_seed_option("first-seed", "Seed of the first game.", "seed", QString::number(defaults.first_seed));
+    QCommandLineOption pieces_option("max-pieces", "Pieces per game at most.", "n", QString::number(defaults.max_pieces));
+    QCommandLineOption width_option("width", "Board width.", "columns", QString::number(defaults.width));
+    QCommandLineOption height_option("height", "Board height.", "rows", QString::number(defaults.height));
+    QCommandLineOption threads_option("threads", "Threads, 0 for all the cores.", "n", "0");
+    QCommandLineOption random_seed_option("random-seed", "Seed of the candidate sampling.", "seed", QString::number(defaults.random_seed));
+    QCommandLineOption checkpoint_option("checkpoint", "Checkpoint file, resumed if it exists.", "path", "tetris_tuner.json");
+    QCommandLineOption restart_option("restart", "Ignore an existing checkpoint.");
+    parser.addOptions({generations_option, population_option, elite_option, seeds_option, first_seed_option,
+                       pieces_option, width_option, height_option, threads_option, random_seed_option,
+                       checkpoint_option, restart_option});
+    parser.process(app);
+
+    TetrisTunerOptions options;
+    options.population = parser.value(population_option).toInt();
+    options.elite_fraction = parser.value(elite_option).toDouble();
+    options.seeds = parser.value(seeds_option).toInt();
+    options.first_seed = parser.value(first_seed_option).toULongLong();
+    options.max_pieces = parser.value(pieces_option).toInt();
+    options.width = qBound(4, parser.value(width_option).toInt(), int(TetrisEngine::MAX_WIDTH));
+    options.height = qMax(4, parser.value(height_option).toInt());
+    options.threads = parser.value(threads_option).toInt();
+    options.random_seed = parser.value(random_seed_option).toULongLong();
+
+    QTextStream out(stdout);
+    const QString checkpoint = parser.value(checkpoint_option);
+    TetrisTuner tuner(options);
+    if(!parser.isSet(restart_option) && QFileInfo::exists(checkpoint)){
+        if(!tuner.loadCheckpoint(checkpoint)){
+            QTextStream(stderr) << "Cannot read the checkpoint " << checkpoint << Qt::endl;
+            return 1;
+        }
+        out << "Resuming " << checkpoint << " at generation " << tuner.generation() << Qt::endl;
+    }
+
+    const int last_generation = tuner.generation() + parser.value(generations_option).toInt();
+    while(tuner.generation() < last_generation){
+        TetrisTunerGeneration generation = tuner.runGeneration();
+        const double seconds = qMax<qint64>(1, generation.elapsed_ms) / 1000.0;
+        out << QString("gen %1  best %2  elite %3  mean %4  |  %5 games/s  %6 pieces/s")
+                   .arg(generation.generation, 4)
+                   .arg(generation.best_fitness, 0, 'f', 1)
+                   .arg(generation.elite_fitness, 0, 'f', 1)
+                   .arg(generation.mean_fitness, 0, 'f', 1)
+                   .arg(generation.games / seconds, 0, 'f', 0)
+                   .arg(generation.pieces / seconds, 0, 'f', 0)
+            << Qt::endl;
+
+        if(!tuner.saveCheckpoint(checkpoint))
+            QTextStream(stderr) << "Cannot write the checkpoint " << checkpoint << Qt::endl;
+    }
+
+    out << "Best weights (" << tuner.bestFitness() << " lines per game):" << Qt::endl;
+    for(int i = 0; i < NUM_TETRIS_FEATURES; ++i)
+        out << "  " << TetrisWeights::featureName(i) << " = " << QString::number(tuner.best().values[i], 'g', 17) << Qt::endl;
+    return 0;
+}
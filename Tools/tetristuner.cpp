@@ -0,0 +1,340 @@
+#include "tetristuner.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int CHECKPOINT_VERSION = 1;
+
+QJsonObject weightsToJson(const TetrisWeights &weights)
+{
+    QJsonObject json;
+    for(int i = 0; i < NUM_TETRIS_FEATURES; ++i)
+        json.insert(TetrisWeights::featureName(i), weights.values[i]);
+    return json;
+}
+
+TetrisWeights weightsFromJson(const QJsonObject &json)
+{
+    TetrisWeights weights;
+    for(int i = 0; i < NUM_TETRIS_FEATURES; ++i)
+        weights.values[i] = json.value(TetrisWeights::featureName(i)).toDouble();
+    return weights;
+}
+
+// The population needs two candidates, the evaluation one seed and the elite one candidate
+TetrisTunerOptions validOptions(TetrisTunerOptions options)
+{
+    options.population = std::max(2, options.population);
+    options.seeds = std::max(1, options.seeds);
+    options.elite_fraction = std::clamp(options.elite_fraction, 1.0 / options.population, 1.0);
+    return options;
+}
+
+} // namespace
+
+TetrisTuner::TetrisTuner(const TetrisTunerOptions &options)
+    : options_(validOptions(options))
+    , generation_(0)
+    , best_fitness_(-1.0)
+    , random_(options.random_seed)
+{
+    start(TetrisWeights::elTetris());
+}
+
+/**
+ * @brief Starts a new run around the given weights.
+ *
+ * @param weights The mean of the first generation.
+ */
+void TetrisTuner::start(const TetrisWeights &weights)
+{
+    generation_ = 0;
+    mean_ = weights;
+    best_ = weights;
+    best_fitness_ = -1.0;
+    std::fill(stddev_.values, stddev_.values + NUM_TETRIS_FEATURES, options_.initial_stddev);
+    random_.setSeed(options_.random_seed);
+}
+
+/**
+ * @brief Samples, plays and selects one generation.
+ *
+ * @return What happened in the generation.
+ */
+TetrisTunerGeneration TetrisTuner::runGeneration()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<TetrisWeights> candidates(options_.population);
+    for(TetrisWeights &candidate : candidates){
+        for(int i = 0; i < NUM_TETRIS_FEATURES; ++i)
+            candidate.values[i] = mean_.values[i] + stddev_.values[i] * gaussian();
+    }
+
+    QVector<double> fitness;
+    TetrisTunerGeneration result;
+    evaluate(candidates, fitness, result.pieces);
+
+    // Best first; equal fitness keeps the sampling order, so runs are reproducible
+    QVector<int> order(candidates.size());
+    for(int i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b){ return fitness[a] > fitness[b]; });
+
+    const int num_elite = std::max(1, int(std::lround(options_.elite_fraction * options_.population)));
+    const double noise = options_.noise * std::max(0.0, 1.0 - double(generation_) / std::max(1, options_.noise_generations));
+    for(int i = 0; i < NUM_TETRIS_FEATURES; ++i){
+        double sum = 0.0, square_sum = 0.0;
+        for(int k = 0; k < num_elite; ++k){
+            double value = candidates[order[k]].values[i];
+            sum += value;
+            square_sum += value * value;
+        }
+        double mean = sum / num_elite;
+        double variance = std::max(0.0, square_sum / num_elite - mean * mean);
+        mean_.values[i] = mean;
+        stddev_.values[i] = std::sqrt(variance + noise);
+    }
+
+    if(fitness[order[0]] > best_fitness_){
+        best_fitness_ = fitness[order[0]];
+        best_ = candidates[order[0]];
+    }
+
+    result.generation = generation_++;
+    result.best_fitness = fitness[order[0]];
+    for(int k = 0; k < fitness.size(); ++k){
+        result.mean_fitness += fitness[order[k]] / fitness.size();
+        if(k < num_elite)
+            result.elite_fitness += fitness[order[k]] / num_elite;
+    }
+    result.games = qint64(options_.population) * options_.seeds;
+    result.elapsed_ms = timer.elapsed();
+    return result;
+}
+
+/**
+ * @brief Plays every candidate on every seed, spread over the threads.
+ *
+ * Games are handed out one at a time with an atomic counter, so a thread done with
+ * short games takes the next ones. The fitness of a candidate is the mean number of
+ * lines removed in its games.
+ *
+ * @param candidates The candidate weights.
+ * @param fitness Filled with the fitness of every candidate.
+ * @param pieces Set to the pieces played in all the games.
+ */
+void TetrisTuner::evaluate(const QVector<TetrisWeights> &candidates, QVector<double> &fitness, qint64 &pieces)
+{
+    const int num_games = candidates.size() * options_.seeds;
+    std::vector<int> lines(num_games, 0);
+    std::atomic<int> next_game(0);
+    std::atomic<qint64> total_pieces(0);
+
+    auto work = [&](){
+        TetrisAi ai;
+        qint64 thread_pieces = 0;
+        for(int game = next_game.fetch_add(1); game < num_games; game = next_game.fetch_add(1)){
+            ai.evaluator().setWeights(candidates[game / options_.seeds]);
+            lines[game] = playGame(ai, options_.first_seed + game % options_.seeds, options_, thread_pieces);
+        }
+        total_pieces += thread_pieces;
+    };
+
+    int num_threads = options_.threads > 0 ? options_.threads : int(std::thread::hardware_concurrency());
+    num_threads = std::max(1, std::min(num_threads, num_games));
+    std::vector<std::thread> threads;
+    for(int i = 1; i < num_threads; ++i)
+        threads.emplace_back(work);
+    work();
+    for(std::thread &thread : threads)
+        thread.join();
+
+    fitness.fill(0.0, candidates.size());
+    for(int game = 0; game < num_games; ++game)
+        fitness[game / options_.seeds] += double(lines[game]) / options_.seeds;
+    pieces = total_pieces;
+}
+
+/**
+ * @brief Plays one game with the greedy AI.
+ *
+ * The path to every placement is given to the engine in one tick, as the AI
+ * controller of the board does.
+ *
+ * @param ai The AI, with the weights to play.
+ * @param seed The seed of the game.
+ * @param options The board size and the number of pieces.
+ * @param pieces Increased by the pieces played.
+ * @return The lines removed before the game is lost or max_pieces are played.
+ */
+int TetrisTuner::playGame(TetrisAi &ai, quint64 seed, const TetrisTunerOptions &options, qint64 &pieces)
+{
+    TetrisRules rules;
+    rules.width = options.width;
+    rules.height = options.height;
+    TetrisEngine engine(rules);
+    engine.start(seed);
+
+    TetrisPlacement placement;
+    std::vector<TetrisAction> path;
+    std::vector<TetrisInput> inputs;
+    while(!engine.isLost() && engine.piecesDropped() < options.max_pieces){
+        if(!ai.choose(engine, placement, path))
+            break;
+
+        inputs.clear();
+        for(TetrisAction action : path)
+            inputs.push_back(TetrisInput{0, action});
+        engine.step(inputs.data(), int(inputs.size()));
+    }
+
+    pieces += engine.piecesDropped();
+    return engine.linesRemoved();
+}
+
+/**
+ * @brief Scores a set of weights on the seeds of the options, on the calling thread.
+ *
+ * @param weights The weights.
+ * @param options The seeds, board size and number of pieces.
+ * @return The mean number of lines removed.
+ */
+double TetrisTuner::playGames(const TetrisWeights &weights, const TetrisTunerOptions &options)
+{
+    TetrisAi ai(weights);
+    qint64 pieces = 0;
+    double lines = 0.0;
+    for(int i = 0; i < options.seeds; ++i)
+        lines += playGame(ai, options.first_seed + i, options, pieces);
+    return lines / std::max(1, options.seeds);
+}
+
+/**
+ * @brief Returns a standard normal sample (Box-Muller) from the tuner generator.
+ *
+ * @return The sample.
+ */
+double TetrisTuner::gaussian()
+{
+    double u1 = (random_.next() + 1.0) / 4294967297.0; // never 0
+    double u2 = random_.next() / 4294967296.0;
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+}
+
+/**
+ * @brief Returns the whole tuner state: options, distribution, best weights, generator.
+ *
+ * @return The state, see fromJson().
+ */
+QJsonObject TetrisTuner::toJson() const
+{
+    QJsonObject options;
+    options.insert("population", options_.population);
+    options.insert("elite_fraction", options_.elite_fraction);
+    options.insert("seeds", options_.seeds);
+    options.insert("first_seed", QString::number(options_.first_seed));
+    options.insert("max_pieces", options_.max_pieces);
+    options.insert("width", options_.width);
+    options.insert("height", options_.height);
+    options.insert("initial_stddev", options_.initial_stddev);
+    options.insert("noise", options_.noise);
+    options.insert("noise_generations", options_.noise_generations);
+    options.insert("random_seed", QString::number(options_.random_seed));
+
+    QJsonObject json;
+    json.insert("version", CHECKPOINT_VERSION);
+    json.insert("options", options);
+    json.insert("generation", generation_);
+    json.insert("mean", weightsToJson(mean_));
+    json.insert("stddev", weightsToJson(stddev_));
+    json.insert("best", weightsToJson(best_));
+    json.insert("best_fitness", best_fitness_);
+    // 64-bit values do not fit in a JSON number
+    json.insert("random_state", QString::number(random_.state()));
+    return json;
+}
+
+/**
+ * @brief Restores a state saved by toJson().
+ *
+ * The number of threads is not part of the state: it does not change the results. The
+ * options are clamped as the constructor does.
+ *
+ * @param json The state.
+ * @return false if it is not a tuner state of a known version, the tuner is then unchanged.
+ */
+bool TetrisTuner::fromJson(const QJsonObject &json)
+{
+    if(json.value("version").toInt() != CHECKPOINT_VERSION || !json.value("options").isObject())
+        return false;
+
+    const QJsonObject options = json.value("options").toObject();
+    options_.population = options.value("population").toInt(options_.population);
+    options_.elite_fraction = options.value("elite_fraction").toDouble(options_.elite_fraction);
+    options_.seeds = options.value("seeds").toInt(options_.seeds);
+    options_.first_seed = options.value("first_seed").toString().toULongLong();
+    options_.max_pieces = options.value("max_pieces").toInt(options_.max_pieces);
+    options_.width = options.value("width").toInt(options_.width);
+    options_.height = options.value("height").toInt(options_.height);
+    options_.initial_stddev = options.value("initial_stddev").toDouble(options_.initial_stddev);
+    options_.noise = options.value("noise").toDouble(options_.noise);
+    options_.noise_generations = options.value("noise_generations").toInt(options_.noise_generations);
+    options_.random_seed = options.value("random_seed").toString().toULongLong();
+    options_ = validOptions(options_);
+
+    generation_ = json.value("generation").toInt();
+    mean_ = weightsFromJson(json.value("mean").toObject());
+    stddev_ = weightsFromJson(json.value("stddev").toObject());
+    best_ = weightsFromJson(json.value("best").toObject());
+    best_fitness_ = json.value("best_fitness").toDouble(-1.0);
+    random_.setState(json.value("random_state").toString().toULongLong());
+    return true;
+}
+
+/**
+ * @brief Writes the tuner state to a file.
+ *
+ * The file is replaced only once fully written, so an interrupted run always leaves
+ * a valid checkpoint.
+ *
+ * @param path The checkpoint file.
+ * @return false if the file cannot be written.
+ */
+bool TetrisTuner::saveCheckpoint(const QString &path) const
+{
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+
+    file.write(QJsonDocument(toJson()).toJson());
+    return file.commit();
+}
+
+/**
+ * @brief Reads the tuner state from a file written by saveCheckpoint().
+ *
+ * @param path The checkpoint file.
+ * @return false if the file cannot be read or is not a checkpoint.
+ */
+bool TetrisTuner::loadCheckpoint(const QString &path)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    return document.isObject() && fromJson(document.object());
+}
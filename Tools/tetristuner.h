@@ -0,0 +1,75 @@
+#ifndef TETRISTUNER_H
+#define TETRISTUNER_H
+
+#include <QString>
+#include <QJsonObject>
+#include <QVector>
+
+#include <cstdint>
+
+#include "Tetris/tetrisai.h"
+#include "Tetris/tetrisevaluator.h"
+#include "Tetris/tetrisrandom.h"
+
+struct TetrisTunerOptions
+{
+    int population = 64;            // candidates per generation
+    double elite_fraction = 0.25;   // best candidates the next distribution is fitted on
+    int seeds = 32;                 // games per candidate, seeds first_seed..first_seed + seeds - 1
+    quint64 first_seed = 1;
+    int max_pieces = 500;           // a game stops after this many pieces if not lost before
+    int width = 10, height = 20;
+    int threads = 0;                // 0 for one per hardware thread
+    double initial_stddev = 2.0;
+    double noise = 1.0;             // added to the variance, decreasing, against early convergence
+    int noise_generations = 50;     // generations until the added noise is 0
+    quint64 random_seed = 1;        // of the candidate sampling
+};
+
+struct TetrisTunerGeneration
+{
+    int generation = 0;
+    double best_fitness = 0.0, elite_fitness = 0.0, mean_fitness = 0.0;
+    qint64 elapsed_ms = 0;
+    qint64 games = 0, pieces = 0;
+};
+
+// Noisy cross-entropy method on the evaluator weights: every generation samples
+// candidates from a Gaussian, plays every candidate on the same seeds with the
+// greedy AI, and fits the Gaussian on the best ones. The games of a generation
+// are spread over all the cores. The state can be saved after every generation
+// and a run resumed from it with the same results.
+class TetrisTuner
+{
+public:
+    explicit TetrisTuner(const TetrisTunerOptions &options = TetrisTunerOptions());
+
+    void start(const TetrisWeights &weights);
+    TetrisTunerGeneration runGeneration();
+
+    const TetrisTunerOptions &options() const { return options_; }
+    int generation() const { return generation_; }
+    const TetrisWeights &mean() const { return mean_; }
+    const TetrisWeights &best() const { return best_; }
+    double bestFitness() const { return best_fitness_; }
+
+    QJsonObject toJson() const;
+    bool fromJson(const QJsonObject &json);
+    bool saveCheckpoint(const QString &path) const;
+    bool loadCheckpoint(const QString &path);
+
+    static double playGames(const TetrisWeights &weights, const TetrisTunerOptions &options);
+
+private:
+    static int playGame(TetrisAi &ai, quint64 seed, const TetrisTunerOptions &options, qint64 &pieces);
+    double gaussian();
+    void evaluate(const QVector<TetrisWeights> &candidates, QVector<double> &fitness, qint64 &pieces);
+
+    TetrisTunerOptions options_;
+    int generation_;
+    TetrisWeights mean_, stddev_, best_;
+    double best_fitness_;
+    TetrisRandom random_;
+};
+
+#endif // TETRISTUNER_H
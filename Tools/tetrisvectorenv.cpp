@@ -0,0 +1,204 @@
+#include "Tools/tetrisvectorenv.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Common/bitops.h"
+
+namespace {
+
+// Games per chunk handed to a thread: enough to amortize the atomic counter,
+// few enough for the threads to share out the end of a step
+constexpr int CHUNK_SIZE = 32;
+
+}
+
+/**
+ * @brief Creates `size` games, not started, and the threads stepping them.
+ *
+ * @param rules Rules of every game.
+ * @param size Number of games.
+ * @param queue_length Shapes written per game in TetrisEnvBuffers::queue.
+ * @param threads Threads stepping the games, the calling one included; 0 for one per hardware thread.
+ */
+TetrisVectorEnv::TetrisVectorEnv(const TetrisRules &rules, int size, int queue_length, int threads)
+    : engines_(std::max(size, 0), TetrisEngine(rules))
+    , queue_length_(std::max(queue_length, 0))
+    , buffers_()
+    , shapes_(size_t(engines_.size()) * queue_length_)
+    , next_chunk_(0)
+    , generation_(0)
+    , pending_(0)
+    , is_stopping_(false)
+{
+    if(threads <= 0)
+        threads = int(std::max(std::thread::hardware_concurrency(), 1u));
+    const int num_chunks = (this->size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    threads = std::min(threads, std::max(num_chunks, 1));
+    for(int i = 1; i < threads; ++i)
+        workers_.emplace_back(&TetrisVectorEnv::work, this);
+}
+
+TetrisVectorEnv::~TetrisVectorEnv()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        is_stopping_ = true;
+    }
+    start_.notify_all();
+    for(std::thread &worker : workers_)
+        worker.join();
+}
+
+/**
+ * @brief Starts every game and writes its first observation.
+ *
+ * @param seeds One seed per game.
+ */
+void TetrisVectorEnv::reset(const uint64_t *seeds)
+{
+    run([this, seeds](int begin, int end){
+        for(int i = begin; i < end; ++i){
+            engines_[i].start(seeds[i]);
+            observe(i, 0);
+        }
+    });
+}
+
+/**
+ * @brief Starts one game again, e.g. once lost, and writes its observation.
+ */
+void TetrisVectorEnv::reset(int index, uint64_t seed)
+{
+    engines_[index].start(seed);
+    observe(index, 0);
+}
+
+/**
+ * @brief Plays one tick of every game and writes the observations.
+ *
+ * The reward of a game is the points it scored in the tick. A lost game does not
+ * move, as the engine does, until reset.
+ *
+ * @param actions One TetrisAction per game, NoAction for none; other values count as NoAction.
+ */
+void TetrisVectorEnv::step(const uint8_t *actions)
+{
+    run([this, actions](int begin, int end){
+        for(int i = begin; i < end; ++i){
+            TetrisEngine &engine = engines_[i];
+            const int score = engine.score();
+            const TetrisInput input = { 0, actions[i] <= HardDrop ? TetrisAction(actions[i]) : NoAction };
+            engine.step(&input, input.action == NoAction ? 0 : 1);
+            observe(i, engine.score() - score);
+        }
+    });
+}
+
+/**
+ * @brief Calls `job` on ranges covering all the games, over all the threads, and
+ * returns once every range is done.
+ */
+void TetrisVectorEnv::run(const std::function<void(int, int)> &job)
+{
+    if(workers_.empty()){
+        job(0, size());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = job;
+        next_chunk_.store(0, std::memory_order_relaxed);
+        pending_ = int(workers_.size());
+        ++generation_;
+    }
+    start_.notify_all();
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+/**
+ * @brief Runs the current job on the chunks no other thread took yet.
+ */
+void TetrisVectorEnv::runChunks()
+{
+    const int num_chunks = (size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    for(int chunk = next_chunk_.fetch_add(1); chunk < num_chunks; chunk = next_chunk_.fetch_add(1))
+        job_(chunk * CHUNK_SIZE, std::min(size(), (chunk + 1) * CHUNK_SIZE));
+}
+
+/**
+ * @brief Loop of a worker thread: waits for a job, takes its share of the chunks.
+ */
+void TetrisVectorEnv::work()
+{
+    uint64_t generation = 0;
+    for(;;){
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [this, generation] { return is_stopping_ || generation_ != generation; });
+            if(is_stopping_)
+                return;
+            generation = generation_;
+        }
+
+        runChunks();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(--pending_ == 0)
+            done_.notify_one();
+    }
+}
+
+/**
+ * @brief Writes the observation of one game in every buffer set.
+ *
+ * @param index Game.
+ * @param reward Points scored since the last observation.
+ */
+void TetrisVectorEnv::observe(int index, int reward)
+{
+    const TetrisEngine &engine = engines_[index];
+    const int width = engine.width();
+    const int height = engine.height();
+
+    if(buffers_.board)
+        std::memcpy(buffers_.board + size_t(index) * height, engine.rows(), sizeof(uint32_t) * height);
+
+    if(buffers_.queue && queue_length_ > 0){
+        TetrisShape *shapes = shapes_.data() + size_t(index) * queue_length_;
+        if(engine.upcomingPieces(shapes, queue_length_) == 0)
+            std::fill(shapes, shapes + queue_length_, NoShape);
+        uint8_t *queue = buffers_.queue + size_t(index) * queue_length_;
+        for(int i = 0; i < queue_length_; ++i)
+            queue[i] = uint8_t(shapes[i]);
+    }
+
+    if(buffers_.heights){
+        int32_t *heights = buffers_.heights + size_t(index) * width;
+        std::fill(heights, heights + width, 0);
+        uint32_t seen = 0;
+        const uint32_t full = width == 32 ? ~0u : (1u << width) - 1;
+        for(int y = 0; y < height && seen != full; ++y){
+            uint32_t found = engine.rowBits(y) & ~seen;
+            seen |= found;
+            for(; found; found &= found - 1)
+                heights[trailingZeros(found)] = height - y;
+        }
+    }
+
+    if(buffers_.piece){
+        int32_t *piece = buffers_.piece + size_t(index) * 3;
+        piece[0] = engine.currentX();
+        piece[1] = engine.currentY();
+        piece[2] = engine.currentRotation();
+    }
+
+    if(buffers_.rewards)
+        buffers_.rewards[index] = float(reward);
+    if(buffers_.dones)
+        buffers_.dones[index] = engine.isLost() ? 1 : 0;
+}
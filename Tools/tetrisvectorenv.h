@@ -0,0 +1,63 @@
+#ifndef TETRISVECTORENV_H
+#define TETRISVECTORENV_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Tetris/tetrisengine.h"
+#include "Tools/tetris_env.h"
+
+// Batch of Tetris games for training agents, behind the C API of tetris_env.h.
+// Every step() plays one engine tick of every game with one action, as TetrisBoard
+// plays a tick with the key pressed in it: a game replays exactly the same for the
+// same seed and actions. The observations are written straight into the buffers
+// of the caller (see TetrisEnvBuffers), and the games are split in chunks over a
+// pool of threads kept for the life of the batch; the results do not depend on
+// the number of threads.
+class TetrisVectorEnv
+{
+public:
+    explicit TetrisVectorEnv(const TetrisRules &rules, int size, int queue_length = 5, int threads = 0);
+    ~TetrisVectorEnv();
+
+    TetrisVectorEnv(const TetrisVectorEnv &) = delete;
+    TetrisVectorEnv &operator=(const TetrisVectorEnv &) = delete;
+
+    void setBuffers(const TetrisEnvBuffers &buffers){ buffers_ = buffers; }
+    void reset(const uint64_t *seeds);
+    void reset(int index, uint64_t seed);
+    void step(const uint8_t *actions);
+
+    int size() const { return int(engines_.size()); }
+    int queueLength() const { return queue_length_; }
+    int threads() const { return int(workers_.size()) + 1; }
+    const TetrisEngine &engine(int index) const { return engines_[index]; }
+
+private:
+    void run(const std::function<void(int, int)> &job);
+    void runChunks();
+    void work();
+    void observe(int index, int reward);
+
+    std::vector<TetrisEngine> engines_;
+    int queue_length_;
+    TetrisEnvBuffers buffers_;
+    std::vector<TetrisShape> shapes_;       // queue of every game before the narrowing to bytes
+
+    // Thread pool: run() hands a job to the workers and takes chunks itself too
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_, done_;
+    std::function<void(int, int)> job_;     // called with a range of games
+    std::atomic<int> next_chunk_;
+    uint64_t generation_;                   // jobs handed out so far
+    int pending_;                           // workers still on the current job
+    bool is_stopping_;
+};
+
+#endif // TETRISVECTORENV_H
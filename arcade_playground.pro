@@ -10,19 +10,77 @@ CONFIG += release
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    Common/perfcounter.cpp \
+    Common/perfoverlay.cpp \
+    Tetris/tetrisai.cpp \
+    Tetris/tetrisaicontroller.cpp \
+    Tetris/tetrisanimation.cpp \
+    Tetris/tetrisbatchevaluator.cpp \
+    Tetris/tetrisbattleview.cpp \
+    Tetris/tetrisbeamsearch.cpp \
     Tetris/tetrisboard.cpp \
+    Tetris/tetrisengine.cpp \
+    Tetris/tetrisevaluator.cpp \
+    Tetris/tetrisfinesse.cpp \
+    Tetris/tetrishintcontroller.cpp \
+    Tetris/tetrisinputqueue.cpp \
+    Tetris/tetrismegaboard.cpp \
+    Tetris/tetrismegaengine.cpp \
+    Tetris/tetrismovegenerator.cpp \
+    Tetris/tetrisperfectclear.cpp \
     Tetris/tetrispiece.cpp \
+    Tetris/tetrisreplay.cpp \
+    Tetris/tetrisreplayplayer.cpp \
+    Tetris/tetrisreplayverifier.cpp \
+    Tetris/tetrisreplaywriter.cpp \
+    Tetris/tetrisrewindbuffer.cpp \
+    Tetris/tetrissavedgame.cpp \
+    Tetris/tetrissearchpool.cpp \
+    Tetris/tetrissparseboard.cpp \
+    Tetris/tetristranspositiontable.cpp \
     Tetris/tetriswindow.cpp \
+    Tetris/tetriszobrist.cpp \
     TicTacToe/tictactoeboard.cpp \
+    TicTacToe/tictactoeengine.cpp \
     TicTacToe/tictactoewindow.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
+    Common/bitops.h \
+    Common/perfcounter.h \
+    Common/perfoverlay.h \
+    Tetris/tetrisai.h \
+    Tetris/tetrisaicontroller.h \
+    Tetris/tetrisanimation.h \
+    Tetris/tetrisbatchevaluator.h \
+    Tetris/tetrisbattleview.h \
+    Tetris/tetrisbeamsearch.h \
     Tetris/tetrisboard.h \
+    Tetris/tetrisengine.h \
+    Tetris/tetrisevaluator.h \
+    Tetris/tetrisfinesse.h \
+    Tetris/tetrishintcontroller.h \
+    Tetris/tetrisinputqueue.h \
+    Tetris/tetrismegaboard.h \
+    Tetris/tetrismegaengine.h \
+    Tetris/tetrismovegenerator.h \
+    Tetris/tetrisperfectclear.h \
     Tetris/tetrispiece.h \
+    Tetris/tetrisrandom.h \
+    Tetris/tetrisreplay.h \
+    Tetris/tetrisreplayplayer.h \
+    Tetris/tetrisreplayverifier.h \
+    Tetris/tetrisreplaywriter.h \
+    Tetris/tetrisrewindbuffer.h \
+    Tetris/tetrissavedgame.h \
+    Tetris/tetrissearchpool.h \
+    Tetris/tetrissparseboard.h \
+    Tetris/tetristranspositiontable.h \
     Tetris/tetriswindow.h \
+    Tetris/tetriszobrist.h \
     TicTacToe/tictactoeboard.h \
+    TicTacToe/tictactoeengine.h \
     TicTacToe/tictactoewindow.h \
     mainwindow.h
 
@@ -0,0 +1,51 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+CONFIG += release
+
+TARGET = arcade_sim
+
+# Headless: only the Qt-free engines and bots, see Tools/arcade_sim.cpp
+
+SOURCES += \
+    Tetris/tetrisai.cpp \
+    Tetris/tetrisbatchengine.cpp \
+    Tetris/tetrisbatchevaluator.cpp \
+    Tetris/tetrisbeamsearch.cpp \
+    Tetris/tetrisengine.cpp \
+    Tetris/tetrisevaluator.cpp \
+    Tetris/tetrismegaengine.cpp \
+    Tetris/tetrismovegenerator.cpp \
+    Tetris/tetrispiece.cpp \
+    Tetris/tetrissparseboard.cpp \
+    Tetris/tetristranspositiontable.cpp \
+    Tetris/tetriszobrist.cpp \
+    TicTacToe/tictactoeengine.cpp \
+    Tools/arcade_sim.cpp \
+    Tools/arcadesim.cpp
+
+HEADERS += \
+    Common/bitops.h \
+    Tetris/tetrisai.h \
+    Tetris/tetrisbatchengine.h \
+    Tetris/tetrisbatchevaluator.h \
+    Tetris/tetrisbeamsearch.h \
+    Tetris/tetrisengine.h \
+    Tetris/tetrisevaluator.h \
+    Tetris/tetrisinputqueue.h \
+    Tetris/tetrismegaengine.h \
+    Tetris/tetrismovegenerator.h \
+    Tetris/tetrispiece.h \
+    Tetris/tetrisrandom.h \
+    Tetris/tetrissparseboard.h \
+    Tetris/tetristranspositiontable.h \
+    Tetris/tetriszobrist.h \
+    TicTacToe/tictactoeengine.h \
+    Tools/arcadesim.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,32 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+CONFIG += release
+
+TARGET = replay_verifier
+
+# Headless: only the Qt-free engine and replay sources, see Tools/replay_verifier.cpp
+
+SOURCES += \
+    Tetris/tetrisengine.cpp \
+    Tetris/tetrispiece.cpp \
+    Tetris/tetrisreplay.cpp \
+    Tetris/tetrisreplayverifier.cpp \
+    Tetris/tetriszobrist.cpp \
+    Tools/replay_verifier.cpp
+
+HEADERS += \
+    Tetris/tetrisengine.h \
+    Tetris/tetrisinputqueue.h \
+    Tetris/tetrispiece.h \
+    Tetris/tetrisrandom.h \
+    Tetris/tetrisreplay.h \
+    Tetris/tetrisreplayverifier.h \
+    Tetris/tetriszobrist.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,32 @@
+QT       -= core gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tetris_engine_test
+
+# Checks of the other engines against TetrisEngine on random rules, run with `make check`
+
+SOURCES += \
+    Tetris/tetrisbatchengine.cpp \
+    Tetris/tetrisbatchevaluator.cpp \
+    Tetris/tetrisengine.cpp \
+    Tetris/tetrisevaluator.cpp \
+    Tetris/tetrismegaengine.cpp \
+    Tetris/tetrispiece.cpp \
+    Tetris/tetrissparseboard.cpp \
+    Tetris/tetriszobrist.cpp \
+    Tools/tetris_engine_test.cpp
+
+HEADERS += \
+    Common/bitops.h \
+    Tetris/tetrisbatchengine.h \
+    Tetris/tetrisbatchevaluator.h \
+    Tetris/tetrisengine.h \
+    Tetris/tetrisevaluator.h \
+    Tetris/tetrisinputqueue.h \
+    Tetris/tetrismegaengine.h \
+    Tetris/tetrispiece.h \
+    Tetris/tetrisrandom.h \
+    Tetris/tetrissparseboard.h \
+    Tetris/tetriszobrist.h
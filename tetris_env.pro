@@ -0,0 +1,32 @@
+QT       -= core gui
+
+TEMPLATE = lib
+CONFIG += c++17 shared
+CONFIG += release
+
+TARGET = tetris_env
+DEFINES += TETRIS_ENV_LIBRARY
+
+# Shared library for training agents: the C API of Tools/tetris_env.h over the
+# Qt-free engine, see Tools/tetrisvectorenv.h
+
+SOURCES += \
+    Tetris/tetrisengine.cpp \
+    Tetris/tetrispiece.cpp \
+    Tetris/tetriszobrist.cpp \
+    Tools/tetris_env.cpp \
+    Tools/tetrisvectorenv.cpp
+
+HEADERS += \
+    Common/bitops.h \
+    Tetris/tetrisengine.h \
+    Tetris/tetrisinputqueue.h \
+    Tetris/tetrispiece.h \
+    Tetris/tetrisrandom.h \
+    Tetris/tetriszobrist.h \
+    Tools/tetris_env.h \
+    Tools/tetrisvectorenv.h
+
+# Default rules for deployment.
+unix: target.path = /usr/local/lib
+!isEmpty(target.path): INSTALLS += target
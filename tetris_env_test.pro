@@ -0,0 +1,26 @@
+QT       -= core gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tetris_env_test
+
+# Checks of the C API of the tetris_env library, run with `make check`
+
+SOURCES += \
+    Tetris/tetrisengine.cpp \
+    Tetris/tetrispiece.cpp \
+    Tetris/tetriszobrist.cpp \
+    Tools/tetris_env.cpp \
+    Tools/tetris_env_test.cpp \
+    Tools/tetrisvectorenv.cpp
+
+HEADERS += \
+    Common/bitops.h \
+    Tetris/tetrisengine.h \
+    Tetris/tetrisinputqueue.h \
+    Tetris/tetrispiece.h \
+    Tetris/tetrisrandom.h \
+    Tetris/tetriszobrist.h \
+    Tools/tetris_env.h \
+    Tools/tetrisvectorenv.h
@@ -0,0 +1,22 @@
+QT       -= core gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tetris_evaluator_test
+
+# Checks of the SIMD board features against TetrisEvaluator, run with `make check`;
+# `tetris_evaluator_test --benchmark` also times them
+
+SOURCES += \
+    Tetris/tetrisbatchevaluator.cpp \
+    Tetris/tetrisevaluator.cpp \
+    Tetris/tetrispiece.cpp \
+    Tools/tetris_evaluator_test.cpp
+
+HEADERS += \
+    Common/bitops.h \
+    Tetris/tetrisbatchevaluator.h \
+    Tetris/tetrisevaluator.h \
+    Tetris/tetrispiece.h \
+    Tetris/tetrisrandom.h
@@ -0,0 +1,37 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+CONFIG += release
+
+TARGET = tetris_tuner
+
+# Headless: only the Qt-free engine and AI sources, see Tools/tetris_tuner.cpp
+
+SOURCES += \
+    Tetris/tetrisai.cpp \
+    Tetris/tetrisengine.cpp \
+    Tetris/tetrisevaluator.cpp \
+    Tetris/tetrismovegenerator.cpp \
+    Tetris/tetrispiece.cpp \
+    Tetris/tetriszobrist.cpp \
+    Tools/tetris_tuner.cpp \
+    Tools/tetristuner.cpp
+
+HEADERS += \
+    Common/bitops.h \
+    Tetris/tetrisai.h \
+    Tetris/tetrisengine.h \
+    Tetris/tetrisevaluator.h \
+    Tetris/tetrisinputqueue.h \
+    Tetris/tetrismovegenerator.h \
+    Tetris/tetrispiece.h \
+    Tetris/tetrisrandom.h \
+    Tetris/tetriszobrist.h \
+    Tools/tetristuner.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target